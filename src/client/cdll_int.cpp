@@ -35,6 +35,7 @@
 #include "Exports.h"
 
 #include "tri.h"
+#include "light_cache.h"
 #include "vgui_TeamFortressViewport.h"
 #include "filesystem_utils.h"
 #include "steam_utils.h"
@@ -58,6 +59,7 @@ void CL_UnloadParticleMan();
 
 void InitInput();
 void EV_HookEvents();
+void R_StudioVidInit();
 
 #ifdef HALFLIFE_JOYSTICK
 void Joy_Commands();
@@ -463,6 +465,9 @@ int HUD_VidInit()
 {
 	gHUD.VidInit();
 
+	g_LightCache.Reset();
+	R_StudioVidInit();
+
 	VGui_Startup();
 
 	return 1;
@@ -482,6 +487,7 @@ void HUD_Init()
 {
 	InitInput();
 	gHUD.Init();
+	g_LightCache.Init();
 	Scheme_Init();
 }
 
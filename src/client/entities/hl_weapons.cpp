@@ -25,6 +25,7 @@
 #include "event_api.h"
 #include "r_efx.h"
 #include "pm_shared.h"
+#include "pm_record.h"
 #include "gamemovement.h"
 
 #include "cl_dll.h"
@@ -41,6 +42,8 @@ extern int g_iObserverTarget;
 extern int g_iObserverTarget2;
 extern struct local_state_s g_finalstate;
 
+void R_StudioQueueBones(cl_entity_t* ent);
+
 static bool firstTimePredicting = false;
 
 // Pool of client side entities
@@ -454,13 +457,18 @@ void HUD_PlayerMoveInit(struct playermove_s* ppmove)
 	HUD_InitClientWeapons();
 	PM_Init(ppmove);
 	player->InstallGameMovement(new CHalfLifeMovement{ppmove, player});
+
+	client::AddCommand("cl_pm_record", PM_RecordCommand);
 }
 
 
 void HUD_PlayerMove(struct playermove_s* ppmove, int server)
 {
 	ppmove->server = 0;
+
+	PM_RecordBeginMove(ppmove);
 	player->GetGameMovement()->Move();
+	PM_RecordEndMove(ppmove);
 }
 
 
@@ -481,10 +489,11 @@ int HUD_AddEntity(int type, struct cl_entity_s* ent, const char* modelname)
 	switch (type)
 	{
 		case ET_PLAYER:
+		case ET_NORMAL:
+			R_StudioQueueBones(ent);
+			break;
 		case ET_BEAM:
 		case ET_TEMPENTITY:
-			break;
-		case ET_NORMAL:
 		case ET_FRAGMENTED:
 		default:
 			break;
@@ -19,6 +19,7 @@
 extern IParticleMan* g_pParticleMan;
 
 void Game_AddObjects();
+void R_StudioDispatchBones();
 
 extern Vector v_origin;
 
@@ -115,6 +116,9 @@ void HUD_CreateEntities()
 	Game_AddObjects();
 
 	GetClientVoiceMgr()->CreateEntities();
+
+	// Every entity is in, so their bones can be set up while the world is drawn
+	R_StudioDispatchBones();
 }
 
 
@@ -22,6 +22,8 @@
 
 #include "vgui_TeamFortressViewport.h"
 #include "filesystem_utils.h"
+#include "pm_defs.h"
+#include "pm_record.h"
 #include "steam_utils.h"
 
 
@@ -42,6 +44,7 @@ extern cvar_t* in_joystick;
 #endif
 
 void V_Init();
+void R_StudioShutdown();
 int CL_ButtonBits(bool);
 
 static int in_impulse = 0;
@@ -866,6 +869,9 @@ void HUD_Shutdown()
 {
 	ShutdownInput();
 
+	R_StudioShutdown();
+
+	PM_RecordStop();
 	FileSystem_FreeFileSystem();
 	CL_UnloadParticleMan();
 	Steam_FreeSteamAPI();
@@ -23,6 +23,7 @@
 #include "studio_util.h"
 #include "r_studioint.h"
 
+#include "studio_kernels.h"
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
 #include "Exports.h"
@@ -84,6 +85,50 @@ void R_StudioInit()
 	g_StudioRenderer.Init();
 }
 
+/*
+====================
+R_StudioVidInit
+
+====================
+*/
+void R_StudioVidInit()
+{
+	g_StudioRenderer.StudioResetBoneCache();
+}
+
+/*
+====================
+R_StudioShutdown
+
+====================
+*/
+void R_StudioShutdown()
+{
+	g_StudioRenderer.StudioShutdownBones();
+}
+
+/*
+====================
+R_StudioQueueBones
+
+====================
+*/
+void R_StudioQueueBones(cl_entity_t* ent)
+{
+	g_StudioRenderer.StudioQueueBones(ent);
+}
+
+/*
+====================
+R_StudioDispatchBones
+
+====================
+*/
+void R_StudioDispatchBones()
+{
+	g_StudioRenderer.StudioDispatchBones();
+}
+
 // The simple drawing interface we'll pass back to the engine
 r_studio_interface_t studio =
 	{
@@ -20,6 +20,7 @@
 #include "studio_util.h"
 #include "r_studioint.h"
 
+#include "studio_kernels.h"
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
 
@@ -44,6 +45,10 @@ void CStudioModelRenderer::Init()
 	m_pCvarDeveloper = IEngineStudio.GetCvar("developer");
 	m_pCvarDrawEntities = IEngineStudio.GetCvar("r_drawentities");
 	m_pCvarUseTriAPI = client::RegisterVariable("gl_use_triapi", "1", FCVAR_ARCHIVE);
+	m_pCvarBoneCache = client::RegisterVariable("r_bonecache", "1", FCVAR_ARCHIVE);
+	m_pCvarBoneCacheStats = client::RegisterVariable("r_bonecache_stats", "0", 0);
+	m_pCvarStudioBatch = client::RegisterVariable("r_studio_batch", "1", FCVAR_ARCHIVE);
+	m_pCvarStudioThreads = client::RegisterVariable("r_studio_threads", "2", FCVAR_ARCHIVE);
 
 	m_pChromeSprite = IEngineStudio.GetChromeSprite();
 
@@ -85,6 +90,17 @@ CStudioModelRenderer::CStudioModelRenderer()
 	m_pRenderModel = nullptr;
 	m_pTextureHeader = nullptr;
 	m_pCvarUseTriAPI = nullptr;
+	m_pCvarBoneCache = nullptr;
+	m_pCvarBoneCacheStats = nullptr;
+	m_nBoneCacheFrame = -1;
+	m_nBoneCacheHits = 0;
+	m_nBoneCacheMisses = 0;
+	m_pCvarStudioBatch = nullptr;
+	m_nKernelChecks = 0;
+	m_flKernelMaxError = 0;
+	m_pCvarStudioThreads = nullptr;
+	m_nBoneCachePrepared = 0;
+	m_BoneScratch.resize(1);
 }
 
 /*
@@ -175,82 +191,7 @@ StudioCalcBoneQuaterion
 */
 void CStudioModelRenderer::StudioCalcBoneQuaterion(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* q)
 {
-	int j, k;
-	vec4_t q1, q2;
-	Vector angle1, angle2;
-	mstudioanimvalue_t* panimvalue;
-
-	for (j = 0; j < 3; j++)
-	{
-		if (panim->offset[j + 3] == 0)
-		{
-			angle2[j] = angle1[j] = pbone->value[j + 3]; // default;
-		}
-		else
-		{
-			panimvalue = (mstudioanimvalue_t*)((byte*)panim + panim->offset[j + 3]);
-			k = frame;
-			// DEBUG
-			if (panimvalue->num.total < panimvalue->num.valid)
-				k = 0;
-			while (panimvalue->num.total <= k)
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-				// DEBUG
-				if (panimvalue->num.total < panimvalue->num.valid)
-					k = 0;
-			}
-			// Bah, missing blend!
-			if (panimvalue->num.valid > k)
-			{
-				angle1[j] = panimvalue[k + 1].value;
-
-				if (panimvalue->num.valid > k + 1)
-				{
-					angle2[j] = panimvalue[k + 2].value;
-				}
-				else
-				{
-					if (panimvalue->num.total > k + 1)
-						angle2[j] = angle1[j];
-					else
-						angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
-				}
-			}
-			else
-			{
-				angle1[j] = panimvalue[panimvalue->num.valid].value;
-				if (panimvalue->num.total > k + 1)
-				{
-					angle2[j] = angle1[j];
-				}
-				else
-				{
-					angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
-				}
-			}
-			angle1[j] = pbone->value[j + 3] + angle1[j] * pbone->scale[j + 3];
-			angle2[j] = pbone->value[j + 3] + angle2[j] * pbone->scale[j + 3];
-		}
-
-		if (pbone->bonecontroller[j + 3] != -1)
-		{
-			angle1[j] += adj[pbone->bonecontroller[j + 3]];
-			angle2[j] += adj[pbone->bonecontroller[j + 3]];
-		}
-	}
-
-	if (angle1 != angle2)
-	{
-		AngleQuaternion(angle1, q1);
-		AngleQuaternion(angle2, q2);
-		QuaternionSlerp(q1, q2, s, q);
-	}
-	else
-	{
-		AngleQuaternion(angle1, q);
-	}
+	StudioCalcBoneQuaterionReference(frame, s, pbone, panim, adj, q);
 }
 
 /*
@@ -261,64 +202,7 @@ StudioCalcBonePosition
 */
 void CStudioModelRenderer::StudioCalcBonePosition(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* pos)
 {
-	int j, k;
-	mstudioanimvalue_t* panimvalue;
-
-	for (j = 0; j < 3; j++)
-	{
-		pos[j] = pbone->value[j]; // default;
-		if (panim->offset[j] != 0)
-		{
-			panimvalue = (mstudioanimvalue_t*)((byte*)panim + panim->offset[j]);
-			/*
-			if (i == 0 && j == 0)
-				Con_DPrintf("%d  %d:%d  %f\n", frame, panimvalue->num.valid, panimvalue->num.total, s );
-			*/
-
-			k = frame;
-			// DEBUG
-			if (panimvalue->num.total < panimvalue->num.valid)
-				k = 0;
-			// find span of values that includes the frame we want
-			while (panimvalue->num.total <= k)
-			{
-				k -= panimvalue->num.total;
-				panimvalue += panimvalue->num.valid + 1;
-				// DEBUG
-				if (panimvalue->num.total < panimvalue->num.valid)
-					k = 0;
-			}
-			// if we're inside the span
-			if (panimvalue->num.valid > k)
-			{
-				// and there's more data in the span
-				if (panimvalue->num.valid > k + 1)
-				{
-					pos[j] += (panimvalue[k + 1].value * (1.0 - s) + s * panimvalue[k + 2].value) * pbone->scale[j];
-				}
-				else
-				{
-					pos[j] += panimvalue[k + 1].value * pbone->scale[j];
-				}
-			}
-			else
-			{
-				// are we at the end of the repeating values section and there's another section with data?
-				if (panimvalue->num.total <= k + 1)
-				{
-					pos[j] += (panimvalue[panimvalue->num.valid].value * (1.0 - s) + s * panimvalue[panimvalue->num.valid + 2].value) * pbone->scale[j];
-				}
-				else
-				{
-					pos[j] += panimvalue[panimvalue->num.valid].value * pbone->scale[j];
-				}
-			}
-		}
-		if (pbone->bonecontroller[j] != -1 && adj)
-		{
-			pos[j] += adj[pbone->bonecontroller[j]];
-		}
-	}
+	StudioCalcBonePositionReference(frame, s, pbone, panim, adj, pos);
 }
 
 /*
@@ -329,28 +213,56 @@ StudioSlerpBones
 */
 void CStudioModelRenderer::StudioSlerpBones(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
 {
-	int i;
-	vec4_t q3;
-	float s1;
+	const int batch = (m_pCvarStudioBatch != nullptr) ? static_cast<int>(m_pCvarStudioBatch->value) : 0;
 
-	if (s < 0)
-		s = 0;
-	else if (s > 1.0)
-		s = 1.0;
+	const float error = StudioSlerpBonesMode(batch, q1, pos1, q2, pos2, s, m_pStudioHeader->numbones);
 
-	s1 = 1.0 - s;
+	if (batch == 2)
+	{
+		StudioReportKernelError(error);
+	}
+}
 
-	for (i = 0; i < m_pStudioHeader->numbones; i++)
+/*
+====================
+StudioSlerpBonesMode
+
+StudioSlerpBones, for any thread. Returns the largest difference
+from the original when checking the batched version.
+====================
+*/
+float CStudioModelRenderer::StudioSlerpBonesMode(int batch, vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones)
+{
+	if (batch == 0)
+	{
+		StudioSlerpBonesReference(q1, pos1, q2, pos2, s, numbones);
+		return 0;
+	}
+
+	if (batch == 2)
 	{
-		QuaternionSlerp(q1[i], q2[i], s, q3);
-		q1[i][0] = q3[0];
-		q1[i][1] = q3[1];
-		q1[i][2] = q3[2];
-		q1[i][3] = q3[3];
-		pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s;
-		pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s;
-		pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s;
+		return StudioSlerpBonesCheck(q1, pos1, q2, pos2, s, numbones);
 	}
+
+	StudioSlerpBonesBatch(q1, pos1, q2, pos2, s, numbones);
+	return 0;
+}
+
+/*
+====================
+StudioReportKernelError
+
+====================
+*/
+void CStudioModelRenderer::StudioReportKernelError(float error)
+{
+	m_nKernelChecks++;
+	m_flKernelMaxError = std::max(m_flKernelMaxError, error);
+
+	client::Con_NPrintf(21, "Studio kernels (%s): %d checks, max error %g",
+		StudioKernelsUseSSE() ? "SSE" : "scalar",
+		m_nKernelChecks,
+		m_flKernelMaxError);
 }
 
 /*
@@ -589,14 +501,38 @@ StudioCalcRotations
 ====================
 */
 void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudioseqdesc_t* pseqdesc, mstudioanim_t* panim, float f)
+{
+	float adj[MAXSTUDIOCONTROLLERS];
+
+	// add in programtic controllers
+	StudioCalcBoneAdj(StudioEstimateInterpolant(), adj, m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, m_pCurrentEntity->mouth.mouthopen);
+
+	const int batch = (m_pCvarStudioBatch != nullptr) ? static_cast<int>(m_pCvarStudioBatch->value) : 0;
+
+	const float error = StudioDecodeRotations(m_BoneScratch[0].decode, batch, m_pStudioHeader, pos, q, pseqdesc, panim, f, adj);
+
+	if (batch == 2)
+	{
+		StudioReportKernelError(error);
+	}
+}
+
+/*
+====================
+StudioDecodeRotations
+
+StudioCalcRotations, for any thread, with the controllers already worked out.
+Returns the largest difference from the original when checking the batched version.
+====================
+*/
+float CStudioModelRenderer::StudioDecodeRotations(StudioDecodeScratch& scratch, int batch, studiohdr_t* header, float pos[][3], vec4_t* q, mstudioseqdesc_t* pseqdesc, mstudioanim_t* panim, float f, float* adj)
 {
 	int i;
 	int frame;
 	mstudiobone_t* pbone;
 
 	float s;
-	float adj[MAXSTUDIOCONTROLLERS];
-	float dadt;
+	float error = 0;
 
 	if (f > pseqdesc->numframes - 1)
 	{
@@ -612,28 +548,26 @@ void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudi
 
 	frame = (int)f;
 
-	// Con_DPrintf("%d %.4f %.4f %.4f %.4f %d\n", m_pCurrentEntity->curstate.sequence, m_clTime, m_pCurrentEntity->animtime, m_pCurrentEntity->frame, f, frame );
-
-	// Con_DPrintf( "%f %f %f\n", m_pCurrentEntity->angles[ROLL], m_pCurrentEntity->angles[PITCH], m_pCurrentEntity->angles[YAW] );
-
-	// Con_DPrintf("frame %d %d\n", frame1, frame2 );
-
-
-	dadt = StudioEstimateInterpolant();
 	s = (f - frame);
 
-	// add in programtic controllers
-	pbone = (mstudiobone_t*)((byte*)m_pStudioHeader + m_pStudioHeader->boneindex);
-
-	StudioCalcBoneAdj(dadt, adj, m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, m_pCurrentEntity->mouth.mouthopen);
+	pbone = (mstudiobone_t*)((byte*)header + header->boneindex);
 
-	for (i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++)
+	if (batch == 2)
+	{
+		error = StudioDecodeBonesCheck(scratch, pbone, panim, header->numbones, frame, s, adj, pos, q);
+	}
+	else if (batch != 0)
+	{
+		StudioDecodeBones(scratch, pbone, panim, header->numbones, frame, s, adj, pos, q);
+	}
+	else
 	{
-		StudioCalcBoneQuaterion(frame, s, pbone, panim, adj, q[i]);
+		for (i = 0; i < header->numbones; i++, pbone++, panim++)
+		{
+			StudioCalcBoneQuaterion(frame, s, pbone, panim, adj, q[i]);
 
-		StudioCalcBonePosition(frame, s, pbone, panim, adj, pos[i]);
-		// if (0 && i == 0)
-		//	Con_DPrintf("%d %d %d %d\n", m_pCurrentEntity->curstate.sequence, frame, j, k );
+			StudioCalcBonePosition(frame, s, pbone, panim, adj, pos[i]);
+		}
 	}
 
 	if ((pseqdesc->motiontype & STUDIO_X) != 0)
@@ -649,20 +583,9 @@ void CStudioModelRenderer::StudioCalcRotations(float pos[][3], vec4_t* q, mstudi
 		pos[pseqdesc->motionbone][2] = 0.0;
 	}
 
-	s = 0 * ((1.0 - (f - (int)(f))) / (pseqdesc->numframes)) * m_pCurrentEntity->curstate.framerate;
+	// The linear movement once added here was always scaled by zero.
 
-	if ((pseqdesc->motiontype & STUDIO_LX) != 0)
-	{
-		pos[pseqdesc->motionbone][0] += s * pseqdesc->linearmovement[0];
-	}
-	if ((pseqdesc->motiontype & STUDIO_LY) != 0)
-	{
-		pos[pseqdesc->motionbone][1] += s * pseqdesc->linearmovement[1];
-	}
-	if ((pseqdesc->motiontype & STUDIO_LZ) != 0)
-	{
-		pos[pseqdesc->motionbone][2] += s * pseqdesc->linearmovement[2];
-	}
+	return error;
 }
 
 /*
@@ -714,187 +637,728 @@ void CStudioModelRenderer::StudioFxTransform(cl_entity_t* ent, float transform[3
 
 /*
 ====================
-StudioEstimateFrame
+StudioEstimateFrame
+
+====================
+*/
+float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t* pseqdesc)
+{
+	double dfdt, f;
+
+	if (m_fDoInterp)
+	{
+		if (m_clTime < m_pCurrentEntity->curstate.animtime)
+		{
+			dfdt = 0;
+		}
+		else
+		{
+			dfdt = (m_clTime - m_pCurrentEntity->curstate.animtime) * m_pCurrentEntity->curstate.framerate * pseqdesc->fps;
+		}
+	}
+	else
+	{
+		dfdt = 0;
+	}
+
+	if (pseqdesc->numframes <= 1)
+	{
+		f = 0;
+	}
+	else
+	{
+		f = (m_pCurrentEntity->curstate.frame * (pseqdesc->numframes - 1)) / 256.0;
+	}
+
+	f += dfdt;
+
+	if ((pseqdesc->flags & STUDIO_LOOPING) != 0)
+	{
+		if (pseqdesc->numframes > 1)
+		{
+			f -= (int)(f / (pseqdesc->numframes - 1)) * (pseqdesc->numframes - 1);
+		}
+		if (f < 0)
+		{
+			f += (pseqdesc->numframes - 1);
+		}
+	}
+	else
+	{
+		if (f >= pseqdesc->numframes - 1.001)
+		{
+			f = pseqdesc->numframes - 1.001;
+		}
+		if (f < 0.0)
+		{
+			f = 0.0;
+		}
+	}
+	return f;
+}
+
+/*
+====================
+StudioHashBonePoseKey
+
+====================
+*/
+static unsigned int StudioHashBonePoseKey(const void* key, std::size_t size)
+{
+	auto bytes = static_cast<const byte*>(key);
+	unsigned int hash = 2166136261U;
+
+	for (std::size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/*
+====================
+StudioBuildBonePoseKey
+
+Everything the pose from StudioSetupBonePose depends on.
+====================
+*/
+void CStudioModelRenderer::StudioBuildBonePoseKey(BonePoseKey& key, model_t* model, mstudioseqdesc_t* pseqdesc, float f, bool merge)
+{
+	memset(&key, 0, sizeof(key));
+
+	key.model = model;
+	key.header = m_pStudioHeader;
+	key.merge = merge;
+	key.sequence = m_pCurrentEntity->curstate.sequence;
+	key.frame = f;
+	key.prevsequence = -1;
+
+	const float dadt = StudioEstimateInterpolant();
+
+	StudioCalcBoneAdj(dadt, key.adj, m_pCurrentEntity->curstate.controller, m_pCurrentEntity->latched.prevcontroller, m_pCurrentEntity->mouth.mouthopen);
+
+	if (merge)
+	{
+		return;
+	}
+
+	if (pseqdesc->numblends > 1)
+	{
+		key.blend[0] = (m_pCurrentEntity->curstate.blending[0] * dadt + m_pCurrentEntity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
+
+		if (pseqdesc->numblends == 4)
+		{
+			key.blend[1] = (m_pCurrentEntity->curstate.blending[1] * dadt + m_pCurrentEntity->latched.prevblending[1] * (1.0 - dadt)) / 255.0;
+		}
+	}
+
+	if (m_fDoInterp &&
+		0 != m_pCurrentEntity->latched.sequencetime &&
+		(m_pCurrentEntity->latched.sequencetime + 0.2 > m_clTime) &&
+		(m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq))
+	{
+		key.prevsequence = m_pCurrentEntity->latched.prevsequence;
+		key.prevframe = m_pCurrentEntity->latched.prevframe;
+		key.prevblend[0] = (m_pCurrentEntity->latched.prevseqblending[0]) / 255.0;
+		key.prevblend[1] = (m_pCurrentEntity->latched.prevseqblending[1]) / 255.0;
+		key.prevweight = 1.0 - (m_clTime - m_pCurrentEntity->latched.sequencetime) / 0.2;
+	}
+
+	if (m_pPlayerInfo && m_pPlayerInfo->gaitsequence != 0)
+	{
+		key.gaitsequence = m_pPlayerInfo->gaitsequence;
+		key.gaitframe = m_pPlayerInfo->gaitframe;
+	}
+}
+
+/*
+====================
+StudioFindBonePose
+
+Returns the cached pose, or the entry to store it in if there isn't one.
+====================
+*/
+CStudioModelRenderer::BonePose* CStudioModelRenderer::StudioFindBonePose(const BonePoseKey& key, bool& found)
+{
+	if (m_BonePoses.empty())
+	{
+		m_BonePoses.resize(kBonePoseCacheSize);
+	}
+
+	const unsigned int hash = StudioHashBonePoseKey(&key, sizeof(key));
+
+	BonePose* oldest = nullptr;
+
+	for (auto& pose : m_BonePoses)
+	{
+		if ((pose.valid || pose.pending) && pose.hash == hash && memcmp(&pose.key, &key, sizeof(key)) == 0)
+		{
+			pose.lastFrame = m_nFrameCount;
+			found = true;
+			return &pose;
+		}
+
+		// The workers are still filling these in
+		if (pose.pending)
+		{
+			continue;
+		}
+
+		if (oldest == nullptr || !pose.valid || (oldest->valid && pose.lastFrame < oldest->lastFrame))
+		{
+			oldest = &pose;
+		}
+	}
+
+	oldest->valid = false;
+	oldest->pending = false;
+	oldest->prepared = false;
+	oldest->key = key;
+	oldest->hash = hash;
+	oldest->lastFrame = m_nFrameCount;
+
+	found = false;
+	return oldest;
+}
+
+/*
+====================
+StudioBoneCacheFrame
+
+====================
+*/
+void CStudioModelRenderer::StudioBoneCacheFrame()
+{
+	if (m_nFrameCount == m_nBoneCacheFrame)
+	{
+		return;
+	}
+
+	if (m_pCvarBoneCacheStats != nullptr && m_pCvarBoneCacheStats->value != 0)
+	{
+		const int lookups = m_nBoneCacheHits + m_nBoneCacheMisses;
+
+		client::Con_NPrintf(20, "Bone cache: %d hits (%d prepared on %d threads), %d misses (%.0f%%)",
+			m_nBoneCacheHits,
+			m_nBoneCachePrepared,
+			m_BoneJobs.GetThreadCount(),
+			m_nBoneCacheMisses,
+			(lookups != 0) ? 100.0F * m_nBoneCacheHits / lookups : 0.0F);
+	}
+
+	m_nBoneCacheFrame = m_nFrameCount;
+	m_nBoneCacheHits = 0;
+	m_nBoneCacheMisses = 0;
+	m_nBoneCachePrepared = 0;
+}
+
+/*
+====================
+StudioResetBoneCache
+
+====================
+*/
+void CStudioModelRenderer::StudioResetBoneCache()
+{
+	StudioFinishBones();
+
+	for (auto& pose : m_BonePoses)
+	{
+		pose.valid = false;
+		pose.prepared = false;
+	}
+
+	m_QueuedBoneEntities.clear();
+}
+
+/*
+====================
+StudioQueueBones
+
+The engine is adding an entity to the list of things to draw this frame.
+====================
+*/
+void CStudioModelRenderer::StudioQueueBones(cl_entity_t* ent)
+{
+	if (m_pCvarStudioThreads == nullptr || m_pCvarStudioThreads->value <= 0)
+	{
+		return;
+	}
+
+	if (ent->model == nullptr || ent->model->type != mod_studio)
+	{
+		return;
+	}
+
+	if (m_QueuedBoneEntities.size() < kMaxBoneJobs)
+	{
+		m_QueuedBoneEntities.push_back(ent);
+	}
+}
+
+/*
+====================
+StudioPredictBonePose
+
+Build the key the entity's pose will be looked up by when it's drawn,
+going through what StudioDrawModel and StudioDrawPlayer do beforehand on
+copies, so that nothing is changed. If the guess is wrong, the pose will
+just not be found.
+====================
+*/
+bool CStudioModelRenderer::StudioPredictBonePose(cl_entity_t* ent, BonePoseKey& key)
+{
+	cl_entity_t entity = *ent;
+	entity_state_t player;
+	player_info_t info;
+
+	// Drawn some other way
+	if (entity.curstate.renderfx == kRenderFxDeadPlayer || entity.curstate.movetype == MOVETYPE_FOLLOW)
+	{
+		return false;
+	}
+
+	m_pCurrentEntity = &entity;
+	m_pRenderModel = entity.model;
+	m_pPlayerInfo = nullptr;
+
+	if (entity.player)
+	{
+		m_nPlayerIndex = entity.index - 1;
+
+		if (m_nPlayerIndex < 0 || m_nPlayerIndex >= client::GetMaxClients())
+			return false;
+
+		player = *IEngineStudio.GetPlayerState(m_nPlayerIndex);
+
+		m_pRenderModel = IEngineStudio.SetupPlayerModel(m_nPlayerIndex);
+
+		if (m_pRenderModel == nullptr)
+			return false;
+	}
+
+	m_pStudioHeader = (studiohdr_t*)IEngineStudio.Mod_Extradata(m_pRenderModel);
+
+	if (m_pStudioHeader == nullptr)
+		return false;
+
+	if (entity.player)
+	{
+		info = *IEngineStudio.PlayerInfo(m_nPlayerIndex);
+		m_pPlayerInfo = &info;
+
+		if (0 != player.gaitsequence)
+		{
+			m_fFlipModel = StudioShouldFlipModel();
+
+			StudioProcessGait(&player);
+
+			info.gaitsequence = player.gaitsequence;
+		}
+		else
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				entity.curstate.controller[i] = 127;
+				entity.latched.prevcontroller[i] = 127;
+			}
+
+			info.gaitsequence = 0;
+		}
+
+		if (info.gaitsequence >= m_pStudioHeader->numseq)
+		{
+			info.gaitsequence = 0;
+		}
+	}
+
+	if (entity.curstate.sequence >= m_pStudioHeader->numseq)
+	{
+		return false;
+	}
+
+	auto pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + entity.curstate.sequence;
+
+	double f = StudioEstimateFrame(pseqdesc);
+
+	f = floor(f * kBoneCacheFrameSteps + 0.5) / kBoneCacheFrameSteps;
+
+	StudioBuildBonePoseKey(key, m_pRenderModel, pseqdesc, f, false);
+
+	return true;
+}
+
+/*
+====================
+StudioDispatchBones
 
+Set up the poses of the entities queued this frame on the workers,
+so that drawing them finds their poses in the cache.
 ====================
 */
-float CStudioModelRenderer::StudioEstimateFrame(mstudioseqdesc_t* pseqdesc)
+void CStudioModelRenderer::StudioDispatchBones()
 {
-	double dfdt, f;
+	StudioFinishBones();
 
-	if (m_fDoInterp)
+	if (m_pCvarStudioThreads == nullptr
+	 || m_pCvarStudioThreads->value <= 0
+	 || m_pCvarBoneCache == nullptr
+	 || m_pCvarBoneCache->value == 0)
 	{
-		if (m_clTime < m_pCurrentEntity->curstate.animtime)
+		m_BoneJobs.SetThreadCount(0);
+		m_QueuedBoneEntities.clear();
+		return;
+	}
+
+	m_BoneJobs.SetThreadCount(std::clamp(static_cast<int>(m_pCvarStudioThreads->value), 0, kMaxBoneThreads));
+
+	if (m_BoneScratch.size() < static_cast<std::size_t>(m_BoneJobs.GetWorkerCount()))
+	{
+		m_BoneScratch.resize(m_BoneJobs.GetWorkerCount());
+	}
+
+	if (m_QueuedBoneEntities.empty())
+	{
+		return;
+	}
+
+	// Drawing sets all of these up again, but be tidy
+	const auto saveEntity = m_pCurrentEntity;
+	const auto saveModel = m_pRenderModel;
+	const auto saveHeader = m_pStudioHeader;
+	const auto savePlayerInfo = m_pPlayerInfo;
+	const auto savePlayerIndex = m_nPlayerIndex;
+	const auto saveFlipModel = m_fFlipModel;
+	const auto saveGaitMovement = m_flGaitMovement;
+
+	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
+
+	// The frame about to be drawn
+	m_nFrameCount++;
+
+	for (auto ent : m_QueuedBoneEntities)
+	{
+		BonePoseKey key;
+		BonePoseJob job;
+
+		if (!StudioPredictBonePose(ent, key))
 		{
-			dfdt = 0;
+			continue;
 		}
-		else
+
+		if (!StudioPrepareBonePoseJob(job, key, m_pRenderModel, false))
 		{
-			dfdt = (m_clTime - m_pCurrentEntity->curstate.animtime) * m_pCurrentEntity->curstate.framerate * pseqdesc->fps;
+			continue;
+		}
+
+		bool found;
+		auto pose = StudioFindBonePose(key, found);
+
+		// Already cached, or the same as another entity's
+		if (found)
+		{
+			continue;
 		}
+
+		pose->pending = true;
+		job.pose = pose;
+
+		m_PendingBoneJobs.push_back(job);
 	}
-	else
+
+	m_QueuedBoneEntities.clear();
+
+	m_pCurrentEntity = saveEntity;
+	m_pRenderModel = saveModel;
+	m_pStudioHeader = saveHeader;
+	m_pPlayerInfo = savePlayerInfo;
+	m_nPlayerIndex = savePlayerIndex;
+	m_fFlipModel = saveFlipModel;
+	m_flGaitMovement = saveGaitMovement;
+
+	for (auto& scratch : m_BoneScratch)
 	{
-		dfdt = 0;
+		scratch.error = 0;
 	}
 
-	if (pseqdesc->numframes <= 1)
+	m_BoneJobs.Dispatch(static_cast<int>(m_PendingBoneJobs.size()), [this](int job, int worker)
+		{
+			auto& pending = m_PendingBoneJobs[job];
+
+			StudioComputeBonePose(pending, m_BoneScratch[worker], pending.pose->matrices);
+		});
+}
+
+/*
+====================
+StudioFinishBones
+
+Wait for the workers, and put what they did in the cache.
+====================
+*/
+void CStudioModelRenderer::StudioFinishBones()
+{
+	if (m_PendingBoneJobs.empty())
 	{
-		f = 0;
+		return;
 	}
-	else
+
+	m_BoneJobs.Wait();
+
+	for (auto& job : m_PendingBoneJobs)
 	{
-		f = (m_pCurrentEntity->curstate.frame * (pseqdesc->numframes - 1)) / 256.0;
+		job.pose->pending = false;
+		job.pose->valid = true;
+		job.pose->prepared = true;
 	}
 
-	f += dfdt;
-
-	if ((pseqdesc->flags & STUDIO_LOOPING) != 0)
+	if (m_PendingBoneJobs[0].batch == 2)
 	{
-		if (pseqdesc->numframes > 1)
-		{
-			f -= (int)(f / (pseqdesc->numframes - 1)) * (pseqdesc->numframes - 1);
-		}
-		if (f < 0)
+		float error = 0;
+
+		for (auto& scratch : m_BoneScratch)
 		{
-			f += (pseqdesc->numframes - 1);
+			error = std::max(error, scratch.error);
 		}
+
+		StudioReportKernelError(error);
 	}
-	else
+
+	m_PendingBoneJobs.clear();
+}
+
+/*
+====================
+StudioShutdownBones
+
+====================
+*/
+void CStudioModelRenderer::StudioShutdownBones()
+{
+	StudioFinishBones();
+
+	m_BoneJobs.Shutdown();
+}
+
+/*
+====================
+StudioPrepareBonePoseJob
+
+Find the animations for a pose. Sequence groups are only loaded if
+loadGroups is set, otherwise the job is refused if it needs one.
+====================
+*/
+bool CStudioModelRenderer::StudioPrepareBonePoseJob(BonePoseJob& job, const BonePoseKey& key, model_t* model, bool loadGroups)
+{
+	auto pseqdescs = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex);
+
+	if (!loadGroups)
 	{
-		if (f >= pseqdesc->numframes - 1.001)
-		{
-			f = pseqdesc->numframes - 1.001;
-		}
-		if (f < 0.0)
+		// Sequence groups can be thrown out of the engine's cache at any time
+		if (pseqdescs[key.sequence].seqgroup != 0
+		 || (key.prevsequence >= 0 && pseqdescs[key.prevsequence].seqgroup != 0)
+		 || (key.gaitsequence != 0 && pseqdescs[key.gaitsequence].seqgroup != 0))
 		{
-			f = 0.0;
+			return false;
 		}
 	}
-	return f;
+
+	job.key = key;
+	job.anim = StudioGetAnim(model, &pseqdescs[key.sequence]);
+	job.prevanim = (key.prevsequence >= 0) ? StudioGetAnim(model, &pseqdescs[key.prevsequence]) : nullptr;
+	job.gaitanim = (key.gaitsequence != 0) ? StudioGetAnim(model, &pseqdescs[key.gaitsequence]) : nullptr;
+	job.batch = (m_pCvarStudioBatch != nullptr) ? static_cast<int>(m_pCvarStudioBatch->value) : 0;
+	job.pose = nullptr;
+
+	return true;
 }
 
 /*
 ====================
-StudioSetupBones
+StudioComputeBonePose
 
+Work out the bone matrices, relative to their parents, for a pose.
+Only the job and the scratch space are used, so this can run on any thread.
 ====================
 */
-void CStudioModelRenderer::StudioSetupBones()
+void CStudioModelRenderer::StudioComputeBonePose(const BonePoseJob& job, BonePoseScratch& scratch, float bonematrices[][3][4])
 {
 	int i;
-	double f;
+
+	const BonePoseKey& key = job.key;
+	studiohdr_t* header = key.header;
 
 	mstudiobone_t* pbones;
 	mstudioseqdesc_t* pseqdesc;
 	mstudioanim_t* panim;
 
-	static float pos[MAXSTUDIOBONES][3];
-	static vec4_t q[MAXSTUDIOBONES];
-	float bonematrix[3][4];
-
-	static float pos2[MAXSTUDIOBONES][3];
-	static vec4_t q2[MAXSTUDIOBONES];
-	static float pos3[MAXSTUDIOBONES][3];
-	static vec4_t q3[MAXSTUDIOBONES];
-	static float pos4[MAXSTUDIOBONES][3];
-	static vec4_t q4[MAXSTUDIOBONES];
+	float adj[MAXSTUDIOCONTROLLERS];
+	memcpy(adj, key.adj, sizeof(adj));
 
-	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
+	auto calcRotations = [&](float pos[][3], vec4_t* q, mstudioanim_t* anim, float f)
 	{
-		m_pCurrentEntity->curstate.sequence = 0;
-	}
-
-	pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
+		scratch.error = std::max(scratch.error, StudioDecodeRotations(scratch.decode, job.batch, header, pos, q, pseqdesc, anim, f, adj));
+	};
 
-	f = StudioEstimateFrame(pseqdesc);
+	auto slerpBones = [&](vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s)
+	{
+		scratch.error = std::max(scratch.error, StudioSlerpBonesMode(job.batch, q1, pos1, q2, pos2, s, header->numbones));
+	};
 
-	panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-	StudioCalcRotations(pos, q, pseqdesc, panim, f);
+	pseqdesc = (mstudioseqdesc_t*)((byte*)header + header->seqindex) + key.sequence;
+	panim = job.anim;
+	calcRotations(scratch.pos, scratch.q, panim, key.frame);
 
 	if (pseqdesc->numblends > 1)
 	{
-		float s;
-		float dadt;
-
-		panim += m_pStudioHeader->numbones;
-		StudioCalcRotations(pos2, q2, pseqdesc, panim, f);
+		panim += header->numbones;
+		calcRotations(scratch.pos2, scratch.q2, panim, key.frame);
 
-		dadt = StudioEstimateInterpolant();
-		s = (m_pCurrentEntity->curstate.blending[0] * dadt + m_pCurrentEntity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
-
-		StudioSlerpBones(q, pos, q2, pos2, s);
+		slerpBones(scratch.q, scratch.pos, scratch.q2, scratch.pos2, key.blend[0]);
 
 		if (pseqdesc->numblends == 4)
 		{
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos3, q3, pseqdesc, panim, f);
-
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos4, q4, pseqdesc, panim, f);
+			panim += header->numbones;
+			calcRotations(scratch.pos3, scratch.q3, panim, key.frame);
 
-			s = (m_pCurrentEntity->curstate.blending[0] * dadt + m_pCurrentEntity->latched.prevblending[0] * (1.0 - dadt)) / 255.0;
-			StudioSlerpBones(q3, pos3, q4, pos4, s);
+			panim += header->numbones;
+			calcRotations(scratch.pos4, scratch.q4, panim, key.frame);
 
-			s = (m_pCurrentEntity->curstate.blending[1] * dadt + m_pCurrentEntity->latched.prevblending[1] * (1.0 - dadt)) / 255.0;
-			StudioSlerpBones(q, pos, q3, pos3, s);
+			slerpBones(scratch.q3, scratch.pos3, scratch.q4, scratch.pos4, key.blend[0]);
+			slerpBones(scratch.q, scratch.pos, scratch.q3, scratch.pos3, key.blend[1]);
 		}
 	}
 
-	if (m_fDoInterp &&
-		0 != m_pCurrentEntity->latched.sequencetime &&
-		(m_pCurrentEntity->latched.sequencetime + 0.2 > m_clTime) &&
-		(m_pCurrentEntity->latched.prevsequence < m_pStudioHeader->numseq))
+	if (key.prevsequence >= 0)
 	{
 		// blend from last sequence
-		static float pos1b[MAXSTUDIOBONES][3];
-		static vec4_t q1b[MAXSTUDIOBONES];
-		float s;
-
-		if (m_pCurrentEntity->latched.prevsequence >= m_pStudioHeader->numseq)
-		{
-			m_pCurrentEntity->latched.prevsequence = 0;
-		}
-
-		pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->latched.prevsequence;
-		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
+		pseqdesc = (mstudioseqdesc_t*)((byte*)header + header->seqindex) + key.prevsequence;
+		panim = job.prevanim;
 		// clip prevframe
-		StudioCalcRotations(pos1b, q1b, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+		calcRotations(scratch.pos1b, scratch.q1b, panim, key.prevframe);
 
 		if (pseqdesc->numblends > 1)
 		{
-			panim += m_pStudioHeader->numbones;
-			StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+			panim += header->numbones;
+			calcRotations(scratch.pos2, scratch.q2, panim, key.prevframe);
 
-			s = (m_pCurrentEntity->latched.prevseqblending[0]) / 255.0;
-			StudioSlerpBones(q1b, pos1b, q2, pos2, s);
+			slerpBones(scratch.q1b, scratch.pos1b, scratch.q2, scratch.pos2, key.prevblend[0]);
 
 			if (pseqdesc->numblends == 4)
 			{
-				panim += m_pStudioHeader->numbones;
-				StudioCalcRotations(pos3, q3, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+				panim += header->numbones;
+				calcRotations(scratch.pos3, scratch.q3, panim, key.prevframe);
 
-				panim += m_pStudioHeader->numbones;
-				StudioCalcRotations(pos4, q4, pseqdesc, panim, m_pCurrentEntity->latched.prevframe);
+				panim += header->numbones;
+				calcRotations(scratch.pos4, scratch.q4, panim, key.prevframe);
 
-				s = (m_pCurrentEntity->latched.prevseqblending[0]) / 255.0;
-				StudioSlerpBones(q3, pos3, q4, pos4, s);
+				slerpBones(scratch.q3, scratch.pos3, scratch.q4, scratch.pos4, key.prevblend[0]);
+				slerpBones(scratch.q1b, scratch.pos1b, scratch.q3, scratch.pos3, key.prevblend[1]);
+			}
+		}
+
+		slerpBones(scratch.q, scratch.pos, scratch.q1b, scratch.pos1b, key.prevweight);
+	}
+
+	pbones = (mstudiobone_t*)((byte*)header + header->boneindex);
+
+	// calc gait animation
+	if (key.gaitsequence != 0)
+	{
+		bool copy = true;
+
+		pseqdesc = (mstudioseqdesc_t*)((byte*)header + header->seqindex) + key.gaitsequence;
+
+		calcRotations(scratch.pos2, scratch.q2, job.gaitanim, key.gaitframe);
+
+		for (i = 0; i < header->numbones; i++)
+		{
+			auto bone = &pbones[i];
+
+			if (0 == strcmp(bone->name, "Bip01 Spine"))
+			{
+				copy = false;
+			}
+			else if (bone->parent >= 0 &&
+					 bone->parent < header->numbones &&
+					 0 == strcmp(pbones[bone->parent].name, "Bip01 Pelvis"))
+			{
+				copy = true;
+			}
 
-				s = (m_pCurrentEntity->latched.prevseqblending[1]) / 255.0;
-				StudioSlerpBones(q1b, pos1b, q3, pos3, s);
+			if (copy)
+			{
+				memcpy(scratch.pos[i], scratch.pos2[i], sizeof(scratch.pos[i]));
+				memcpy(scratch.q[i], scratch.q2[i], sizeof(scratch.q[i]));
 			}
 		}
+	}
+
+	for (i = 0; i < header->numbones; i++)
+	{
+		QuaternionMatrix(scratch.q[i], bonematrices[i]);
 
-		s = 1.0 - (m_clTime - m_pCurrentEntity->latched.sequencetime) / 0.2;
-		StudioSlerpBones(q, pos, q1b, pos1b, s);
+		bonematrices[i][0][3] = scratch.pos[i][0];
+		bonematrices[i][1][3] = scratch.pos[i][1];
+		bonematrices[i][2][3] = scratch.pos[i][2];
 	}
-	else
+}
+
+/*
+====================
+StudioSetupBonePose
+
+Work out the bone matrices, relative to their parents, for the current frame.
+====================
+*/
+void CStudioModelRenderer::StudioSetupBonePose(mstudioseqdesc_t* pseqdesc, double f, float bonematrices[][3][4])
+{
+	BonePoseKey key;
+	BonePoseJob job;
+
+	StudioBuildBonePoseKey(key, m_pRenderModel, pseqdesc, f, false);
+	StudioPrepareBonePoseJob(job, key, m_pRenderModel, true);
+
+	auto& scratch = m_BoneScratch[0];
+
+	scratch.error = 0;
+
+	StudioComputeBonePose(job, scratch, bonematrices);
+
+	if (job.batch == 2)
+	{
+		StudioReportKernelError(scratch.error);
+	}
+
+	if (key.prevsequence < 0)
 	{
 		//Con_DPrintf("prevframe = %4.2f\n", f);
 		m_pCurrentEntity->latched.prevframe = f;
 	}
+}
 
-	pbones = (mstudiobone_t*)((byte*)m_pStudioHeader + m_pStudioHeader->boneindex);
+/*
+====================
+StudioSetupBones
+
+====================
+*/
+void CStudioModelRenderer::StudioSetupBones()
+{
+	int i;
+	double f;
+
+	mstudiobone_t* pbones;
+	mstudioseqdesc_t* pseqdesc;
+
+	float (*localmatrices)[3][4] = m_BoneScratch[0].matrices;
+	float bonematrix[3][4];
+
+	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
+	{
+		m_pCurrentEntity->curstate.sequence = 0;
+	}
 
 	// bounds checking
 	if (m_pPlayerInfo)
@@ -905,53 +1369,61 @@ void CStudioModelRenderer::StudioSetupBones()
 		}
 	}
 
-	// calc gait animation
-	if (m_pPlayerInfo && m_pPlayerInfo->gaitsequence != 0)
+	pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pCurrentEntity->curstate.sequence;
+
+	f = StudioEstimateFrame(pseqdesc);
+
+	if (m_pCvarBoneCache != nullptr && m_pCvarBoneCache->value != 0)
 	{
-		if (m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq)
-		{
-			m_pPlayerInfo->gaitsequence = 0;
-		}
+		StudioBoneCacheFrame();
 
-		bool copy = true;
+		// Snap the frame so that poses that are almost the same are the same
+		f = floor(f * kBoneCacheFrameSteps + 0.5) / kBoneCacheFrameSteps;
 
-		pseqdesc = (mstudioseqdesc_t*)((byte*)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pPlayerInfo->gaitsequence;
+		BonePoseKey key;
+		StudioBuildBonePoseKey(key, m_pRenderModel, pseqdesc, f, false);
 
-		panim = StudioGetAnim(m_pRenderModel, pseqdesc);
-		StudioCalcRotations(pos2, q2, pseqdesc, panim, m_pPlayerInfo->gaitframe);
+		bool found;
+		auto pose = StudioFindBonePose(key, found);
 
-		for (i = 0; i < m_pStudioHeader->numbones; i++)
+		if (found)
 		{
-			auto bone = &pbones[i];
+			m_nBoneCacheHits++;
 
-			if (0 == strcmp(bone->name, "Bip01 Spine"))
-			{
-				copy = false;
-			}
-			else if (bone->parent >= 0 &&
-					 bone->parent < m_pStudioHeader->numbones &&
-					 0 == strcmp(pbones[bone->parent].name, "Bip01 Pelvis"))
+			if (pose->prepared)
 			{
-				copy = true;
+				m_nBoneCachePrepared++;
+				pose->prepared = false;
 			}
 
-			if (copy)
+			// StudioSetupBonePose would have done this
+			if (key.prevsequence < 0)
 			{
-				memcpy(pos[i], pos2[i], sizeof(pos[i]));
-				memcpy(q[i], q2[i], sizeof(q[i]));
+				m_pCurrentEntity->latched.prevframe = f;
 			}
 		}
+		else
+		{
+			m_nBoneCacheMisses++;
+
+			StudioSetupBonePose(pseqdesc, f, pose->matrices);
+			pose->valid = true;
+		}
+
+		localmatrices = pose->matrices;
+	}
+	else
+	{
+		StudioSetupBonePose(pseqdesc, f, localmatrices);
 	}
 
+	pbones = (mstudiobone_t*)((byte*)m_pStudioHeader + m_pStudioHeader->boneindex);
+
 	for (i = 0; i < m_pStudioHeader->numbones; i++)
 	{
 		const int parent = pbones[i].parent;
 
-		QuaternionMatrix(q[i], bonematrix);
-
-		bonematrix[0][3] = pos[i][0];
-		bonematrix[1][3] = pos[i][1];
-		bonematrix[2][3] = pos[i][2];
+		MatrixCopy(localmatrices[i], bonematrix);
 
 		if (parent == -1)
 		{
@@ -1028,9 +1500,9 @@ void CStudioModelRenderer::StudioMergeBones(model_t* m_pSubModel)
 	mstudioseqdesc_t* pseqdesc;
 	mstudioanim_t* panim;
 
-	static float pos[MAXSTUDIOBONES][3];
+	float (*pos)[3] = m_BoneScratch[0].pos;
 	float bonematrix[3][4];
-	static vec4_t q[MAXSTUDIOBONES];
+	vec4_t* q = m_BoneScratch[0].q;
 
 	if (m_pCurrentEntity->curstate.sequence >= m_pStudioHeader->numseq)
 	{
@@ -1046,8 +1518,49 @@ void CStudioModelRenderer::StudioMergeBones(model_t* m_pSubModel)
 		//Con_DPrintf("%f %f\n", m_pCurrentEntity->prevframe, f );
 	}
 
-	panim = StudioGetAnim(m_pSubModel, pseqdesc);
-	StudioCalcRotations(pos, q, pseqdesc, panim, f);
+	BonePose* pose = nullptr;
+	bool found = false;
+
+	if (m_pCvarBoneCache != nullptr && m_pCvarBoneCache->value != 0)
+	{
+		StudioBoneCacheFrame();
+
+		f = floor(f * kBoneCacheFrameSteps + 0.5) / kBoneCacheFrameSteps;
+
+		BonePoseKey key;
+		StudioBuildBonePoseKey(key, m_pSubModel, pseqdesc, f, true);
+
+		pose = StudioFindBonePose(key, found);
+
+		if (found)
+		{
+			m_nBoneCacheHits++;
+		}
+		else
+		{
+			m_nBoneCacheMisses++;
+		}
+	}
+
+	if (!found)
+	{
+		panim = StudioGetAnim(m_pSubModel, pseqdesc);
+		StudioCalcRotations(pos, q, pseqdesc, panim, f);
+
+		if (pose != nullptr)
+		{
+			for (i = 0; i < m_pStudioHeader->numbones; i++)
+			{
+				QuaternionMatrix(q[i], pose->matrices[i]);
+
+				pose->matrices[i][0][3] = pos[i][0];
+				pose->matrices[i][1][3] = pos[i][1];
+				pose->matrices[i][2][3] = pos[i][2];
+			}
+
+			pose->valid = true;
+		}
+	}
 
 	pbones = (mstudiobone_t*)((byte*)m_pStudioHeader + m_pStudioHeader->boneindex);
 
@@ -1065,11 +1578,18 @@ void CStudioModelRenderer::StudioMergeBones(model_t* m_pSubModel)
 		}
 		if (j >= m_nCachedBones)
 		{
-			QuaternionMatrix(q[i], bonematrix);
+			if (pose != nullptr)
+			{
+				MatrixCopy(pose->matrices[i], bonematrix);
+			}
+			else
+			{
+				QuaternionMatrix(q[i], bonematrix);
 
-			bonematrix[0][3] = pos[i][0];
-			bonematrix[1][3] = pos[i][1];
-			bonematrix[2][3] = pos[i][2];
+				bonematrix[0][3] = pos[i][0];
+				bonematrix[1][3] = pos[i][1];
+				bonematrix[2][3] = pos[i][2];
+			}
 
 			if (pbones[i].parent == -1)
 			{
@@ -1111,6 +1631,8 @@ bool CStudioModelRenderer::StudioDrawModel(int flags)
 	alight_t lighting;
 	Vector dir;
 
+	StudioFinishBones();
+
 	m_pCurrentEntity = IEngineStudio.GetCurrentEntity();
 	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
 	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
@@ -1424,6 +1946,8 @@ bool CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t* pplayer)
 	alight_t lighting;
 	Vector dir;
 
+	StudioFinishBones();
+
 	m_pCurrentEntity = IEngineStudio.GetCurrentEntity();
 	IEngineStudio.GetTimes(&m_nFrameCount, &m_clTime, &m_clOldTime);
 	IEngineStudio.GetViewInfo(m_vRenderOrigin, m_vUp, m_vRight, m_vNormal);
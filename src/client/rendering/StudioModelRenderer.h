@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <vector>
+
+#include "studio_jobs.h"
+
 /*
 ====================
 CStudioModelRenderer
@@ -41,6 +45,18 @@ public:
 	// Set up model bone positions
 	virtual void StudioSetupBones();
 
+	// Set up bone matrices relative to their parents
+	virtual void StudioSetupBonePose(mstudioseqdesc_t* pseqdesc, double f, float bonematrices[][3][4]);
+
+	// Forget cached bone poses ( on map change )
+	void StudioResetBoneCache();
+
+	// Bone setup ahead of drawing, on worker threads
+	void StudioQueueBones(cl_entity_t* ent);
+	void StudioDispatchBones();
+	void StudioFinishBones();
+	void StudioShutdownBones();
+
 	// Find final attachment points
 	virtual void StudioCalcAttachments();
 
@@ -218,4 +234,108 @@ protected:
 	/* Toodles: These were integers. */
 	struct ChromeVector { float x, y; };
 	ChromeVector m_vChromeValues[MAXSTUDIOVERTS];
+
+	// Bone pose cache
+	// Poses are looked up by everything that goes into them, so models
+	// in the same pose, or that haven't moved since the last frame,
+	// skip decoding and blending their animations.
+	struct BonePoseKey
+	{
+		model_t* model;
+		studiohdr_t* header;
+		int merge;
+		int sequence;
+		float frame;
+		float blend[2];
+		float adj[MAXSTUDIOCONTROLLERS];
+		int prevsequence; // -1 if not blending from the last sequence
+		float prevframe;
+		float prevblend[2];
+		float prevweight;
+		int gaitsequence;
+		float gaitframe;
+	};
+
+	struct BonePose
+	{
+		bool valid;
+		bool pending;  // Being set up by the workers
+		bool prepared; // Set up ahead of drawing, and not looked up yet
+		unsigned int hash;
+		int lastFrame;
+		BonePoseKey key;
+		float matrices[MAXSTUDIOBONES][3][4];
+	};
+
+	static constexpr std::size_t kBonePoseCacheSize = 128;
+	static constexpr double kBoneCacheFrameSteps = 32.0; // Frames are snapped to this fraction of a frame
+
+	void StudioBuildBonePoseKey(BonePoseKey& key, model_t* model, mstudioseqdesc_t* pseqdesc, float f, bool merge);
+	BonePose* StudioFindBonePose(const BonePoseKey& key, bool& found);
+	void StudioBoneCacheFrame();
+
+	std::vector<BonePose> m_BonePoses;
+
+	// Everything needed to set up a pose, besides working space.
+	// Nothing here refers to the renderer's state for the current entity,
+	// so a pose can be set up on any thread.
+	struct BonePoseJob
+	{
+		BonePoseKey key;
+		mstudioanim_t* anim;     // For key.sequence
+		mstudioanim_t* prevanim; // For key.prevsequence
+		mstudioanim_t* gaitanim; // For key.gaitsequence
+		int batch;               // r_studio_batch
+		BonePose* pose;
+	};
+
+	// Working space for setting up a pose, one for each thread
+	struct BonePoseScratch
+	{
+		float pos[MAXSTUDIOBONES][3];
+		vec4_t q[MAXSTUDIOBONES];
+		float pos1b[MAXSTUDIOBONES][3];
+		vec4_t q1b[MAXSTUDIOBONES];
+		float pos2[MAXSTUDIOBONES][3];
+		vec4_t q2[MAXSTUDIOBONES];
+		float pos3[MAXSTUDIOBONES][3];
+		vec4_t q3[MAXSTUDIOBONES];
+		float pos4[MAXSTUDIOBONES][3];
+		vec4_t q4[MAXSTUDIOBONES];
+		float matrices[MAXSTUDIOBONES][3][4];
+		StudioDecodeScratch decode;
+		float error; // Largest difference found by r_studio_batch 2
+	};
+
+	static constexpr int kMaxBoneThreads = 8;
+	static constexpr std::size_t kMaxBoneJobs = kBonePoseCacheSize / 2; // Leave room for what isn't prepared
+
+	bool StudioPrepareBonePoseJob(BonePoseJob& job, const BonePoseKey& key, model_t* model, bool loadGroups);
+	void StudioComputeBonePose(const BonePoseJob& job, BonePoseScratch& scratch, float bonematrices[][3][4]);
+	float StudioDecodeRotations(StudioDecodeScratch& scratch, int batch, studiohdr_t* header, float pos[][3], vec4_t* q, mstudioseqdesc_t* pseqdesc, mstudioanim_t* panim, float f, float* adj);
+	static float StudioSlerpBonesMode(int batch, vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones);
+	bool StudioPredictBonePose(cl_entity_t* ent, BonePoseKey& key);
+
+	CStudioJobPool m_BoneJobs;
+	std::vector<BonePoseScratch> m_BoneScratch; // The render thread's is first
+	std::vector<BonePoseJob> m_PendingBoneJobs;
+	std::vector<cl_entity_t*> m_QueuedBoneEntities;
+
+	cvar_t* m_pCvarStudioThreads;
+
+	int m_nBoneCachePrepared;
+
+	cvar_t* m_pCvarBoneCache;
+	cvar_t* m_pCvarBoneCacheStats;
+
+	int m_nBoneCacheFrame;
+	int m_nBoneCacheHits;
+	int m_nBoneCacheMisses;
+
+	// Batched animation decoding ( r_studio_batch 2 checks it against the original )
+	cvar_t* m_pCvarStudioBatch;
+	int m_nKernelChecks;
+	float m_flKernelMaxError;
+
+	void StudioReportKernelError(float error);
 };
@@ -0,0 +1,262 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Cached world lighting for client side effects
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "hud.h"
+#include "cl_util.h"
+#include "triangleapi.h"
+#include "com_model.h"
+#include "cl_entity.h"
+#include "parsemsg.h"
+#include "light_cache.h"
+
+#include <cmath>
+#include <cstring>
+
+extern Vector v_origin;
+
+CLightCache g_LightCache;
+
+static cvar_t* r_particle_lightcache = nullptr;
+
+static int MsgFunc_LightStyle(const char* pszName, int iSize, void* pbuf)
+{
+	BEGIN_READ(pbuf, iSize);
+
+	const int style = READ_BYTE();
+
+	g_LightCache.SetLightStyle(style, READ_STRING());
+
+	return 1;
+}
+
+void CLightCache::Init()
+{
+	r_particle_lightcache = client::RegisterVariable("r_particle_lightcache", "1", FCVAR_ARCHIVE);
+
+	client::HookUserMsg("LightStyle", MsgFunc_LightStyle);
+}
+
+void CLightCache::Reset()
+{
+	m_Samples.clear();
+	m_StyleFrame = -1;
+
+	std::memset(m_Styles, 0, sizeof(m_Styles));
+	std::memset(m_StyleValues, 0, sizeof(m_StyleValues));
+	m_HaveStyles = false;
+	m_FoundUsedStyles = false;
+}
+
+void CLightCache::SetLightStyle(int style, const char* value)
+{
+	if (style < 0 || style >= kMaxStyles)
+	{
+		return;
+	}
+
+	std::strncpy(m_Styles[style], value, kMaxStyleLength - 1);
+	m_Styles[style][kMaxStyleLength - 1] = '\0';
+
+	m_HaveStyles = true;
+
+	/* Check the styles again on the next lookup. */
+	m_StyleFrame = -1;
+}
+
+void CLightCache::ResetCounters()
+{
+	m_Lookups = 0;
+	m_EngineSamples = 0;
+}
+
+void CLightCache::SampleEngine(const Vector& point, Vector& color)
+{
+	Vector position = point;
+
+	client::tri::LightAtPoint(position, color);
+
+	m_EngineSamples++;
+}
+
+void CLightCache::FindUsedStyles()
+{
+	m_FoundUsedStyles = true;
+
+	auto world = client::GetEntityByIndex(0);
+
+	if (nullptr == world || nullptr == world->model || world->model->type != mod_brush)
+	{
+		/* Can't tell, so watch them all. */
+		std::memset(m_UsedStyles, 1, sizeof(m_UsedStyles));
+		return;
+	}
+
+	std::memset(m_UsedStyles, 0, sizeof(m_UsedStyles));
+
+	/* This includes the surfaces of brush entities. */
+	const model_t* model = world->model;
+
+	for (int i = 0; i < model->numsurfaces; ++i)
+	{
+		const msurface_t& surface = model->surfaces[i];
+
+		for (int j = 0; j < MAXLIGHTMAPS && surface.styles[j] != 255; ++j)
+		{
+			if (surface.styles[j] < kMaxStyles)
+			{
+				m_UsedStyles[surface.styles[j]] = true;
+			}
+		}
+	}
+}
+
+bool CLightCache::StylesChanged()
+{
+	/* Without the styles, assume they've all changed. */
+	if (!m_HaveStyles)
+	{
+		return true;
+	}
+
+	if (!m_FoundUsedStyles)
+	{
+		FindUsedStyles();
+	}
+
+	/* Which letter of each style the engine is showing, like R_AnimateLight. */
+	const int frame = static_cast<int>(client::GetClientTime() * kStyleRate);
+
+	bool changed = false;
+
+	for (int i = 0; i < kMaxStyles; ++i)
+	{
+		if (!m_UsedStyles[i])
+		{
+			continue;
+		}
+
+		const int length = static_cast<int>(std::strlen(m_Styles[i]));
+		const char value = length > 0 ? m_Styles[i][frame % length] : '\0';
+
+		if (value != m_StyleValues[i])
+		{
+			m_StyleValues[i] = value;
+			changed = true;
+		}
+	}
+
+	return changed;
+}
+
+const CLightCache::Sample& CLightCache::GetSample(int x, int y, int z)
+{
+	/* 21 bits for each axis is plenty at this cell size. */
+	constexpr std::uint64_t kMask = (1 << 21) - 1;
+
+	const std::uint64_t key =
+		(static_cast<std::uint64_t>(x) & kMask)
+		| ((static_cast<std::uint64_t>(y) & kMask) << 21)
+		| ((static_cast<std::uint64_t>(z) & kMask) << 42);
+
+	auto [it, inserted] = m_Samples.try_emplace(key);
+
+	if (inserted)
+	{
+		Vector position{x * kCellSize, y * kCellSize, z * kCellSize};
+
+		/* Light inside solid is black, or leaks from the other side of the wall. */
+		it->second.solid = client::PM_PointContents(position, nullptr) == CONTENTS_SOLID;
+
+		if (it->second.solid)
+		{
+			it->second.color = g_vecZero;
+		}
+		else
+		{
+			SampleEngine(position, it->second.color);
+		}
+	}
+
+	return it->second;
+}
+
+void CLightCache::LightAtPoint(const Vector& point, Vector& color)
+{
+	m_Lookups++;
+
+	if (nullptr == r_particle_lightcache
+	 || r_particle_lightcache->value == 0
+	 || (point - v_origin).LengthSquared() > kRadius * kRadius)
+	{
+		SampleEngine(point, color);
+		return;
+	}
+
+	const int styleFrame = static_cast<int>(client::GetClientTime() * kStyleRate);
+
+	if (styleFrame != m_StyleFrame)
+	{
+		m_StyleFrame = styleFrame;
+
+		if (StylesChanged())
+		{
+			m_Samples.clear();
+		}
+	}
+
+	if (m_Samples.size() > kMaxSamples)
+	{
+		m_Samples.clear();
+	}
+
+	const float gridX = point.x / kCellSize;
+	const float gridY = point.y / kCellSize;
+	const float gridZ = point.z / kCellSize;
+
+	const int x = static_cast<int>(std::floor(gridX));
+	const int y = static_cast<int>(std::floor(gridY));
+	const int z = static_cast<int>(std::floor(gridZ));
+
+	const float fracX = gridX - x;
+	const float fracY = gridY - y;
+	const float fracZ = gridZ - z;
+
+	/* Blend the corners outside solid, weighted by how close each one is. */
+	Vector total = g_vecZero;
+	float totalWeight = 0;
+
+	for (int corner = 0; corner < 8; ++corner)
+	{
+		const int dx = corner & 1;
+		const int dy = (corner >> 1) & 1;
+		const int dz = (corner >> 2) & 1;
+
+		const Sample& sample = GetSample(x + dx, y + dy, z + dz);
+
+		if (sample.solid)
+		{
+			continue;
+		}
+
+		const float weight =
+			(0 != dx ? fracX : 1 - fracX)
+			* (0 != dy ? fracY : 1 - fracY)
+			* (0 != dz ? fracZ : 1 - fracZ);
+
+		total = total + sample.color * weight;
+		totalWeight += weight;
+	}
+
+	/* Mostly surrounded by solid, so the corners left don't say much about this point. */
+	if (totalWeight < kMinWeight)
+	{
+		SampleEngine(point, color);
+		return;
+	}
+
+	color = total * (1 / totalWeight);
+}
@@ -0,0 +1,73 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Cached world lighting for client side effects
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+/*
+Light sampled from the world on a coarse grid around the view, so that
+effects near each other don't each ask the engine for the light at their own
+position every frame. A point is lit by blending the grid points around it
+that aren't inside solid, each sampled the first time it's needed.
+
+The server sends its light styles, and the samples are thrown away when a
+style used by the world's surfaces changes, and whenever the map changes.
+Until the styles arrive they are thrown away every time a style could
+change. Points far from the view are sampled directly.
+*/
+class CLightCache
+{
+public:
+	void Init();
+	void Reset(); // Called on map change
+
+	void LightAtPoint(const Vector& point, Vector& color);
+
+	void SetLightStyle(int style, const char* value);
+
+	void ResetCounters();
+
+	int GetLookups() const { return m_Lookups; }
+	int GetEngineSamples() const { return m_EngineSamples; }
+
+private:
+	struct Sample
+	{
+		Vector color;
+		bool solid;
+	};
+
+	static constexpr float kCellSize = 32;
+	static constexpr float kRadius = 2048; // From the view
+	static constexpr float kStyleRate = 10; // Light style changes per second
+	static constexpr float kMinWeight = 0.25f; // Of the corners outside solid, below which the point is sampled directly
+	static constexpr std::size_t kMaxSamples = 32768;
+	static constexpr int kMaxStyles = 64;
+	static constexpr int kMaxStyleLength = 64;
+
+	void SampleEngine(const Vector& point, Vector& color);
+	const Sample& GetSample(int x, int y, int z);
+
+	void FindUsedStyles();
+	bool StylesChanged();
+
+	std::unordered_map<std::uint64_t, Sample> m_Samples;
+	int m_StyleFrame = -1;
+
+	char m_Styles[kMaxStyles][kMaxStyleLength]{};
+	char m_StyleValues[kMaxStyles]{}; // As of m_StyleFrame
+	bool m_UsedStyles[kMaxStyles]{};
+	bool m_HaveStyles = false;
+	bool m_FoundUsedStyles = false;
+
+	int m_Lookups = 0;
+	int m_EngineSamples = 0;
+};
+
+extern CLightCache g_LightCache;
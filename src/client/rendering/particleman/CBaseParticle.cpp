@@ -21,6 +21,7 @@
 #include "event_api.h"
 #include "triangleapi.h"
 
+#include "light_cache.h"
 #include "particleman.h"
 #include "particleman_internal.h"
 #include "CBaseParticle.h"
@@ -146,11 +147,11 @@ bool CBaseParticle::CheckVisibility()
 	return true;
 }
 
-void CBaseParticle::Draw()
+bool CBaseParticle::BuildQuad(ParticleQuad& quad)
 {
 	if (m_flDieTime == client::GetClientTime())
 	{
-		return;
+		return false;
 	}
 
 	Vector vColor;
@@ -158,7 +159,7 @@ void CBaseParticle::Draw()
 
 	if ((m_iRenderFlags & LIGHT_NONE) == 0)
 	{
-		client::tri::LightAtPoint(m_vOrigin, vColor);
+		g_LightCache.LightAtPoint(m_vOrigin, vColor);
 
 		intensity = (vColor.x + vColor.y + vColor.z) / 3.0;
 	}
@@ -211,25 +212,55 @@ void CBaseParticle::Draw()
 	const Vector topLeft = lowLeft + height;
 	const Vector topRight = lowRight + height;
 
-	client::tri::SpriteTexture(m_pTexture, m_iFrame);
-	client::tri::RenderMode(m_iRendermode);
-	client::tri::CullFace(TRI_NONE);
+	quad.m_pTexture = m_pTexture;
+	quad.m_iFrame = m_iFrame;
+	quad.m_iRendermode = m_iRendermode;
 
-	client::tri::Begin(TRI_QUADS);
-	client::tri::Color4f(resultColor.x / 255, resultColor.y / 255, resultColor.z / 255, m_flBrightness / 255);
+	quad.m_flColor[0] = resultColor.x / 255;
+	quad.m_flColor[1] = resultColor.y / 255;
+	quad.m_flColor[2] = resultColor.z / 255;
+	quad.m_flColor[3] = m_flBrightness / 255;
+
+	quad.m_vTopLeft = topLeft;
+	quad.m_vLowLeft = lowLeft;
+	quad.m_vLowRight = lowRight;
+	quad.m_vTopRight = topRight;
+
+	return true;
+}
+
+void CBaseParticle::EmitQuad(const ParticleQuad& quad)
+{
+	client::tri::Color4f(quad.m_flColor[0], quad.m_flColor[1], quad.m_flColor[2], quad.m_flColor[3]);
 
 	client::tri::TexCoord2f(0, 0);
-	client::tri::Vertex3fv(topLeft);
+	client::tri::Vertex3fv(quad.m_vTopLeft);
 
 	client::tri::TexCoord2f(0, 1);
-	client::tri::Vertex3fv(lowLeft);
+	client::tri::Vertex3fv(quad.m_vLowLeft);
 
 	client::tri::TexCoord2f(1, 1);
-	client::tri::Vertex3fv(lowRight);
+	client::tri::Vertex3fv(quad.m_vLowRight);
 
 	client::tri::TexCoord2f(1, 0);
-	client::tri::Vertex3fv(topRight);
+	client::tri::Vertex3fv(quad.m_vTopRight);
+}
 
+void CBaseParticle::Draw()
+{
+	ParticleQuad quad;
+
+	if (!BuildQuad(quad))
+	{
+		return;
+	}
+
+	client::tri::SpriteTexture(quad.m_pTexture, quad.m_iFrame);
+	client::tri::RenderMode(quad.m_iRendermode);
+	client::tri::CullFace(TRI_NONE);
+
+	client::tri::Begin(TRI_QUADS);
+	EmitQuad(quad);
 	client::tri::End();
 
 	client::tri::RenderMode(kRenderNormal);
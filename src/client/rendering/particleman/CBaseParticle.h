@@ -34,6 +34,10 @@ private:
 	int m_iCollisionFlags;
 	float m_flPlayerDistance; //Used for sorting the particles, DO NOT TOUCH.
 
+	bool m_bStock = false; //Only uses the behaviours of this class, see CMiniMem::SetStock.
+
+	friend class CMiniMem;
+
 public:
 	void* operator new(size_t size)
 	{
@@ -71,6 +75,16 @@ public:
 	virtual void InitializeSprite(Vector org, Vector normal, model_s* sprite, float size, float brightness);
 	virtual void Force(void);
 
+	/**
+	*	@brief Works out what Draw would draw. Returns false if there is nothing to draw.
+	*/
+	bool BuildQuad(ParticleQuad& quad);
+
+	/**
+	*	@brief Submits a quad, between tri::Begin(TRI_QUADS) and tri::End.
+	*/
+	static void EmitQuad(const ParticleQuad& quad);
+
 	float m_flSize;			 //scale of object
 	float m_flScaleSpeed;	 //speed at which object expands
 	float m_flContractSpeed; //speed at which object expands
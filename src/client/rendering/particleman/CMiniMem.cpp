@@ -14,22 +14,44 @@
 ****/
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
 
 #include "hud.h"
 #include "cl_util.h"
+#include "triangleapi.h"
 #include "particleman.h"
 #include "particleman_internal.h"
 #include "CMiniMem.h"
 
+//Each particle is preceded by its slot in the particle list.
+static std::size_t HeaderSize(std::size_t alignment)
+{
+	return std::max(alignment, sizeof(std::size_t));
+}
+
+static std::size_t& SlotOf(void* particle)
+{
+	return reinterpret_cast<std::size_t*>(particle)[-1];
+}
+
 void* CMiniMem::Allocate(std::size_t sizeInBytes, std::size_t alignment)
 {
-	auto particle = reinterpret_cast<CBaseParticle*>(_pool.allocate(sizeInBytes, alignment));
+	const std::size_t header = HeaderSize(alignment);
+
+	auto block = reinterpret_cast<std::byte*>(_pool.allocate(sizeInBytes + header, header));
 
-	if (nullptr != particle)
+	if (nullptr == block)
 	{
-		_particles.push_back(particle);
+		return nullptr;
 	}
 
+	auto particle = block + header;
+
+	SlotOf(particle) = _particles.size();
+	_particles.push_back(reinterpret_cast<CBaseParticle*>(particle));
+
 	return particle;
 }
 
@@ -40,9 +62,39 @@ void CMiniMem::Deallocate(void* memory, std::size_t sizeInBytes, std::size_t ali
 		return;
 	}
 
-	_particles.erase(std::find(_particles.begin(), _particles.end(), memory));
+	//Fill the hole with the last particle.
+	const std::size_t slot = SlotOf(memory);
+	const std::size_t last = _particles.size() - 1;
+
+	if (slot != last)
+	{
+		_particles[slot] = _particles[last];
+		SlotOf(_particles[slot]) = slot;
+	}
+
+	_particles.pop_back();
+
+	const std::size_t header = HeaderSize(alignment);
+
+	_pool.deallocate(reinterpret_cast<std::byte*>(memory) - header, sizeInBytes + header, header);
+}
+
+void CMiniMem::SwapSlots(std::size_t lhs, std::size_t rhs)
+{
+	if (lhs == rhs)
+	{
+		return;
+	}
+
+	std::swap(_particles[lhs], _particles[rhs]);
+
+	SlotOf(_particles[lhs]) = lhs;
+	SlotOf(_particles[rhs]) = rhs;
+}
 
-	_pool.deallocate(memory, sizeInBytes, alignment);
+void CMiniMem::SetStock(CBaseParticle* particle)
+{
+	particle->m_bStock = true;
 }
 
 void CMiniMem::Shutdown()
@@ -61,12 +113,295 @@ CMiniMem* CMiniMem::Instance()
 	return _instance;
 }
 
-void CMiniMem::ProcessAll()
+void CMiniMem::Simulate(std::size_t first, std::size_t last, float time, bool allowFastPath)
+{
+	auto& stock = _stock;
+
+	stock.particles.clear();
+
+	//A particle's Think can create and free particles, so those run first, reading the live count each time.
+	//Freeing a particle moves the last one into its slot, so if this one freed itself, run the slot again.
+	for (std::size_t i = first; i < std::min(last, _particles.size());)
+	{
+		auto effect = _particles[i];
+
+		if (allowFastPath && effect->m_bStock)
+		{
+			++i;
+			continue;
+		}
+
+		effect->Think(time);
+
+		if (i < _particles.size() && _particles[i] == effect)
+		{
+			++i;
+		}
+	}
+
+	if (!allowFastPath)
+	{
+		return;
+	}
+
+	for (std::size_t i = first; i < std::min(last, _particles.size()); ++i)
+	{
+		auto effect = _particles[i];
+
+		if (!effect->m_bStock)
+		{
+			continue;
+		}
+
+		//Same order as CBaseParticle::Think. Animation and contraction are done one at a time,
+		//the rest are stepped together in StepStock.
+		if ((effect->m_iCollisionFlags & TRI_ANIMATEDIE) != 0)
+		{
+			effect->CBaseParticle::AnimateAndDie(time);
+		}
+		else
+		{
+			effect->CBaseParticle::Animate(time);
+		}
+
+		effect->CBaseParticle::Contract(time);
+
+		stock.particles.push_back(effect);
+	}
+
+	const std::size_t count = stock.particles.size();
+
+	if (0 == count)
+	{
+		return;
+	}
+
+	stock.ForEachField([&](auto& field)
+		{ field.resize(count); });
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto effect = stock.particles[i];
+
+		stock.originX[i] = effect->m_vOrigin.x;
+		stock.originY[i] = effect->m_vOrigin.y;
+		stock.originZ[i] = effect->m_vOrigin.z;
+		stock.velocityX[i] = effect->m_vVelocity.x;
+		stock.velocityY[i] = effect->m_vVelocity.y;
+		stock.velocityZ[i] = effect->m_vVelocity.z;
+		stock.anglesX[i] = effect->m_vAngles.x;
+		stock.anglesY[i] = effect->m_vAngles.y;
+		stock.anglesZ[i] = effect->m_vAngles.z;
+		stock.originalAnglesX[i] = effect->m_vOriginalAngles.x;
+		stock.originalAnglesY[i] = effect->m_vOriginalAngles.y;
+		stock.originalAnglesZ[i] = effect->m_vOriginalAngles.z;
+		stock.avelocityX[i] = effect->m_vAVelocity.x;
+		stock.avelocityY[i] = effect->m_vAVelocity.y;
+		stock.avelocityZ[i] = effect->m_vAVelocity.z;
+		stock.size[i] = effect->m_flSize;
+		stock.originalSize[i] = effect->m_flOriginalSize;
+		stock.scaleSpeed[i] = effect->m_flScaleSpeed;
+		stock.brightness[i] = effect->m_flBrightness;
+		stock.originalBrightness[i] = effect->m_flOriginalBrightness;
+		stock.fadeSpeed[i] = effect->m_flFadeSpeed;
+		stock.timeCreated[i] = effect->m_flTimeCreated;
+		stock.dieTime[i] = effect->m_flDieTime;
+		stock.gravity[i] = effect->m_flGravity;
+	}
+
+	StepStock(time);
+
+	const float deltaTime = time - g_flOldTime;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto effect = stock.particles[i];
+
+		effect->m_vOrigin = {stock.originX[i], stock.originY[i], stock.originZ[i]};
+
+		//CalculateVelocity doesn't move particles that are at rest.
+		if ((effect->m_iCollisionFlags & TRI_SPIRAL) != 0
+			&& (effect->m_vVelocity != g_vecZero || -deltaTime * g_flGravity * effect->m_flGravity != 0))
+		{
+			effect->m_vOrigin.x += sin(time * 5.0 + reinterpret_cast<std::intptr_t>(effect)) * 2;
+			effect->m_vOrigin.y += sin(time * 7.5 + reinterpret_cast<std::intptr_t>(effect));
+		}
+
+		effect->m_vVelocity = {stock.velocityX[i], stock.velocityY[i], stock.velocityZ[i]};
+		effect->m_vAngles = {stock.anglesX[i], stock.anglesY[i], stock.anglesZ[i]};
+		effect->m_flSize = stock.size[i];
+		effect->m_flBrightness = stock.brightness[i];
+		effect->m_flDieTime = stock.dieTime[i];
+
+		effect->CBaseParticle::CheckCollision(time);
+	}
+}
+
+void CMiniMem::StepStock(float time)
+{
+	auto& stock = _stock;
+
+	const std::size_t count = stock.particles.size();
+
+	//Expand
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (stock.scaleSpeed[i] != 0)
+		{
+			stock.size[i] = (stock.scaleSpeed[i] * 30.0 * (time - stock.timeCreated[i])) + stock.originalSize[i];
+
+			if (stock.size[i] < 0.0001)
+			{
+				stock.dieTime[i] = time;
+			}
+		}
+	}
+
+	//Fade
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		if (stock.fadeSpeed[i] >= -0.5)
+		{
+			const float age = time - stock.timeCreated[i];
+
+			if (stock.fadeSpeed[i] == 0)
+			{
+				stock.brightness[i] = (1.0 - age / (stock.dieTime[i] - stock.timeCreated[i])) * stock.originalBrightness[i];
+			}
+			else
+			{
+				stock.brightness[i] = stock.originalBrightness[i] - stock.fadeSpeed[i] * 30.0 * age;
+			}
+
+			if (stock.brightness[i] < 1)
+			{
+				stock.dieTime[i] = time;
+			}
+		}
+	}
+
+	//Spin
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const float x = stock.avelocityX[i];
+		const float y = stock.avelocityY[i];
+		const float z = stock.avelocityZ[i];
+
+		if (x == 0 && y == 0 && z == 0)
+		{
+			continue;
+		}
+
+		const float length = static_cast<float>(sqrt(x * x + y * y + z * z)) * 30.0 * (time - stock.timeCreated[i]);
+
+		stock.anglesX[i] = stock.originalAnglesX[i] + x * length;
+		stock.anglesY[i] = stock.originalAnglesY[i] + y * length;
+		stock.anglesZ[i] = stock.originalAnglesZ[i] + z * length;
+	}
+
+	//CalculateVelocity, except for spirals which are added afterwards.
+	const float deltaTime = time - g_flOldTime;
+	const float gravityScale = -deltaTime * g_flGravity;
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		stock.originX[i] += stock.velocityX[i] * deltaTime;
+		stock.originY[i] += stock.velocityY[i] * deltaTime;
+		stock.originZ[i] += stock.velocityZ[i] * deltaTime;
+		stock.velocityZ[i] += gravityScale * stock.gravity[i];
+	}
+}
+
+void CMiniMem::AddQuad(const ParticleQuad& quad)
+{
+	const auto key = std::make_tuple(quad.m_pTexture, quad.m_iFrame, quad.m_iRendermode);
+
+	auto it = _batchLookup.find(key);
+
+	if (it == _batchLookup.end())
+	{
+		it = _batchLookup.emplace(key, _batches.size()).first;
+		_batches.push_back({quad.m_pTexture, quad.m_iFrame, quad.m_iRendermode, 0, 0});
+	}
+
+	++_batches[it->second].count;
+
+	_quads.push_back(quad);
+	_quadBatches.push_back(it->second);
+}
+
+void CMiniMem::DrawBatches()
+{
+	if (_quads.empty())
+	{
+		return;
+	}
+
+	//Batches are drawn in the order they were first seen, which is farthest first.
+	std::size_t first = 0;
+
+	for (auto& batch : _batches)
+	{
+		batch.first = first;
+		first += batch.count;
+		batch.count = 0;
+	}
+
+	_batchedQuads.resize(_quads.size());
+
+	for (std::size_t i = 0; i < _quads.size(); ++i)
+	{
+		auto& batch = _batches[_quadBatches[i]];
+		_batchedQuads[batch.first + batch.count++] = _quads[i];
+	}
+
+	int rendermode = -1;
+
+	client::tri::CullFace(TRI_NONE);
+	++_stateChanges;
+
+	for (const auto& batch : _batches)
+	{
+		client::tri::SpriteTexture(batch.texture, batch.frame);
+		++_stateChanges;
+
+		if (batch.rendermode != rendermode)
+		{
+			rendermode = batch.rendermode;
+			client::tri::RenderMode(rendermode);
+			++_stateChanges;
+		}
+
+		client::tri::Begin(TRI_QUADS);
+
+		for (std::size_t i = batch.first; i < batch.first + batch.count; ++i)
+		{
+			CBaseParticle::EmitQuad(_batchedQuads[i]);
+		}
+
+		client::tri::End();
+
+		++_drawnBatches;
+	}
+
+	client::tri::RenderMode(kRenderNormal);
+	client::tri::CullFace(TRI_FRONT);
+	_stateChanges += 2;
+}
+
+void CMiniMem::ProcessAll(bool batchDrawing)
 {
 	const float time = client::GetClientTime();
 
 	//Clear list of visible particles.
 	_visibleParticles = 0;
+	_drawnBatches = 0;
+	_stateChanges = 0;
+
+	if (!IsGamePaused())
+	{
+		Simulate(0, _particles.size(), time);
+	}
 
 	//Divide the particle list in two: the list of visible particles and the list of invisible particles.
 	//Remove any particles that have died.
@@ -76,18 +411,18 @@ void CMiniMem::ProcessAll()
 	{
 		auto effect = _particles[i];
 
-		if (!IsGamePaused())
-		{
-			effect->Think(time);
-		}
-
 		if (0 != effect->m_flDieTime && time >= effect->m_flDieTime)
 		{
+			//Move the effect to the end of the list, keeping the invisible effects together,
+			//so that operator delete filling its slot doesn't move an effect we haven't checked yet.
+			const std::size_t lastUnchecked = _particles.size() - 1 - invisibleCount;
+
+			SwapSlots(i, lastUnchecked);
+			SwapSlots(lastUnchecked, _particles.size() - 1);
+
 			effect->Die();
 			delete effect;
 
-			//Don't do this! operator delete removes the effect from the list.
-			//_particles.erase(_particles.begin() + i);
 			continue;
 		}
 
@@ -104,7 +439,7 @@ void CMiniMem::ProcessAll()
 			{
 				//There is an effect we haven't checked yet.
 				//Put the invisible effect at the end of the list and check the other effect next.
-				std::swap(_particles[i], _particles[_particles.size() - 1 - invisibleCount]);
+				SwapSlots(i, _particles.size() - 1 - invisibleCount);
 				++invisibleCount;
 				continue;
 			}
@@ -123,12 +458,38 @@ void CMiniMem::ProcessAll()
 			return lhsDistance > rhsDistance;
 		});
 
+	_quads.clear();
+	_quadBatches.clear();
+	_batches.clear();
+	_batchLookup.clear();
+
 	for (std::size_t i = 0; i < _visibleParticles; ++i)
 	{
 		auto effect = _particles[i];
-		effect->Draw();
+		SlotOf(effect) = i;
+
+		//Stock particles are drawn in batches, anything else draws itself.
+		if (batchDrawing && effect->m_bStock)
+		{
+			ParticleQuad quad;
+
+			if (effect->BuildQuad(quad))
+			{
+				AddQuad(quad);
+			}
+		}
+		else
+		{
+			effect->Draw();
+
+			//Texture, render mode and cull face, then put back afterwards.
+			++_drawnBatches;
+			_stateChanges += 5;
+		}
 	}
 
+	DrawBatches();
+
 	g_flOldTime = time;
 }
 
@@ -208,16 +569,110 @@ void CMiniMem::Reset()
 {
 	_visibleParticles = 0;
 
-	for (auto particle : _particles)
+	//operator delete removes the particle from the list.
+	while (!_particles.empty())
 	{
+		auto particle = _particles.back();
 		particle->Die();
 		delete particle;
 	}
 
-	//Cleared by CBaseParticle::operator delete
-	//_particles.clear();
-
 	//Wipe away previously allocated memory so maps with loads of particles don't eat up memory forever.
 	_pool.release();
 	_particles.shrink_to_fit();
+
+	_quads.clear();
+	_quads.shrink_to_fit();
+	_quadBatches.clear();
+	_quadBatches.shrink_to_fit();
+	_batchedQuads.clear();
+	_batchedQuads.shrink_to_fit();
+	_batches.clear();
+	_batchLookup.clear();
+
+	_stock.particles.clear();
+	_stock.particles.shrink_to_fit();
+	_stock.ForEachField([](auto& field)
+		{
+			field.clear();
+			field.shrink_to_fit();
+		});
+}
+
+void CMiniMem::Benchmark(std::size_t count, int steps)
+{
+	if (0 == count || steps <= 0)
+	{
+		return;
+	}
+
+	using Clock = std::chrono::steady_clock;
+
+	const float oldTime = g_flOldTime;
+	const std::size_t first = _particles.size();
+
+	std::mt19937 random{0};
+	std::uniform_real_distribution<float> position{-1024, 1024};
+	std::uniform_real_distribution<float> speed{-256, 256};
+	std::uniform_real_distribution<float> angle{0, 360};
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		auto particle = new CBaseParticle();
+
+		particle->InitializeSprite({position(random), position(random), position(random)},
+			{angle(random), angle(random), angle(random)}, nullptr, 10, 255);
+
+		particle->m_vVelocity = {speed(random), speed(random), speed(random)};
+		particle->m_vAVelocity = {speed(random) / 256, speed(random) / 256, 0};
+		particle->m_flGravity = 1;
+		particle->m_flScaleSpeed = 0.1;
+		particle->m_flFadeSpeed = 0.01;
+
+		SetStock(particle);
+	}
+
+	const std::size_t last = _particles.size();
+
+	double elapsed[2];
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		float time = client::GetClientTime();
+
+		g_flOldTime = time;
+
+		const auto start = Clock::now();
+
+		for (int step = 0; step < steps; ++step)
+		{
+			time += 0.01;
+			Simulate(first, last, time, pass == 0);
+			g_flOldTime = time;
+		}
+
+		elapsed[pass] = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	//Remove them in random order, the way they die in game.
+	std::vector<CBaseParticle*> remove{_particles.begin() + first, _particles.begin() + last};
+	std::shuffle(remove.begin(), remove.end(), random);
+
+	const auto removeStart = Clock::now();
+
+	for (auto particle : remove)
+	{
+		delete particle;
+	}
+
+	const double removeElapsed = std::chrono::duration<double, std::milli>(Clock::now() - removeStart).count();
+
+	g_flOldTime = oldTime;
+
+	const double perParticle = 1000000.0 / (static_cast<double>(count) * steps);
+
+	client::Con_Printf("%lu particles, %d steps\n", static_cast<unsigned long>(count), steps);
+	client::Con_Printf("  stock fast path: %.3f ms per step (%.1f ns per particle)\n", elapsed[0] / steps, elapsed[0] * perParticle);
+	client::Con_Printf("  virtual Think:   %.3f ms per step (%.1f ns per particle)\n", elapsed[1] / steps, elapsed[1] * perParticle);
+	client::Con_Printf("  removal:         %.3f ms (%.1f ns per particle)\n", removeElapsed, removeElapsed * 1000000.0 / count);
 }
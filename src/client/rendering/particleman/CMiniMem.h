@@ -1,15 +1,36 @@
 #pragma once
 
 #include <cstddef>
+#include <map>
 #include <memory_resource>
+#include <tuple>
 #include <vector>
 
 class CBaseParticle;
+struct model_s;
 
 #define TRIANGLE_FPS 30
 
+/**
+*	@brief A particle as it will be drawn this frame.
+*/
+struct ParticleQuad
+{
+	model_s* m_pTexture;
+	int m_iFrame;
+	int m_iRendermode;
+
+	float m_flColor[4];
+
+	Vector m_vTopLeft;
+	Vector m_vLowLeft;
+	Vector m_vLowRight;
+	Vector m_vTopRight;
+};
+
 /**
 *	@brief Simple allocator that uses a chunk-based pool to serve requests.
+*	Every particle knows its slot in the particle list, so removing one is a swap with the last particle.
 */
 class CMiniMem
 {
@@ -21,17 +42,85 @@ private:
 	std::vector<CBaseParticle*> _particles;
 	std::size_t _visibleParticles = 0;
 
+	/**
+	*	@brief Stock particles being simulated this frame, with their state laid out by field so the
+	*	stock behaviours can be stepped in tight loops.
+	*/
+	struct StockArrays
+	{
+		std::vector<CBaseParticle*> particles;
+
+		std::vector<float> originX, originY, originZ;
+		std::vector<float> velocityX, velocityY, velocityZ;
+		std::vector<float> anglesX, anglesY, anglesZ;
+		std::vector<float> originalAnglesX, originalAnglesY, originalAnglesZ;
+		std::vector<float> avelocityX, avelocityY, avelocityZ;
+		std::vector<float> size, originalSize, scaleSpeed;
+		std::vector<float> brightness, originalBrightness, fadeSpeed;
+		std::vector<float> timeCreated, dieTime, gravity;
+
+		template <typename Function>
+		void ForEachField(Function function)
+		{
+			for (auto field : {&originX, &originY, &originZ, &velocityX, &velocityY, &velocityZ,
+					 &anglesX, &anglesY, &anglesZ, &originalAnglesX, &originalAnglesY, &originalAnglesZ,
+					 &avelocityX, &avelocityY, &avelocityZ, &size, &originalSize, &scaleSpeed,
+					 &brightness, &originalBrightness, &fadeSpeed, &timeCreated, &dieTime, &gravity})
+			{
+				function(*field);
+			}
+		}
+	};
+
+	StockArrays _stock;
+
+	/**
+	*	@brief Quads sharing a sprite, frame and render mode, drawn together.
+	*/
+	struct QuadBatch
+	{
+		model_s* texture;
+		int frame;
+		int rendermode;
+		std::size_t first;
+		std::size_t count;
+	};
+
+	std::vector<ParticleQuad> _quads;		 //Farthest to nearest
+	std::vector<std::size_t> _quadBatches; //Batch of each quad
+	std::vector<ParticleQuad> _batchedQuads; //Grouped by batch, still farthest to nearest within each
+	std::vector<QuadBatch> _batches;
+	std::map<std::tuple<model_s*, int, int>, std::size_t> _batchLookup;
+
+	std::size_t _drawnBatches = 0;
+	std::size_t _stateChanges = 0;
+
 protected:
 	// private constructor and destructor.
 	CMiniMem() = default;
 	~CMiniMem() = default;
 
+private:
+	void SwapSlots(std::size_t lhs, std::size_t rhs);
+
+	/**
+	*	@brief Runs one frame of behaviour for the particles in the slots [first, last), or up to the
+	*	end of the list if particles are freed along the way.
+	*	Stock particles take the fast path after the rest have thought, unless @p allowFastPath is false.
+	*/
+	void Simulate(std::size_t first, std::size_t last, float time, bool allowFastPath = true);
+
+	void StepStock(float time);
+
+	void AddQuad(const ParticleQuad& quad);
+	void DrawBatches();
+
 public:
 	void* Allocate(std::size_t sizeInBytes, std::size_t alignment = alignof(std::max_align_t));
 
 	void Deallocate(void* memory, std::size_t sizeInBytes, std::size_t alignment = alignof(std::max_align_t));
 
-	void ProcessAll(); //Processes all
+	void ProcessAll(bool batchDrawing = true); //Processes all
 
 	void Reset(); //clears memory, setting all particles to not used.
 
@@ -39,8 +128,20 @@ public:
 
 	int ApplyForce(Vector vOrigin, Vector vDirection, float flRadius, float flStrength);
 
+	/**
+	*	@brief Marks a particle as using only the behaviours of CBaseParticle, so it can be simulated without virtual calls.
+	*/
+	void SetStock(CBaseParticle* particle);
+
+	/**
+	*	@brief Times stepping @p count stock particles for @p steps frames, with and without the fast path.
+	*/
+	void Benchmark(std::size_t count, int steps);
+
 	static CMiniMem* Instance();
 
 	std::size_t GetTotalParticles() { return _particles.size(); }
 	std::size_t GetDrawnParticles() { return _visibleParticles; }
+	std::size_t GetDrawnBatches() { return _drawnBatches; }
+	std::size_t GetStateChanges() { return _stateChanges; }
 };
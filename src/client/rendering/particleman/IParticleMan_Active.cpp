@@ -18,6 +18,7 @@
 #include "hud.h"
 #include "cl_util.h"
 #include "triangleapi.h"
+#include "light_cache.h"
 #include "particleman.h"
 #include "particleman_internal.h"
 #include "CMiniMem.h"
@@ -26,6 +27,7 @@
 static bool g_iRenderMode = true;
 
 static cvar_t* cl_pmanstats = nullptr;
+static cvar_t* cl_pmanbatch = nullptr;
 
 static std::vector<ForceMember> g_pForceList;
 
@@ -59,15 +61,34 @@ void IParticleMan_Active::ApplyForce(Vector vOrigin, Vector vDirection, float fl
 	g_pForceList.push_back(member);
 }
 
+static void ParticleBench()
+{
+	const int count = client::Cmd_Argc() > 1 ? atoi(client::Cmd_Argv(1)) : 50000;
+	const int steps = client::Cmd_Argc() > 2 ? atoi(client::Cmd_Argv(2)) : 100;
+
+	if (count <= 0 || steps <= 0)
+	{
+		client::Con_Printf("Usage: particle_bench [particles] [steps]\n");
+		return;
+	}
+
+	CMiniMem::Instance()->Benchmark(count, steps);
+}
+
 void IParticleMan_Active::SetUp(cl_enginefunc_t* pEnginefuncs)
 {
 	cl_pmanstats = client::RegisterVariable("cl_pmanstats", "0", 0);
+	cl_pmanbatch = client::RegisterVariable("cl_pmanbatch", "1", 0);
+
+	client::AddCommand("particle_bench", ParticleBench);
 }
 
 CBaseParticle* IParticleMan_Active::CreateParticle(Vector org, Vector normal, model_s* sprite, float size, float brightness, const char* classname)
 {
 	auto particle = new CBaseParticle();
 
+	CMiniMem::Instance()->SetStock(particle);
+
 	particle->InitializeSprite(org, normal, sprite, size, brightness);
 	strncpy(particle->m_szClassname, classname, sizeof(particle->m_szClassname) - 1);
 	particle->m_szClassname[sizeof(particle->m_szClassname) - 1] = '\0';
@@ -124,12 +145,17 @@ void IParticleMan_Active::Update()
 
 	g_cFrustum.CalculateFrustum();
 
-	memory->ProcessAll();
+	memory->ProcessAll(nullptr == cl_pmanbatch || cl_pmanbatch->value != 0);
 
 	if (nullptr != cl_pmanstats && cl_pmanstats->value == 1)
 	{
 		//TODO: engine doesn't support printing size_t, use local printf
 		client::Con_NPrintf(15, "Number of Particles: %d", static_cast<int>(CMiniMem::Instance()->GetTotalParticles()));
 		client::Con_NPrintf(16, "Particles Drawn: %d", static_cast<int>(CMiniMem::Instance()->GetDrawnParticles()));
+		client::Con_NPrintf(17, "Particle Batches: %d", static_cast<int>(CMiniMem::Instance()->GetDrawnBatches()));
+		client::Con_NPrintf(18, "Particle State Changes: %d", static_cast<int>(CMiniMem::Instance()->GetStateChanges()));
+		client::Con_NPrintf(19, "Light Lookups: %d (%d sampled from the world)", g_LightCache.GetLookups(), g_LightCache.GetEngineSamples());
 	}
+
+	g_LightCache.ResetCounters();
 }
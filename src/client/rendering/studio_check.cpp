@@ -0,0 +1,460 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Check the batched studio model code against the original on a model file
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "hud.h"
+#include "cl_util.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "studio_util.h"
+#include "studio_kernels.h"
+
+
+/*
+Every frame of every sequence and blend in the model is decoded by both the
+batched code and the original one bone at a time, at several fractions of a
+frame and with the bone controllers both at rest and turned, and the results
+are compared. So is blending each pose with the next. This is what
+r_studio_batch 2 does in the game, but for every frame of a model at once.
+*/
+
+#define STUDIO_HEADER_ID (('T' << 24) + ('S' << 16) + ('D' << 8) + 'I')
+#define STUDIO_SEQ_HEADER_ID (('Q' << 24) + ('S' << 16) + ('D' << 8) + 'I')
+#define STUDIO_FILE_VERSION 10
+
+static const float g_CheckFractions[] = {0.0F, 0.25F, 0.5F, 0.75F};
+
+typedef struct
+{
+	std::vector<byte> data;
+	std::vector<std::vector<byte>> groups; // Demand loaded sequence groups, empty if missing
+} CheckModel;
+
+typedef struct
+{
+	float error;
+	int sequence;
+	int frame;
+	float s;
+} CheckResult;
+
+static StudioDecodeScratch g_Scratch;
+
+
+/*
+====================
+CheckLoadFile
+
+====================
+*/
+static bool CheckLoadFile(const char* filename, std::vector<byte>& data)
+{
+	FILE* file = fopen(filename, "rb");
+	if (file == nullptr)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	const long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	data.resize(size > 0 ? size : 0);
+
+	const bool result = size > 0 && fread(data.data(), 1, data.size(), file) == data.size();
+
+	fclose(file);
+
+	return result;
+}
+
+
+/*
+====================
+CheckInRange
+
+Whether count items of the given size at offset all lie within the data.
+====================
+*/
+static bool CheckInRange(const std::vector<byte>& data, int offset, int count, std::size_t size)
+{
+	return offset >= 0 && count >= 0 && static_cast<std::size_t>(offset) + count * size <= data.size();
+}
+
+
+/*
+====================
+CheckLoadModel
+
+Load the model, and any sequence groups it has, which sit next to it
+named as the engine expects (barney01.mdl for group 1 of barney.mdl).
+====================
+*/
+static bool CheckLoadModel(const char* filename, CheckModel& model)
+{
+	if (!CheckLoadFile(filename, model.data))
+	{
+		printf("Couldn't read %s\n", filename);
+		return false;
+	}
+
+	auto header = reinterpret_cast<studiohdr_t*>(model.data.data());
+
+	if (model.data.size() < sizeof(studiohdr_t)
+	 || header->id != STUDIO_HEADER_ID
+	 || header->version != STUDIO_FILE_VERSION)
+	{
+		printf("%s is not a version %d studio model\n", filename, STUDIO_FILE_VERSION);
+		return false;
+	}
+
+	if (header->numbones <= 0 || header->numbones > MAXSTUDIOBONES
+	 || !CheckInRange(model.data, header->boneindex, header->numbones, sizeof(mstudiobone_t))
+	 || !CheckInRange(model.data, header->seqindex, header->numseq, sizeof(mstudioseqdesc_t))
+	 || !CheckInRange(model.data, header->seqgroupindex, header->numseqgroups, sizeof(mstudioseqgroup_t)))
+	{
+		printf("%s is damaged\n", filename);
+		return false;
+	}
+
+	auto pbones = reinterpret_cast<mstudiobone_t*>(model.data.data() + header->boneindex);
+
+	for (int i = 0; i < header->numbones; i++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			if (pbones[i].bonecontroller[j] < -1 || pbones[i].bonecontroller[j] >= MAXSTUDIOCONTROLLERS)
+			{
+				printf("%s is damaged\n", filename);
+				return false;
+			}
+		}
+	}
+
+	std::string base = filename;
+	if (base.size() > 4 && 0 == strcmp(base.c_str() + base.size() - 4, ".mdl"))
+	{
+		base.resize(base.size() - 4);
+	}
+
+	model.groups.resize(header->numseqgroups);
+
+	for (int i = 1; i < header->numseqgroups; i++)
+	{
+		char groupname[16];
+		snprintf(groupname, sizeof(groupname), "%02d.mdl", i);
+
+		const std::string groupfile = base + groupname;
+
+		auto& group = model.groups[i];
+
+		if (!CheckLoadFile(groupfile.c_str(), group)
+		 || group.size() < sizeof(studioseqhdr_t)
+		 || reinterpret_cast<studioseqhdr_t*>(group.data())->id != STUDIO_SEQ_HEADER_ID)
+		{
+			printf("Couldn't read sequence group %s, its sequences won't be checked\n", groupfile.c_str());
+			group.clear();
+		}
+	}
+
+	return true;
+}
+
+
+/*
+====================
+CheckGetAnim
+
+The animations of a sequence, as StudioGetAnim finds them, or null
+if they aren't loaded or don't fit in their file.
+====================
+*/
+static mstudioanim_t* CheckGetAnim(CheckModel& model, mstudioseqdesc_t* pseqdesc)
+{
+	auto header = reinterpret_cast<studiohdr_t*>(model.data.data());
+
+	if (pseqdesc->seqgroup < 0 || pseqdesc->seqgroup >= header->numseqgroups || pseqdesc->numblends < 1)
+	{
+		return nullptr;
+	}
+
+	auto& data = (pseqdesc->seqgroup == 0) ? model.data : model.groups[pseqdesc->seqgroup];
+
+	if (!CheckInRange(data, pseqdesc->animindex, pseqdesc->numblends * header->numbones, sizeof(mstudioanim_t)))
+	{
+		return nullptr;
+	}
+
+	return reinterpret_cast<mstudioanim_t*>(data.data() + pseqdesc->animindex);
+}
+
+
+/*
+====================
+CheckSetControllers
+
+Controller adjustments at rest, or turned a different amount each.
+====================
+*/
+static void CheckSetControllers(float* adj, bool turned)
+{
+	for (int i = 0; i < MAXSTUDIOCONTROLLERS; i++)
+	{
+		adj[i] = turned ? 0.1F * (i + 1) * ((i & 1) != 0 ? -1.0F : 1.0F) : 0.0F;
+	}
+}
+
+
+/*
+====================
+CheckDecodeReference
+
+====================
+*/
+static void CheckDecodeReference(mstudiobone_t* pbones, mstudioanim_t* panim, int numbones, int frame, float s, float* adj, float pos[][3], vec4_t* q)
+{
+	for (int i = 0; i < numbones; i++)
+	{
+		StudioCalcBoneQuaterionReference(frame, s, &pbones[i], &panim[i], adj, q[i]);
+		StudioCalcBonePositionReference(frame, s, &pbones[i], &panim[i], adj, pos[i]);
+	}
+}
+
+
+/*
+====================
+CheckRecord
+
+====================
+*/
+static void CheckRecord(CheckResult& result, float error, int sequence, int frame, float s)
+{
+	if (error > result.error)
+	{
+		result.error = error;
+		result.sequence = sequence;
+		result.frame = frame;
+		result.s = s;
+	}
+}
+
+
+/*
+====================
+CheckPrintResult
+
+====================
+*/
+static bool CheckPrintResult(const char* name, int checks, const CheckResult& result, studiohdr_t* header, float tolerance)
+{
+	printf("  %-8s %8d checks, max error %g", name, checks, result.error);
+
+	if (result.sequence >= 0)
+	{
+		auto pseqdesc = reinterpret_cast<mstudioseqdesc_t*>(reinterpret_cast<byte*>(header) + header->seqindex) + result.sequence;
+
+		printf(" (sequence %s, frame %d + %g)", pseqdesc->label, result.frame, result.s);
+	}
+
+	const bool passed = result.error <= tolerance;
+
+	printf("%s\n", passed ? "" : " - over the tolerance");
+
+	return passed;
+}
+
+
+static void PrintUsage()
+{
+	printf("usage: studio_check <model.mdl> [passes [tolerance]]\n");
+	printf("  decodes and blends every frame of the model with both the batched code and the original,\n");
+	printf("  and fails if they differ by more than 'tolerance' (default 0.001); then times 'passes'\n");
+	printf("  runs (default 10) of each over all of the frames\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const char* filename = argv[1];
+	const int passes = argc > 2 ? atoi(argv[2]) : 10;
+	const float tolerance = argc > 3 ? atof(argv[3]) : 0.001F;
+
+	CheckModel model;
+	if (!CheckLoadModel(filename, model))
+	{
+		return 1;
+	}
+
+	auto header = reinterpret_cast<studiohdr_t*>(model.data.data());
+	auto pbones = reinterpret_cast<mstudiobone_t*>(model.data.data() + header->boneindex);
+	auto pseqdescs = reinterpret_cast<mstudioseqdesc_t*>(model.data.data() + header->seqindex);
+	const int numbones = header->numbones;
+
+	printf("%s: %d bones, %d sequences, batched code is %s\n", filename, numbones, header->numseq, StudioKernelsUseSSE() ? "SSE" : "scalar");
+
+	static vec4_t q1[MAXSTUDIOBONES], q2[MAXSTUDIOBONES];
+	static float pos1[MAXSTUDIOBONES][3], pos2[MAXSTUDIOBONES][3];
+	float adj[MAXSTUDIOCONTROLLERS];
+
+	CheckResult decode = {0, -1, 0, 0};
+	CheckResult slerp = {0, -1, 0, 0};
+	int decodeChecks = 0;
+	int slerpChecks = 0;
+	int skipped = 0;
+	int frames = 0;
+
+	/* Check every frame */
+	for (int sequence = 0; sequence < header->numseq; sequence++)
+	{
+		mstudioseqdesc_t* pseqdesc = &pseqdescs[sequence];
+		mstudioanim_t* panim = CheckGetAnim(model, pseqdesc);
+
+		if (panim == nullptr)
+		{
+			skipped++;
+			continue;
+		}
+
+		for (int frame = 0; frame < pseqdesc->numframes; frame++)
+		{
+			const int nextframe = (frame + 1 < pseqdesc->numframes) ? frame + 1 : frame;
+
+			for (auto s : g_CheckFractions)
+			{
+				for (int blend = 0; blend < pseqdesc->numblends; blend++)
+				{
+					for (int turned = 0; turned < 2; turned++)
+					{
+						CheckSetControllers(adj, turned != 0);
+
+						const float error = StudioDecodeBonesCheck(g_Scratch, pbones, panim + blend * numbones, numbones, frame, s, adj, pos1, q1);
+
+						CheckRecord(decode, error, sequence, frame, s);
+						decodeChecks++;
+					}
+				}
+
+				/* Blend with the next blend, or the next frame if there's only one */
+				CheckSetControllers(adj, false);
+
+				mstudioanim_t* pnext = (pseqdesc->numblends > 1) ? panim + numbones : panim;
+
+				CheckDecodeReference(pbones, panim, numbones, frame, s, adj, pos1, q1);
+				CheckDecodeReference(pbones, pnext, numbones, nextframe, s, adj, pos2, q2);
+
+				const float error = StudioSlerpBonesCheck(q1, pos1, q2, pos2, s + 0.125F, numbones);
+
+				CheckRecord(slerp, error, sequence, frame, s);
+				slerpChecks++;
+			}
+
+			frames++;
+		}
+	}
+
+	if (skipped != 0)
+	{
+		printf("%d sequences weren't checked, because their animations couldn't be found\n", skipped);
+	}
+
+	bool passed = CheckPrintResult("decode", decodeChecks, decode, header, tolerance);
+	passed = CheckPrintResult("blend", slerpChecks, slerp, header, tolerance) && passed;
+
+	if (frames == 0)
+	{
+		return passed ? 0 : 2;
+	}
+
+	/* Time each version over all of the frames, at rest and half way to the next frame */
+	using Clock = std::chrono::steady_clock;
+
+	double decodeReference = 0.0, decodeBatch = 0.0;
+	double slerpReference = 0.0, slerpBatch = 0.0;
+
+	CheckSetControllers(adj, false);
+
+	for (int pass = 0; pass < passes; pass++)
+	{
+		for (int batch = 0; batch < 2; batch++)
+		{
+			double decodeTime = 0.0, slerpTime = 0.0;
+
+			for (int sequence = 0; sequence < header->numseq; sequence++)
+			{
+				mstudioseqdesc_t* pseqdesc = &pseqdescs[sequence];
+				mstudioanim_t* panim = CheckGetAnim(model, pseqdesc);
+
+				if (panim == nullptr)
+				{
+					continue;
+				}
+
+				for (int frame = 0; frame < pseqdesc->numframes; frame++)
+				{
+					auto start = Clock::now();
+
+					if (batch != 0)
+					{
+						StudioDecodeBones(g_Scratch, pbones, panim, numbones, frame, 0.5F, adj, pos1, q1);
+						StudioDecodeBones(g_Scratch, pbones, panim, numbones, frame, 0.5F, adj, pos2, q2);
+					}
+					else
+					{
+						CheckDecodeReference(pbones, panim, numbones, frame, 0.5F, adj, pos1, q1);
+						CheckDecodeReference(pbones, panim, numbones, frame, 0.5F, adj, pos2, q2);
+					}
+
+					auto middle = Clock::now();
+
+					if (batch != 0)
+					{
+						StudioSlerpBonesBatch(q1, pos1, q2, pos2, 0.5F, numbones);
+					}
+					else
+					{
+						StudioSlerpBonesReference(q1, pos1, q2, pos2, 0.5F, numbones);
+					}
+
+					auto end = Clock::now();
+
+					decodeTime += std::chrono::duration<double, std::nano>(middle - start).count();
+					slerpTime += std::chrono::duration<double, std::nano>(end - middle).count();
+				}
+			}
+
+			(batch != 0 ? decodeBatch : decodeReference) += decodeTime;
+			(batch != 0 ? slerpBatch : slerpReference) += slerpTime;
+		}
+	}
+
+	if (passes > 0)
+	{
+		const double bones = static_cast<double>(passes) * frames * numbones;
+
+		printf("%d passes, ns per bone:\n", passes);
+		printf("  decode   original %8.2f, batched %8.2f, speedup %.2fx\n",
+			decodeReference / (2 * bones), decodeBatch / (2 * bones), decodeReference / std::max(decodeBatch, 1.0));
+		printf("  blend    original %8.2f, batched %8.2f, speedup %.2fx\n",
+			slerpReference / bones, slerpBatch / bones, slerpReference / std::max(slerpBatch, 1.0));
+	}
+
+	return passed ? 0 : 2;
+}
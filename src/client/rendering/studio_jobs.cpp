@@ -0,0 +1,159 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Worker threads for studio model bone setup
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "studio_jobs.h"
+
+
+CStudioJobPool::~CStudioJobPool()
+{
+	/* Too late to wait for them, threads may already be gone at exit. */
+	for (auto& thread : m_Threads)
+	{
+		if (thread.joinable())
+		{
+			thread.detach();
+		}
+	}
+}
+
+
+void CStudioJobPool::SetThreadCount(int count)
+{
+	if (count == GetThreadCount())
+	{
+		return;
+	}
+
+	Shutdown();
+
+	for (auto i = 1; i <= count; i++)
+	{
+		m_Threads.emplace_back(&CStudioJobPool::WorkerThread, this, i);
+	}
+}
+
+
+void CStudioJobPool::Shutdown()
+{
+	Wait();
+
+	if (m_Threads.empty())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard guard{m_Mutex};
+		m_Quit = true;
+	}
+
+	m_Start.notify_all();
+
+	for (auto& thread : m_Threads)
+	{
+		thread.join();
+	}
+
+	m_Threads.clear();
+	m_Quit = false;
+}
+
+
+void CStudioJobPool::Dispatch(int count, Job job)
+{
+	Wait();
+
+	if (count <= 0)
+	{
+		return;
+	}
+
+	{
+		std::unique_lock lock{m_Mutex};
+
+		/* A thread that woke up late may still be looking at the last batch. */
+		m_Done.wait(lock, [this]()
+			{ return m_Active == 0; });
+
+		m_Job = std::move(job);
+		m_JobCount = count;
+		m_NextJob = 0;
+		m_Batch++;
+	}
+
+	m_Busy = true;
+
+	m_Start.notify_all();
+}
+
+
+void CStudioJobPool::Wait()
+{
+	if (!m_Busy)
+	{
+		return;
+	}
+
+	RunJobs(0);
+
+	/* Every job has been taken, so once no thread is working they're all done. */
+	std::unique_lock lock{m_Mutex};
+
+	m_Done.wait(lock, [this]()
+		{ return m_Active == 0; });
+
+	m_Busy = false;
+}
+
+
+void CStudioJobPool::RunJobs(int worker)
+{
+	while (true)
+	{
+		const int job = m_NextJob++;
+
+		if (job >= m_JobCount)
+		{
+			break;
+		}
+
+		m_Job(job, worker);
+	}
+}
+
+
+void CStudioJobPool::WorkerThread(int worker)
+{
+	unsigned int batch = 0;
+
+	while (true)
+	{
+		{
+			std::unique_lock lock{m_Mutex};
+
+			m_Start.wait(lock, [this, batch]()
+				{ return m_Quit || m_Batch != batch; });
+
+			if (m_Quit)
+			{
+				break;
+			}
+
+			batch = m_Batch;
+			m_Active++;
+		}
+
+		RunJobs(worker);
+
+		{
+			std::lock_guard guard{m_Mutex};
+			m_Active--;
+		}
+
+		m_Done.notify_all();
+	}
+}
@@ -0,0 +1,62 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Worker threads for studio model bone setup
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+A few threads kept waiting for work from the render thread. A batch of jobs
+is handed over with Dispatch, which returns straight away, so the render
+thread can get on with the frame. Wait has the render thread help with
+whatever is left and returns once every job is done.
+
+Jobs are told which worker runs them, so that each can use working space
+of its own. The render thread is worker 0.
+*/
+class CStudioJobPool
+{
+public:
+	using Job = std::function<void(int job, int worker)>;
+
+	~CStudioJobPool();
+
+	void SetThreadCount(int count); // Waits for the current batch
+	int GetThreadCount() const { return static_cast<int>(m_Threads.size()); }
+	int GetWorkerCount() const { return GetThreadCount() + 1; }
+
+	void Dispatch(int count, Job job);
+	void Wait();
+
+	bool IsBusy() const { return m_Busy; }
+
+	void Shutdown();
+
+private:
+	void WorkerThread(int worker);
+	void RunJobs(int worker);
+
+	std::vector<std::thread> m_Threads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Start;
+	std::condition_variable m_Done;
+
+	Job m_Job;
+	int m_JobCount = 0;
+	std::atomic<int> m_NextJob{0};
+
+	unsigned int m_Batch = 0;
+	int m_Active = 0; // Threads working on a batch
+	bool m_Quit = false;
+	bool m_Busy = false;
+};
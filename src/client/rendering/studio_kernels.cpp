@@ -0,0 +1,619 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Batched animation decoding & blending for studio models
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "hud.h"
+#include "cl_util.h"
+#include "com_model.h"
+#include "studio.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "studio_util.h"
+#include "studio_kernels.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define STUDIO_KERNELS_SSE
+#include <xmmintrin.h>
+#endif
+
+
+bool StudioKernelsUseSSE()
+{
+#ifdef STUDIO_KERNELS_SSE
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+/*
+====================
+StudioFindSpan
+
+Find the run of values that holds the frame, as the per bone code does.
+====================
+*/
+static mstudioanimvalue_t* StudioFindSpan(mstudioanimvalue_t* panimvalue, int& k)
+{
+	// DEBUG
+	if (panimvalue->num.total < panimvalue->num.valid)
+		k = 0;
+	while (panimvalue->num.total <= k)
+	{
+		k -= panimvalue->num.total;
+		panimvalue += panimvalue->num.valid + 1;
+		// DEBUG
+		if (panimvalue->num.total < panimvalue->num.valid)
+			k = 0;
+	}
+	return panimvalue;
+}
+
+
+/*
+====================
+StudioDecodePosition
+
+Same as StudioCalcBonePosition, before scaling.
+====================
+*/
+static float StudioDecodePosition(mstudioanimvalue_t* panimvalue, int frame, float s)
+{
+	int k = frame;
+
+	panimvalue = StudioFindSpan(panimvalue, k);
+
+	if (panimvalue->num.valid > k)
+	{
+		if (panimvalue->num.valid > k + 1)
+		{
+			return panimvalue[k + 1].value * (1.0 - s) + s * panimvalue[k + 2].value;
+		}
+
+		return panimvalue[k + 1].value;
+	}
+
+	if (panimvalue->num.total <= k + 1)
+	{
+		return panimvalue[panimvalue->num.valid].value * (1.0 - s) + s * panimvalue[panimvalue->num.valid + 2].value;
+	}
+
+	return panimvalue[panimvalue->num.valid].value;
+}
+
+
+/*
+====================
+StudioDecodeRotation
+
+Same as StudioCalcBoneQuaterion, before scaling.
+====================
+*/
+static void StudioDecodeRotation(mstudioanimvalue_t* panimvalue, int frame, float& value1, float& value2)
+{
+	int k = frame;
+
+	panimvalue = StudioFindSpan(panimvalue, k);
+
+	// Bah, missing blend!
+	if (panimvalue->num.valid > k)
+	{
+		value1 = panimvalue[k + 1].value;
+
+		if (panimvalue->num.valid > k + 1)
+		{
+			value2 = panimvalue[k + 2].value;
+		}
+		else if (panimvalue->num.total > k + 1)
+		{
+			value2 = value1;
+		}
+		else
+		{
+			value2 = panimvalue[panimvalue->num.valid + 2].value;
+		}
+	}
+	else
+	{
+		value1 = panimvalue[panimvalue->num.valid].value;
+
+		if (panimvalue->num.total > k + 1)
+		{
+			value2 = value1;
+		}
+		else
+		{
+			value2 = panimvalue[panimvalue->num.valid + 2].value;
+		}
+	}
+}
+
+
+/*
+====================
+StudioSlerp
+
+QuaternionSlerp, with the quaternion math done four components at once.
+Like QuaternionSlerp, q is flipped if it is backwards.
+====================
+*/
+#ifdef STUDIO_KERNELS_SSE
+static inline float StudioHorizontalSum(__m128 v)
+{
+	__m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(v, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	sums = _mm_add_ss(sums, shuffled);
+	return _mm_cvtss_f32(sums);
+}
+#endif
+
+static void StudioSlerp(float* p, float* q, float t, float* qt)
+{
+#ifdef STUDIO_KERNELS_SSE
+	const __m128 vp = _mm_loadu_ps(p);
+	__m128 vq = _mm_loadu_ps(q);
+
+	const __m128 difference = _mm_sub_ps(vp, vq);
+	const __m128 sum = _mm_add_ps(vp, vq);
+
+	// decide if one of the quaternions is backwards
+	if (StudioHorizontalSum(_mm_mul_ps(difference, difference)) > StudioHorizontalSum(_mm_mul_ps(sum, sum)))
+	{
+		vq = _mm_sub_ps(_mm_setzero_ps(), vq);
+		_mm_storeu_ps(q, vq);
+	}
+
+	const float cosom = StudioHorizontalSum(_mm_mul_ps(vp, vq));
+
+	if ((1.0 + cosom) > 0.000001)
+	{
+		float sclp, sclq;
+
+		if ((1.0 - cosom) > 0.000001)
+		{
+			const float omega = acos(cosom);
+			const float sinom = sin(omega);
+			sclp = sin((1.0 - t) * omega) / sinom;
+			sclq = sin(t * omega) / sinom;
+		}
+		else
+		{
+			sclp = 1.0 - t;
+			sclq = t;
+		}
+
+		_mm_storeu_ps(qt, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(sclp), vp), _mm_mul_ps(_mm_set1_ps(sclq), vq)));
+		return;
+	}
+#endif
+
+	// Opposite quaternions are rare, leave them to the original
+	vec4_t result;
+	QuaternionSlerp(p, q, t, result);
+
+	qt[0] = result[0];
+	qt[1] = result[1];
+	qt[2] = result[2];
+	qt[3] = result[3];
+}
+
+
+/*
+====================
+StudioDecodeBones
+
+====================
+*/
+void StudioDecodeBones(StudioDecodeScratch& scratch, mstudiobone_t* pbones, mstudioanim_t* panim, int numbones, int frame, float s, const float* adj, float pos[][3], vec4_t* q)
+{
+	int i, j;
+
+	// Gather the bone data and decode the run length encoded values
+	for (i = 0; i < numbones; i++)
+	{
+		mstudiobone_t* pbone = &pbones[i];
+
+		for (j = 0; j < 6; j++)
+		{
+			scratch.value[j][i] = pbone->value[j];
+			scratch.scale[j][i] = pbone->scale[j];
+			scratch.adj[j][i] = (pbone->bonecontroller[j] != -1) ? adj[pbone->bonecontroller[j]] : 0.0F;
+
+			// Nothing animated comes out as the default value
+			if (panim[i].offset[j] == 0)
+			{
+				scratch.raw1[j][i] = 0.0F;
+
+				if (j >= 3)
+				{
+					scratch.raw2[j - 3][i] = 0.0F;
+				}
+				continue;
+			}
+
+			auto panimvalue = (mstudioanimvalue_t*)((byte*)&panim[i] + panim[i].offset[j]);
+
+			if (j < 3)
+			{
+				scratch.raw1[j][i] = StudioDecodePosition(panimvalue, frame, s);
+			}
+			else
+			{
+				StudioDecodeRotation(panimvalue, frame, scratch.raw1[j][i], scratch.raw2[j - 3][i]);
+			}
+		}
+	}
+
+	// Scale into angles and positions
+#ifdef STUDIO_KERNELS_SSE
+	for (j = 0; j < 3; j++)
+	{
+		for (i = 0; i < numbones; i += 4)
+		{
+			const __m128 positionValue = _mm_load_ps(&scratch.value[j][i]);
+			const __m128 positionScale = _mm_load_ps(&scratch.scale[j][i]);
+			const __m128 positionAdj = _mm_load_ps(&scratch.adj[j][i]);
+
+			_mm_store_ps(&scratch.pos[j][i],
+				_mm_add_ps(_mm_add_ps(positionValue, _mm_mul_ps(_mm_load_ps(&scratch.raw1[j][i]), positionScale)), positionAdj));
+
+			const __m128 angleValue = _mm_load_ps(&scratch.value[j + 3][i]);
+			const __m128 angleScale = _mm_load_ps(&scratch.scale[j + 3][i]);
+			const __m128 angleAdj = _mm_load_ps(&scratch.adj[j + 3][i]);
+
+			_mm_store_ps(&scratch.angle1[j][i],
+				_mm_add_ps(_mm_add_ps(angleValue, _mm_mul_ps(_mm_load_ps(&scratch.raw1[j + 3][i]), angleScale)), angleAdj));
+			_mm_store_ps(&scratch.angle2[j][i],
+				_mm_add_ps(_mm_add_ps(angleValue, _mm_mul_ps(_mm_load_ps(&scratch.raw2[j][i]), angleScale)), angleAdj));
+		}
+	}
+#else
+	for (j = 0; j < 3; j++)
+	{
+		for (i = 0; i < numbones; i++)
+		{
+			scratch.pos[j][i] = scratch.value[j][i] + scratch.raw1[j][i] * scratch.scale[j][i] + scratch.adj[j][i];
+			scratch.angle1[j][i] = scratch.value[j + 3][i] + scratch.raw1[j + 3][i] * scratch.scale[j + 3][i] + scratch.adj[j + 3][i];
+			scratch.angle2[j][i] = scratch.value[j + 3][i] + scratch.raw2[j][i] * scratch.scale[j + 3][i] + scratch.adj[j + 3][i];
+		}
+	}
+#endif
+
+	for (i = 0; i < numbones; i++)
+	{
+		pos[i][0] = scratch.pos[0][i];
+		pos[i][1] = scratch.pos[1][i];
+		pos[i][2] = scratch.pos[2][i];
+
+		const Vector angle1{scratch.angle1[0][i], scratch.angle1[1][i], scratch.angle1[2][i]};
+		const Vector angle2{scratch.angle2[0][i], scratch.angle2[1][i], scratch.angle2[2][i]};
+
+		if (angle1 != angle2)
+		{
+			vec4_t q1, q2;
+
+			AngleQuaternion(angle1, q1);
+			AngleQuaternion(angle2, q2);
+			StudioSlerp(q1, q2, s, q[i]);
+		}
+		else
+		{
+			AngleQuaternion(angle1, q[i]);
+		}
+	}
+}
+
+
+/*
+====================
+StudioSlerpBonesBatch
+
+====================
+*/
+void StudioSlerpBonesBatch(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones)
+{
+	int i;
+
+	if (s < 0)
+		s = 0;
+	else if (s > 1.0)
+		s = 1.0;
+
+	const float s1 = 1.0 - s;
+
+	for (i = 0; i < numbones; i++)
+	{
+		StudioSlerp(q1[i], q2[i], s, q1[i]);
+	}
+
+	// The positions are blended as one flat array
+	float* a = &pos1[0][0];
+	const float* b = &pos2[0][0];
+	const int count = numbones * 3;
+
+	i = 0;
+
+#ifdef STUDIO_KERNELS_SSE
+	const __m128 weight1 = _mm_set1_ps(s1);
+	const __m128 weight2 = _mm_set1_ps(s);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(&a[i], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&a[i]), weight1), _mm_mul_ps(_mm_loadu_ps(&b[i]), weight2)));
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		a[i] = a[i] * s1 + b[i] * s;
+	}
+}
+
+
+/*
+====================
+StudioCalcBoneQuaterionReference
+
+The original one bone at a time version, which the batched code must match.
+====================
+*/
+void StudioCalcBoneQuaterionReference(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* q)
+{
+	int j, k;
+	vec4_t q1, q2;
+	Vector angle1, angle2;
+	mstudioanimvalue_t* panimvalue;
+
+	for (j = 0; j < 3; j++)
+	{
+		if (panim->offset[j + 3] == 0)
+		{
+			angle2[j] = angle1[j] = pbone->value[j + 3]; // default;
+		}
+		else
+		{
+			panimvalue = (mstudioanimvalue_t*)((byte*)panim + panim->offset[j + 3]);
+			k = frame;
+			// DEBUG
+			if (panimvalue->num.total < panimvalue->num.valid)
+				k = 0;
+			while (panimvalue->num.total <= k)
+			{
+				k -= panimvalue->num.total;
+				panimvalue += panimvalue->num.valid + 1;
+				// DEBUG
+				if (panimvalue->num.total < panimvalue->num.valid)
+					k = 0;
+			}
+			// Bah, missing blend!
+			if (panimvalue->num.valid > k)
+			{
+				angle1[j] = panimvalue[k + 1].value;
+
+				if (panimvalue->num.valid > k + 1)
+				{
+					angle2[j] = panimvalue[k + 2].value;
+				}
+				else
+				{
+					if (panimvalue->num.total > k + 1)
+						angle2[j] = angle1[j];
+					else
+						angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
+				}
+			}
+			else
+			{
+				angle1[j] = panimvalue[panimvalue->num.valid].value;
+				if (panimvalue->num.total > k + 1)
+				{
+					angle2[j] = angle1[j];
+				}
+				else
+				{
+					angle2[j] = panimvalue[panimvalue->num.valid + 2].value;
+				}
+			}
+			angle1[j] = pbone->value[j + 3] + angle1[j] * pbone->scale[j + 3];
+			angle2[j] = pbone->value[j + 3] + angle2[j] * pbone->scale[j + 3];
+		}
+
+		if (pbone->bonecontroller[j + 3] != -1)
+		{
+			angle1[j] += adj[pbone->bonecontroller[j + 3]];
+			angle2[j] += adj[pbone->bonecontroller[j + 3]];
+		}
+	}
+
+	if (angle1 != angle2)
+	{
+		AngleQuaternion(angle1, q1);
+		AngleQuaternion(angle2, q2);
+		QuaternionSlerp(q1, q2, s, q);
+	}
+	else
+	{
+		AngleQuaternion(angle1, q);
+	}
+}
+
+
+/*
+====================
+StudioCalcBonePositionReference
+
+The original one bone at a time version, which the batched code must match.
+====================
+*/
+void StudioCalcBonePositionReference(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* pos)
+{
+	int j, k;
+	mstudioanimvalue_t* panimvalue;
+
+	for (j = 0; j < 3; j++)
+	{
+		pos[j] = pbone->value[j]; // default;
+		if (panim->offset[j] != 0)
+		{
+			panimvalue = (mstudioanimvalue_t*)((byte*)panim + panim->offset[j]);
+			/*
+			if (i == 0 && j == 0)
+				Con_DPrintf("%d  %d:%d  %f\n", frame, panimvalue->num.valid, panimvalue->num.total, s );
+			*/
+
+			k = frame;
+			// DEBUG
+			if (panimvalue->num.total < panimvalue->num.valid)
+				k = 0;
+			// find span of values that includes the frame we want
+			while (panimvalue->num.total <= k)
+			{
+				k -= panimvalue->num.total;
+				panimvalue += panimvalue->num.valid + 1;
+				// DEBUG
+				if (panimvalue->num.total < panimvalue->num.valid)
+					k = 0;
+			}
+			// if we're inside the span
+			if (panimvalue->num.valid > k)
+			{
+				// and there's more data in the span
+				if (panimvalue->num.valid > k + 1)
+				{
+					pos[j] += (panimvalue[k + 1].value * (1.0 - s) + s * panimvalue[k + 2].value) * pbone->scale[j];
+				}
+				else
+				{
+					pos[j] += panimvalue[k + 1].value * pbone->scale[j];
+				}
+			}
+			else
+			{
+				// are we at the end of the repeating values section and there's another section with data?
+				if (panimvalue->num.total <= k + 1)
+				{
+					pos[j] += (panimvalue[panimvalue->num.valid].value * (1.0 - s) + s * panimvalue[panimvalue->num.valid + 2].value) * pbone->scale[j];
+				}
+				else
+				{
+					pos[j] += panimvalue[panimvalue->num.valid].value * pbone->scale[j];
+				}
+			}
+		}
+		if (pbone->bonecontroller[j] != -1 && adj)
+		{
+			pos[j] += adj[pbone->bonecontroller[j]];
+		}
+	}
+}
+
+
+/*
+====================
+StudioSlerpBonesReference
+
+The original one bone at a time version, which the batched code must match.
+====================
+*/
+void StudioSlerpBonesReference(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones)
+{
+	int i;
+	vec4_t q3;
+	float s1;
+
+	if (s < 0)
+		s = 0;
+	else if (s > 1.0)
+		s = 1.0;
+
+	s1 = 1.0 - s;
+
+	for (i = 0; i < numbones; i++)
+	{
+		QuaternionSlerp(q1[i], q2[i], s, q3);
+		q1[i][0] = q3[0];
+		q1[i][1] = q3[1];
+		q1[i][2] = q3[2];
+		q1[i][3] = q3[3];
+		pos1[i][0] = pos1[i][0] * s1 + pos2[i][0] * s;
+		pos1[i][1] = pos1[i][1] * s1 + pos2[i][1] * s;
+		pos1[i][2] = pos1[i][2] * s1 + pos2[i][2] * s;
+	}
+}
+
+
+/*
+====================
+StudioDecodeBonesCheck
+
+StudioDecodeBones, then the original alongside it.
+Returns the largest difference between them.
+====================
+*/
+float StudioDecodeBonesCheck(StudioDecodeScratch& scratch, mstudiobone_t* pbones, mstudioanim_t* panim, int numbones, int frame, float s, float* adj, float pos[][3], vec4_t* q)
+{
+	int i, j;
+	float error = 0;
+
+	StudioDecodeBones(scratch, pbones, panim, numbones, frame, s, adj, pos, q);
+
+	for (i = 0; i < numbones; i++)
+	{
+		vec4_t refq;
+		float refpos[3];
+
+		StudioCalcBoneQuaterionReference(frame, s, &pbones[i], &panim[i], adj, refq);
+		StudioCalcBonePositionReference(frame, s, &pbones[i], &panim[i], adj, refpos);
+
+		for (j = 0; j < 4; j++)
+			error = std::max(error, fabsf(refq[j] - q[i][j]));
+		for (j = 0; j < 3; j++)
+			error = std::max(error, fabsf(refpos[j] - pos[i][j]));
+	}
+
+	return error;
+}
+
+
+/*
+====================
+StudioSlerpBonesCheck
+
+StudioSlerpBonesBatch, then the original alongside it.
+Returns the largest difference between them.
+====================
+*/
+float StudioSlerpBonesCheck(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones)
+{
+	int i, j;
+	vec4_t refq1[MAXSTUDIOBONES];
+	vec4_t refq2[MAXSTUDIOBONES];
+	float refpos1[MAXSTUDIOBONES][3];
+	float error = 0;
+
+	memcpy(refq1, q1, sizeof(vec4_t) * numbones);
+	memcpy(refq2, q2, sizeof(vec4_t) * numbones);
+	memcpy(refpos1, pos1, sizeof(refpos1[0]) * numbones);
+
+	StudioSlerpBonesReference(refq1, refpos1, refq2, pos2, s, numbones);
+	StudioSlerpBonesBatch(q1, pos1, q2, pos2, s, numbones);
+
+	for (i = 0; i < numbones; i++)
+	{
+		for (j = 0; j < 4; j++)
+			error = std::max(error, fabsf(refq1[i][j] - q1[i][j]));
+		for (j = 0; j < 3; j++)
+			error = std::max(error, fabsf(refpos1[i][j] - pos1[i][j]));
+	}
+
+	return error;
+}
@@ -0,0 +1,50 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Batched animation decoding & blending for studio models
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+/*
+These do for every bone of a model at once what StudioCalcBoneQuaterion,
+StudioCalcBonePosition and StudioSlerpBones do a bone at a time. The
+animation values are decoded into arrays by component, so that turning them
+into angles and positions, and the blending, can be done four bones at a
+time with SSE where the build allows it. Otherwise the same loops run one
+bone at a time.
+*/
+
+// Working space for StudioDecodeBones
+struct StudioDecodeScratch
+{
+	// Components 0 - 2 are position, 3 - 5 are rotation
+	alignas(16) float value[6][MAXSTUDIOBONES];
+	alignas(16) float scale[6][MAXSTUDIOBONES];
+	alignas(16) float adj[6][MAXSTUDIOBONES];
+	alignas(16) float raw1[6][MAXSTUDIOBONES]; // Positions are already blended between frames
+	alignas(16) float raw2[3][MAXSTUDIOBONES]; // Rotations only
+
+	alignas(16) float angle1[3][MAXSTUDIOBONES];
+	alignas(16) float angle2[3][MAXSTUDIOBONES];
+	alignas(16) float pos[3][MAXSTUDIOBONES];
+};
+
+// Bone positions & rotations for one frame of an animation
+void StudioDecodeBones(StudioDecodeScratch& scratch, mstudiobone_t* pbones, mstudioanim_t* panim, int numbones, int frame, float s, const float* adj, float pos[][3], vec4_t* q);
+
+// Blend q2 & pos2 into q1 & pos1, like StudioSlerpBones
+void StudioSlerpBonesBatch(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones);
+
+// The original one bone at a time versions, which the batched ones must match
+void StudioCalcBoneQuaterionReference(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* q);
+void StudioCalcBonePositionReference(int frame, float s, mstudiobone_t* pbone, mstudioanim_t* panim, float* adj, float* pos);
+void StudioSlerpBonesReference(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones);
+
+// The batched versions, checked against the originals. These return the largest difference
+float StudioDecodeBonesCheck(StudioDecodeScratch& scratch, mstudiobone_t* pbones, mstudioanim_t* panim, int numbones, int frame, float s, float* adj, float pos[][3], vec4_t* q);
+float StudioSlerpBonesCheck(vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s, int numbones);
+
+// Whether the batched code uses SSE in this build
+bool StudioKernelsUseSSE();
@@ -67,4 +67,6 @@ void LinkUserMessages()
 	gmsgShooter = engine::RegUserMsg("Shooter", -1);
 
 	gmsgStatusIcon = engine::RegUserMsg("StatusIcon", -1);
+
+	gmsgLightStyle = engine::RegUserMsg("LightStyle", -1);
 }
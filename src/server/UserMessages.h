@@ -56,4 +56,6 @@ inline int gmsgShooter = 0;
 
 inline int gmsgStatusIcon = 0;
 
+inline int gmsgLightStyle = 0;
+
 void LinkUserMessages();
@@ -18,6 +18,7 @@
 
 #include "bot.h"
 #include "bot_util.h"
+#include "bot_perf.h"
 
 float g_flBotCommandInterval		= 1.0 / 30.0;	// 30 times per second, just like human clients
 float g_flBotFullThinkInterval	= 1.0 / 10.0;	// full AI only 10 times per second
@@ -40,6 +41,9 @@ CBot::CBot( Entity* containingEntity ) : CBasePlayer(containingEntity)
 	++nextID;
 
 	m_postureStackIndex = 0;
+
+	m_flNextFullBotThink = 0.0f;
+	m_flFullThinkInterval = g_flBotFullThinkInterval;
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -70,6 +74,7 @@ bool CBot::Spawn( void )
 
 	m_flNextBotThink		= gpGlobals->time + g_flBotCommandInterval;
 	m_flNextFullBotThink	= gpGlobals->time + g_flBotFullThinkInterval;
+	m_flFullThinkInterval	= g_flBotFullThinkInterval;
 	m_flPreviousCommandTime	= gpGlobals->time;
 
 	m_isRunning = true;
@@ -98,27 +103,61 @@ Vector CBot::GetAimVector( void )
 
 
 //--------------------------------------------------------------------------------------------------------------
-void CBot::BotThink( void )
+void CBot::BotThink( bool allowFullThink )
 {
 	if ( gpGlobals->time >= m_flNextBotThink )
 	{
 		m_flNextBotThink = gpGlobals->time + g_flBotCommandInterval;
 
+		// steering is timed once per command, leaving out any full think in the middle of it
+		CBotPerf::Clock::time_point steerStart = CBotPerf::Clock::now();
+		CBotPerf::Clock::duration fullThinkTime = CBotPerf::Clock::duration::zero();
+
 		Upkeep();
 
-		if ( gpGlobals->time >= m_flNextFullBotThink )
+		// a full think put off by the bot manager stays due, and happens on a later command
+		if ( allowFullThink && gpGlobals->time >= m_flNextFullBotThink )
 		{
-			m_flNextFullBotThink = gpGlobals->time + g_flBotFullThinkInterval;
+			CBotPerf::Clock::time_point fullThinkStart = CBotPerf::Clock::now();
+
+			m_flNextFullBotThink = gpGlobals->time + m_flFullThinkInterval;
 
 			ResetCommand();
 			Update();
+
+			fullThinkTime = CBotPerf::Clock::now() - fullThinkStart;
+			TheBotPerf.Add( BOT_PERF_FULL_THINK, fullThinkTime );
 		}
 
 		ExecuteCommand();
+
+		TheBotPerf.Add( BOT_PERF_STEER, CBotPerf::Clock::now() - steerStart - fullThinkTime );
 	}
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+bool CBot::IsFullThinkDue( void ) const
+{
+	return (gpGlobals->time >= m_flNextBotThink && gpGlobals->time >= m_flNextFullBotThink);
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool CBot::IsFullThinkOverdue( void ) const
+{
+	return (gpGlobals->time - m_flNextFullBotThink >= m_flFullThinkInterval);
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CBot::SetFullThinkInterval( float interval )
+{
+	m_flNextFullBotThink += interval - m_flFullThinkInterval;
+	m_flFullThinkInterval = interval;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 void CBot::MoveForward( void )
 {
@@ -160,6 +199,34 @@ void CBot::StrafeRight( void )
 	ClearBits( m_buttonFlags, IN_MOVELEFT );
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Move towards the given position, whichever way we are facing
+ */
+void CBot::MoveTowards( const Vector &pos )
+{
+	Vector2D to = (pos - v.origin).Make2D();
+
+	// split the direction to the position into forward and sideways movement relative to our view
+	float delta = atan2( to.y, to.x ) - v.v_angle.y * M_PI / 180.0f;
+	float speed = GetMoveSpeed();
+
+	m_forwardSpeed = speed * cos( delta );
+	m_strafeSpeed = -speed * sin( delta );
+
+	ClearBits( m_buttonFlags, IN_FORWARD | IN_BACK | IN_MOVELEFT | IN_MOVERIGHT );
+
+	if (m_forwardSpeed > 0.0f)
+		SetBits( m_buttonFlags, IN_FORWARD );
+	else if (m_forwardSpeed < 0.0f)
+		SetBits( m_buttonFlags, IN_BACK );
+
+	if (m_strafeSpeed > 0.0f)
+		SetBits( m_buttonFlags, IN_MOVERIGHT );
+	else if (m_strafeSpeed < 0.0f)
+		SetBits( m_buttonFlags, IN_MOVELEFT );
+}
+
 //--------------------------------------------------------------------------------------------------------------
 bool CBot::Jump( bool mustJump )
 {
@@ -102,6 +102,7 @@ public:
 	virtual void MoveBackward( void );
 	virtual void StrafeLeft( void );
 	virtual void StrafeRight( void );
+	virtual void MoveTowards( const Vector &pos );			///< move towards the given position, whichever way we are facing
 
 	#define MUST_JUMP true
 	virtual bool Jump( bool mustJump = false );				///< returns true if jump was started
@@ -192,7 +193,11 @@ public:
 	virtual Vector GetAimVector( void );
 
 	bool Spawn( void ) override;
-	void BotThink( void );
+	void BotThink( bool allowFullThink = true );			///< steer and send our commands, and think in full if allowed and due
+	bool IsFullThinkDue( void ) const;						///< return true if our next BotThink() would think in full if allowed
+	bool IsFullThinkOverdue( void ) const;					///< return true if our full think has been put off for a whole interval
+	void SetFullThinkInterval( float interval );			///< change how often we think in full, keeping our place in the current interval
+	float GetFullThinkInterval( void ) const		{ return m_flFullThinkInterval; }
 	bool IsNetClient( void ) override			{ return false; }
 #ifdef HALFLIFE_SAVERESTORE
 	int Save( CSave &save )	override			{ return 0; }
@@ -216,6 +221,7 @@ private:
 	// Think mechanism variables
 	float m_flNextBotThink;
 	float m_flNextFullBotThink;
+	float m_flFullThinkInterval;							///< chosen by the bot manager from how near the humans are
 
 	// Command interface variables
 	float m_flPreviousCommandTime;
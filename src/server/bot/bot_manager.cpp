@@ -18,12 +18,13 @@
 #include "gamerules.h"
 #include "player.h"
 #include "client.h"
-#include "perf_counter.h"
 
 #include "bot.h"
 #include "bot_manager.h"
 #include "nav_area.h"
+#include "nav_analysis.h"
 #include "bot_util.h"
+#include "bot_perf.h"
 #ifdef CSTRIKE
 #include "hostage.h"
 #include "tutor.h"
@@ -32,25 +33,6 @@
 const float smokeRadius = 115.0f;		///< for smoke grenades
 
 
-//#define CHECK_PERFORMANCE
-#ifdef CHECK_PERFORMANCE
-	// crude performance timing
-	static CPerformanceCounter perfCounter;
-
-	struct PerfInfo
-	{
-		float frameTime;
-		float botThinkTime;
-	};
-
-	#define MAX_PERF_DATA 50000
-	static PerfInfo perfData[ MAX_PERF_DATA ];
-	static int perfDataCount = 0;
-	static int perfFileIndex = 0;
-#endif
-
-
-
 /**
  * Convert name to GameEventType
  * @todo Find more appropriate place for this function
@@ -77,23 +59,6 @@ CBotManager::CBotManager()
  */
 void CBotManager::RestartRound( void )
 {
-#ifdef CHECK_PERFORMANCE
-	// dump previous round's performance
-	char filename[80];
-	sprintf( filename, "perfdata%02X.txt", perfFileIndex++ );
-	FILE *fp = fopen( filename, "w" );
-
-	if (fp)
-	{
-		for( int p=0; p<perfDataCount; ++p )
-			fprintf( fp, "%f\t%f\n", perfData[p].frameTime, perfData[p].botThinkTime );
-
-		fclose( fp );
-	}
-		
-	perfDataCount = 0;
-#endif
-
 	DestroyAllGrenades();
 }
 
@@ -103,6 +68,8 @@ void CBotManager::RestartRound( void )
  */
 void CBotManager::StartFrame( void )
 {
+	CBotPerfScope frameScope( BOT_PERF_FRAME );
+
 	// debug smoke grenade visualization
 	if (cv_bot_debug.value == 5)
 	{
@@ -157,45 +124,39 @@ void CBotManager::StartFrame( void )
 	}
 
 
-	//
-	// Process each active bot
-	//
+	// pick up any changes made to the navigation mesh
+	{
+		CBotPerfScope perfScope( BOT_PERF_NAV_MESH );
+		TheNavCompactMesh.Update();
+	}
 
-#ifdef CHECK_PERFORMANCE
-	static double lastTime = 0.0f;
-	double startTime = perfCounter.GetCurTime();
-#endif
+	// forget old danger
+	TheNavDanger.Update();
 
-	for( int i = 1; i <= gpGlobals->maxClients; ++i )
+	// where everyone is and which way they face, for the bots to share
 	{
-		CBasePlayer *pPlayer = (CBasePlayer *)util::PlayerByIndex( i );
+		CBotPerfScope perfScope( BOT_PERF_VISIBILITY );
+		m_visibility.Update();
+	}
 
-		if (!pPlayer)
-			continue;
+	//
+	// Process each active bot
+	//
 
-		if (pPlayer->IsBot() && IsEntityValid( pPlayer ))
-		{
-			CBot *pBot = static_cast<CBot *>( pPlayer );
+	// the bots near humans think in full most often, the rest take turns within our time budget
+	m_thinkScheduler.Update();
 
-			pBot->BotThink();
-		}
+	// continue path queries the bots are waiting on, within our time budget
+	{
+		CBotPerfScope perfScope( BOT_PERF_NAV_QUEUE );
+		m_pathQueue.Update( cv_bot_nav_budget.value / 1000000.0f );
 	}
 
-#ifdef CHECK_PERFORMANCE
-	if (perfDataCount < MAX_PERF_DATA)
+	// run the traces of any navigation analysis in progress
 	{
-		if (lastTime > 0.0f)
-		{
-			double endTime = perfCounter.GetCurTime();
-
-			perfData[ perfDataCount ].frameTime = (float)(startTime - lastTime);
-			perfData[ perfDataCount ].botThinkTime = (float)(endTime - startTime);
-			++perfDataCount;
-		}
-
-		lastTime = startTime;
+		CBotPerfScope perfScope( BOT_PERF_NAV_ANALYSIS );
+		TheNavAnalysis.Update( cv_bot_nav_analysis_budget.value / 1000000.0f );
 	}
-#endif
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -16,6 +16,9 @@
 #include "util.h"
 #include <list>
 #include "GameEvent.h" // Game event enum used by career mode, tutor system, and bots
+#include "nav_path_queue.h"
+#include "bot_visibility.h"
+#include "bot_think_scheduler.h"
 
 
 class CNavArea;
@@ -90,8 +93,18 @@ public:
 	bool IsLineBlockedBySmoke( const Vector *from, const Vector *to );	///< return true if line intersects smoke volume
 	bool IsInsideSmokeCloud( const Vector *pos );				///< return true if position is inside a smoke cloud
 
+	CNavPathQueue *GetPathQueue( void )							{ return &m_pathQueue; }	///< path queries made here are spread over several frames
+	CBotVisibility *GetVisibility( void )						{ return &m_visibility; }	///< what the players can see of each other, shared by all bots
+	CBotThinkScheduler *GetThinkScheduler( void )				{ return &m_thinkScheduler; }	///< how often each bot thinks in full
+
 private:
 	ActiveGrenadeList m_activeGrenadeList;///< the list of active grenades the bots are aware of
+
+	CNavPathQueue m_pathQueue;									///< pending path queries of the bots
+
+	CBotVisibility m_visibility;
+
+	CBotThinkScheduler m_thinkScheduler;
 };
 
 #endif
@@ -0,0 +1,219 @@
+// bot_perf.cpp
+// Timing of the bots' work, kept in every build so it can be looked at on a live server
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <math.h>
+#include <string>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "filesystem_utils.h"
+
+#include "bot_util.h"
+#include "bot_perf.h"
+
+
+CBotPerf TheBotPerf;
+
+
+static const char *sectionName[ NUM_BOT_PERF_SECTIONS ] =
+{
+	"frame",
+	"think",
+	"full_think",
+	"steer",
+	"target",
+	"visibility",
+	"vis_trace",
+	"nav_mesh",
+	"nav_request",
+	"nav_queue",
+	"nav_analysis",
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the position of the highest set bit of a non-zero value
+ */
+inline int HighestBit( unsigned long long value )
+{
+	int bit = 0;
+
+	if (value >> 32)	{ value >>= 32; bit += 32; }
+	if (value >> 16)	{ value >>= 16; bit += 16; }
+	if (value >> 8)		{ value >>= 8; bit += 8; }
+	if (value >> 4)		{ value >>= 4; bit += 4; }
+	if (value >> 2)		{ value >>= 2; bit += 2; }
+	if (value >> 1)		{ bit += 1; }
+
+	return bit;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotPerfHistogram::Reset( void )
+{
+	for( int b = 0; b < NUM_BUCKETS; ++b )
+		m_bucket[b] = 0;
+
+	m_count = 0;
+	m_total = 0;
+	m_max = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotPerfHistogram::Add( unsigned long long nanoseconds )
+{
+	int bucket;
+
+	if (nanoseconds < SUB_BUCKETS)
+	{
+		bucket = (int)nanoseconds;
+	}
+	else
+	{
+		// the highest bit picks the doubling, the two below it the quarter within it
+		const int bit = HighestBit( nanoseconds );
+		bucket = (bit - 1) * SUB_BUCKETS + (int)((nanoseconds >> (bit - 2)) & (SUB_BUCKETS - 1));
+	}
+
+	++m_bucket[ bucket ];
+	++m_count;
+	m_total += nanoseconds;
+
+	if (nanoseconds > m_max)
+		m_max = nanoseconds;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the first time in nanoseconds too long for the given bucket
+ */
+double CBotPerfHistogram::GetBucketUpperBound( int bucket )
+{
+	if (bucket < SUB_BUCKETS)
+		return bucket + 1;
+
+	const int bit = bucket / SUB_BUCKETS + 1;
+	const int quarter = bucket % SUB_BUCKETS;
+
+	return ldexp( (double)(SUB_BUCKETS + quarter + 1), bit - 2 );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the time in seconds that the given fraction of runs took no longer than
+ */
+double CBotPerfHistogram::GetPercentile( float fraction ) const
+{
+	if (m_count == 0)
+		return 0.0;
+
+	// the rank of the run we want, counting from 1
+	unsigned int rank = (unsigned int)ceil( fraction * m_count );
+	if (rank < 1)
+		rank = 1;
+
+	unsigned int count = 0;
+	for( int b = 0; b < NUM_BUCKETS; ++b )
+	{
+		count += m_bucket[b];
+
+		if (count >= rank)
+		{
+			// the slowest run is known exactly, so don't report more than it
+			double bound = GetBucketUpperBound( b );
+			if (bound > (double)m_max)
+				bound = (double)m_max;
+
+			return bound * 1.0e-9;
+		}
+	}
+
+	return GetMax();
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+CBotPerf::CBotPerf( void )
+{
+	Reset();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotPerf::Reset( void )
+{
+	for( int s = 0; s < NUM_BOT_PERF_SECTIONS; ++s )
+		m_histogram[s].Reset();
+
+	m_startTime = Clock::now();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+const char *CBotPerf::GetSectionName( BotPerfSection section )
+{
+	return sectionName[ section ];
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotPerf::Print( void ) const
+{
+	const double elapsed = std::chrono::duration< double >( Clock::now() - m_startTime ).count();
+
+	CONSOLE_ECHO( "Bot performance over %.1f seconds (times in microseconds):\n", elapsed );
+	CONSOLE_ECHO( "  %-14s %10s %10s %10s %10s %10s %8s\n", "section", "count", "mean", "p50", "p99", "max", "ms/sec" );
+
+	for( int s = 0; s < NUM_BOT_PERF_SECTIONS; ++s )
+	{
+		const CBotPerfHistogram &histogram = m_histogram[s];
+		const unsigned int count = histogram.GetCount();
+
+		if (count == 0)
+			continue;
+
+		CONSOLE_ECHO( "  %-14s %10u %10.1f %10.1f %10.1f %10.1f %8.2f\n",
+						sectionName[s],
+						count,
+						1.0e6 * histogram.GetTotal() / count,
+						1.0e6 * histogram.GetPercentile( 0.5f ),
+						1.0e6 * histogram.GetPercentile( 0.99f ),
+						1.0e6 * histogram.GetMax(),
+						(elapsed > 0.0) ? 1.0e3 * histogram.GetTotal() / elapsed : 0.0 );
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+bool CBotPerf::WriteCSV( const char *filename ) const
+{
+	std::string name = filename;
+	FileSystem_FixSlashes( name );
+
+	FSFile file( name.c_str(), "w", "GAMECONFIG" );
+	if (!file)
+		return false;
+
+	const double elapsed = std::chrono::duration< double >( Clock::now() - m_startTime ).count();
+
+	file.Printf( "section,count,total_us,mean_us,p50_us,p99_us,max_us,elapsed_s\n" );
+
+	for( int s = 0; s < NUM_BOT_PERF_SECTIONS; ++s )
+	{
+		const CBotPerfHistogram &histogram = m_histogram[s];
+		const unsigned int count = histogram.GetCount();
+
+		file.Printf( "%s,%u,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+						sectionName[s],
+						count,
+						1.0e6 * histogram.GetTotal(),
+						(count > 0) ? 1.0e6 * histogram.GetTotal() / count : 0.0,
+						1.0e6 * histogram.GetPercentile( 0.5f ),
+						1.0e6 * histogram.GetPercentile( 0.99f ),
+						1.0e6 * histogram.GetMax(),
+						elapsed );
+	}
+
+	return true;
+}
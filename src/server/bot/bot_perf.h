@@ -0,0 +1,108 @@
+// bot_perf.h
+// Timing of the bots' work, kept in every build so it can be looked at on a live server
+
+#ifndef _BOT_PERF_H_
+#define _BOT_PERF_H_
+
+#include <chrono>
+
+
+/**
+ * The parts of the bots' work we keep timings for
+ */
+enum BotPerfSection
+{
+	BOT_PERF_FRAME,												///< all the bot manager does in a frame
+	BOT_PERF_THINK,												///< running every bot for a frame
+	BOT_PERF_FULL_THINK,										///< one bot's full think
+	BOT_PERF_STEER,												///< one bot's steering and command
+	BOT_PERF_TARGET,											///< one bot looking for an enemy
+	BOT_PERF_VISIBILITY,										///< sharing out what the players can see, once a frame
+	BOT_PERF_VIS_TRACE,											///< one line of sight trace
+	BOT_PERF_NAV_MESH,											///< picking up changes to the navigation mesh
+	BOT_PERF_NAV_REQUEST,										///< one path request
+	BOT_PERF_NAV_QUEUE,											///< continuing the queued path searches
+	BOT_PERF_NAV_ANALYSIS,										///< continuing a navigation analysis
+
+	NUM_BOT_PERF_SECTIONS
+};
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * How long each run of a section took, kept as a histogram so we can find the median and the worst.
+ * Buckets are spaced four to each doubling of the time, so any percentile is within 20% or so.
+ */
+class CBotPerfHistogram
+{
+public:
+	CBotPerfHistogram( void )		{ Reset(); }
+
+	void Reset( void );
+	void Add( unsigned long long nanoseconds );
+
+	unsigned int GetCount( void ) const				{ return m_count; }
+	double GetTotal( void ) const					{ return m_total * 1.0e-9; }	///< seconds
+	double GetMax( void ) const						{ return m_max * 1.0e-9; }		///< seconds
+	double GetPercentile( float fraction ) const;	///< seconds, fraction in [0,1]
+
+	enum { SUB_BUCKETS = 4, NUM_BUCKETS = 64 * SUB_BUCKETS };
+
+private:
+	static double GetBucketUpperBound( int bucket );				///< nanoseconds
+
+	unsigned int m_bucket[ NUM_BUCKETS ];
+	unsigned int m_count;
+	unsigned long long m_total;
+	unsigned long long m_max;
+};
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * The timings of every section since they were last reset.
+ * These are only kept for the main thread, which is where all the sections run.
+ */
+class CBotPerf
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	CBotPerf( void );
+
+	void Add( BotPerfSection section, Clock::duration elapsed )
+	{
+		m_histogram[ section ].Add( std::chrono::duration_cast< std::chrono::nanoseconds >( elapsed ).count() );
+	}
+
+	void Reset( void );
+	void Print( void ) const;									///< show the timings on the console
+	bool WriteCSV( const char *filename ) const;				///< write the timings to a file in the game directory
+
+	static const char *GetSectionName( BotPerfSection section );
+
+private:
+	CBotPerfHistogram m_histogram[ NUM_BOT_PERF_SECTIONS ];
+	Clock::time_point m_startTime;
+};
+
+extern CBotPerf TheBotPerf;
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * Time a section from here to the end of the enclosing scope
+ */
+class CBotPerfScope
+{
+public:
+	CBotPerfScope( BotPerfSection section ) : m_section( section ), m_startTime( CBotPerf::Clock::now() ) { }
+	~CBotPerfScope()		{ TheBotPerf.Add( m_section, CBotPerf::Clock::now() - m_startTime ); }
+
+private:
+	BotPerfSection m_section;
+	CBotPerf::Clock::time_point m_startTime;
+};
+
+
+#endif // _BOT_PERF_H_
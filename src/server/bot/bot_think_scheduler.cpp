@@ -0,0 +1,191 @@
+// bot_think_scheduler.cpp
+// Decides which bots get to think in full each frame, and how often
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+
+#include "bot.h"
+#include "bot_manager.h"
+#include "bot_util.h"
+#include "bot_perf.h"
+#include "bot_think_scheduler.h"
+
+
+//--------------------------------------------------------------------------------------------------------------
+CBotThinkScheduler::CBotThinkScheduler( void )
+{
+	Reset();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotThinkScheduler::Reset( void )
+{
+	m_cursor = 0;
+
+	ResetStats();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotThinkScheduler::ResetStats( void )
+{
+	for( int i = 0; i < NUM_DETAIL_LEVELS; ++i )
+		m_fullThinkCount[i] = 0;
+
+	m_deferCount = 0;
+	m_frameCount = 0;
+	m_thinkTime = 0.0;
+	m_statsStartTime = (gpGlobals != nullptr) ? gpGlobals->time : 0.0f;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return how often a bot at the given level of detail thinks in full
+ */
+float CBotThinkScheduler::GetFullThinkInterval( DetailLevel level )
+{
+	switch( level )
+	{
+		case DETAIL_MID:
+			return 2.0f * g_flBotFullThinkInterval;
+
+		case DETAIL_FAR:
+			return 4.0f * g_flBotFullThinkInterval;
+
+		default:
+			return g_flBotFullThinkInterval;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Work out how closely the humans can see this bot, from the nearest of them.
+ * Spectators count from wherever their view is, and any spectator watching the bot puts it nearest of all.
+ */
+CBotThinkScheduler::DetailLevel CBotThinkScheduler::ComputeDetailLevel( CBot *bot ) const
+{
+	if (cv_bot_think_lod.value <= 0.0f)
+		return DETAIL_NEAR;
+
+	const int botIndex = bot->v.GetIndex();
+	float closeRangeSq = 999999999.9f;
+
+	for( int i = 1; i <= gpGlobals->maxClients; ++i )
+	{
+		CBasePlayer *player = static_cast<CBasePlayer *>( util::PlayerByIndex( i ) );
+
+		if (player == nullptr)
+			continue;
+
+		if (STRING(player->v.netname)[0] == '\0')
+			continue;
+
+		if (player->IsBot())
+			continue;
+
+		if (player->IsObserver() && player->v.iuser2 == botIndex)
+			return DETAIL_NEAR;
+
+		const float rangeSq = (player->v.origin - bot->v.origin).LengthSquared();
+		if (rangeSq < closeRangeSq)
+			closeRangeSq = rangeSq;
+	}
+
+	if (closeRangeSq < cv_bot_think_near.value * cv_bot_think_near.value)
+		return DETAIL_NEAR;
+
+	if (closeRangeSq < cv_bot_think_far.value * cv_bot_think_far.value)
+		return DETAIL_MID;
+
+	return DETAIL_FAR;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run every bot for this frame, handing out the full thinks that are due within our time budget
+ */
+void CBotThinkScheduler::Update( void )
+{
+	CBotPerfScope perfScope( BOT_PERF_THINK );
+
+	const int maxClients = gpGlobals->maxClients;
+	if (maxClients <= 0)
+		return;
+
+	const std::chrono::duration< double > budget( cv_bot_think_budget.value / 1000000.0 );
+	const CBotPerf::Clock::time_point startTime = CBotPerf::Clock::now();
+	bool isOverBudget = false;
+	int lastFullThink = 0;
+
+	// start after the last bot given a full think, so that any put off last frame go first
+	for( int n = 0; n < maxClients; ++n )
+	{
+		const int i = 1 + (m_cursor + n) % maxClients;
+
+		CBasePlayer *player = static_cast<CBasePlayer *>( util::PlayerByIndex( i ) );
+
+		if (player == nullptr)
+			continue;
+
+		if (!player->IsBot() || !IsEntityValid( player ))
+			continue;
+
+		CBot *bot = static_cast<CBot *>( player );
+
+		// a human may have come closer since this bot last thought, so keep its interval up to date
+		const DetailLevel level = ComputeDetailLevel( bot );
+		bot->SetFullThinkInterval( GetFullThinkInterval( level ) );
+
+		bool allowFullThink = false;
+
+		if (bot->IsFullThinkDue())
+		{
+			// always make some progress, and never put a bot off for longer than its own interval
+			if (lastFullThink == 0 || !isOverBudget || bot->IsFullThinkOverdue())
+			{
+				allowFullThink = true;
+				lastFullThink = i;
+				++m_fullThinkCount[ level ];
+			}
+			else
+			{
+				++m_deferCount;
+			}
+		}
+
+		bot->BotThink( allowFullThink );
+
+		if (budget.count() > 0.0 && !isOverBudget && CBotPerf::Clock::now() - startTime >= budget)
+			isOverBudget = true;
+	}
+
+	if (lastFullThink != 0)
+		m_cursor = lastFullThink;
+
+	++m_frameCount;
+	m_thinkTime += std::chrono::duration< double >( CBotPerf::Clock::now() - startTime ).count();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotThinkScheduler::PrintStats( void )
+{
+	const float elapsed = gpGlobals->time - m_statsStartTime;
+
+	unsigned int total = 0;
+	for( int i = 0; i < NUM_DETAIL_LEVELS; ++i )
+		total += m_fullThinkCount[i];
+
+	CONSOLE_ECHO( "Bot think: %u full thinks (%u near, %u mid, %u far), %u put off, over %.1f seconds\n",
+					total, m_fullThinkCount[ DETAIL_NEAR ], m_fullThinkCount[ DETAIL_MID ], m_fullThinkCount[ DETAIL_FAR ],
+					m_deferCount, elapsed );
+
+	if (m_frameCount > 0)
+		CONSOLE_ECHO( "  %.1f microseconds per frame running bots (cv_bot_think_budget %g us)\n",
+						1000000.0 * m_thinkTime / m_frameCount, cv_bot_think_budget.value );
+
+	if (elapsed > 0.0f)
+		CONSOLE_ECHO( "  %.1f full thinks per second\n", total / elapsed );
+}
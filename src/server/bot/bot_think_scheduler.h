@@ -0,0 +1,55 @@
+// bot_think_scheduler.h
+// Decides which bots get to think in full each frame, and how often
+
+#ifndef _BOT_THINK_SCHEDULER_H_
+#define _BOT_THINK_SCHEDULER_H_
+
+class CBot;
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * Every bot steers and sends its movement commands at the usual rate, but the full think,
+ * where it picks its targets and asks for paths, is given out here.
+ *
+ * Bots near a human, or being spectated by one, think in full as often as ever. Bots further
+ * away think less often, as no one is there to notice. The full thinks due each frame are given
+ * out in turn, starting after the last bot to have one, until 'cv_bot_think_budget' microseconds
+ * have been spent. Those left over go first next frame. A bot is never put off for longer than
+ * its own interval, whatever the budget.
+ */
+class CBotThinkScheduler
+{
+public:
+	CBotThinkScheduler( void );
+
+	enum DetailLevel
+	{
+		DETAIL_NEAR,											///< near a human, or spectated
+		DETAIL_MID,
+		DETAIL_FAR,
+
+		NUM_DETAIL_LEVELS
+	};
+
+	void Reset( void );											///< forget everything, such as when the map changes
+	void Update( void );										///< invoked each frame to run the bots
+
+	DetailLevel ComputeDetailLevel( CBot *bot ) const;			///< how closely the humans can see this bot
+	static float GetFullThinkInterval( DetailLevel level );
+
+	void PrintStats( void );
+	void ResetStats( void );
+
+private:
+	int m_cursor;												///< index of the last bot given a full think
+
+	unsigned int m_fullThinkCount[ NUM_DETAIL_LEVELS ];
+	unsigned int m_deferCount;									///< full thinks put off to a later frame
+	unsigned int m_frameCount;
+	double m_thinkTime;											///< seconds spent running the bots
+	float m_statsStartTime;
+};
+
+
+#endif // _BOT_THINK_SCHEDULER_H_
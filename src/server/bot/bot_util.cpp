@@ -478,6 +478,45 @@ bool UTIL_IsVisibleToTeam( const Vector &spot, int team, float maxRange )
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if anyone on the given team can see the given player.
+ * Lines of sight between players are shared with the bots through the bot manager.
+ */
+bool UTIL_IsVisibleToTeam( CBasePlayer *player, int team, float maxRange )
+{
+	if (g_pBotMan == nullptr)
+		return UTIL_IsVisibleToTeam( player->BodyTarget(), team, maxRange );
+
+	CBotVisibility *visibility = g_pBotMan->GetVisibility();
+
+	for( int i = 1; i <= gpGlobals->maxClients; ++i )
+	{
+		CBasePlayer *viewer = static_cast<CBasePlayer *>( util::PlayerByIndex( i ) );
+
+		if (viewer == nullptr || viewer == player)
+			continue;
+
+		if (STRING(viewer->v.netname)[0] == '\0')
+			continue;
+
+		if (!viewer->IsAlive())
+			continue;
+
+		if (viewer->TeamNumber() != team)
+			continue;
+
+		if (maxRange > 0.0f && visibility->GetRange( viewer, player ) > maxRange)
+			continue;
+
+		if (visibility->IsLineOfSightClear( viewer, player ))
+			return true;
+	}
+
+	return false;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 
 
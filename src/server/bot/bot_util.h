@@ -52,6 +52,13 @@ extern cvar_t cv_bot_zombie;
 extern cvar_t cv_bot_defer_to_human;
 extern cvar_t cv_bot_chatter;
 extern cvar_t cv_bot_profile_db;
+extern cvar_t cv_bot_nav_budget;
+extern cvar_t cv_bot_nav_analysis_budget;
+extern cvar_t cv_bot_vis_interval;
+extern cvar_t cv_bot_think_lod;
+extern cvar_t cv_bot_think_near;
+extern cvar_t cv_bot_think_far;
+extern cvar_t cv_bot_think_budget;
 
 #ifdef TERRORSTRIKE
 extern cvar_t cv_zombie_near_spawn;
@@ -95,6 +102,7 @@ extern CBasePlayer *UTIL_GetClosestEnemyPlayer( CBasePlayer *self, float *distan
 extern bool UTIL_KickBotFromTeam( int kickTeam ); ///< kick a bot from the given team. If no bot exists on the team, return false.
 
 extern bool UTIL_IsVisibleToTeam( const Vector &spot, int team, float maxRange = -1.0f ); ///< return true if anyone on the given team can see the given spot
+extern bool UTIL_IsVisibleToTeam( CBasePlayer *player, int team, float maxRange = -1.0f ); ///< return true if anyone on the given team can see the given player
 
 extern const char * UTIL_GetBotPrefix(); ///< returns the bot prefix string.
 extern void UTIL_ConstructBotNetName(char *name, int nameLength, const BotProfile *bot);
@@ -0,0 +1,232 @@
+// bot_visibility.cpp
+// What each player can see of the others, shared by all bots for the frame
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+
+#include "bot_util.h"
+#include "bot_visibility.h"
+#include "bot_perf.h"
+
+
+/**
+ * How far either player may move before a line of sight is traced again, however recent it is
+ */
+const float VisibilityDriftTolerance = 16.0f;
+
+
+//--------------------------------------------------------------------------------------------------------------
+CBotVisibility::CBotVisibility( void )
+{
+	Reset();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotVisibility::Reset( void )
+{
+	for( int i = 0; i <= MAX_PLAYERS; ++i )
+	{
+		for( int j = 0; j <= MAX_PLAYERS; ++j )
+		{
+			m_entry[i][j].frame = -1;
+			m_entry[i][j].traceTime = -1.0f;
+			m_rangeFrame[i][j] = -1;
+		}
+
+		m_forwardFrame[i] = -1;
+	}
+
+	m_frame = 0;
+
+	ResetStats();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotVisibility::ResetStats( void )
+{
+	m_queryCount = 0;
+	m_traceCount = 0;
+	m_statsStartTime = (gpGlobals != nullptr) ? gpGlobals->time : 0.0f;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Work out the range between every pair of live players.
+ * Facing changes as the bots aim during their thinks, so it is worked out when asked for.
+ */
+void CBotVisibility::Update( void )
+{
+	++m_frame;
+
+	CBasePlayer *live[ MAX_PLAYERS ];
+	int liveCount = 0;
+
+	for( int i = 1; i <= gpGlobals->maxClients && i <= MAX_PLAYERS; ++i )
+	{
+		CBasePlayer *player = static_cast<CBasePlayer *>( util::PlayerByIndex( i ) );
+
+		if (player == nullptr || !player->IsAlive())
+			continue;
+
+		live[ liveCount++ ] = player;
+	}
+
+	for( int i = 0; i < liveCount; ++i )
+	{
+		for( int j = i+1; j < liveCount; ++j )
+			UpdateRange( live[i], live[j] );
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotVisibility::UpdateFacing( CBasePlayer *player )
+{
+	const int index = player->v.GetIndex();
+
+	if (m_forwardFrame[ index ] == m_frame && m_forwardAngles[ index ] == player->v.angles)
+		return;
+
+	util::MakeVectors( player->v.angles );
+
+	m_forward[ index ] = gpGlobals->v_forward;
+	m_forwardAngles[ index ] = player->v.angles;
+	m_forwardFrame[ index ] = m_frame;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotVisibility::UpdateDot( CBasePlayer *viewer, CBasePlayer *target, Entry *entry )
+{
+	UpdateFacing( viewer );
+
+	const Vector los = (target->BodyTarget() - viewer->EyePosition()).Normalize();
+
+	entry->dot = DotProduct( los, m_forward[ viewer->v.GetIndex() ] );
+	entry->frame = m_frame;
+	entry->angles = viewer->v.angles;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotVisibility::UpdateRange( CBasePlayer *viewer, CBasePlayer *target )
+{
+	const int viewerIndex = viewer->v.GetIndex();
+	const int targetIndex = target->v.GetIndex();
+
+	const float range = (target->Center() - viewer->Center()).Length();
+
+	m_range[ viewerIndex ][ targetIndex ] = range;
+	m_range[ targetIndex ][ viewerIndex ] = range;
+	m_rangeFrame[ viewerIndex ][ targetIndex ] = m_frame;
+	m_rangeFrame[ targetIndex ][ viewerIndex ] = m_frame;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+CBotVisibility::Entry *CBotVisibility::GetEntry( CBasePlayer *viewer, CBasePlayer *target )
+{
+	const int viewerIndex = viewer->v.GetIndex();
+	const int targetIndex = target->v.GetIndex();
+
+	if (viewerIndex < 1 || viewerIndex > MAX_PLAYERS || targetIndex < 1 || targetIndex > MAX_PLAYERS)
+		return nullptr;
+
+	return &m_entry[ viewerIndex ][ targetIndex ];
+}
+
+//--------------------------------------------------------------------------------------------------------------
+float CBotVisibility::GetRange( CBasePlayer *viewer, CBasePlayer *target )
+{
+	Entry *entry = GetEntry( viewer, target );
+
+	if (entry == nullptr)
+		return (target->Center() - viewer->Center()).Length();
+
+	// players who joined or came back to life since the start of the frame
+	if (m_rangeFrame[ viewer->v.GetIndex() ][ target->v.GetIndex() ] != m_frame)
+		UpdateRange( viewer, target );
+
+	return m_range[ viewer->v.GetIndex() ][ target->v.GetIndex() ];
+}
+
+//--------------------------------------------------------------------------------------------------------------
+float CBotVisibility::GetDot( CBasePlayer *viewer, CBasePlayer *target )
+{
+	Entry *entry = GetEntry( viewer, target );
+
+	if (entry == nullptr)
+	{
+		util::MakeVectors( viewer->v.angles );
+		return DotProduct( (target->BodyTarget() - viewer->EyePosition()).Normalize(), gpGlobals->v_forward );
+	}
+
+	// the viewer may have turned since it was last asked about this frame
+	if (entry->frame != m_frame || entry->angles != viewer->v.angles)
+		UpdateDot( viewer, target, entry );
+
+	return entry->dot;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if nothing blocks the viewer's eyes from the target's body.
+ * The last trace is used if it is recent enough, and neither player has moved far since.
+ */
+bool CBotVisibility::IsLineOfSightClear( CBasePlayer *viewer, CBasePlayer *target )
+{
+	++m_queryCount;
+
+	const Vector eye = viewer->EyePosition();
+	const Vector body = target->BodyTarget();
+
+	Entry *entry = GetEntry( viewer, target );
+
+	if (entry != nullptr && entry->traceTime >= 0.0f)
+	{
+		const float age = gpGlobals->time - entry->traceTime;
+
+		if (age >= 0.0f && age < cv_bot_vis_interval.value / 1000.0f
+			&& (eye - entry->traceEye) < VisibilityDriftTolerance
+			&& (body - entry->traceBody) < VisibilityDriftTolerance)
+		{
+			return entry->isClear;
+		}
+	}
+
+	++m_traceCount;
+
+	TraceResult result;
+	{
+		CBotPerfScope perfScope( BOT_PERF_VIS_TRACE );
+		util::TraceLine( eye, body, util::ignore_monsters, viewer, &result );
+	}
+
+	const bool isClear = (result.flFraction == 1.0f || result.pHit == &target->v);
+
+	if (entry != nullptr)
+	{
+		entry->isClear = isClear;
+		entry->traceTime = gpGlobals->time;
+		entry->traceEye = eye;
+		entry->traceBody = body;
+	}
+
+	return isClear;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CBotVisibility::PrintStats( void )
+{
+	const float elapsed = gpGlobals->time - m_statsStartTime;
+	const unsigned int saved = m_queryCount - m_traceCount;
+
+	CONSOLE_ECHO( "Bot visibility: %u line of sight queries, %u traced, %u reused (%.1f%%) over %.1f seconds\n",
+					m_queryCount, m_traceCount, saved,
+					(m_queryCount > 0) ? 100.0f * saved / m_queryCount : 0.0f,
+					elapsed );
+
+	if (elapsed > 0.0f)
+		CONSOLE_ECHO( "  %.1f traces per second, %.1f traces per second saved (cv_bot_vis_interval %g ms)\n",
+						m_traceCount / elapsed, saved / elapsed, cv_bot_vis_interval.value );
+}
@@ -0,0 +1,71 @@
+// bot_visibility.h
+// What each player can see of the others, shared by all bots for the frame
+
+#ifndef _BOT_VISIBILITY_H_
+#define _BOT_VISIBILITY_H_
+
+#include "cdll_dll.h"
+
+class CBasePlayer;
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * For every pair of live players, how far apart they are, how squarely each faces the other,
+ * and whether each has a clear line from its eyes to the body of the other.
+ *
+ * Ranges are cheap, and are worked out for everyone at the start of each frame.
+ * Facing is worked out when asked for, as bots turn while they aim during their thinks, and is
+ * reused for as long as the viewer's angles stay the same.
+ * Lines of sight are traced when first asked for, and reused until they are 'cv_bot_vis_interval'
+ * milliseconds old, or until either player moves too far from where they were traced.
+ * Lines of sight go one way, as a line from A's eyes to B's body is not the line from B's to A's.
+ */
+class CBotVisibility
+{
+public:
+	CBotVisibility( void );
+
+	void Reset( void );											///< forget everything, such as when the map changes
+	void Update( void );										///< invoked at the start of each frame
+
+	float GetRange( CBasePlayer *viewer, CBasePlayer *target );	///< distance between the centers of the two players
+	float GetDot( CBasePlayer *viewer, CBasePlayer *target );	///< cosine of the angle between the viewer's facing and the target's body
+	bool IsLineOfSightClear( CBasePlayer *viewer, CBasePlayer *target );	///< return true if nothing blocks the viewer's eyes from the target's body
+
+	void PrintStats( void );
+	void ResetStats( void );
+
+private:
+	struct Entry
+	{
+		float dot;
+		int frame;												///< the frame 'dot' was worked out in
+		Vector angles;											///< and the viewer's angles it was worked out for
+
+		bool isClear;
+		float traceTime;										///< when the line of sight was traced, negative if never
+		Vector traceEye;										///< where the viewer's eyes and the target's body were then
+		Vector traceBody;
+	};
+
+	Entry *GetEntry( CBasePlayer *viewer, CBasePlayer *target );	///< nullptr if either isn't a player
+	void UpdateFacing( CBasePlayer *player );
+	void UpdateDot( CBasePlayer *viewer, CBasePlayer *target, Entry *entry );
+	void UpdateRange( CBasePlayer *viewer, CBasePlayer *target );
+
+	Entry m_entry[ MAX_PLAYERS + 1 ][ MAX_PLAYERS + 1 ];		///< by viewer, then target
+	float m_range[ MAX_PLAYERS + 1 ][ MAX_PLAYERS + 1 ];		///< the same both ways
+	int m_rangeFrame[ MAX_PLAYERS + 1 ][ MAX_PLAYERS + 1 ];
+	Vector m_forward[ MAX_PLAYERS + 1 ];						///< facing of each player this frame
+	Vector m_forwardAngles[ MAX_PLAYERS + 1 ];					///< the angles 'm_forward' was worked out from
+	int m_forwardFrame[ MAX_PLAYERS + 1 ];
+	int m_frame;
+
+	unsigned int m_queryCount;
+	unsigned int m_traceCount;
+	float m_statsStartTime;
+};
+
+
+#endif // _BOT_VISIBILITY_H_
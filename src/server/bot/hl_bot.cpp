@@ -17,6 +17,8 @@
 #include "bot.h"
 #include "bot_util.h"
 #include "bot_profile.h"
+#include "bot_perf.h"
+#include "nav_area.h"
 
 #include "hl_bot.h"
 
@@ -24,6 +26,9 @@
 CHLBot::CHLBot(Entity* containingEntity) : CBot(containingEntity)
 {
     m_pEnemy = nullptr;
+    m_pathIndex = 0;
+    m_repathTime = 0.0f;
+    m_pathProgressTime = 0.0f;
 }
 
 
@@ -51,11 +56,14 @@ bool CHLBot::Initialize(const BotProfile* profile)
 void CHLBot::SpawnBot()
 {
     m_pEnemy = nullptr;
+    DestroyPath();
 }
 
 
 void CHLBot::Upkeep()
 {
+    UpdatePathMovement();
+
     if (!m_pEnemy)
     {
         return;
@@ -74,19 +82,26 @@ void CHLBot::Update()
         g_pGameRules->ChangePlayerTeam(this, g_pGameRules->GetDefaultPlayerTeam(this), false, false, true);
         return;
     }
+    UpdatePath();
     if (!m_pActiveWeapon || m_pActiveWeapon->m_iClip == 0)
     {
         ClearPrimaryAttack();
         return;
     }
-    float distance;
-    if (!m_pEnemy)
     {
-        m_pEnemy = UTIL_GetClosestEnemyPlayer(this, &distance);
+        CBotPerfScope perfScope(BOT_PERF_TARGET);
+        float distance;
+        if (!m_pEnemy)
+        {
+            m_pEnemy = UTIL_GetClosestEnemyPlayer(this, &distance);
+        }
+        if (m_pEnemy && !IsVisible(m_pEnemy))
+        {
+            m_pEnemy = nullptr;
+        }
     }
-    if (!m_pEnemy || !IsVisible(m_pEnemy))
+    if (!m_pEnemy)
     {
-        m_pEnemy = nullptr;
         ClearPrimaryAttack();
         return;
     }
@@ -95,6 +110,180 @@ void CHLBot::Update()
 }
 
 
+/* Head for the closest enemy, asking for a new path when they get away from the end of ours. */
+void CHLBot::UpdatePath()
+{
+    if (!IsAlive() || TheNavAreaList.empty())
+    {
+        DestroyPath();
+        return;
+    }
+
+    float distance;
+    auto enemy = UTIL_GetClosestEnemyPlayer(this, &distance);
+    if (!enemy)
+    {
+        DestroyPath();
+        return;
+    }
+
+    /* Give up on a path we are not making any progress along. */
+    const auto stuckTime = 3.0f;
+    if (m_path.IsValid() && gpGlobals->time - m_pathProgressTime > stuckTime)
+    {
+        DestroyPath();
+    }
+
+    const auto repathRange = 200.0f;
+    if (m_path.IsValid() && (enemy->v.origin - m_pathGoal) < repathRange)
+    {
+        UpdatePathMovement();
+        return;
+    }
+
+    if (m_repathTime <= gpGlobals->time)
+    {
+        ComputePath(enemy->v.origin);
+    }
+
+    UpdatePathMovement();
+}
+
+
+/*
+Ask the bot manager for a path to the goal. Long searches are spread over
+several frames, so we head straight for the goal until the path is ready.
+*/
+bool CHLBot::ComputePath(const Vector& goal)
+{
+    const auto repathInterval = 2.0f;
+
+    m_pathGoal = goal;
+    m_pathIndex = 1;
+    m_pathProgressTime = gpGlobals->time;
+    m_repathTime = gpGlobals->time + repathInterval;
+
+    ShortestPathCost cost;
+    NavPathSearchStatus status;
+    {
+        CBotPerfScope perfScope(BOT_PERF_NAV_REQUEST);
+        status = g_pBotMan->GetPathQueue()->Request(this, &m_path, &v.origin, &goal, cost);
+    }
+    switch (status)
+    {
+    case NAV_SEARCH_FOUND:
+        return true;
+    case NAV_SEARCH_IN_PROGRESS:
+        m_path.BuildTrivialPath(&v.origin, &goal);
+        return true;
+    default:
+        return false;
+    }
+}
+
+
+void CHLBot::DestroyPath()
+{
+    if (g_pBotMan != nullptr)
+    {
+        g_pBotMan->GetPathQueue()->Cancel(this);
+    }
+    m_path.Invalidate();
+    m_pathIndex = 0;
+    m_repathTime = 0.0f;
+}
+
+
+void CHLBot::OnPathComputed(CNavPath* path, bool pathToGoalExists)
+{
+    if (!path->IsValid())
+    {
+        return;
+    }
+
+    /* We kept moving while we waited, so pick up the path at the nearest of its first few segments. */
+    const auto maxSkip = 8;
+    auto closest = 1;
+    auto closestRangeSq = 999999999.9f;
+    for (auto i = 1; i < path->GetSegmentCount() && i <= maxSkip; i++)
+    {
+        const auto rangeSq = ((*path)[i]->pos - v.origin).Make2D().LengthSquared();
+        if (rangeSq < closestRangeSq)
+        {
+            closest = i;
+            closestRangeSq = rangeSq;
+        }
+    }
+
+    m_pathIndex = closest;
+    m_pathProgressTime = gpGlobals->time;
+}
+
+
+/* Move towards the next segment of our path, whichever way we are looking. */
+void CHLBot::UpdatePathMovement()
+{
+    if (!m_path.IsValid() || !IsAlive())
+    {
+        return;
+    }
+
+    const auto feet = Vector(v.origin.x, v.origin.y, v.origin.z + v.mins.z);
+    const auto reachedRange = 20.0f;
+
+    const CNavPath::PathSegment* segment;
+    while ((segment = m_path[m_pathIndex]) != nullptr)
+    {
+        const auto to = segment->pos - feet;
+        const auto isLadder = segment->how == GO_LADDER_UP || segment->how == GO_LADDER_DOWN;
+        if (to.Make2D() > reachedRange || (isLadder && fabs(to.z) > HalfHumanHeight))
+        {
+            break;
+        }
+        m_pathIndex++;
+        m_pathProgressTime = gpGlobals->time;
+    }
+
+    if (segment == nullptr)
+    {
+        /* We have arrived. */
+        m_path.Invalidate();
+        return;
+    }
+
+    /* Look where we are going, unless we are busy with an enemy. */
+    if (!m_pEnemy)
+    {
+        const auto eyes = EyePosition();
+        const auto target = segment->pos + Vector(0, 0, v.view_ofs.z - v.mins.z);
+        v.v_angle = util::VecToAngles(target - eyes);
+        v.v_angle.x = -v.v_angle.x;
+    }
+
+    MoveTowards(segment->pos);
+
+    if (segment->area != nullptr && (segment->area->GetAttributes() & NAV_CROUCH) != 0)
+    {
+        Crouch();
+    }
+    else
+    {
+        StandUp();
+    }
+
+    const auto jumpRange = 64.0f;
+    if (segment->how != GO_LADDER_UP && segment->how != GO_LADDER_DOWN
+     && segment->pos.z - feet.z > StepHeight && (segment->pos - feet).Make2D() < jumpRange)
+    {
+        Jump();
+    }
+    else if (segment->area != nullptr && (segment->area->GetAttributes() & NAV_JUMP) != 0)
+    {
+        Jump();
+    }
+}
+
+
 bool CHLBot::IsVisible(const Vector* pos, bool testFOV = false)
 {
     return true;
@@ -121,29 +310,16 @@ bool CHLBot::IsVisible(CBasePlayer* player, bool testFOV = false, unsigned char*
         return false;
     }
 
-    util::MakeVectors(v.angles);
-
-	const auto los = (player->BodyTarget() - EyePosition()).Normalize();
-	const auto dot = DotProduct(los, gpGlobals->v_forward);
+    /* The other bots have likely asked about the same players this frame. */
+    auto visibility = g_pBotMan->GetVisibility();
 
     /* The player is out of our field of view. */
-	if (dot <= 0.1F)
-	{
-		return false;
-	}
-
-    TraceResult tr;
-    auto start = GetGunPosition();
-    auto end = player->BodyTarget();
-
-    util::TraceLine(start, end, util::ignore_monsters, this, &tr);
-
-    if (tr.flFraction != 1.0f && tr.pHit != &player->v)
+    if (visibility->GetDot(this, player) <= 0.1F)
     {
         return false;
     }
 
-    return true;
+    return visibility->IsLineOfSightClear(this, player);
 }
 
 
@@ -9,8 +9,9 @@
 #define HL_BOT_H
 
 #include "bot.h"
+#include "nav_path_queue.h"
 
-class CHLBot : public CBot
+class CHLBot : public CBot, public INavPathListener
 {
 public:
 	CHLBot(Entity* containingEntity);
@@ -25,8 +26,21 @@ public:
 
 	bool IsEnemyPartVisible(VisiblePartType part) override;
 
+	void OnPathComputed(CNavPath* path, bool pathToGoalExists) override;
+
 protected:
+	void UpdatePath();
+	void UpdatePathMovement();
+	bool ComputePath(const Vector& goal);
+	void DestroyPath();
+
 	CBaseEntity *m_pEnemy;
+
+	CNavPath m_path;
+	int m_pathIndex;			// the path segment we are moving towards
+	Vector m_pathGoal;			// where the path was computed to
+	float m_repathTime;			// when we may ask for another path
+	float m_pathProgressTime;	// when we last reached a path segment
 };
 
 #endif // HL_BOT_H
@@ -12,13 +12,16 @@
 #include "gamerules.h"
 #include "player.h"
 #include "client.h"
-#include "perf_counter.h"
 
 #include "bot.h"
 #include "bot_manager.h"
 #include "nav_area.h"
+#include "nav_path.h"
+#include "nav_bench.h"
+#include "nav_analysis.h"
 #include "bot_util.h"
 #include "bot_profile.h"
+#include "bot_perf.h"
 
 #include "hl_bot.h"
 #include "hl_bot_manager.h"
@@ -46,15 +49,27 @@ cvar_t cv_bot_zombie					= {"cv_bot_zombie",					"0",			FCVAR_SERVER};
 cvar_t cv_bot_defer_to_human			= {"cv_bot_defer_to_human",			"0",			FCVAR_SERVER};
 cvar_t cv_bot_chatter					= {"cv_bot_chatter",				"0",			FCVAR_SERVER};
 cvar_t cv_bot_profile_db				= {"cv_bot_profile_db",				"BotProfile.db",FCVAR_SERVER};
+cvar_t cv_bot_nav_budget				= {"cv_bot_nav_budget",				"500",			FCVAR_SERVER};
+cvar_t cv_bot_nav_analysis_budget		= {"cv_bot_nav_analysis_budget",	"20000",		FCVAR_SERVER};
+cvar_t cv_bot_vis_interval				= {"cv_bot_vis_interval",			"100",			FCVAR_SERVER};
+cvar_t cv_bot_think_lod					= {"cv_bot_think_lod",				"1",			FCVAR_SERVER};
+cvar_t cv_bot_think_near				= {"cv_bot_think_near",				"1000",			FCVAR_SERVER};
+cvar_t cv_bot_think_far					= {"cv_bot_think_far",				"2500",			FCVAR_SERVER};
+cvar_t cv_bot_think_budget				= {"cv_bot_think_budget",			"1000",			FCVAR_SERVER};
 
 
 CHLBotManager::CHLBotManager()
 {
+	AddServerCommands();
 }
 
 
 void CHLBotManager::ClientDisconnect(CBasePlayer *pPlayer)
 {
+	if (pPlayer->IsBot())
+	{
+		GetPathQueue()->Cancel(static_cast<CHLBot *>(pPlayer));
+	}
 	m_NextQuotaCheckTime = gpGlobals->time;
 }
 
@@ -130,6 +145,11 @@ void CHLBotManager::ServerActivate()
 	TheBotProfiles = new BotProfileManager();
 	TheBotProfiles->Init(cv_bot_profile_db.string);
 
+	LoadNavigationMap();
+	TheNavPathCache.ResetStats();
+	GetVisibility()->Reset();
+	GetThinkScheduler()->Reset();
+
 	m_NextQuotaCheckTime = gpGlobals->time + 3.0f;
 }
 
@@ -154,21 +174,194 @@ void CHLBotManager::ServerDeactivate()
 	}
 	delete TheBotProfiles;
 	TheBotProfiles = nullptr;
+
+	// the navigation map belongs to the level that is going away
+	GetPathQueue()->Reset();
+	DestroyNavigationMap();
+}
+
+
+static const char *const NavBenchCommands[] =
+{
+	"bot_nav_bench",
+	"bot_nav_bench_nearest",
+	"bot_nav_bench_lookup",
+	"bot_nav_bench_flood",
+	"bot_nav_bench_distance",
+	"bot_nav_bench_all",
+};
+
+
+static bool IsNavBenchCommand(const char *pcmd)
+{
+	for (auto command : NavBenchCommands)
+	{
+		if (streq(pcmd, command))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+static void PrintNavBenchUsage()
+{
+	CONSOLE_ECHO("Usage: bot_nav_bench[_nearest|_lookup|_distance|_all] [queries] [seed]\n");
+	CONSOLE_ECHO("       bot_nav_bench_flood [queries] [seed] [range]\n");
 }
 
 
 void CHLBotManager::ServerCommand(const char *pcmd)
 {
+	if (IsNavBenchCommand(pcmd))
+	{
+		const int queryCount = engine::Cmd_Argc() > 1 ? atoi(engine::Cmd_Argv(1)) : 1000;
+		const unsigned int seed = engine::Cmd_Argc() > 2 ? strtoul(engine::Cmd_Argv(2), nullptr, 10) : 1;
+
+		if (queryCount <= 0)
+		{
+			PrintNavBenchUsage();
+			return;
+		}
+
+		if (LoadNavigationMap() != NAV_OK)
+		{
+			CONSOLE_ECHO("Navigation map '%s' could not be loaded.\n", GetNavMapFilename());
+			return;
+		}
+
+		if (streq(pcmd, "bot_nav_bench"))
+		{
+			BenchmarkNavAreaBuildPath(queryCount, seed);
+		}
+		else if (streq(pcmd, "bot_nav_bench_nearest"))
+		{
+			BenchmarkGetNearestNavArea(queryCount, seed);
+		}
+		else if (streq(pcmd, "bot_nav_bench_lookup"))
+		{
+			BenchmarkGetNavArea(queryCount, seed);
+		}
+		else if (streq(pcmd, "bot_nav_bench_flood"))
+		{
+			const float range = engine::Cmd_Argc() > 3 ? atof(engine::Cmd_Argv(3)) : 1000.0f;
+			BenchmarkSearchSurroundingAreas(queryCount, seed, range);
+		}
+		else if (streq(pcmd, "bot_nav_bench_distance"))
+		{
+			BenchmarkNavAreaTravelDistance(queryCount, seed);
+		}
+		else if (streq(pcmd, "bot_nav_bench_all"))
+		{
+			BenchmarkNavAll(queryCount, seed);
+		}
+	}
+	else if (strncmp(pcmd, "bot_nav_bench", 13) == 0)
+	{
+		PrintNavBenchUsage();
+	}
+	else if (streq(pcmd, "bot_nav_analyze"))
+	{
+		if (LoadNavigationMap() != NAV_OK)
+		{
+			CONSOLE_ECHO("Navigation map '%s' could not be loaded.\n", GetNavMapFilename());
+			return;
+		}
+
+		/* Leave a core for the game thread, which runs the traces. */
+		auto threadCount = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+		if (engine::Cmd_Argc() > 1)
+		{
+			threadCount = atoi(engine::Cmd_Argv(1));
+		}
+
+		TheNavAnalysis.Start(threadCount);
+	}
+	else if (streq(pcmd, "bot_nav_cache_stats"))
+	{
+		TheNavPathCache.PrintStats();
+
+		if (engine::Cmd_Argc() > 1 && streq(engine::Cmd_Argv(1), "reset"))
+		{
+			TheNavPathCache.ResetStats();
+		}
+	}
+	else if (streq(pcmd, "bot_vis_stats"))
+	{
+		GetVisibility()->PrintStats();
+
+		if (engine::Cmd_Argc() > 1 && streq(engine::Cmd_Argv(1), "reset"))
+		{
+			GetVisibility()->ResetStats();
+		}
+	}
+	else if (streq(pcmd, "bot_think_stats"))
+	{
+		GetThinkScheduler()->PrintStats();
+
+		if (engine::Cmd_Argc() > 1 && streq(engine::Cmd_Argv(1), "reset"))
+		{
+			GetThinkScheduler()->ResetStats();
+		}
+	}
+	else if (streq(pcmd, "bot_perf_dump"))
+	{
+		if (engine::Cmd_Argc() > 1)
+		{
+			const char *filename = engine::Cmd_Argv(1);
+
+			if (TheBotPerf.WriteCSV(filename))
+			{
+				CONSOLE_ECHO("Bot performance written to '%s'.\n", filename);
+			}
+			else
+			{
+				CONSOLE_ECHO("ERROR: Unable to write bot performance to '%s'.\n", filename);
+			}
+		}
+		else
+		{
+			TheBotPerf.Print();
+		}
+	}
+	else if (streq(pcmd, "bot_perf_reset"))
+	{
+		TheBotPerf.Reset();
+	}
 }
 
 
 void CHLBotManager::AddServerCommand(const char *cmd)
 {
+	engine::AddServerCommand(cmd, Bot_ServerCommand);
 }
 
 
 void CHLBotManager::AddServerCommands()
 {
+	// the engine keeps commands registered for the lifetime of the dll
+	static bool fFirstTime = true;
+
+	if (!fFirstTime)
+	{
+		return;
+	}
+
+	fFirstTime = false;
+
+	for (auto command : NavBenchCommands)
+	{
+		AddServerCommand(command);
+	}
+
+	AddServerCommand("bot_nav_cache_stats");
+	AddServerCommand("bot_nav_analyze");
+	AddServerCommand("bot_vis_stats");
+	AddServerCommand("bot_think_stats");
+	AddServerCommand("bot_perf_dump");
+	AddServerCommand("bot_perf_reset");
 }
 
 
@@ -186,7 +379,10 @@ void InstallBotControl()
 
 void Bot_ServerCommand()
 {
-
+	if (g_pBotMan)
+	{
+		g_pBotMan->ServerCommand(engine::Cmd_Argv(0));
+	}
 }
 
 
@@ -212,4 +408,11 @@ void Bot_RegisterCvars()
 	engine::CVarRegister(&cv_bot_defer_to_human);
 	engine::CVarRegister(&cv_bot_chatter);
 	engine::CVarRegister(&cv_bot_profile_db);
+	engine::CVarRegister(&cv_bot_nav_budget);
+	engine::CVarRegister(&cv_bot_nav_analysis_budget);
+	engine::CVarRegister(&cv_bot_vis_interval);
+	engine::CVarRegister(&cv_bot_think_lod);
+	engine::CVarRegister(&cv_bot_think_near);
+	engine::CVarRegister(&cv_bot_think_far);
+	engine::CVarRegister(&cv_bot_think_budget);
 }
@@ -0,0 +1,474 @@
+// nav_analysis.cpp
+// Analysis of the navigation mesh, spread over worker threads
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <chrono>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "bot_util.h"
+
+#include "nav.h"
+#include "nav_area.h"
+#include "nav_analysis.h"
+
+
+/**
+ * The singleton for analyzing the mesh
+ */
+CNavAnalysis TheNavAnalysis;
+
+/**
+ * The trace queue of the analysis a worker thread belongs to, or nullptr on the game thread
+ */
+static thread_local CNavTraceQueue *navTraceQueue = nullptr;
+
+extern void ApproachAreaAnalysisPrep( void );
+extern void CleanupApproachAreaAnalysisPrep( void );
+extern void StripNavigationAreas( void );
+
+static const char *navAnalysisPhaseName[ NUM_NAV_ANALYSIS_PHASES ] =
+{
+	"hiding spots",
+	"spot encounters",
+	"sniper spots",
+	"approach areas"
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+CNavTraceQueue::CNavTraceQueue( void )
+{
+	m_isCancelled = false;
+	m_jobCount = 0;
+	m_batchCount = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Invoked by a worker: have the game thread run 'job', and wait until it has.
+ * If the queue has been cancelled, the job is not run at all.
+ */
+void CNavTraceQueue::Run( const std::function<void (void)> &job )
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+
+	if (m_isCancelled)
+		return;
+
+	Request request;
+	request.job = &job;
+	request.isDone = false;
+
+	m_pending.push_back( &request );
+	m_queued.notify_one();
+
+	m_done.wait( lock, [&]() { return request.isDone || m_isCancelled; } );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Invoked by the game thread: wait up to 'timeout' seconds for workers to queue jobs,
+ * then run every job that is waiting in one batch. Returns the number of jobs run.
+ */
+int CNavTraceQueue::Service( float timeout )
+{
+	std::vector<Request *> batch;
+
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+
+		if (m_pending.empty() && timeout > 0.0f)
+			m_queued.wait_for( lock, std::chrono::duration<float>( timeout ) );
+
+		batch.swap( m_pending );
+	}
+
+	if (batch.empty())
+		return 0;
+
+	// the workers are blocked until we are done, so their jobs can be run without the lock
+	for( std::vector<Request *>::iterator iter = batch.begin(); iter != batch.end(); ++iter )
+		(*(*iter)->job)();
+
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+
+		for( std::vector<Request *>::iterator iter = batch.begin(); iter != batch.end(); ++iter )
+			(*iter)->isDone = true;
+
+		m_jobCount += batch.size();
+		++m_batchCount;
+	}
+
+	m_done.notify_all();
+
+	return batch.size();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Release the waiting workers without running their jobs, and drop any jobs queued from now on.
+ * Must be invoked by the game thread, so no batch is being run.
+ */
+void CNavTraceQueue::Cancel( void )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+
+		m_isCancelled = true;
+		m_pending.clear();
+	}
+
+	m_done.notify_all();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Stop the game thread waiting for jobs
+ */
+void CNavTraceQueue::Wake( void )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	m_queued.notify_all();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Accept jobs again, once all the workers are gone
+ */
+void CNavTraceQueue::Reset( void )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	m_isCancelled = false;
+	m_pending.clear();
+	m_jobCount = 0;
+	m_batchCount = 0;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run 'job' on the game thread, waiting until it is done
+ */
+void NavRunOnGameThread( const std::function<void (void)> &job )
+{
+	if (navTraceQueue)
+		navTraceQueue->Run( job );
+	else
+		job();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Trace a line on the game thread. If the analysis is aborted while we wait, the line is clear.
+ */
+void NavTraceLine( const Vector &start, const Vector &end, util::IGNORE_MONSTERS igmon, CBaseEntity *ignore, TraceResult *result )
+{
+	if (navTraceQueue == nullptr)
+	{
+		util::TraceLine( start, end, igmon, ignore, result );
+		return;
+	}
+
+	memset( result, 0, sizeof(TraceResult) );
+	result->flFraction = 1.0f;
+	result->vecEndPos = end;
+
+	navTraceQueue->Run( [&]() { util::TraceLine( start, end, igmon, ignore, result ); } );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void NavTraceLine( const Vector &start, const Vector &end, util::IGNORE_MONSTERS igmon, util::IGNORE_GLASS ignoreGlass, CBaseEntity *ignore, TraceResult *result )
+{
+	if (navTraceQueue == nullptr)
+	{
+		util::TraceLine( start, end, igmon, ignoreGlass, ignore, result );
+		return;
+	}
+
+	memset( result, 0, sizeof(TraceResult) );
+	result->flFraction = 1.0f;
+	result->vecEndPos = end;
+
+	navTraceQueue->Run( [&]() { util::TraceLine( start, end, igmon, ignoreGlass, ignore, result ); } );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+CNavAnalysis::CNavAnalysis( void )
+{
+	m_phase = NUM_NAV_ANALYSIS_PHASES;
+	m_threadCount = 0;
+	m_nextArea = 0;
+	m_finishedAreaCount = 0;
+	m_finishedWorkerCount = 0;
+	m_isAborted = false;
+	m_progress = 0;
+	m_startTime = CBotPerf::Clock::time_point();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+CNavAnalysis::~CNavAnalysis()
+{
+	Abort();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Discard the analyzed data of the current mesh and analyze it again, using the given number of worker threads.
+ * With no threads, the whole analysis is done at once on the game thread - this is the reference
+ * the threaded analysis must match.
+ */
+bool CNavAnalysis::Start( int threadCount )
+{
+	Abort();
+
+	if (TheNavAreaList.empty())
+		return false;
+
+	m_startTime = CBotPerf::Clock::now();
+
+	// the encounters refer to the hiding spots, so both go together
+	StripNavigationAreas();
+	DestroyHidingSpots();
+
+	// the workers read the compact mesh, so it must not need to be rebuilt while they run
+	TheNavCompactMesh.Update();
+
+	m_areaVector.assign( TheNavAreaList.begin(), TheNavAreaList.end() );
+	m_threadCount = threadCount;
+	m_isAborted = false;
+	m_traceQueue.Reset();
+
+	if (threadCount <= 0)
+	{
+		// analyze each area in turn, exactly as the phases do
+		for( int phase = 0; phase < NUM_NAV_ANALYSIS_PHASES; ++phase )
+		{
+			CONSOLE_ECHO( "Analyzing %s...\n", navAnalysisPhaseName[ phase ] );
+
+			if (phase == NAV_ANALYZE_APPROACH_AREAS)
+				ApproachAreaAnalysisPrep();
+
+			for( std::vector<CNavArea *>::iterator iter = m_areaVector.begin(); iter != m_areaVector.end(); ++iter )
+			{
+				CNavArea *area = *iter;
+
+				switch( phase )
+				{
+					case NAV_ANALYZE_HIDING_SPOTS:		area->ComputeHidingSpots();		break;
+					case NAV_ANALYZE_SPOT_ENCOUNTERS:	area->ComputeSpotEncounters();	break;
+					case NAV_ANALYZE_SNIPER_SPOTS:		area->ComputeSniperSpots();		break;
+					case NAV_ANALYZE_APPROACH_AREAS:	area->ComputeApproachAreas();	break;
+				}
+			}
+		}
+
+		Finish();
+		return true;
+	}
+
+	CONSOLE_ECHO( "Analyzing %d navigation areas on %d threads.\n", (int)m_areaVector.size(), threadCount );
+
+	StartPhase( NAV_ANALYZE_HIDING_SPOTS );
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Share the areas out among the workers for the given phase
+ */
+void CNavAnalysis::StartPhase( NavAnalysisPhase phase )
+{
+	m_phase = phase;
+	m_nextArea = 0;
+	m_finishedAreaCount = 0;
+	m_finishedWorkerCount = 0;
+	m_progress = 0;
+
+	switch( phase )
+	{
+		case NAV_ANALYZE_HIDING_SPOTS:
+			m_hidingSpots.clear();
+			m_hidingSpots.resize( m_areaVector.size() );
+			break;
+
+		case NAV_ANALYZE_APPROACH_AREAS:
+			ApproachAreaAnalysisPrep();
+			break;
+	}
+
+	for( int i = 0; i < m_threadCount; ++i )
+		m_workerList.push_back( std::thread( &CNavAnalysis::WorkerThread, this ) );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Commit the results of the current phase, in area order
+ */
+void CNavAnalysis::FinishPhase( void )
+{
+	if (m_phase == NAV_ANALYZE_HIDING_SPOTS)
+	{
+		// create the spots here, so that they get the same IDs as they would one area at a time
+		for( unsigned int i = 0; i < m_areaVector.size(); ++i )
+			m_areaVector[i]->AddHidingSpots( &m_hidingSpots[i] );
+
+		m_hidingSpots.clear();
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAnalysis::Finish( void )
+{
+	CleanupApproachAreaAnalysisPrep();
+
+	m_phase = NUM_NAV_ANALYSIS_PHASES;
+	m_areaVector.clear();
+
+	if (m_threadCount > 0)
+		CONSOLE_ECHO( "Navigation analysis finished in %.1f seconds, with %u traces in %u batches.\n",
+						std::chrono::duration< double >( CBotPerf::Clock::now() - m_startTime ).count(), m_traceQueue.GetJobCount(), m_traceQueue.GetBatchCount() );
+	else
+		CONSOLE_ECHO( "Navigation analysis finished in %.1f seconds.\n", std::chrono::duration< double >( CBotPerf::Clock::now() - m_startTime ).count() );
+
+	char filename[256];
+	sprintf( filename, "maps\\%s.nav", STRING( gpGlobals->mapname ) );
+
+	if (SaveNavigationMap( filename ))
+		CONSOLE_ECHO( "Navigation map '%s' saved.\n", filename );
+	else
+		CONSOLE_ECHO( "ERROR: Cannot save navigation map '%s'.\n", filename );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run the current phase on the given area.
+ * Only the area itself is changed, apart from hiding spots, which are held until the phase is done.
+ */
+void CNavAnalysis::AnalyzeArea( unsigned int index )
+{
+	CNavArea *area = m_areaVector[ index ];
+
+	switch( m_phase )
+	{
+		case NAV_ANALYZE_HIDING_SPOTS:		area->FindHidingSpots( &m_hidingSpots[ index ] );	break;
+		case NAV_ANALYZE_SPOT_ENCOUNTERS:	area->ComputeSpotEncounters();						break;
+		case NAV_ANALYZE_SNIPER_SPOTS:		area->ComputeSniperSpots();							break;
+		case NAV_ANALYZE_APPROACH_AREAS:	area->ComputeApproachAreas();						break;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Take areas and analyze them until there are none left
+ */
+void CNavAnalysis::WorkerThread( void )
+{
+	navTraceQueue = &m_traceQueue;
+
+	// approach areas are found by searching the mesh, which needs search state of our own
+	NavSearchContext search;
+	CNavArea::SetSearchContext( &search );
+
+	while( !m_isAborted )
+	{
+		unsigned int index = m_nextArea++;
+		if (index >= m_areaVector.size())
+			break;
+
+		AnalyzeArea( index );
+
+		++m_finishedAreaCount;
+	}
+
+	++m_finishedWorkerCount;
+
+	// the game thread may be waiting for jobs
+	m_traceQueue.Wake();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAnalysis::JoinWorkers( void )
+{
+	for( std::vector<std::thread>::iterator iter = m_workerList.begin(); iter != m_workerList.end(); ++iter )
+		iter->join();
+
+	m_workerList.clear();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run the traces the workers are waiting for, in batches, for up to 'budget' seconds.
+ * Once all the workers of a phase are done, commit its results and start the next phase.
+ */
+void CNavAnalysis::Update( float budget )
+{
+	if (!IsRunning())
+		return;
+
+	CBotPerf::Clock::time_point deadline = CBotPerf::Clock::now() + std::chrono::duration_cast< CBotPerf::Clock::duration >( std::chrono::duration< float >( budget ) );
+
+	while( true )
+	{
+		if (m_finishedWorkerCount == m_threadCount)
+		{
+			JoinWorkers();
+			FinishPhase();
+
+			if (m_phase == NAV_ANALYZE_APPROACH_AREAS)
+			{
+				Finish();
+				return;
+			}
+
+			StartPhase( (NavAnalysisPhase)(m_phase + 1) );
+		}
+
+		double timeLeft = std::chrono::duration< double >( deadline - CBotPerf::Clock::now() ).count();
+		if (timeLeft <= 0.0)
+			break;
+
+		m_traceQueue.Service( (float)timeLeft );
+	}
+
+	// report progress every tenth of a phase
+	int progress = (m_areaVector.empty()) ? 10 : 10 * m_finishedAreaCount / m_areaVector.size();
+	if (progress > m_progress)
+	{
+		m_progress = progress;
+		CONSOLE_ECHO( "Analyzing %s: %d%%\n", navAnalysisPhaseName[ m_phase ], 10 * progress );
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Stop the analysis. The workers finish the area they are on without the engine, and their results are discarded.
+ */
+void CNavAnalysis::Abort( void )
+{
+	if (!IsRunning())
+		return;
+
+	m_isAborted = true;
+	m_traceQueue.Cancel();
+	JoinWorkers();
+
+	CleanupApproachAreaAnalysisPrep();
+
+	// leave the mesh without analyzed data, rather than with some of it
+	StripNavigationAreas();
+	DestroyHidingSpots();
+
+	m_phase = NUM_NAV_ANALYSIS_PHASES;
+	m_areaVector.clear();
+	m_hidingSpots.clear();
+
+	CONSOLE_ECHO( "Navigation analysis aborted.\n" );
+}
@@ -0,0 +1,128 @@
+// nav_analysis.h
+// Analysis of the navigation mesh, spread over worker threads
+
+#ifndef _NAV_ANALYSIS_H_
+#define _NAV_ANALYSIS_H_
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "nav_area.h"
+#include "bot_perf.h"
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * The engine may only be used by the game thread. Workers hand it what they need done through
+ * the CNavTraceQueue and wait, while the game thread runs everything that is waiting in one batch.
+ */
+class CNavTraceQueue
+{
+public:
+	CNavTraceQueue( void );
+
+	void Run( const std::function<void (void)> &job );		///< invoked by a worker: have the game thread run 'job', and wait until it has
+	int Service( float timeout );							///< invoked by the game thread: wait up to 'timeout' seconds for jobs, run them all, and return how many were run
+	void Cancel( void );									///< release waiting workers without running their jobs - later jobs are dropped at once
+	void Wake( void );										///< stop the game thread waiting for jobs
+	void Reset( void );										///< accept jobs again
+
+	unsigned int GetJobCount( void ) const					{ return m_jobCount; }
+	unsigned int GetBatchCount( void ) const				{ return m_batchCount; }
+
+private:
+	struct Request
+	{
+		const std::function<void (void)> *job;
+		bool isDone;
+	};
+
+	std::mutex m_mutex;
+	std::condition_variable m_queued;						///< signalled when a worker queues a job
+	std::condition_variable m_done;							///< signalled when a batch of jobs has been run
+	std::vector<Request *> m_pending;
+	bool m_isCancelled;
+
+	unsigned int m_jobCount;
+	unsigned int m_batchCount;
+};
+
+/**
+ * Run 'job' on the game thread. Invoked from the game thread, it simply runs it.
+ * The nav analysis functions use these instead of using the engine themselves.
+ */
+extern void NavRunOnGameThread( const std::function<void (void)> &job );
+extern void NavTraceLine( const Vector &start, const Vector &end, util::IGNORE_MONSTERS igmon, CBaseEntity *ignore, TraceResult *result );
+extern void NavTraceLine( const Vector &start, const Vector &end, util::IGNORE_MONSTERS igmon, util::IGNORE_GLASS ignoreGlass, CBaseEntity *ignore, TraceResult *result );
+
+
+//--------------------------------------------------------------------------------------------------------
+enum NavAnalysisPhase
+{
+	NAV_ANALYZE_HIDING_SPOTS,
+	NAV_ANALYZE_SPOT_ENCOUNTERS,
+	NAV_ANALYZE_SNIPER_SPOTS,
+	NAV_ANALYZE_APPROACH_AREAS,
+
+	NUM_NAV_ANALYSIS_PHASES
+};
+
+/**
+ * The CNavAnalysis finds the hiding spots, spot encounters, sniper spots, and approach areas of
+ * the navigation mesh. Each phase analyzes the areas independently of each other, so they are
+ * shared out among worker threads while the game thread keeps running and services their traces.
+ * Anything a phase creates is committed in area order once the phase is done, and each phase
+ * only reads what earlier phases made, so the result is identical to analyzing the areas one at a time.
+ * The mesh must not change while the analysis runs - editing it or destroying it aborts the analysis.
+ */
+class CNavAnalysis
+{
+public:
+	CNavAnalysis( void );
+	~CNavAnalysis();
+
+	/**
+	 * Discard the analyzed data of the current mesh and analyze it again, using the given number of
+	 * worker threads. With no threads, the whole analysis is done at once, here on the game thread.
+	 */
+	bool Start( int threadCount );
+	void Update( float budget );							///< service the workers for up to 'budget' seconds, and move on as phases finish
+	void Abort( void );										///< stop the analysis, leaving the mesh without analyzed data
+
+	bool IsRunning( void ) const							{ return (m_phase < NUM_NAV_ANALYSIS_PHASES) ? true : false; }
+
+private:
+	void StartPhase( NavAnalysisPhase phase );
+	void FinishPhase( void );								///< commit the results of the current phase
+	void Finish( void );
+	void AnalyzeArea( unsigned int index );					///< run the current phase on the given area
+	void WorkerThread( void );
+	void JoinWorkers( void );
+
+	NavAnalysisPhase m_phase;
+	std::vector<CNavArea *> m_areaVector;					///< the areas to analyze, in the order of TheNavAreaList
+	std::vector<HidingSpotCandidateList> m_hidingSpots;		///< hiding spots found in each area, waiting to be created
+
+	std::vector<std::thread> m_workerList;
+	int m_threadCount;
+	std::atomic<unsigned int> m_nextArea;					///< the next area a worker will take
+	std::atomic<unsigned int> m_finishedAreaCount;
+	std::atomic<int> m_finishedWorkerCount;
+	std::atomic<bool> m_isAborted;
+
+	CNavTraceQueue m_traceQueue;
+	int m_progress;											///< last progress reported, in tenths of the current phase
+
+	CBotPerf::Clock::time_point m_startTime;
+};
+
+extern CNavAnalysis TheNavAnalysis;
+
+
+#endif // _NAV_ANALYSIS_H_
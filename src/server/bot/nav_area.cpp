@@ -41,6 +41,9 @@
 #include "nav.h"
 #include "nav_node.h"
 #include "nav_area.h"
+#include "nav_file.h"
+#include "nav_analysis.h"
+#include "nav_path.h"
 
 #include "pm_shared.h" // for OBS_ROAMING
 
@@ -51,8 +54,8 @@ NavAreaList TheNavAreaList;
 
 NavLadderList TheNavLadderList;
 
-unsigned int CNavArea::m_masterMarker = 1;
-CNavArea *CNavArea::m_openList = nullptr;
+NavSearchContext CNavArea::m_sharedSearch;
+thread_local NavSearchContext *CNavArea::m_search = &CNavArea::m_sharedSearch;
 
 bool CNavArea::m_isReset = false;
 static float lastDrawTimestamp = 0.0f;
@@ -97,7 +100,7 @@ void DestroyHidingSpots( void )
 		area->m_hidingSpotList.clear();
 	}
 
-	HidingSpot::m_nextID = 0;
+	HidingSpot::m_nextID = 1;
 
 	// free all the HidingSpots
 	for( HidingSpotList::iterator iter = TheHidingSpotList.begin(); iter != TheHidingSpotList.end(); ++iter )
@@ -130,11 +133,14 @@ HidingSpot::HidingSpot( const Vector *pos, unsigned char flags )
 	TheHidingSpotList.push_back( this );
 }
 
-void HidingSpot::Save( int fd, unsigned int version ) const
+void HidingSpot::Save( NavFileHidingSpot *data ) const
 {
-	_write( fd, &m_id, sizeof(unsigned int) );
-	_write( fd, &m_pos, 3 * sizeof(float) );
-	_write( fd, &m_flags, sizeof(unsigned char) );
+	data->id = m_id;
+	data->pos[0] = m_pos.x;
+	data->pos[1] = m_pos.y;
+	data->pos[2] = m_pos.z;
+	data->flags = m_flags;
+	data->pad[0] = data->pad[1] = data->pad[2] = 0;
 }
 
 void HidingSpot::Load( SteamFile *file, unsigned int version )
@@ -148,6 +154,17 @@ void HidingSpot::Load( SteamFile *file, unsigned int version )
 		m_nextID = m_id+1;
 }
 
+void HidingSpot::Load( const NavFileHidingSpot *data )
+{
+	m_id = data->id;
+	m_pos = Vector( data->pos[0], data->pos[1], data->pos[2] );
+	m_flags = data->flags;
+
+	// update next ID to avoid ID collisions by later spots
+	if (m_id >= m_nextID)
+		m_nextID = m_id+1;
+}
+
 /**
  * Given a HidingSpot ID, return the associated HidingSpot
  */
@@ -171,24 +188,20 @@ HidingSpot *GetHidingSpotByID( unsigned int id )
  */
 void CNavArea::Initialize( void )
 {
-	m_marker = 0;
-	m_parent = nullptr;
-	m_parentHow = GO_NORTH;
 	m_attributeFlags = 0;
 	m_place = 0;
 
 	for ( int i=0; i<MAX_AREA_TEAMS; ++i )
-	{
-		m_danger[i] = 0.0f;
-		m_dangerTimestamp[i] = 0.0f;
-
 		m_clearedTimestamp[i] = 0.0f;
-	}
 
 	m_approachCount = 0;
 
 	// set an ID for splitting and other interactive editing - loads will overwrite this
 	m_id = m_nextID++;
+	ReserveSearchNode( m_id );
+	TheNavDanger.ClearDanger( m_id );
+
+	TheNavCompactMesh.Invalidate();
 
 	m_prevHash = nullptr;
 	m_nextHash = nullptr;
@@ -301,6 +314,8 @@ CNavArea::~CNavArea()
 	if (m_isReset)
 		return;
 
+	TheNavCompactMesh.Invalidate();
+
 	// tell the other areas we are going away
 	NavAreaList::iterator iter;
 	for( iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
@@ -358,6 +373,8 @@ void CNavArea::ConnectTo( CNavArea *area, NavDirType dir )
 	con.area = area;
 	m_connect[ dir ].push_back( con );
 
+	TheNavCompactMesh.Invalidate();
+
 	//static char *dirName[] = { "NORTH", "EAST", "SOUTH", "WEST" };
 	//CONSOLE_ECHO( "  Connected area #%d to #%d, %s\n", m_id, area->m_id, dirName[ dir ] );
 }
@@ -373,6 +390,8 @@ void CNavArea::Disconnect( CNavArea *area )
 
 	for( int dir = 0; dir<NUM_DIRECTIONS; dir++ )
 		m_connect[ dir ].remove( connect );
+
+	TheNavCompactMesh.Invalidate();
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -606,6 +625,8 @@ bool CNavArea::SplitEdit( bool splitAlongX, float splitEdge, CNavArea **outAlpha
 	TheNavAreaList.remove( this );
 	delete this;
 
+	TheNavPathCache.OnMeshChanged();
+
 	return true;
 }
 
@@ -904,6 +925,8 @@ bool CNavArea::SpliceEdit( CNavArea *other )
 	TheNavAreaList.push_back( newArea );
 	TheNavAreaGrid.AddNavArea( newArea );
 
+	TheNavPathCache.OnMeshChanged();
+
 	return true;
 }
 
@@ -960,6 +983,8 @@ bool CNavArea::MergeEdit( CNavArea *adj )
 	TheNavAreaList.remove( adj );
 	delete adj;
 
+	TheNavPathCache.OnMeshChanged();
+
 	return true;
 }
 
@@ -996,6 +1021,9 @@ void DestroyLadders( void )
  */
 void DestroyNavigationMap( void )
 {
+	// the analysis can't outlive the areas it is working on
+	TheNavAnalysis.Abort();
+
 	CNavArea::m_isReset = true;
 
 	// remove each element of the list and delete them
@@ -1008,6 +1036,15 @@ void DestroyNavigationMap( void )
 
 	CNavArea::m_isReset = false;
 
+	// all areas are gone, so is their search state
+	CNavArea::m_sharedSearch.nodeList.clear();
+	CNavArea::m_sharedSearch.openList.clear();
+
+	// and any paths through them
+	TheNavPathCache.Reset();
+	TheNavCompactMesh.Reset();
+	TheNavDanger.Reset();
+
 	// destroy ladder representations
 	DestroyLadders();
 
@@ -2632,99 +2669,185 @@ void CNavArea::DrawMarkedCorner( NavCornerType corner, byte red, byte green, byt
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Add to open list in decreasing value order
+ * Make sure there is a search node for the given area ID.
+ * New nodes are zeroed, which reads as "not marked" and "not open" since the master marker is never zero.
  */
-void CNavArea::AddToOpenList( void )
+void CNavArea::ReserveSearchNode( unsigned int id )
 {
-	// mark as being on open list for quick check
-	m_openMarker = m_masterMarker;
-
-	// if list is empty, add and return
-	if (m_openList == nullptr)
+	if (id >= m_sharedSearch.nodeList.size())
 	{
-		m_openList = this;
-		this->m_prevOpen = nullptr;
-		this->m_nextOpen = nullptr;
-		return;
+		NavSearchNode empty;
+		memset( &empty, 0, sizeof(NavSearchNode) );
+
+		m_sharedSearch.nodeList.resize( id+1, empty );
 	}
+}
 
-	// insert self in ascending cost order
-	CNavArea *area, *last = nullptr;
-	for( area = m_openList; area; area = area->m_nextOpen )
-	{
-		if (this->GetTotalCost() < area->GetTotalCost())
-			break;
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Make the given search state current, so that marking, open list, and cost operations use it.
+ * Passing nullptr makes the shared search state current again.
+ * The given context is grown to cover every area ID before it is used.
+ * Returns the previously current search state.
+ */
+NavSearchContext *CNavArea::SetSearchContext( NavSearchContext *context )
+{
+	NavSearchContext *prev = m_search;
 
-		last = area;
-	}
+	if (context == nullptr)
+		context = &m_sharedSearch;
 
-	if (area)
+	if (context->nodeList.size() < m_sharedSearch.nodeList.size())
 	{
-		// insert before this area
-		this->m_prevOpen = area->m_prevOpen;
-		if (this->m_prevOpen)
-			this->m_prevOpen->m_nextOpen = this;
-		else
-			m_openList = this;
+		NavSearchNode empty;
+		memset( &empty, 0, sizeof(NavSearchNode) );
 
-		this->m_nextOpen = area;
-		area->m_prevOpen = this;
+		context->nodeList.resize( m_sharedSearch.nodeList.size(), empty );
 	}
-	else
+
+	m_search = context;
+
+	return prev;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if open list entry 'a' should be popped before 'b'.
+ * Ties in cost go to the area that was added or updated first, which matches
+ * the order of the old sorted linked list, so searches return the same paths.
+ */
+inline bool IsOpenEntryBefore( const NavOpenEntry &a, const NavOpenEntry &b )
+{
+	if (a.totalCost < b.totalCost)
+		return true;
+
+	if (a.totalCost > b.totalCost)
+		return false;
+
+	return (a.sequence < b.sequence) ? true : false;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Move the open list entry at 'index' towards the top of the heap until it is in order
+ */
+void CNavArea::OpenListSiftUp( unsigned int index )
+{
+	NavOpenEntry entry = m_search->openList[ index ];
+
+	while( index > 0 )
 	{
-		// append to end of list
-		last->m_nextOpen = this;
+		unsigned int parent = (index-1)/2;
 
-		this->m_prevOpen = last;
-		this->m_nextOpen = nullptr;
+		if (!IsOpenEntryBefore( entry, m_search->openList[ parent ] ))
+			break;
+
+		m_search->openList[ index ] = m_search->openList[ parent ];
+		m_search->nodeList[ m_search->openList[ index ].id ].openIndex = index;
+
+		index = parent;
 	}
+
+	m_search->openList[ index ] = entry;
+	m_search->nodeList[ entry.id ].openIndex = index;
 }
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * A smaller value has been found, update this area on the open list
- * @todo "bubbling" does unnecessary work, since the order of all other nodes will be unchanged - only this node is altered
+ * Move the open list entry at 'index' towards the bottom of the heap until it is in order
  */
-void CNavArea::UpdateOnOpenList( void )
+void CNavArea::OpenListSiftDown( unsigned int index )
 {
-	// since value can only decrease, bubble this area up from current spot
-	while( m_prevOpen && 
-				 this->GetTotalCost() < m_prevOpen->GetTotalCost() )
+	NavOpenEntry entry = m_search->openList[ index ];
+	unsigned int count = m_search->openList.size();
+
+	while( true )
 	{
-		// swap position with predecessor
-		CNavArea *other = m_prevOpen;
-		CNavArea *before = other->m_prevOpen;
-		CNavArea *after  = this->m_nextOpen;
+		unsigned int child = 2*index + 1;
+		if (child >= count)
+			break;
 
-		this->m_nextOpen = other;
-		this->m_prevOpen = before;
+		// pick the cheaper of the two children
+		if (child+1 < count && IsOpenEntryBefore( m_search->openList[ child+1 ], m_search->openList[ child ] ))
+			++child;
 
-		other->m_prevOpen = this;
-		other->m_nextOpen = after;
+		if (!IsOpenEntryBefore( m_search->openList[ child ], entry ))
+			break;
 
-		if (before)
-			before->m_nextOpen = this;
-		else
-			m_openList = this;
+		m_search->openList[ index ] = m_search->openList[ child ];
+		m_search->nodeList[ m_search->openList[ index ].id ].openIndex = index;
 
-		if (after)
-			after->m_prevOpen = other;
+		index = child;
 	}
+
+	m_search->openList[ index ] = entry;
+	m_search->nodeList[ entry.id ].openIndex = index;
 }
 
 //--------------------------------------------------------------------------------------------------------------
-void CNavArea::RemoveFromOpenList( void )
+/**
+ * Add to open list in increasing cost order.
+ * The total cost must be set before the area is added.
+ */
+void CNavArea::AddToOpenList( void )
 {
-	if (m_prevOpen)
-		m_prevOpen->m_nextOpen = m_nextOpen;
-	else
-		m_openList = m_nextOpen;
+	NavSearchNode *node = &m_search->nodeList[ m_id ];
+
+	// mark as being on open list for quick check
+	node->openMarker = m_search->masterMarker;
+
+	NavOpenEntry entry;
+	entry.totalCost = node->totalCost;
+	entry.sequence = m_search->openSequence++;
+	entry.id = m_id;
+	entry.area = this;
 
-	if (m_nextOpen)
-		m_nextOpen->m_prevOpen = m_prevOpen;
+	m_search->openList.push_back( entry );
+	OpenListSiftUp( m_search->openList.size()-1 );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * A smaller value has been found, update this area on the open list
+ */
+void CNavArea::UpdateOnOpenList( void )
+{
+	const NavSearchNode *node = &m_search->nodeList[ m_id ];
+	NavOpenEntry *entry = &m_search->openList[ node->openIndex ];
+
+	// an updated area goes behind others of the same cost, just like a new one
+	entry->totalCost = node->totalCost;
+	entry->sequence = m_search->openSequence++;
+
+	// since value can only decrease, move this area up the heap
+	OpenListSiftUp( node->openIndex );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavArea::RemoveFromOpenList( void )
+{
+	NavSearchNode *node = &m_search->nodeList[ m_id ];
+	unsigned int index = node->openIndex;
 
 	// zero is an invalid marker
-	m_openMarker = 0;
+	node->openMarker = 0;
+
+	// fill the hole with the last entry and restore heap order
+	unsigned int last = m_search->openList.size()-1;
+	if (index != last)
+	{
+		m_search->openList[ index ] = m_search->openList[ last ];
+		m_search->openList.pop_back();
+
+		if (index > 0 && IsOpenEntryBefore( m_search->openList[ index ], m_search->openList[ (index-1)/2 ] ))
+			OpenListSiftUp( index );
+		else
+			OpenListSiftDown( index );
+	}
+	else
+	{
+		m_search->openList.pop_back();
+	}
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -2733,10 +2856,11 @@ void CNavArea::RemoveFromOpenList( void )
  */
 void CNavArea::ClearSearchLists( void )
 {
-	// effectively clears all open list pointers and closed flags
+	// effectively clears all open list markers and closed flags
 	CNavArea::MakeNewMarker();
 
-	m_openList = nullptr;
+	m_search->openList.clear();
+	m_search->openSequence = 0;
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -2774,9 +2898,9 @@ const Vector *CNavArea::GetCorner( NavCornerType corner ) const
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Returns true if an existing hiding spot is too close to given position
+ * Returns true if an existing hiding spot, or one of the given spots that are yet to be added, is too close to given position
  */
-bool CNavArea::IsHidingSpotCollision( const Vector *pos ) const
+bool CNavArea::IsHidingSpotCollision( const Vector *pos, const HidingSpotCandidateList *spots ) const
 {
 	const float collisionRange = 30.0f;
 
@@ -2788,6 +2912,12 @@ bool CNavArea::IsHidingSpotCollision( const Vector *pos ) const
 			return true;
 	}
 
+	for( HidingSpotCandidateList::const_iterator iter = spots->begin(); iter != spots->end(); ++iter )
+	{
+		if ((iter->pos - *pos) < collisionRange)
+			return true;
+	}
+
 	return false;
 }
 
@@ -2804,7 +2934,7 @@ bool IsHidingSpotInCover( const Vector *spot )
 
 	// if we are crouched underneath something, that counts as good cover
 	to = from + Vector( 0, 0, 20.0f );
-	util::TraceLine( from, to, util::ignore_monsters, nullptr, &result );
+	NavTraceLine( from, to, util::ignore_monsters, nullptr, &result );
 	if (result.flFraction != 1.0f)
 		return true;
 
@@ -2815,7 +2945,7 @@ bool IsHidingSpotInCover( const Vector *spot )
 	{
 		to = from + Vector( coverRange * cos(angle), coverRange * sin(angle), HalfHumanHeight );
 
-		util::TraceLine( from, to, util::ignore_monsters, nullptr, &result );
+		NavTraceLine( from, to, util::ignore_monsters, nullptr, &result );
 
 		// if traceline hit something, it hit "cover"
 		if (result.flFraction != 1.0f)
@@ -2835,6 +2965,19 @@ bool IsHidingSpotInCover( const Vector *spot )
  * Analyze local area neighborhood to find "hiding spots" for this area
  */
 void CNavArea::ComputeHidingSpots( void )
+{
+	HidingSpotCandidateList spots;
+
+	FindHidingSpots( &spots );
+	AddHidingSpots( &spots );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Analyze local area neighborhood to find where the "hiding spots" of this area belong.
+ * Nothing is changed, so this may be run for several areas at once.
+ */
+void CNavArea::FindHidingSpots( HidingSpotCandidateList *spots ) const
 {
 	struct
 	{
@@ -2860,7 +3003,7 @@ void CNavArea::ComputeHidingSpots( void )
 
 		bool isHoriz = (d == NORTH || d == SOUTH) ? true : false;
 
-		for( NavConnectList::iterator iter = m_connect[d].begin(); iter != m_connect[d].end(); ++iter )
+		for( NavConnectList::const_iterator iter = m_connect[d].begin(); iter != m_connect[d].end(); ++iter )
 		{
 			NavConnect connect = *iter;
 
@@ -2929,36 +3072,56 @@ void CNavArea::ComputeHidingSpots( void )
 
 	// if a corner count is 2, then it really is a corner (walls on both sides)
 	float offset = 12.5f;
+	HidingSpotCandidate spot;
 
 	if (cornerCount[ NORTH_WEST ] == 2)
 	{
-		Vector pos = *GetCorner( NORTH_WEST ) + Vector(  offset,  offset, 0.0f );
-
-		m_hidingSpotList.push_back( new HidingSpot( &pos, (IsHidingSpotInCover( &pos )) ? HidingSpot::IN_COVER : 0 ) );
+		spot.pos = *GetCorner( NORTH_WEST ) + Vector(  offset,  offset, 0.0f );
+		spot.flags = (IsHidingSpotInCover( &spot.pos )) ? HidingSpot::IN_COVER : 0;
+		spots->push_back( spot );
 	}
 
 	if (cornerCount[ NORTH_EAST ] == 2)
 	{
-		Vector pos = *GetCorner( NORTH_EAST ) + Vector( -offset,  offset, 0.0f );
-		if (!IsHidingSpotCollision( &pos ))
-			m_hidingSpotList.push_back( new HidingSpot( &pos, (IsHidingSpotInCover( &pos )) ? HidingSpot::IN_COVER : 0 ) );
+		spot.pos = *GetCorner( NORTH_EAST ) + Vector( -offset,  offset, 0.0f );
+		if (!IsHidingSpotCollision( &spot.pos, spots ))
+		{
+			spot.flags = (IsHidingSpotInCover( &spot.pos )) ? HidingSpot::IN_COVER : 0;
+			spots->push_back( spot );
+		}
 	}
 
 	if (cornerCount[ SOUTH_WEST ] == 2)
 	{
-		Vector pos = *GetCorner( SOUTH_WEST ) + Vector(  offset, -offset, 0.0f );
-		if (!IsHidingSpotCollision( &pos ))
-			m_hidingSpotList.push_back( new HidingSpot( &pos, (IsHidingSpotInCover( &pos )) ? HidingSpot::IN_COVER : 0 ) );
+		spot.pos = *GetCorner( SOUTH_WEST ) + Vector(  offset, -offset, 0.0f );
+		if (!IsHidingSpotCollision( &spot.pos, spots ))
+		{
+			spot.flags = (IsHidingSpotInCover( &spot.pos )) ? HidingSpot::IN_COVER : 0;
+			spots->push_back( spot );
+		}
 	}
 
 	if (cornerCount[ SOUTH_EAST ] == 2)
 	{
-		Vector pos = *GetCorner( SOUTH_EAST ) + Vector( -offset, -offset, 0.0f );
-		if (!IsHidingSpotCollision( &pos ))
-			m_hidingSpotList.push_back( new HidingSpot( &pos, (IsHidingSpotInCover( &pos )) ? HidingSpot::IN_COVER : 0 ) );
+		spot.pos = *GetCorner( SOUTH_EAST ) + Vector( -offset, -offset, 0.0f );
+		if (!IsHidingSpotCollision( &spot.pos, spots ))
+		{
+			spot.flags = (IsHidingSpotInCover( &spot.pos )) ? HidingSpot::IN_COVER : 0;
+			spots->push_back( spot );
+		}
 	}
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Create the given hiding spots in this area, assigning their IDs in order
+ */
+void CNavArea::AddHidingSpots( const HidingSpotCandidateList *spots )
+{
+	for( HidingSpotCandidateList::const_iterator iter = spots->begin(); iter != spots->end(); ++iter )
+		m_hidingSpotList.push_back( new HidingSpot( &iter->pos, iter->flags ) );
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Determine how much walkable area we can see from the spot, and how far away we can see.
@@ -2988,7 +3151,7 @@ void ClassifySniperSpot( HidingSpot *spot )
 				walkable.z = area->GetZ( &walkable ) + HalfHumanHeight;
 				
 				// check line of sight
-				util::TraceLine( eye, walkable, util::ignore_monsters, util::ignore_glass, nullptr, &result );
+				NavTraceLine( eye, walkable, util::ignore_monsters, util::ignore_glass, nullptr, &result );
 
 				if (result.flFraction == 1.0f && !result.fStartSolid)
 				{
@@ -3110,8 +3273,8 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 	Vector dir = e.path.to - e.path.from;
 	float length = dir.NormalizeInPlace();
 
-	// create unique marker to flag used spots
-	HidingSpot::ChangeMasterMarker();
+	// flag used spots - kept here rather than in the spots themselves, since other areas may be doing the same
+	std::vector<bool> isEncountered( TheHidingSpotList.size(), false );
 
 	const float stepSize = 25.0f;		// 50
 	const float seeSpotRange = 2000.0f;	// 3000
@@ -3136,7 +3299,8 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 		eye = e.path.from + along * dir;
 
 		// check each hiding spot for visibility
-		for( HidingSpotList::iterator iter = TheHidingSpotList.begin(); iter != TheHidingSpotList.end(); ++iter )
+		int s = 0;
+		for( HidingSpotList::iterator iter = TheHidingSpotList.begin(); iter != TheHidingSpotList.end(); ++iter, ++s )
 		{
 			spot = *iter;
 
@@ -3144,7 +3308,7 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 			if (!spot->HasGoodCover())
 				continue;
 
-			if (spot->IsMarked())
+			if (isEncountered[s])
 				continue;
 
 			const Vector *spotPos = spot->GetPosition();
@@ -3158,7 +3322,7 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 				continue;
 
 			// check if we have LOS
-			util::TraceLine( eye, Vector( spotPos->x, spotPos->y, spotPos->z + HalfHumanHeight ), util::ignore_monsters, util::ignore_glass, nullptr, &result );
+			NavTraceLine( eye, Vector( spotPos->x, spotPos->y, spotPos->z + HalfHumanHeight ), util::ignore_monsters, util::ignore_glass, nullptr, &result );
 			if (result.flFraction != 1.0f)
 				continue;
 
@@ -3179,7 +3343,7 @@ void CNavArea::AddSpotEncounters( const CNavArea *from, NavDirType fromDir, cons
 			}
 
 			// mark spot as encountered
-			spot->Mark();
+			isEncountered[s] = true;
 		}
 	}
 
@@ -3226,97 +3390,375 @@ void CNavArea::ComputeSpotEncounters( void )
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Decay the danger values
+ * Increase the danger of this area for the given team
  */
-void CNavArea::DecayDanger( void )
+void CNavArea::IncreaseDanger( int teamID, float amount )
 {
-	// one kill == 1.0, which we will forget about in two minutes
-	const float decayRate = 1.0f / 120.0f;
+	TheNavDanger.IncreaseDanger( m_id, teamID, amount );
 
-	for( int i=0; i<MAX_AREA_TEAMS; ++i )
-	{
-		float deltaT = gpGlobals->time - m_dangerTimestamp[i];
-		float decayAmount = decayRate * deltaT;
+	// paths that avoid danger may no longer be the best ones
+	// NOTE: decay is not tracked, it only makes cached paths more cautious than they need to be
+	TheNavPathCache.OnDangerChanged();
+}
 
-		m_danger[i] -= decayAmount;
-		if (m_danger[i] < 0.0f)
-			m_danger[i] = 0.0f;
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the danger of this area (decays over time)
+ */
+float CNavArea::GetDanger( int teamID )
+{
+	return TheNavDanger.GetDanger( m_id, teamID );
+}
 
-		// update timestamp
-		m_dangerTimestamp[i] = gpGlobals->time;
-	}
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Increase the danger of nav areas containing and near the given position
+ */
+void IncreaseDangerNearby( int teamID, float amount, CNavArea *startArea, const Vector *pos, float maxRadius )
+{
+	TheNavDanger.IncreaseDangerNearby( teamID, amount, startArea, pos, maxRadius );
 }
 
+
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Increase the danger of this area for the given team
+ * The singleton for the danger of all areas
  */
-void CNavArea::IncreaseDanger( int teamID, float amount )
+CNavDangerField TheNavDanger;
+
+/**
+ * One kill == 1.0, which we will forget about in two minutes
+ */
+const float NavDangerDecayRate = 1.0f / 120.0f;
+
+/**
+ * How often the decay is applied to all areas
+ */
+const float NavDangerDecayInterval = 1.0f;
+
+/**
+ * The neighborhood of an area holds every area that can be reached from it without going
+ * further than this from its center, which covers the danger radius of any nearby position
+ * as long as the two together don't exceed it.
+ */
+const float NavDangerNeighborhoodRadius = 750.0f;
+
+/**
+ * A neighborhood is indexed by unsigned short, so it can't hold more areas than this
+ */
+const unsigned int NavDangerMaxNeighborhoodSize = 65535;
+
+
+CNavDangerField::CNavDangerField( void )
+{
+	m_timestamp = 0.0f;
+	m_meshBuildCount = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the danger of the given area for the given team, decayed to now
+ */
+float CNavDangerField::GetDanger( unsigned int id, int teamID ) const
 {
-	// before we add the new value, decay what's there
-	DecayDanger();
+	if (id >= m_danger[ teamID ].size())
+		return 0.0f;
 
-	m_danger[ teamID ] += amount;
-	m_dangerTimestamp[ teamID ] = gpGlobals->time;
+	float danger = m_danger[ teamID ][ id ] - NavDangerDecayRate * (gpGlobals->time - m_timestamp);
+
+	return (danger > 0.0f) ? danger : 0.0f;
 }
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Return the danger of this area (decays over time)
+ * Increase the danger of the given area for the given team.
+ * Values are kept as of the last decay pass, so the decay since then is added back
+ * to what is stored, to be taken off again when the value is read or decayed.
  */
-float CNavArea::GetDanger( int teamID )
+void CNavDangerField::IncreaseDanger( unsigned int id, int teamID, float amount )
 {
-	DecayDanger();
-	return m_danger[ teamID ];
+	if (id >= m_danger[ teamID ].size())
+	{
+		for( int t=0; t<MAX_TEAMS; ++t )
+			m_danger[t].resize( id+1, 0.0f );
+	}
+
+	float elapsed = NavDangerDecayRate * (gpGlobals->time - m_timestamp);
+
+	m_danger[ teamID ][ id ] = GetDanger( id, teamID ) + amount + elapsed;
 }
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Increase the danger of nav areas containing and near the given position
+ * Forget the danger of the given area, invoked when an area is given its ID
  */
-void IncreaseDangerNearby( int teamID, float amount, CNavArea *startArea, const Vector *pos, float maxRadius )
+void CNavDangerField::ClearDanger( unsigned int id )
+{
+	for( int t=0; t<MAX_TEAMS; ++t )
+		if (id < m_danger[t].size())
+			m_danger[t][ id ] = 0.0f;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Increase the danger of nav areas containing and near the given position.
+ * Areas are reached through adjacent areas within 'maxRadius' of the position, and are given more
+ * of 'amount' the farther they are from it.
+ */
+void CNavDangerField::IncreaseDangerNearby( int teamID, float amount, CNavArea *startArea, const Vector *pos, float maxRadius )
 {
 	if (startArea == nullptr)
 		return;
 
-	CNavArea::MakeNewMarker();
-	CNavArea::ClearSearchLists();
+	// paths that avoid danger may no longer be the best ones
+	TheNavPathCache.OnDangerChanged();
 
-	startArea->AddToOpenList();
-	startArea->SetTotalCost( 0.0f );
-	startArea->Mark();
-	startArea->IncreaseDanger( teamID, amount );
+	// if the radius reaches past the neighborhood of the area, or the neighborhoods aren't usable, search the mesh instead
+	const Neighborhood *neighborhood = nullptr;
+	if (maxRadius + (*pos - *startArea->GetCenter()).Length() <= NavDangerNeighborhoodRadius)
+		neighborhood = GetNeighborhood( startArea );
 
-	while( !CNavArea::IsOpenListEmpty() )
+	if (neighborhood == nullptr)
 	{
-		// get next area to check
-		CNavArea *area = CNavArea::PopOpenList();
-		
-		// area has no hiding spots, explore adjacent areas
-		for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+		CNavArea::MakeNewMarker();
+		CNavArea::ClearSearchLists();
+
+		startArea->SetTotalCost( 0.0f );
+		startArea->AddToOpenList();
+		startArea->Mark();
+		IncreaseDanger( startArea->GetID(), teamID, amount );
+
+		while( !CNavArea::IsOpenListEmpty() )
 		{
-			int count = area->GetAdjacentCount( (NavDirType)dir );
-			for( int i=0; i<count; ++i )
+			// get next area to check
+			CNavArea *area = CNavArea::PopOpenList();
+			
+			// area has no hiding spots, explore adjacent areas
+			for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
 			{
-				CNavArea *adjArea = area->GetAdjacentArea( (NavDirType)dir, i );
-
-				if (!adjArea->IsMarked())
+				int count = area->GetAdjacentCount( (NavDirType)dir );
+				for( int i=0; i<count; ++i )
 				{
-					// compute distance from danger source
-					float cost = (*adjArea->GetCenter() - *pos).Length();
-					if (cost <= maxRadius)
+					CNavArea *adjArea = area->GetAdjacentArea( (NavDirType)dir, i );
+
+					if (!adjArea->IsMarked())
 					{
-						adjArea->AddToOpenList();
-						adjArea->SetTotalCost( cost );
-						adjArea->Mark();
-						adjArea->IncreaseDanger( teamID, amount * cost/maxRadius );
+						// compute distance from danger source
+						float cost = (*adjArea->GetCenter() - *pos).Length();
+						if (cost <= maxRadius)
+						{
+							adjArea->SetTotalCost( cost );
+							adjArea->AddToOpenList();
+							adjArea->Mark();
+							IncreaseDanger( adjArea->GetID(), teamID, amount * cost/maxRadius );
+						}
 					}
 				}
 			}
 		}
+
+		return;
+	}
+
+	// every area within the radius is in the neighborhood, and so is every connection between them,
+	// so walking the neighborhood reaches exactly the areas the search would
+	m_isVisited.assign( neighborhood->entry.size(), false );
+	m_stack.clear();
+
+	m_isVisited[0] = true;
+	m_stack.push_back( 0 );
+	IncreaseDanger( startArea->GetID(), teamID, amount );
+
+	while( !m_stack.empty() )
+	{
+		const Neighborhood::Entry *entry = &neighborhood->entry[ m_stack.back() ];
+		m_stack.pop_back();
+
+		for( unsigned int i=0; i<entry->adjacentCount; ++i )
+		{
+			unsigned short adj = neighborhood->adjacent[ entry->firstAdjacent + i ];
+			if (m_isVisited[ adj ])
+				continue;
+
+			CNavArea *adjArea = neighborhood->entry[ adj ].area;
+
+			// compute distance from danger source
+			float cost = (*adjArea->GetCenter() - *pos).Length();
+			if (cost <= maxRadius)
+			{
+				m_isVisited[ adj ] = true;
+				m_stack.push_back( adj );
+				IncreaseDanger( adjArea->GetID(), teamID, amount * cost/maxRadius );
+			}
+		}
 	}
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the areas around the given area, collecting them the first time.
+ * Returns nullptr if the compact mesh is out of date, since the areas may be changing.
+ */
+const CNavDangerField::Neighborhood *CNavDangerField::GetNeighborhood( const CNavArea *area )
+{
+	if (!TheNavCompactMesh.IsCurrent())
+		return nullptr;
+
+	if (m_meshBuildCount != TheNavCompactMesh.GetBuildCount())
+	{
+		// the areas have changed since the neighborhoods were collected
+		for( unsigned int i=0; i<m_neighborhood.size(); ++i )
+			delete m_neighborhood[i];
+
+		m_neighborhood.clear();
+		m_meshBuildCount = TheNavCompactMesh.GetBuildCount();
+	}
+
+	unsigned int id = area->GetID();
+	if (id >= m_neighborhood.size())
+		m_neighborhood.resize( id+1, nullptr );
+
+	if (m_neighborhood[ id ])
+		return m_neighborhood[ id ];
+
+	Neighborhood *neighborhood = new Neighborhood;
+
+	// collect the areas that can be reached without leaving the neighborhood radius
+	CNavArea::MakeNewMarker();
+
+	Neighborhood::Entry entry;
+	entry.area = const_cast<CNavArea *>( area );
+	entry.firstAdjacent = 0;
+	entry.adjacentCount = 0;
+	neighborhood->entry.push_back( entry );
+	entry.area->Mark();
+
+	for( unsigned int e=0; e<neighborhood->entry.size() && neighborhood->entry.size() < NavDangerMaxNeighborhoodSize; ++e )
+	{
+		const CNavArea *from = neighborhood->entry[e].area;
+
+		for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+		{
+			int count = from->GetAdjacentCount( (NavDirType)dir );
+			for( int i=0; i<count; ++i )
+			{
+				CNavArea *adjArea = from->GetAdjacentArea( (NavDirType)dir, i );
+
+				if (adjArea->IsMarked())
+					continue;
+
+				if ((*adjArea->GetCenter() - *area->GetCenter()).Length() > NavDangerNeighborhoodRadius)
+					continue;
+
+				adjArea->Mark();
+				entry.area = adjArea;
+				neighborhood->entry.push_back( entry );
+			}
+		}
+	}
+
+	if (neighborhood->entry.size() >= NavDangerMaxNeighborhoodSize)
+	{
+		// too big to index - let the mesh be searched instead
+		delete neighborhood;
+		return nullptr;
+	}
+
+	// the connections between them, by index into the neighborhood
+	std::vector<int> index( m_neighborhood.size(), -1 );
+	for( unsigned int e=0; e<neighborhood->entry.size(); ++e )
+	{
+		unsigned int entryID = neighborhood->entry[e].area->GetID();
+		if (entryID >= index.size())
+			index.resize( entryID+1, -1 );
+
+		index[ entryID ] = e;
+	}
+
+	for( unsigned int e=0; e<neighborhood->entry.size(); ++e )
+	{
+		Neighborhood::Entry *from = &neighborhood->entry[e];
+		from->firstAdjacent = neighborhood->adjacent.size();
+
+		for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+		{
+			int count = from->area->GetAdjacentCount( (NavDirType)dir );
+			for( int i=0; i<count; ++i )
+			{
+				unsigned int adjID = from->area->GetAdjacentArea( (NavDirType)dir, i )->GetID();
+
+				if (adjID < index.size() && index[ adjID ] >= 0)
+					neighborhood->adjacent.push_back( index[ adjID ] );
+			}
+		}
+
+		from->adjacentCount = neighborhood->adjacent.size() - from->firstAdjacent;
+	}
+
+	m_neighborhood[ id ] = neighborhood;
+
+	return neighborhood;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Apply the decay to all areas, if it is time
+ */
+void CNavDangerField::Update( void )
+{
+	float elapsed = gpGlobals->time - m_timestamp;
+
+	// the clock starts over with each map
+	if (elapsed < 0.0f)
+	{
+		m_timestamp = gpGlobals->time;
+		return;
+	}
+
+	if (elapsed >= NavDangerDecayInterval)
+		Decay();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Decay the danger of all areas to now, in one pass over each array
+ */
+void CNavDangerField::Decay( void )
+{
+	const float decayAmount = NavDangerDecayRate * (gpGlobals->time - m_timestamp);
+
+	for( int t=0; t<MAX_TEAMS; ++t )
+	{
+		// simple enough for the compiler to vectorize
+		float *danger = m_danger[t].data();
+		const unsigned int count = m_danger[t].size();
+
+		for( unsigned int i=0; i<count; ++i )
+		{
+			float value = danger[i] - decayAmount;
+			danger[i] = (value > 0.0f) ? value : 0.0f;
+		}
+	}
+
+	m_timestamp = gpGlobals->time;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Forget all danger, invoked when the navigation mesh goes away
+ */
+void CNavDangerField::Reset( void )
+{
+	for( int t=0; t<MAX_TEAMS; ++t )
+		m_danger[t].clear();
+
+	for( unsigned int i=0; i<m_neighborhood.size(); ++i )
+		delete m_neighborhood[i];
+
+	m_neighborhood.clear();
+	m_timestamp = gpGlobals ? gpGlobals->time : 0.0f;
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Show danger levels for debugging
@@ -3941,6 +4383,9 @@ void CNavArea::DrawConnectedAreas( void )
  */
 void CNavArea::RaiseCorner( NavCornerType corner, int amount )
 {
+	TheNavPathCache.OnMeshChanged();
+	TheNavCompactMesh.Invalidate();
+
 	if ( corner == NUM_CORNERS )
 	{
 		m_extent.lo.z += amount;
@@ -4012,6 +4457,19 @@ void EditNavAreas( NavEditCmdType cmd )
 	if (player == nullptr)
 		return;
 
+	// most edit commands change areas or their connections, so cached paths and the compact mesh can't be trusted
+	if (cmd != EDIT_NONE)
+	{
+		if (TheNavAnalysis.IsRunning())
+		{
+			CONSOLE_ECHO( "Navigation analysis cancelled by edit.\n" );
+			TheNavAnalysis.Abort();
+		}
+
+		TheNavPathCache.OnMeshChanged();
+		TheNavCompactMesh.Invalidate();
+	}
+
 	// don't draw too often on fast video cards or the areas may not appear (odd video effect)
 	float drawTimestamp = gpGlobals->time;
 	const float maxDrawRate = 0.05f;
@@ -4668,7 +5126,7 @@ bool GetGroundHeight( const Vector *pos, float *height, Vector *normal )
 	{
 		from = *pos + Vector( 0, 0, offset );
 
-		util::TraceLine( from, to, util::ignore_monsters, util::dont_ignore_glass, ignore->Get<CBaseEntity>(), &result );
+		util::TraceLine( from, to, util::ignore_monsters, util::dont_ignore_glass, (ignore) ? ignore->Get<CBaseEntity>() : nullptr, &result );
 
 		// if the trace came down thru a door, ignore the door and try again
 		// also ignore breakable floors
@@ -4752,8 +5210,6 @@ bool GetSimpleGroundHeight( const Vector *pos, float *height, Vector *normal )
 
 //--------------------------------------------------------------------------------------------------------------
 enum { MAX_BLOCKED_AREAS = 256 };
-static unsigned int BlockedID[ MAX_BLOCKED_AREAS ];
-static int BlockedIDCount = 0;
 
 /**
  * Shortest path cost, paying attention to "blocked" areas
@@ -4761,11 +5217,17 @@ static int BlockedIDCount = 0;
 class ApproachAreaCost
 {
 public:
+	ApproachAreaCost( const unsigned int *blockedID, int blockedIDCount )
+	{
+		m_blockedID = blockedID;
+		m_blockedIDCount = blockedIDCount;
+	}
+
 	float operator() ( CNavArea *area, CNavArea *fromArea, const CNavLadder *ladder )
 	{
 		// check if this area is "blocked"
-		for( int i=0; i<BlockedIDCount; ++i )
-			if (area->GetID() == BlockedID[i])
+		for( int i=0; i<m_blockedIDCount; ++i )
+			if (area->GetID() == m_blockedID[i])
 				return -1.0f;
 
 		if (fromArea == nullptr)
@@ -4788,6 +5250,10 @@ public:
 			return cost;
 		}
 	}
+
+private:
+	const unsigned int *m_blockedID;
+	int m_blockedIDCount;
 };
 
 /**
@@ -4805,7 +5271,7 @@ inline bool IsAreaVisible( const Vector *pos, const CNavArea *area )
 		corner = *area->GetCorner( (NavCornerType)c );
 		corner.z += 0.75f * HumanHeight;
 
-		util::TraceLine( *pos, corner, util::ignore_monsters, nullptr, &result );
+		NavTraceLine( *pos, corner, util::ignore_monsters, nullptr, &result );
 		if (result.flFraction == 1.0f)
 		{
 			// we can see this area
@@ -4830,7 +5296,9 @@ void CNavArea::ComputeApproachAreas( void )
 
 	// use the center of the nav area as the "view" point
 	Vector eye = m_center;
-	if (GetGroundHeight( &eye, &eye.z ) == false)
+	bool isOnGround = false;
+	NavRunOnGameThread( [&]() { isOnGround = GetGroundHeight( &eye, &eye.z ); } );
+	if (isOnGround == false)
 		return;
 
 	// approximate eye position
@@ -4842,6 +5310,9 @@ void CNavArea::ComputeApproachAreas( void )
 	enum { MAX_PATH_LENGTH = 256 };
 	CNavArea *path[ MAX_PATH_LENGTH ];
 
+	unsigned int BlockedID[ MAX_BLOCKED_AREAS ];
+	int BlockedIDCount;
+
 	//
 	// In order to enumerate all of the approach areas, we need to
 	// run the algorithm many times, once for each "far away" area
@@ -4859,7 +5330,7 @@ void CNavArea::ComputeApproachAreas( void )
 			continue;
 	
 		// make first path to far away area
-		ApproachAreaCost cost;
+		ApproachAreaCost cost( BlockedID, BlockedIDCount );
 		if (NavAreaBuildPath( this, farArea, nullptr, cost ) == false)
 			continue;
 
@@ -4895,7 +5366,7 @@ void CNavArea::ComputeApproachAreas( void )
 				// mark this area as "blocked" and unusable by subsequent approach paths
 				if (BlockedIDCount == MAX_BLOCKED_AREAS)
 				{
-					CONSOLE_ECHO( "Overflow computing approach areas for area #%d.\n", m_id );
+					NavRunOnGameThread( [this]() { CONSOLE_ECHO( "Overflow computing approach areas for area #%d.\n", m_id ); } );
 					return;
 				}
 
@@ -4932,7 +5403,7 @@ void CNavArea::ComputeApproachAreas( void )
 			}
 
 			// find another path to 'farArea'
-			ApproachAreaCost cost;
+			ApproachAreaCost cost( BlockedID, BlockedIDCount );
 			if (NavAreaBuildPath( this, farArea, nullptr, cost ) == false)
 			{
 				// can't find a path to 'farArea' means all exits have been already tested and blocked
@@ -5092,6 +5563,10 @@ CNavArea *CNavAreaGrid::GetNavArea( const Vector *pos, float beneathLimit ) cons
 	// get list in cell that contains position
 	int x = WorldToGridX( pos->x );
 	int y = WorldToGridY( pos->y );
+
+	if (TheNavCompactMesh.IsCurrent())
+		return TheNavCompactMesh.GetNavArea( x + y*m_gridSizeX, pos, beneathLimit );
+
 	NavAreaList *list = &m_grid[ x + y*m_gridSizeX ];
 
 
@@ -5131,11 +5606,323 @@ CNavArea *CNavAreaGrid::GetNavArea( const Vector *pos, float beneathLimit ) cons
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+CNavCompactMesh TheNavCompactMesh;
+
+CNavCompactMesh::CNavCompactMesh( void )
+{
+	m_isBuilt = false;
+	m_isStale = false;
+	m_buildCount = 0;
+}
+
+/**
+ * Build the compact mesh from the current navigation mesh
+ */
+void CNavCompactMesh::Build( void )
+{
+	unsigned int maxID = BeginBuild();
+	if (maxID == 0)
+		return;
+
+	for( unsigned int id=0; id<=maxID; ++id )
+		if (m_area[ id ])
+			m_extent[ id ] = *m_area[ id ]->GetExtent();
+
+	// lay out the adjacent areas of each area one after another, in order of ID
+	for( unsigned int id=0; id<=maxID; ++id )
+	{
+		m_adjacentStart[ id ] = m_adjacent.size();
+
+		if (m_area[ id ])
+			CollectAdjacentAreas( m_area[ id ], &m_adjacent );
+	}
+	m_adjacentStart[ maxID+1 ] = m_adjacent.size();
+
+	FinishBuild();
+}
+
+/**
+ * Build the compact mesh from the records of the file the current navigation mesh was just loaded from,
+ * reading the extents and floor connections in place rather than from the lists of each CNavArea.
+ * Ladders are not stored in the file, so they still come from the areas.
+ * The file must have been validated.
+ */
+void CNavCompactMesh::Build( const NavMappedFile *file )
+{
+	unsigned int maxID = BeginBuild();
+	if (maxID == 0)
+		return;
+
+	const NavFileArea *records = file->GetRecords<NavFileArea>( NAV_FILE_AREAS );
+	const unsigned int *connections = file->GetRecords<unsigned int>( NAV_FILE_CONNECTIONS );
+	unsigned int count = file->GetCount( NAV_FILE_AREAS );
+
+	std::vector<const NavFileArea *> recordByID( maxID+1, nullptr );
+	for( unsigned int i=0; i<count; ++i )
+	{
+		const NavFileArea *data = &records[i];
+		if (data->id > maxID || m_area[ data->id ] == nullptr)
+			continue;
+
+		recordByID[ data->id ] = data;
+
+		m_extent[ data->id ].lo = Vector( data->lo[0], data->lo[1], data->lo[2] );
+		m_extent[ data->id ].hi = Vector( data->hi[0], data->hi[1], data->hi[2] );
+	}
+
+	// lay out the adjacent areas of each area one after another, in order of ID,
+	// in the same order as CollectAdjacentAreas()
+	NavAdjacentArea adj;
+	adj.ladder = nullptr;
+
+	for( unsigned int id=0; id<=maxID; ++id )
+	{
+		m_adjacentStart[ id ] = m_adjacent.size();
+
+		const NavFileArea *data = recordByID[ id ];
+		if (data == nullptr)
+		{
+			// an area that is not in the file
+			if (m_area[ id ])
+				CollectAdjacentAreas( m_area[ id ], &m_adjacent );
+			continue;
+		}
+
+		const unsigned int *connection = connections + data->firstConnection;
+		for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+		{
+			adj.how = (NavTraverseType)dir;
+
+			for( int i=0; i<data->connectionCount[ dir ]; ++i )
+			{
+				unsigned int connectID = *connection++;
+				adj.area = (connectID <= maxID) ? m_area[ connectID ] : nullptr;
+				m_adjacent.push_back( adj );
+			}
+		}
+
+		CollectLadderAreas( m_area[ id ], &m_adjacent );
+	}
+	m_adjacentStart[ maxID+1 ] = m_adjacent.size();
+
+	FinishBuild();
+}
+
+/**
+ * Discard what we had and index the current areas by ID.
+ * Return the highest area ID, or zero if there is no navigation mesh to build from.
+ */
+unsigned int CNavCompactMesh::BeginBuild( void )
+{
+	Reset();
+
+	++m_buildCount;
+
+	if (TheNavAreaList.empty() || TheNavAreaGrid.m_grid == nullptr)
+		return 0;
+
+	unsigned int maxID = 0;
+	NavAreaList::iterator iter;
+	for( iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
+		if ((*iter)->GetID() > maxID)
+			maxID = (*iter)->GetID();
+
+	m_area.resize( maxID+1, nullptr );
+	m_extent.resize( maxID+1 );
+	m_adjacentStart.resize( maxID+2 );
+
+	for( iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
+		m_area[ (*iter)->GetID() ] = *iter;
+
+	return maxID;
+}
+
+/**
+ * Copy the grid cells, keeping the order of their areas, and start being used
+ */
+void CNavCompactMesh::FinishBuild( void )
+{
+	int cellCount = TheNavAreaGrid.m_gridSizeX * TheNavAreaGrid.m_gridSizeY;
+	m_cellStart.resize( cellCount+1 );
+	for( int c=0; c<cellCount; ++c )
+	{
+		m_cellStart[ c ] = m_cellArea.size();
+
+		const NavAreaList *list = &TheNavAreaGrid.m_grid[ c ];
+		for( NavAreaList::const_iterator cellIter = list->begin(); cellIter != list->end(); ++cellIter )
+			m_cellArea.push_back( (*cellIter)->GetID() );
+	}
+	m_cellStart[ cellCount ] = m_cellArea.size();
+
+	m_isBuilt = true;
+}
+
+/**
+ * Discard the compact mesh, invoked when the navigation mesh goes away
+ */
+void CNavCompactMesh::Reset( void )
+{
+	m_isBuilt = false;
+	m_isStale = false;
+
+	m_area.clear();
+	m_extent.clear();
+	m_adjacentStart.clear();
+	m_adjacent.clear();
+	m_cellStart.clear();
+	m_cellArea.clear();
+}
+
+/**
+ * Rebuild the compact mesh if the navigation mesh has changed since it was built
+ */
+void CNavCompactMesh::Update( void )
+{
+	if (m_isBuilt && m_isStale)
+		Build();
+}
+
+/**
+ * Append the areas that can be reached from 'area', in the order searches expand them:
+ * the areas connected on the floor in each direction, then the areas at the top of
+ * up ladders, then the areas at the bottom of down ladders.
+ */
+void CNavCompactMesh::CollectAdjacentAreas( const CNavArea *area, NavAdjacentAreaVector *adjacent )
+{
+	NavAdjacentArea adj;
+
+	adj.ladder = nullptr;
+	for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+	{
+		adj.how = (NavTraverseType)dir;
+
+		const NavConnectList *list = area->GetAdjacentList( (NavDirType)dir );
+		for( NavConnectList::const_iterator iter = list->begin(); iter != list->end(); ++iter )
+		{
+			adj.area = (*iter).area;
+			adjacent->push_back( adj );
+		}
+	}
+
+	CollectLadderAreas( area, adjacent );
+}
+
+/**
+ * Append the areas that can be reached from 'area' by ladder:
+ * the areas at the top of up ladders, then the areas at the bottom of down ladders.
+ */
+void CNavCompactMesh::CollectLadderAreas( const CNavArea *area, NavAdjacentAreaVector *adjacent )
+{
+	NavAdjacentArea adj;
+	NavLadderList::const_iterator ladderIter;
+
+	adj.how = GO_LADDER_UP;
+	const NavLadderList *ladderList = area->GetLadderList( LADDER_UP );
+	for( ladderIter = ladderList->begin(); ladderIter != ladderList->end(); ++ladderIter )
+	{
+		const CNavLadder *ladder = *ladderIter;
+
+		// cannot use this ladder if the ladder bottom is hanging above our head
+		if (ladder->m_isDangling)
+			continue;
+
+		adj.ladder = ladder;
+
+		// do not use BEHIND connection, as its very hard to get to when going up a ladder
+		CNavArea *top[] = { ladder->m_topForwardArea, ladder->m_topLeftArea, ladder->m_topRightArea };
+		for( int t=0; t<3; ++t )
+		{
+			if (top[t] == nullptr)
+				continue;
+
+			adj.area = top[t];
+			adjacent->push_back( adj );
+		}
+	}
+
+	adj.how = GO_LADDER_DOWN;
+	ladderList = area->GetLadderList( LADDER_DOWN );
+	for( ladderIter = ladderList->begin(); ladderIter != ladderList->end(); ++ladderIter )
+	{
+		const CNavLadder *ladder = *ladderIter;
+
+		if (ladder->m_bottomArea == nullptr)
+			continue;
+
+		adj.ladder = ladder;
+		adj.area = ladder->m_bottomArea;
+		adjacent->push_back( adj );
+	}
+}
+
+/**
+ * Given a position in the given grid cell, return the nav area that IsOverlapping and is *immediately* beneath it
+ */
+CNavArea *CNavCompactMesh::GetNavArea( int cell, const Vector *pos, float beneathLimit ) const
+{
+	CNavArea *use = nullptr;
+	float useZ = -99999999.9f;
+	Vector testPos = *pos + Vector( 0, 0, 5 );
+
+	for( unsigned int i = m_cellStart[ cell ]; i < m_cellStart[ cell+1 ]; ++i )
+	{
+		unsigned int id = m_cellArea[ i ];
+		const Extent *extent = &m_extent[ id ];
+
+		// check if position is within 2D boundaries of this area
+		if (testPos.x >= extent->lo.x && testPos.x <= extent->hi.x &&
+			testPos.y >= extent->lo.y && testPos.y <= extent->hi.y)
+		{
+			// project position onto area to get Z
+			float z = m_area[ id ]->GetZ( &testPos );
+
+			// if area is above us, skip it
+			if (z > testPos.z)
+				continue;
+
+			// if area is too far below us, skip it
+			if (z < pos->z - beneathLimit)
+				continue;
+
+			// if area is higher than the one we have, use this instead
+			if (z > useZ)
+			{
+				use = m_area[ id ];
+				useZ = z;
+			}
+		}
+	}
+
+	return use;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * An area near a position, and the closest point on it
+ */
+struct NearbyNavArea
+{
+	CNavArea *area;
+	Vector closePos;
+	float distSq;
+};
+
+inline bool IsNearbyNavAreaCloser( const NearbyNavArea &a, const NearbyNavArea &b )
+{
+	return (a.distSq < b.distSq) ? true : false;
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Given a position in the world, return the nav area that is closest
  * and at the same height, or beneath it.
  * Used to find initial area if we start off of the mesh.
+ *
+ * Grid cells are searched in rings of increasing size around the position. Once the rings
+ * searched so far guarantee that no unseen area can be closer than a candidate, the
+ * candidates are checked for line of sight closest first, and the first one visible wins.
  */
 CNavArea *CNavAreaGrid::GetNearestNavArea( const Vector *pos, bool anyZ ) const
 {
@@ -5143,7 +5930,6 @@ CNavArea *CNavAreaGrid::GetNearestNavArea( const Vector *pos, bool anyZ ) const
 		return nullptr;
 
 	CNavArea *close = nullptr;
-	float closeDistSq = 99999999.9f;
 
 	// quick check
 	close = GetNavArea( pos );
@@ -5159,36 +5945,101 @@ CNavArea *CNavAreaGrid::GetNearestNavArea( const Vector *pos, bool anyZ ) const
 
 	source.z += HalfHumanHeight;
 
-	/// @todo Step incrementally using grid for speed
+	int sourceX = WorldToGridX( source.x );
+	int sourceY = WorldToGridY( source.y );
 
-	// find closest nav area
-	for( NavAreaList::iterator iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
+	std::vector<NearbyNavArea> candidates;		// areas seen but not yet checked, sorted closest first once checking starts
+	std::vector<bool> seen( CNavArea::m_nextID );	// by area ID - areas cover several cells, so only look at each one once
+	unsigned int checked = 0;					// candidates before this index have failed their line of sight check
+
+	for( int ring = 0; ; ++ring )
 	{
-		CNavArea *area = *iter;
+		// the rectangle of cells covered by all rings so far
+		int loX = sourceX - ring;
+		int hiX = sourceX + ring;
+		int loY = sourceY - ring;
+		int hiY = sourceY + ring;
+
+		bool isLastRing = (loX <= 0 && loY <= 0 && hiX >= m_gridSizeX-1 && hiY >= m_gridSizeY-1);
+
+		// gather areas in the cells of this ring
+		for( int y = loY; y <= hiY; ++y )
+		{
+			if (y < 0 || y >= m_gridSizeY)
+				continue;
+
+			// rows between the top and bottom of the ring only have cells at either end
+			int step = (y == loY || y == hiY) ? 1 : hiX - loX;
+
+			for( int x = loX; x <= hiX; x += step )
+			{
+				if (x < 0 || x >= m_gridSizeX)
+					continue;
+
+				const NavAreaList *list = &m_grid[ x + y*m_gridSizeX ];
+				for( NavAreaList::const_iterator iter = list->begin(); iter != list->end(); ++iter )
+				{
+					CNavArea *area = *iter;
+
+					if (seen[ area->GetID() ])
+						continue;
 
-		Vector areaPos;
-		area->GetClosestPointOnArea( &source, &areaPos );
+					seen[ area->GetID() ] = true;
 
-		float distSq = (areaPos - source).LengthSquared();
+					NearbyNavArea nearby;
+					nearby.area = area;
+					area->GetClosestPointOnArea( &source, &nearby.closePos );
+					nearby.distSq = (nearby.closePos - source).LengthSquared();
 
-		// keep the closest area
-		if (distSq < closeDistSq)
+					candidates.push_back( nearby );
+				}
+			}
+		}
+
+		// any area not seen yet lies entirely outside the rectangle, so it is at least this far away
+		float unseenDist = 99999999.9f;
+		if (!isLastRing)
+		{
+			if (loX > 0)
+				unseenDist = std::min( unseenDist, source.x - (m_minX + loX * m_cellSize) );
+			if (hiX < m_gridSizeX-1)
+				unseenDist = std::min( unseenDist, (m_minX + (hiX+1) * m_cellSize) - source.x );
+			if (loY > 0)
+				unseenDist = std::min( unseenDist, source.y - (m_minY + loY * m_cellSize) );
+			if (hiY < m_gridSizeY-1)
+				unseenDist = std::min( unseenDist, (m_minY + (hiY+1) * m_cellSize) - source.y );
+
+			if (unseenDist < 0.0f)
+				unseenDist = 0.0f;
+		}
+
+		std::sort( candidates.begin() + checked, candidates.end(), IsNearbyNavAreaCloser );
+
+		// check line of sight to candidates that no unseen area can beat, closest first
+		float unseenDistSq = unseenDist * unseenDist;
+		for( ; checked < candidates.size(); ++checked )
 		{
-			// check LOS to area
+			const NearbyNavArea *nearby = &candidates[ checked ];
+
+			if (!isLastRing && nearby->distSq >= unseenDistSq)
+				break;
+
 			if (!anyZ)
 			{
 				TraceResult result;
-				util::TraceLine( source, areaPos + Vector( 0, 0, HalfHumanHeight ), util::ignore_monsters, util::ignore_glass, nullptr, &result );
+				util::TraceLine( source, nearby->closePos + Vector( 0, 0, HalfHumanHeight ), util::ignore_monsters, util::ignore_glass, nullptr, &result );
 				if (result.flFraction != 1.0f)
 					continue;
 			}
-					
-			closeDistSq = distSq;
-			close = area;
+
+			return nearby->area;
 		}
+
+		if (isLastRing)
+			break;
 	}
 
-	return close;
+	return nullptr;
 }
 
 //--------------------------------------------------------------------------------------------------------------
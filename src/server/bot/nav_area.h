@@ -6,10 +6,15 @@
 #define _NAV_AREA_H_
 
 #include <list>
+#include <vector>
 #include "nav.h"
 #include "steam_util.h"
 
 class CNavArea;
+class NavMappedFile;
+struct NavFileContents;
+struct NavFileArea;
+struct NavFileHidingSpot;
 
 void DestroyHidingSpots( void );
 void StripNavigationAreas( void );
@@ -130,8 +135,9 @@ public:
 	void SetFlags( unsigned char flags )		{ m_flags |= flags; }		///< FOR INTERNAL USE ONLY
 	unsigned char GetFlags( void ) const		{ return m_flags; }
 
-	void Save( int fd, unsigned int version ) const;
+	void Save( NavFileHidingSpot *data ) const;
 	void Load( SteamFile *file, unsigned int version );
+	void Load( const NavFileHidingSpot *data );
 
 	const Vector *GetPosition( void ) const		{ return &m_pos; }	///< get the position of the hiding spot
 	unsigned int GetID( void ) const			{ return m_id; }
@@ -157,6 +163,16 @@ extern HidingSpotList TheHidingSpotList;
 
 extern HidingSpot *GetHidingSpotByID( unsigned int id );
 
+/**
+ * A hiding spot found by analysis, before it has been created
+ */
+struct HidingSpotCandidate
+{
+	Vector pos;
+	unsigned char flags;
+};
+typedef std::vector<HidingSpotCandidate> HidingSpotCandidateList;
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Stores a pointer to an interesting "spot", and a parametric distance along a path
@@ -188,6 +204,57 @@ struct SpotEncounter
 typedef std::list<SpotEncounter> SpotEncounterList;
 
 
+//-------------------------------------------------------------------------------------------------------------------
+/**
+ * The per-search state of a nav area, used by the A* and breadth-first searches.
+ * These are kept in a flat array indexed by area ID rather than in the areas themselves,
+ * so a search only touches one contiguous block of memory for its bookkeeping.
+ * An entry is only meaningful while its marker matches the current master marker.
+ */
+struct NavSearchNode
+{
+	unsigned int marker;									///< used to flag the area as visited
+	unsigned int openMarker;								///< if this equals the current marker value, we are on the open list
+	CNavArea *parent;										///< the area just prior to this on in the search path
+	NavTraverseType parentHow;								///< how we get from parent to us
+	float totalCost;										///< the distance so far plus an estimate of the distance left
+	float costSoFar;										///< distance travelled so far
+	unsigned int openIndex;									///< position in the open list heap - only valid if on the open list
+};
+
+/**
+ * An entry in the open list heap.
+ * The cost is copied here so that ordering the heap does not touch the search nodes.
+ */
+struct NavOpenEntry
+{
+	float totalCost;
+	unsigned int sequence;									///< insertion order, so that areas with equal cost leave the open list first-in, first-out
+	unsigned int id;
+	CNavArea *area;
+};
+
+/**
+ * Everything an A* search keeps between expansions: the per-area search nodes,
+ * the open list, and the marker that tells which nodes belong to the current search.
+ * Areas read and write whichever context is current, so a search that is spread
+ * over several frames keeps its own context and only makes it current while it runs.
+ */
+struct NavSearchContext
+{
+	NavSearchContext( void )
+	{
+		masterMarker = 1;
+		openSequence = 0;
+	}
+
+	unsigned int masterMarker;								///< used to mark areas
+	std::vector<NavSearchNode> nodeList;					///< search state of every area, indexed by area ID
+	std::vector<NavOpenEntry> openList;						///< binary min-heap of areas ordered by total cost
+	unsigned int openSequence;								///< used to order areas with equal cost on the open list
+};
+
+
 //-------------------------------------------------------------------------------------------------------------------
 /**
  * A CNavArea is a rectangular region defining a walkable area in the map
@@ -206,8 +273,9 @@ public:
 	void Disconnect( CNavArea *area );							///< disconnect this area from given area
 
 	void Save( FILE *fp ) const;
-	void Save( int fd, unsigned int version );
+	bool Save( NavFileContents *contents ) const;
 	void Load( SteamFile *file, unsigned int version );
+	void Load( const NavMappedFile *file, const NavFileArea *data );
 	NavErrorType PostLoad( void );
 
 	unsigned int GetID( void ) const						{ return m_id; }
@@ -254,6 +322,8 @@ public:
 	//- hiding spots ------------------------------------------------------------------------------------
 	const HidingSpotList *GetHidingSpotList( void ) const	{ return &m_hidingSpotList; }
 	void ComputeHidingSpots( void );							///< analyze local area neighborhood to find "hiding spots" in this area - for map learning
+	void FindHidingSpots( HidingSpotCandidateList *spots ) const;	///< find where the "hiding spots" of this area belong, without creating them
+	void AddHidingSpots( const HidingSpotCandidateList *spots );	///< create the given hiding spots in this area
 	void ComputeSniperSpots( void );							///< analyze local area neighborhood to find "sniper spots" in this area - for map learning
 
 	SpotEncounter *GetSpotEncounter( const CNavArea *from, const CNavArea *to );	///< given the areas we are moving between, return the spots we will encounter
@@ -283,16 +353,16 @@ public:
 	void ComputeApproachAreas( void );							///< determine the set of "approach areas" - for map learning
 
 	//- A* pathfinding algorithm ------------------------------------------------------------------------
-	static void MakeNewMarker( void )					{ ++m_masterMarker; if (m_masterMarker == 0) m_masterMarker = 1; }
-	void Mark( void )													{ m_marker = m_masterMarker; }
-	bool IsMarked( void ) const								{ return (m_marker == m_masterMarker) ? true : false; }
+	static void MakeNewMarker( void )					{ ++m_search->masterMarker; if (m_search->masterMarker == 0) m_search->masterMarker = 1; }
+	void Mark( void )													{ m_search->nodeList[ m_id ].marker = m_search->masterMarker; }
+	bool IsMarked( void ) const								{ return (m_search->nodeList[ m_id ].marker == m_search->masterMarker) ? true : false; }
 	
-	void SetParent( CNavArea *parent, NavTraverseType how = NUM_TRAVERSE_TYPES )	{ m_parent = parent; m_parentHow = how; }
-	CNavArea *GetParent( void ) const						{ return m_parent; }
-	NavTraverseType GetParentHow( void ) const	{ return m_parentHow; }
+	void SetParent( CNavArea *parent, NavTraverseType how = NUM_TRAVERSE_TYPES )	{ m_search->nodeList[ m_id ].parent = parent; m_search->nodeList[ m_id ].parentHow = how; }
+	CNavArea *GetParent( void ) const						{ return m_search->nodeList[ m_id ].parent; }
+	NavTraverseType GetParentHow( void ) const	{ return m_search->nodeList[ m_id ].parentHow; }
 
 	bool IsOpen( void ) const;								///< true if on "open list"
-	void AddToOpenList( void );								///< add to open list in decreasing value order
+	void AddToOpenList( void );								///< add to open list, ordered by total cost (set the cost first)
 	void UpdateOnOpenList( void );							///< a smaller value has been found, update this area on the open list
 	void RemoveFromOpenList( void );
 	static bool IsOpenListEmpty( void );
@@ -304,11 +374,13 @@ public:
 
 	static void ClearSearchLists( void );					///< clears the open and closed lists for a new search
 
-	void SetTotalCost( float value )							{ m_totalCost = value; }
-	float GetTotalCost( void ) const							{ return m_totalCost; }
+	static NavSearchContext *SetSearchContext( NavSearchContext *context );	///< make the given search state current (nullptr for the shared one), returning the previous one
+
+	void SetTotalCost( float value )							{ m_search->nodeList[ m_id ].totalCost = value; }
+	float GetTotalCost( void ) const							{ return m_search->nodeList[ m_id ].totalCost; }
 
-	void SetCostSoFar( float value )							{ m_costSoFar = value; }
-	float GetCostSoFar( void ) const							{ return m_costSoFar; }
+	void SetCostSoFar( float value )							{ m_search->nodeList[ m_id ].costSoFar = value; }
+	float GetCostSoFar( void ) const							{ return m_search->nodeList[ m_id ].costSoFar; }
 
 	//- editing -----------------------------------------------------------------------------------------
 	void Draw( byte red, byte green, byte blue, int duration = 50 );	///< draw area for debugging & editing
@@ -354,14 +426,9 @@ private:
 	//- for hunting -------------------------------------------------------------------------------------
 	float m_clearedTimestamp[ MAX_AREA_TEAMS ];				///< time this area was last "cleared" of enemies
 
-	//- "danger" ----------------------------------------------------------------------------------------
-	float m_danger[ MAX_AREA_TEAMS ];						///< danger of this area, allowing bots to avoid areas where they died in the past - zero is no danger
-	float m_dangerTimestamp[ MAX_AREA_TEAMS ];				///< time when danger value was set - used for decaying
-	void DecayDanger( void );
-
 	//- hiding spots ------------------------------------------------------------------------------------
 	HidingSpotList m_hidingSpotList;
-	bool IsHidingSpotCollision( const Vector *pos ) const;	///< returns true if an existing hiding spot is too close to given position
+	bool IsHidingSpotCollision( const Vector *pos, const HidingSpotCandidateList *spots ) const;	///< returns true if an existing or found hiding spot is too close to given position
 
 	//- encounter spots ---------------------------------------------------------------------------------
 	SpotEncounterList m_spotEncounterList;					///< list of possible ways to move thru this area, and the spots to look at as we do
@@ -375,16 +442,12 @@ private:
 	void Strip( void );										///< remove "analyzed" data from nav area
 
 	//- A* pathfinding algorithm ------------------------------------------------------------------------
-	static unsigned int m_masterMarker;
-	unsigned int m_marker;									///< used to flag the area as visited
-	CNavArea *m_parent;										///< the area just prior to this on in the search path
-	NavTraverseType m_parentHow;							///< how we get from parent to us
-	float m_totalCost;										///< the distance so far plus an estimate of the distance left
-	float m_costSoFar;										///< distance travelled so far
+	static NavSearchContext m_sharedSearch;					///< search state used by all searches that run to completion at once
+	static thread_local NavSearchContext *m_search;			///< the current search state of this thread
+	static void ReserveSearchNode( unsigned int id );		///< make sure there is a search node for the given area ID
 
-	static CNavArea *m_openList;
-	CNavArea *m_nextOpen, *m_prevOpen;						///< only valid if m_openMarker == m_masterMarker
-	unsigned int m_openMarker;								///< if this equals the current marker value, we are on the open list
+	static void OpenListSiftUp( unsigned int index );
+	static void OpenListSiftDown( unsigned int index );
 
 	//- connections to adjacent areas -------------------------------------------------------------------
 	NavConnectList m_connect[ NUM_DIRECTIONS ];				///< a list of adjacent areas for each direction
@@ -434,19 +497,19 @@ inline CNavArea *CNavArea::GetAdjacentArea( NavDirType dir, int i ) const
 
 inline bool CNavArea::IsOpen( void ) const
 {
-	return (m_openMarker == m_masterMarker) ? true : false;
+	return (m_search->nodeList[ m_id ].openMarker == m_search->masterMarker) ? true : false;
 }
 
 inline bool CNavArea::IsOpenListEmpty( void )
 {
-	return (m_openList) ? false : true;
+	return m_search->openList.empty();
 }
 
 inline CNavArea *CNavArea::PopOpenList( void )
 {
-	if (m_openList)
+	if (!m_search->openList.empty())
 	{
-		CNavArea *area = m_openList;
+		CNavArea *area = m_search->openList.front().area;
 	
 		// disconnect from list
 		area->RemoveFromOpenList();
@@ -501,6 +564,8 @@ public:
 	Place GetPlace( const Vector *pos ) const;				///< return radio chatter place for given coordinate
 
 private:
+	friend class CNavCompactMesh;
+
 	const float m_cellSize;
 	NavAreaList *m_grid;
 	int m_gridSizeX;
@@ -542,6 +607,140 @@ private:
 
 extern CNavAreaGrid TheNavAreaGrid;
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * An area that can be reached from another area, and how to get there
+ */
+struct NavAdjacentArea
+{
+	CNavArea *area;
+	const CNavLadder *ladder;								///< the ladder to use, or nullptr if the areas are connected on the floor
+	NavTraverseType how;
+};
+
+typedef std::vector<NavAdjacentArea> NavAdjacentAreaVector;
+
+/**
+ * The CNavCompactMesh is a read-only copy of the navigation mesh laid out for searching.
+ * The connections of all areas are kept in one array, with the connections of each area
+ * found by its ID, and the grid cells and area extents are kept the same way, so searches
+ * step through contiguous memory instead of following the lists of each CNavArea.
+ * The CNavAreas are still what is edited and saved. The compact mesh is built once the
+ * mesh is loaded, and any change to the areas stops it from being used until it is rebuilt.
+ */
+class CNavCompactMesh
+{
+public:
+	CNavCompactMesh( void );
+
+	void Build( void );										///< build from the current navigation mesh
+	void Build( const NavMappedFile *file );				///< build from the records of the file the current navigation mesh was just loaded from
+	void Reset( void );										///< discard, invoked when the navigation mesh goes away
+	void Invalidate( void )							{ m_isStale = true; }	///< the navigation mesh has changed
+	void Update( void );									///< rebuild if the navigation mesh has changed since it was built
+
+	bool IsCurrent( void ) const					{ return (m_isBuilt && !m_isStale) ? true : false; }
+	unsigned int GetBuildCount( void ) const		{ return m_buildCount; }	///< changes each time we are built
+
+	/**
+	 * Return the number of areas that can be reached from 'area', and point 'adjacent' at them.
+	 * If the compact mesh is out of date, they are collected from the area into 'scratch'.
+	 */
+	int GetAdjacentAreas( const CNavArea *area, const NavAdjacentArea **adjacent, NavAdjacentAreaVector *scratch ) const
+	{
+		if (IsCurrent())
+		{
+			unsigned int id = area->GetID();
+			*adjacent = m_adjacent.data() + m_adjacentStart[ id ];
+			return m_adjacentStart[ id+1 ] - m_adjacentStart[ id ];
+		}
+
+		scratch->clear();
+		CollectAdjacentAreas( area, scratch );
+		*adjacent = scratch->data();
+		return scratch->size();
+	}
+
+	static void CollectAdjacentAreas( const CNavArea *area, NavAdjacentAreaVector *adjacent );	///< append the areas that can be reached from 'area', in the order searches expand them
+
+	CNavArea *GetNavArea( int cell, const Vector *pos, float beneathLimit ) const;	///< CNavAreaGrid::GetNavArea() for the given grid cell
+
+private:
+	static void CollectLadderAreas( const CNavArea *area, NavAdjacentAreaVector *adjacent );	///< append the areas that can be reached from 'area' by ladder
+
+	unsigned int BeginBuild( void );						///< start building, returning the highest area ID, or zero if there is no mesh
+	void FinishBuild( void );								///< copy the grid cells and start being used
+
+	bool m_isBuilt;
+	bool m_isStale;											///< if true, the areas have changed since we were built
+	unsigned int m_buildCount;
+
+	std::vector<CNavArea *> m_area;							///< areas by ID
+	std::vector<Extent> m_extent;							///< area extents by ID
+
+	std::vector<unsigned int> m_adjacentStart;				///< index of the first adjacent area of each area in m_adjacent, by ID, followed by the total count
+	NavAdjacentAreaVector m_adjacent;						///< the adjacent areas of all areas
+
+	std::vector<unsigned int> m_cellStart;					///< index of the first area of each grid cell in m_cellArea, followed by the total count
+	std::vector<unsigned int> m_cellArea;					///< the IDs of the areas overlapping each grid cell
+};
+
+extern CNavCompactMesh TheNavCompactMesh;
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The danger of every area for each team, allowing bots to avoid areas where they died in the past.
+ * Danger is kept in a dense array for each team, indexed by area ID, and decays linearly over time.
+ * All areas share one decay timestamp, and the decay is applied to all of them in one pass on a fixed
+ * interval - in between, values are decayed as they are read.
+ * Increasing the danger near a position walks a list of the areas around each area, collected when the
+ * area is first used this way, rather than searching the mesh each time.
+ */
+class CNavDangerField
+{
+public:
+	enum { MAX_TEAMS = 2 };
+
+	CNavDangerField( void );
+
+	float GetDanger( unsigned int id, int teamID ) const;					///< return the danger of the given area, decayed to now
+	void IncreaseDanger( unsigned int id, int teamID, float amount );		///< increase the danger of the given area
+	void IncreaseDangerNearby( int teamID, float amount, CNavArea *startArea, const Vector *pos, float maxRadius );
+	void ClearDanger( unsigned int id );									///< forget the danger of the given area, invoked when its ID is assigned
+
+	void Update( void );													///< apply the decay to all areas, if it is time
+	void Reset( void );														///< forget all danger, invoked when the navigation mesh goes away
+
+private:
+	/// the areas around an area, with the connections between them as indices into the same list
+	struct Neighborhood
+	{
+		struct Entry
+		{
+			CNavArea *area;
+			unsigned int firstAdjacent;
+			unsigned int adjacentCount;
+		};
+
+		std::vector<Entry> entry;											///< the first entry is the area itself
+		std::vector<unsigned short> adjacent;
+	};
+
+	const Neighborhood *GetNeighborhood( const CNavArea *area );
+	void Decay( void );
+
+	std::vector<float> m_danger[ MAX_TEAMS ];								///< danger as of m_timestamp, by area ID
+	float m_timestamp;														///< when the decay was last applied
+
+	std::vector<Neighborhood *> m_neighborhood;								///< by area ID, nullptr if not collected yet
+	unsigned int m_meshBuildCount;											///< the compact mesh the neighborhoods were collected from
+
+	std::vector<bool> m_isVisited;											///< scratch space for walking a neighborhood
+	std::vector<unsigned short> m_stack;
+};
+
+extern CNavDangerField TheNavDanger;
+
 //--------------------------------------------------------------------------------------------------------------
 //
 // Function prototypes
@@ -666,23 +865,69 @@ public:
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Find path from startArea to goalArea via an A* search, using supplied cost heuristic.
+ * The state of a path search after starting it or running some of it
+ */
+enum NavPathSearchStatus
+{
+	NAV_SEARCH_IN_PROGRESS,				///< the search has more areas to expand
+	NAV_SEARCH_FOUND,					///< a path to the goal area exists
+	NAV_SEARCH_FAILED,					///< the goal area cannot be reached
+};
+
+/**
+ * An A* search from startArea to goalArea, using supplied cost heuristic, which can be run
+ * a few areas at a time. All of the search state lives in the current NavSearchContext,
+ * so the same context must be current whenever the search is started or stepped.
  * If cost functor returns -1 for an area, that area is considered a dead end.
  * This doesn't actually build a path, but the path is defined by following parent
  * pointers back from goalArea to startArea.
- * If 'closestArea' is non-nullptr, the closest area to the goal is returned (useful if the path fails).
- * If 'goalArea' is nullptr, will compute a path as close as possible to 'goalPos'.
- * If 'goalPos' is nullptr, will use the center of 'goalArea' as the goal position.
- * Returns true if a path exists.
  */
 template< typename CostFunctor >
-bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CostFunctor &costFunc, CNavArea **closestArea = nullptr )
+class NavAreaPathSearch
 {
-	if (closestArea)
-		*closestArea = nullptr;
+public:
+	NavAreaPathSearch( CostFunctor &costFunc ) : m_costFunc( costFunc )
+	{
+		m_goalArea = nullptr;
+		m_closestArea = nullptr;
+		m_closestAreaDist = 0.0f;
+	}
+
+	/**
+	 * Begin a new search.
+	 * If 'goalArea' is nullptr, will compute a path as close as possible to 'goalPos'.
+	 * If 'goalPos' is nullptr, will use the center of 'goalArea' as the goal position.
+	 */
+	NavPathSearchStatus Start( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos );
+
+	/**
+	 * Expand up to 'maxIterations' areas, or until the search is done if 'maxIterations' is zero
+	 */
+	NavPathSearchStatus Step( int maxIterations );
+
+	/// return the area visited that is closest to the goal (useful if the path fails), or the goal area itself if it was reached
+	CNavArea *GetClosestArea( void ) const		{ return m_closestArea; }
+
+private:
+	CostFunctor &m_costFunc;
+	CNavArea *m_goalArea;
+	Vector m_actualGoalPos;									///< the position the remaining cost is estimated to
+
+	CNavArea *m_closestArea;								///< keep track of the area we visit that is closest to the goal
+	float m_closestAreaDist;
+
+	NavAdjacentAreaVector m_adjacentScratch;				///< adjacent areas of the current area, if the compact mesh is out of date
+};
+
+//--------------------------------------------------------------------------------------------------------------
+template< typename CostFunctor >
+NavPathSearchStatus NavAreaPathSearch< CostFunctor >::Start( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos )
+{
+	m_goalArea = goalArea;
+	m_closestArea = nullptr;
 
 	if (startArea == nullptr)
-		return false;
+		return NAV_SEARCH_FAILED;
 
 	//
 	// If goalArea is nullptr, this function will return the closest area to the goal.
@@ -690,7 +935,7 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 	// 
 	if (goalArea == nullptr && goalPos == nullptr)
 	{
-		return false;
+		return NAV_SEARCH_FAILED;
 	}
 
 	startArea->SetParent( nullptr );
@@ -699,164 +944,73 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 	if (startArea == goalArea)
 	{
 		goalArea->SetParent( nullptr );
-
-		if (closestArea)
-			*closestArea = goalArea;
-
-		return true;
+		m_closestArea = goalArea;
+		return NAV_SEARCH_FOUND;
 	}
 
 	// determine actual goal position
-	Vector actualGoalPos = (goalPos) ? *goalPos : *goalArea->GetCenter();
+	m_actualGoalPos = (goalPos) ? *goalPos : *goalArea->GetCenter();
 
 	// start search
 	CNavArea::ClearSearchLists();
 
 	// compute estimate of path length
 	/// @todo Cost might work as "manhattan distance"
-	startArea->SetTotalCost( (*startArea->GetCenter() - actualGoalPos).Length() );
+	startArea->SetTotalCost( (*startArea->GetCenter() - m_actualGoalPos).Length() );
 
-	float initCost = costFunc( startArea, nullptr, nullptr );	
+	float initCost = m_costFunc( startArea, nullptr, nullptr );	
 	if (initCost < 0.0f)
-		return false;
+		return NAV_SEARCH_FAILED;
 	startArea->SetCostSoFar( initCost );
 
 	startArea->AddToOpenList();
 
 	// keep track of the area we visit that is closest to the goal
-	if (closestArea)
-		*closestArea = startArea;
-	float closestAreaDist = startArea->GetTotalCost();
+	m_closestArea = startArea;
+	m_closestAreaDist = startArea->GetTotalCost();
+
+	return NAV_SEARCH_IN_PROGRESS;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+template< typename CostFunctor >
+NavPathSearchStatus NavAreaPathSearch< CostFunctor >::Step( int maxIterations )
+{
+	CNavArea *goalArea = m_goalArea;
+	int iterations = 0;
 
 	// do A* search
 	while( !CNavArea::IsOpenListEmpty() )
 	{
+		// give up our time slice, the search can be continued later
+		if (maxIterations > 0 && iterations++ == maxIterations)
+			return NAV_SEARCH_IN_PROGRESS;
+
 		// get next area to check
 		CNavArea *area = CNavArea::PopOpenList();
 
 		// check if we have found the goal area
 		if (area == goalArea)
 		{
-			if (closestArea)
-				*closestArea = goalArea;
-
-			return true;
+			m_closestArea = goalArea;
+			return NAV_SEARCH_FOUND;
 		}
 
-		// search adjacent areas
-		bool searchFloor = true;
-		int dir = NORTH;
-		const NavConnectList *floorList = area->GetAdjacentList( NORTH );
-		NavConnectList::const_iterator floorIter = floorList->begin();
+		// search adjacent areas - on the floor, then via ladders
+		const NavAdjacentArea *adjacent;
+		int adjacentCount = TheNavCompactMesh.GetAdjacentAreas( area, &adjacent, &m_adjacentScratch );
 
-		bool ladderUp = true;
-		const NavLadderList *ladderList = nullptr;
-		NavLadderList::const_iterator ladderIter;
-		enum { AHEAD = 0, LEFT, RIGHT, BEHIND, NUM_TOP_DIRECTIONS };
-		int ladderTopDir;
-
-		while(true)
+		for( int a=0; a<adjacentCount; ++a )
 		{
-			CNavArea *newArea;
-			NavTraverseType how;
-			const CNavLadder *ladder = nullptr;
-
-			//
-			// Get next adjacent area - either on floor or via ladder
-			//
-			if (searchFloor)
-			{
-				// if exhausted adjacent connections in current direction, begin checking next direction
-				if (floorIter == floorList->end())
-				{
-					++dir;
-
-					if (dir == NUM_DIRECTIONS)
-					{
-						// checked all directions on floor - check ladders next
-						searchFloor = false;
-
-						ladderList = area->GetLadderList( LADDER_UP );
-						ladderIter = ladderList->begin();
-						ladderTopDir = AHEAD;
-					}
-					else
-					{
-						// start next direction
-						floorList = area->GetAdjacentList( (NavDirType)dir );
-						floorIter = floorList->begin();
-					}
-
-					continue;
-				}
-
-				newArea = (*floorIter).area;
-				how = (NavTraverseType)dir;
-				++floorIter;
-			}
-			else	// search ladders
-			{
-				if (ladderIter == ladderList->end())
-				{
-					if (!ladderUp)
-					{
-						// checked both ladder directions - done
-						break;
-					}
-					else
-					{
-						// check down ladders
-						ladderUp = false;
-						ladderList = area->GetLadderList( LADDER_DOWN );
-						ladderIter = ladderList->begin();
-					}
-					continue;
-				}
-
-				if (ladderUp)
-				{
-					ladder = *ladderIter;
-
-					// cannot use this ladder if the ladder bottom is hanging above our head
-					if (ladder->m_isDangling)
-					{
-						++ladderIter;
-						continue;
-					}
-
-					// do not use BEHIND connection, as its very hard to get to when going up a ladder
-					if (ladderTopDir == AHEAD)
-						newArea = ladder->m_topForwardArea;
-					else if (ladderTopDir == LEFT)
-						newArea = ladder->m_topLeftArea;
-					else if (ladderTopDir == RIGHT)
-						newArea = ladder->m_topRightArea;
-					else
-					{
-						++ladderIter;
-						continue;
-					}
-
-					how = GO_LADDER_UP;
-					++ladderTopDir;
-				}
-				else
-				{
-					newArea = (*ladderIter)->m_bottomArea;
-					how = GO_LADDER_DOWN;
-					ladder = (*ladderIter);
-					++ladderIter;
-				}
-
-				if (newArea == nullptr)
-					continue;
-			}
+			CNavArea *newArea = adjacent[a].area;
+			NavTraverseType how = adjacent[a].how;
+			const CNavLadder *ladder = adjacent[a].ladder;
 
 			// don't backtrack
 			if (newArea == area)
 				continue;
 
-			float newCostSoFar = costFunc( newArea, area, ladder );
+			float newCostSoFar = m_costFunc( newArea, area, ladder );
 
 			// check if cost functor says this area is a dead-end
 			if (newCostSoFar < 0.0f)
@@ -870,13 +1024,13 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 			else
 			{
 				// compute estimate of distance left to go
-				float newCostRemaining = (*newArea->GetCenter() - actualGoalPos).Length();
+				float newCostRemaining = (*newArea->GetCenter() - m_actualGoalPos).Length();
 
 				// track closest area to goal in case path fails
-				if (closestArea && newCostRemaining < closestAreaDist)
+				if (newCostRemaining < m_closestAreaDist)
 				{
-					*closestArea = newArea;
-					closestAreaDist = newCostRemaining;
+					m_closestArea = newArea;
+					m_closestAreaDist = newCostRemaining;
 				}
 				
 				newArea->SetParent( area, how );
@@ -902,7 +1056,33 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 		area->AddToClosedList();
 	}
 
-	return false;
+	return NAV_SEARCH_FAILED;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Find path from startArea to goalArea via an A* search, using supplied cost heuristic.
+ * If cost functor returns -1 for an area, that area is considered a dead end.
+ * This doesn't actually build a path, but the path is defined by following parent
+ * pointers back from goalArea to startArea.
+ * If 'closestArea' is non-nullptr, the closest area to the goal is returned (useful if the path fails).
+ * If 'goalArea' is nullptr, will compute a path as close as possible to 'goalPos'.
+ * If 'goalPos' is nullptr, will use the center of 'goalArea' as the goal position.
+ * Returns true if a path exists.
+ */
+template< typename CostFunctor >
+bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CostFunctor &costFunc, CNavArea **closestArea = nullptr )
+{
+	NavAreaPathSearch< CostFunctor > search( costFunc );
+
+	NavPathSearchStatus status = search.Start( startArea, goalArea, goalPos );
+	if (status == NAV_SEARCH_IN_PROGRESS)
+		status = search.Step( 0 );
+
+	if (closestArea)
+		*closestArea = search.GetClosestArea();
+
+	return (status == NAV_SEARCH_FOUND) ? true : false;
 }
 
 
@@ -1033,11 +1213,13 @@ void SearchSurroundingAreas( CNavArea *startArea, const Vector *startPos, Functo
 	CNavArea::MakeNewMarker();
 	CNavArea::ClearSearchLists();
 
-	startArea->AddToOpenList();
+	NavAdjacentAreaVector adjacentScratch;
+
 	startArea->SetTotalCost( 0.0f );
 	startArea->SetCostSoFar( 0.0f );
 	startArea->SetParent( nullptr );
 	startArea->Mark();
+	startArea->AddToOpenList();
 
 	while( !CNavArea::IsOpenListEmpty() )
 	{
@@ -1047,54 +1229,12 @@ void SearchSurroundingAreas( CNavArea *startArea, const Vector *startPos, Functo
 		// invoke functor on area
 		if (func( area ))
 		{
-			// explore adjacent floor areas
-			for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
-			{
-				int count = area->GetAdjacentCount( (NavDirType)dir );
-				for( int i=0; i<count; ++i )
-				{
-					CNavArea *adjArea = area->GetAdjacentArea( (NavDirType)dir, i );
-					
-					AddAreaToOpenList( adjArea, area, startPos, maxRange );
-				}
-			}
-
+			// explore adjacent areas, on the floor and connected by ladders
+			const NavAdjacentArea *adjacent;
+			int adjacentCount = TheNavCompactMesh.GetAdjacentAreas( area, &adjacent, &adjacentScratch );
 
-			// explore adjacent areas connected by ladders
-			NavLadderList::const_iterator ladderIt;
-
-			// check up ladders
-			const NavLadderList *ladderList = area->GetLadderList( LADDER_UP );
-			if (ladderList)
-			{
-				for( ladderIt = ladderList->begin(); ladderIt != ladderList->end(); ++ladderIt )
-				{
-					const CNavLadder *ladder = *ladderIt;
-
-					// cannot use this ladder if the ladder bottom is hanging above our head
-					if (ladder->m_isDangling)
-					{
-						continue;
-					}
-
-					// do not use BEHIND connection, as its very hard to get to when going up a ladder
-					AddAreaToOpenList( ladder->m_topForwardArea, area, startPos, maxRange );
-					AddAreaToOpenList( ladder->m_topLeftArea, area, startPos, maxRange );
-					AddAreaToOpenList( ladder->m_topRightArea, area, startPos, maxRange );
-				}
-			}
-
-			// check down ladders
-			ladderList = area->GetLadderList( LADDER_DOWN );
-			if (ladderList)
-			{
-				for( ladderIt = ladderList->begin(); ladderIt != ladderList->end(); ++ladderIt )
-				{
-					const CNavLadder *ladder = *ladderIt;
-
-					AddAreaToOpenList( ladder->m_bottomArea, area, startPos, maxRange );
-				}
-			}
+			for( int a=0; a<adjacentCount; ++a )
+				AddAreaToOpenList( adjacent[a].area, area, startPos, maxRange );
 		}
 	}
 }
@@ -0,0 +1,767 @@
+// nav_bench.cpp
+// Navigation mesh benchmarks
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+
+#include "bot_util.h"
+#include "nav.h"
+#include "nav_area.h"
+#include "nav_bench.h"
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Simple deterministic random number generator, so benchmark runs are reproducible
+ * regardless of the engine's random state.
+ */
+class NavBenchRandom
+{
+public:
+	NavBenchRandom( unsigned int seed )			{ m_state = (seed) ? seed : 1; }
+
+	unsigned int Next( void )
+	{
+		// xorshift32
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 17;
+		m_state ^= m_state << 5;
+		return m_state;
+	}
+
+	int RandomInt( int count )					{ return Next() % count; }
+	float RandomFloat( float lo, float hi )		{ return lo + (hi - lo) * (Next() & 0xFFFF) / 65535.0f; }
+
+private:
+	unsigned int m_state;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Times a benchmark as a whole for throughput, and each of its queries on its own for latency percentiles
+ */
+class NavBenchTimer
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	NavBenchTimer( int queryCount )				{ m_latency.reserve( queryCount ); m_total = 0.0; }
+
+	void Begin( void )							{ m_begin = Clock::now(); }
+	void End( void )							{ m_total = Seconds( m_begin ); }
+
+	void StartQuery( void )						{ m_queryStart = Clock::now(); }
+	void StopQuery( void )						{ m_latency.push_back( Seconds( m_queryStart ) ); }
+
+	double GetTotal( void ) const				{ return m_total; }
+
+	/// output throughput and latency percentiles, in the same form for every benchmark
+	void Print( const char *label )
+	{
+		std::sort( m_latency.begin(), m_latency.end() );
+
+		const int count = m_latency.size();
+
+		CONSOLE_ECHO( "  %-17s %8.3f ms total, %10.0f queries/sec, p50 %8.2f us, p99 %8.2f us, max %8.2f us\n",
+						label,
+						1000.0 * m_total,
+						(m_total > 0.0) ? count / m_total : 0.0,
+						1000000.0 * GetPercentile( 0.5 ),
+						1000000.0 * GetPercentile( 0.99 ),
+						(count > 0) ? 1000000.0 * m_latency.back() : 0.0 );
+	}
+
+private:
+	static double Seconds( Clock::time_point since )	{ return std::chrono::duration< double >( Clock::now() - since ).count(); }
+
+	double GetPercentile( double fraction ) const
+	{
+		if (m_latency.empty())
+			return 0.0;
+
+		int index = (int)ceil( fraction * m_latency.size() ) - 1;
+		if (index < 0)
+			index = 0;
+
+		return m_latency[ index ];
+	}
+
+	std::vector<double> m_latency;
+	Clock::time_point m_begin;
+	Clock::time_point m_queryStart;
+	double m_total;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Gather the areas of the loaded mesh into an array we can pick from at random
+ */
+static void GetBenchAreas( std::vector<CNavArea *> *areas, unsigned int *idCount = nullptr )
+{
+	areas->clear();
+	areas->reserve( TheNavAreaList.size() );
+
+	unsigned int maxID = 0;
+	for( NavAreaList::iterator iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
+	{
+		areas->push_back( *iter );
+
+		if ((*iter)->GetID() >= maxID)
+			maxID = (*iter)->GetID()+1;
+	}
+
+	if (idCount)
+		*idCount = maxID;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The original open list: a doubly linked list kept sorted by total cost.
+ * Kept here as a reference to measure and validate the heap-based open list against.
+ * Links are stored in side arrays indexed by area ID.
+ */
+class LegacyOpenList
+{
+public:
+	void Reset( unsigned int idCount )
+	{
+		m_next.assign( idCount, nullptr );
+		m_prev.assign( idCount, nullptr );
+		m_isOpen.assign( idCount, false );
+		m_head = nullptr;
+	}
+
+	bool IsEmpty( void ) const					{ return (m_head) ? false : true; }
+	bool IsOpen( const CNavArea *area ) const	{ return m_isOpen[ area->GetID() ]; }
+
+	/// add to open list in ascending cost order
+	void Add( CNavArea *area )
+	{
+		unsigned int id = area->GetID();
+		m_isOpen[ id ] = true;
+
+		CNavArea *at, *last = nullptr;
+		for( at = m_head; at; at = m_next[ at->GetID() ] )
+		{
+			if (area->GetTotalCost() < at->GetTotalCost())
+				break;
+
+			last = at;
+		}
+
+		m_next[ id ] = at;
+		m_prev[ id ] = last;
+
+		if (last)
+			m_next[ last->GetID() ] = area;
+		else
+			m_head = area;
+
+		if (at)
+			m_prev[ at->GetID() ] = area;
+	}
+
+	/// a smaller value has been found - bubble this area up towards the head
+	void Update( CNavArea *area )
+	{
+		unsigned int id = area->GetID();
+
+		while( m_prev[ id ] && area->GetTotalCost() < m_prev[ id ]->GetTotalCost() )
+		{
+			CNavArea *other = m_prev[ id ];
+			CNavArea *before = m_prev[ other->GetID() ];
+			CNavArea *after = m_next[ id ];
+
+			m_next[ id ] = other;
+			m_prev[ id ] = before;
+
+			m_prev[ other->GetID() ] = area;
+			m_next[ other->GetID() ] = after;
+
+			if (before)
+				m_next[ before->GetID() ] = area;
+			else
+				m_head = area;
+
+			if (after)
+				m_prev[ after->GetID() ] = other;
+		}
+	}
+
+	CNavArea *Pop( void )
+	{
+		CNavArea *area = m_head;
+		unsigned int id = area->GetID();
+
+		m_head = m_next[ id ];
+		if (m_head)
+			m_prev[ m_head->GetID() ] = nullptr;
+
+		m_isOpen[ id ] = false;
+
+		return area;
+	}
+
+private:
+	std::vector<CNavArea *> m_next;
+	std::vector<CNavArea *> m_prev;
+	std::vector<bool> m_isOpen;
+	CNavArea *m_head;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * An area reachable from the area being expanded, and how to get there
+ */
+struct LegacyNeighbor
+{
+	CNavArea *area;
+	NavTraverseType how;
+	const CNavLadder *ladder;
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * NavAreaBuildPath() as it was with the sorted linked list open list.
+ * Floor connections and ladders are expanded in the same order, so the results must be identical.
+ */
+template< typename CostFunctor >
+bool LegacyNavAreaBuildPath( LegacyOpenList &openList, unsigned int idCount, CNavArea *startArea, CNavArea *goalArea, CostFunctor &costFunc )
+{
+	startArea->SetParent( nullptr );
+
+	if (startArea == goalArea)
+		return true;
+
+	Vector actualGoalPos = *goalArea->GetCenter();
+
+	CNavArea::MakeNewMarker();
+	openList.Reset( idCount );
+
+	startArea->SetTotalCost( (*startArea->GetCenter() - actualGoalPos).Length() );
+
+	float initCost = costFunc( startArea, nullptr, nullptr );
+	if (initCost < 0.0f)
+		return false;
+	startArea->SetCostSoFar( initCost );
+
+	openList.Add( startArea );
+
+	std::vector<LegacyNeighbor> adj;
+
+	while( !openList.IsEmpty() )
+	{
+		CNavArea *area = openList.Pop();
+
+		if (area == goalArea)
+			return true;
+
+		// gather neighbours in the same order NavAreaBuildPath() visits them
+		adj.clear();
+
+		for( int dir=0; dir<NUM_DIRECTIONS; ++dir )
+		{
+			const NavConnectList *list = area->GetAdjacentList( (NavDirType)dir );
+			for( NavConnectList::const_iterator iter = list->begin(); iter != list->end(); ++iter )
+			{
+				LegacyNeighbor n = { (*iter).area, (NavTraverseType)dir, nullptr };
+				adj.push_back( n );
+			}
+		}
+
+		// NOTE: the original NavAreaBuildPath() never reset the top direction between ladders, so
+		// only the first usable ladder's tops were expanded. That was a bug, fixed along with the
+		// compact mesh, so every usable ladder's tops are expanded here too.
+		const NavLadderList *ladderList = area->GetLadderList( LADDER_UP );
+		for( NavLadderList::const_iterator liter = ladderList->begin(); liter != ladderList->end(); ++liter )
+		{
+			const CNavLadder *ladder = *liter;
+			if (ladder->m_isDangling)
+				continue;
+
+			CNavArea *top[3] = { ladder->m_topForwardArea, ladder->m_topLeftArea, ladder->m_topRightArea };
+			for( int ladderTopDir = 0; ladderTopDir < 3; ++ladderTopDir )
+			{
+				if (top[ ladderTopDir ] == nullptr)
+					continue;
+
+				LegacyNeighbor n = { top[ ladderTopDir ], GO_LADDER_UP, ladder };
+				adj.push_back( n );
+			}
+		}
+
+		ladderList = area->GetLadderList( LADDER_DOWN );
+		for( NavLadderList::const_iterator liter = ladderList->begin(); liter != ladderList->end(); ++liter )
+		{
+			if ((*liter)->m_bottomArea == nullptr)
+				continue;
+
+			LegacyNeighbor n = { (*liter)->m_bottomArea, GO_LADDER_DOWN, *liter };
+			adj.push_back( n );
+		}
+
+		for( unsigned int i=0; i<adj.size(); ++i )
+		{
+			CNavArea *newArea = adj[i].area;
+
+			if (newArea == area)
+				continue;
+
+			float newCostSoFar = costFunc( newArea, area, adj[i].ladder );
+			if (newCostSoFar < 0.0f)
+				continue;
+
+			bool isOpen = openList.IsOpen( newArea );
+			bool isClosed = newArea->IsMarked() && !isOpen;
+
+			if ((isOpen || isClosed) && newArea->GetCostSoFar() <= newCostSoFar)
+				continue;
+
+			float newCostRemaining = (*newArea->GetCenter() - actualGoalPos).Length();
+
+			newArea->SetParent( area, adj[i].how );
+			newArea->SetCostSoFar( newCostSoFar );
+			newArea->SetTotalCost( newCostSoFar + newCostRemaining );
+
+			if (isOpen)
+				openList.Update( newArea );
+			else
+				openList.Add( newArea );
+		}
+
+		area->Mark();
+	}
+
+	return false;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Compute a hash of the path ending at the given area, by following parent links
+ */
+inline unsigned int HashNavPath( const CNavArea *goalArea )
+{
+	unsigned int hash = 2166136261u;
+
+	for( const CNavArea *area = goalArea; area; area = area->GetParent() )
+	{
+		hash ^= area->GetID();
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run random shortest-path queries with both open list implementations and report the results
+ */
+void BenchmarkNavAreaBuildPath( int queryCount, unsigned int seed )
+{
+	std::vector<CNavArea *> areas;
+	unsigned int idCount;
+	GetBenchAreas( &areas, &idCount );
+
+	if (areas.size() < 2 || queryCount <= 0)
+	{
+		CONSOLE_ECHO( "No navigation mesh to benchmark.\n" );
+		return;
+	}
+
+	// generate the query set up front so both implementations see the same queries
+	std::vector<CNavArea *> queries;
+	queries.reserve( 2*queryCount );
+
+	NavBenchRandom random( seed );
+	for( int q=0; q<queryCount; ++q )
+	{
+		queries.push_back( areas[ random.RandomInt( areas.size() ) ] );
+		queries.push_back( areas[ random.RandomInt( areas.size() ) ] );
+	}
+
+	std::vector<unsigned int> heapHashes( queryCount );
+	std::vector<unsigned int> listHashes( queryCount );
+	int found = 0;
+
+	ShortestPathCost cost;
+
+	NavBenchTimer heapTimer( queryCount );
+	heapTimer.Begin();
+	for( int q=0; q<queryCount; ++q )
+	{
+		CNavArea *goal = queries[ 2*q+1 ];
+
+		heapTimer.StartQuery();
+		bool isFound = NavAreaBuildPath( queries[ 2*q ], goal, nullptr, cost );
+		heapTimer.StopQuery();
+
+		if (isFound)
+		{
+			heapHashes[q] = HashNavPath( goal );
+			++found;
+		}
+		else
+		{
+			heapHashes[q] = 0;
+		}
+	}
+	heapTimer.End();
+
+	LegacyOpenList legacyList;
+
+	NavBenchTimer listTimer( queryCount );
+	listTimer.Begin();
+	for( int q=0; q<queryCount; ++q )
+	{
+		CNavArea *goal = queries[ 2*q+1 ];
+
+		listTimer.StartQuery();
+		bool isFound = LegacyNavAreaBuildPath( legacyList, idCount, queries[ 2*q ], goal, cost );
+		listTimer.StopQuery();
+
+		listHashes[q] = (isFound) ? HashNavPath( goal ) : 0;
+	}
+	listTimer.End();
+
+	int mismatches = 0;
+	for( int q=0; q<queryCount; ++q )
+		if (heapHashes[q] != listHashes[q])
+			++mismatches;
+
+	const double heapTime = heapTimer.GetTotal();
+	const double listTime = listTimer.GetTotal();
+
+	CONSOLE_ECHO( "NavAreaBuildPath benchmark: %d areas, %d queries (seed %u), %d paths found\n", areas.size(), queryCount, seed, found );
+	heapTimer.Print( "heap open list:" );
+	listTimer.Print( "sorted list:" );
+	CONSOLE_ECHO( "  speedup %.2fx, %d mismatched paths\n", (heapTime > 0.0) ? listTime / heapTime : 0.0, mismatches );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * CNavAreaGrid::GetNearestNavArea() as it was, checking every area in the map.
+ * Kept here as a reference to measure and validate the grid search against.
+ */
+CNavArea *LegacyGetNearestNavArea( const Vector *pos, bool anyZ )
+{
+	CNavArea *close = nullptr;
+	float closeDistSq = 99999999.9f;
+
+	// quick check
+	close = TheNavAreaGrid.GetNavArea( pos );
+	if (close)
+		return close;
+
+	// ensure source position is well behaved
+	Vector source;
+	source.x = pos->x;
+	source.y = pos->y;
+	if (GetGroundHeight( pos, &source.z ) == false)
+		return nullptr;
+
+	source.z += HalfHumanHeight;
+
+	// find closest nav area
+	for( NavAreaList::iterator iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
+	{
+		CNavArea *area = *iter;
+
+		Vector areaPos;
+		area->GetClosestPointOnArea( &source, &areaPos );
+
+		float distSq = (areaPos - source).LengthSquared();
+
+		// keep the closest area
+		if (distSq < closeDistSq)
+		{
+			// check LOS to area
+			if (!anyZ)
+			{
+				TraceResult result;
+				util::TraceLine( source, areaPos + Vector( 0, 0, HalfHumanHeight ), util::ignore_monsters, util::ignore_glass, nullptr, &result );
+				if (result.flFraction != 1.0f)
+					continue;
+			}
+					
+			closeDistSq = distSq;
+			close = area;
+		}
+	}
+
+	return close;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Look up the nearest area to random positions around the mesh with both implementations and report the results
+ */
+void BenchmarkGetNearestNavArea( int queryCount, unsigned int seed )
+{
+	std::vector<CNavArea *> areas;
+	GetBenchAreas( &areas );
+
+	if (areas.empty() || queryCount <= 0)
+	{
+		CONSOLE_ECHO( "No navigation mesh to benchmark.\n" );
+		return;
+	}
+
+	// generate positions near random areas, often off of the mesh, like a bot knocked off of it
+	std::vector<Vector> queries;
+	queries.reserve( queryCount );
+
+	NavBenchRandom random( seed );
+	int offMesh = 0;
+	for( int q=0; q<queryCount; ++q )
+	{
+		const CNavArea *area = areas[ random.RandomInt( areas.size() ) ];
+		const Extent *extent = area->GetExtent();
+
+		const float maxOffset = 300.0f;
+		Vector pos;
+		pos.x = random.RandomFloat( extent->lo.x, extent->hi.x ) + random.RandomFloat( -maxOffset, maxOffset );
+		pos.y = random.RandomFloat( extent->lo.y, extent->hi.y ) + random.RandomFloat( -maxOffset, maxOffset );
+		pos.z = area->GetCenter()->z + random.RandomFloat( 0.0f, 100.0f );
+
+		if (TheNavAreaGrid.GetNavArea( &pos ) == nullptr)
+			++offMesh;
+
+		queries.push_back( pos );
+	}
+
+	std::vector<CNavArea *> gridResults( queryCount );
+	std::vector<CNavArea *> listResults( queryCount );
+
+	NavBenchTimer gridTimer( queryCount );
+	gridTimer.Begin();
+	for( int q=0; q<queryCount; ++q )
+	{
+		gridTimer.StartQuery();
+		gridResults[q] = TheNavAreaGrid.GetNearestNavArea( &queries[q] );
+		gridTimer.StopQuery();
+	}
+	gridTimer.End();
+
+	NavBenchTimer listTimer( queryCount );
+	listTimer.Begin();
+	for( int q=0; q<queryCount; ++q )
+	{
+		listTimer.StartQuery();
+		listResults[q] = LegacyGetNearestNavArea( &queries[q], false );
+		listTimer.StopQuery();
+	}
+	listTimer.End();
+
+	int found = 0;
+	int mismatches = 0;
+	for( int q=0; q<queryCount; ++q )
+	{
+		if (gridResults[q])
+			++found;
+
+		if (gridResults[q] != listResults[q])
+			++mismatches;
+	}
+
+	const double gridTime = gridTimer.GetTotal();
+	const double listTime = listTimer.GetTotal();
+
+	CONSOLE_ECHO( "GetNearestNavArea benchmark: %d areas, %d queries (seed %u), %d off the mesh, %d areas found\n", areas.size(), queryCount, seed, offMesh, found );
+	gridTimer.Print( "grid ring search:" );
+	listTimer.Print( "linear scan:" );
+	CONSOLE_ECHO( "  speedup %.2fx, %d mismatched areas\n", (gridTime > 0.0) ? listTime / gridTime : 0.0, mismatches );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Look up the area directly beneath random positions over the mesh and report the results
+ */
+void BenchmarkGetNavArea( int queryCount, unsigned int seed )
+{
+	std::vector<CNavArea *> areas;
+	GetBenchAreas( &areas );
+
+	if (areas.empty() || queryCount <= 0)
+	{
+		CONSOLE_ECHO( "No navigation mesh to benchmark.\n" );
+		return;
+	}
+
+	// positions somewhere over random areas, at about the height a bot stands
+	std::vector<Vector> queries;
+	queries.reserve( queryCount );
+
+	NavBenchRandom random( seed );
+	for( int q=0; q<queryCount; ++q )
+	{
+		const CNavArea *area = areas[ random.RandomInt( areas.size() ) ];
+		const Extent *extent = area->GetExtent();
+
+		Vector pos;
+		pos.x = random.RandomFloat( extent->lo.x, extent->hi.x );
+		pos.y = random.RandomFloat( extent->lo.y, extent->hi.y );
+		pos.z = area->GetZ( pos.x, pos.y ) + HalfHumanHeight;
+
+		queries.push_back( pos );
+	}
+
+	int found = 0;
+
+	NavBenchTimer timer( queryCount );
+	timer.Begin();
+	for( int q=0; q<queryCount; ++q )
+	{
+		timer.StartQuery();
+		CNavArea *area = TheNavAreaGrid.GetNavArea( &queries[q] );
+		timer.StopQuery();
+
+		if (area)
+			++found;
+	}
+	timer.End();
+
+	CONSOLE_ECHO( "GetNavArea benchmark: %d areas, %d queries (seed %u), %d areas found\n", areas.size(), queryCount, seed, found );
+	timer.Print( "grid lookup:" );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Counts the areas a search reaches, and lets it go on to all of them
+ */
+class NavBenchFloodCounter
+{
+public:
+	NavBenchFloodCounter( void )				{ m_count = 0; }
+
+	bool operator() ( CNavArea *area )			{ ++m_count; return true; }
+
+	int m_count;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Search the areas within 'range' of random areas and report the results
+ */
+void BenchmarkSearchSurroundingAreas( int queryCount, unsigned int seed, float range )
+{
+	std::vector<CNavArea *> areas;
+	GetBenchAreas( &areas );
+
+	if (areas.empty() || queryCount <= 0)
+	{
+		CONSOLE_ECHO( "No navigation mesh to benchmark.\n" );
+		return;
+	}
+
+	std::vector<CNavArea *> queries;
+	queries.reserve( queryCount );
+
+	NavBenchRandom random( seed );
+	for( int q=0; q<queryCount; ++q )
+		queries.push_back( areas[ random.RandomInt( areas.size() ) ] );
+
+	long reached = 0;
+
+	NavBenchTimer timer( queryCount );
+	timer.Begin();
+	for( int q=0; q<queryCount; ++q )
+	{
+		NavBenchFloodCounter counter;
+
+		timer.StartQuery();
+		SearchSurroundingAreas( queries[q], queries[q]->GetCenter(), counter, range );
+		timer.StopQuery();
+
+		reached += counter.m_count;
+	}
+	timer.End();
+
+	CONSOLE_ECHO( "SearchSurroundingAreas benchmark: %d areas, %d searches of range %g (seed %u), %.1f areas reached per search\n",
+					areas.size(), queryCount, range, seed, (double)reached / queryCount );
+	timer.Print( "flood:" );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Measure the travel distance between random pairs of areas and report the results
+ */
+void BenchmarkNavAreaTravelDistance( int queryCount, unsigned int seed )
+{
+	std::vector<CNavArea *> areas;
+	GetBenchAreas( &areas );
+
+	if (areas.size() < 2 || queryCount <= 0)
+	{
+		CONSOLE_ECHO( "No navigation mesh to benchmark.\n" );
+		return;
+	}
+
+	std::vector<CNavArea *> queries;
+	queries.reserve( 2*queryCount );
+
+	NavBenchRandom random( seed );
+	for( int q=0; q<queryCount; ++q )
+	{
+		queries.push_back( areas[ random.RandomInt( areas.size() ) ] );
+		queries.push_back( areas[ random.RandomInt( areas.size() ) ] );
+	}
+
+	ShortestPathCost cost;
+	int found = 0;
+	double totalDistance = 0.0;
+
+	NavBenchTimer timer( queryCount );
+	timer.Begin();
+	for( int q=0; q<queryCount; ++q )
+	{
+		timer.StartQuery();
+		float distance = NavAreaTravelDistance( queries[ 2*q ], queries[ 2*q+1 ], cost );
+		timer.StopQuery();
+
+		if (distance >= 0.0f)
+		{
+			totalDistance += distance;
+			++found;
+		}
+	}
+	timer.End();
+
+	CONSOLE_ECHO( "NavAreaTravelDistance benchmark: %d areas, %d queries (seed %u), %d reachable, %.0f average distance\n",
+					areas.size(), queryCount, seed, found, (found > 0) ? totalDistance / found : 0.0 );
+	timer.Print( "travel distance:" );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run every benchmark, so a whole set of results can be compared before and after a change
+ */
+void BenchmarkNavAll( int queryCount, unsigned int seed )
+{
+	const float floodRange = 1000.0f;
+
+	BenchmarkNavAreaBuildPath( queryCount, seed );
+	BenchmarkNavAreaTravelDistance( queryCount, seed );
+	BenchmarkGetNavArea( queryCount, seed );
+	BenchmarkGetNearestNavArea( queryCount, seed );
+	BenchmarkSearchSurroundingAreas( queryCount, seed, floodRange );
+}
@@ -0,0 +1,42 @@
+// nav_bench.h
+// Navigation mesh benchmarks
+
+#ifndef _NAV_BENCH_H_
+#define _NAV_BENCH_H_
+
+/**
+ * Run 'queryCount' random shortest-path queries over the loaded navigation mesh,
+ * timing the open list heap against the original sorted linked list open list
+ * and verifying that both produce the same paths.
+ * The same 'seed' always produces the same queries for a given mesh.
+ */
+extern void BenchmarkNavAreaBuildPath( int queryCount, unsigned int seed );
+
+/**
+ * Look up the nearest area to 'queryCount' random positions around the loaded navigation mesh,
+ * many of them off of it, timing the grid search against the original scan of every area
+ * and verifying that both find the same areas.
+ */
+extern void BenchmarkGetNearestNavArea( int queryCount, unsigned int seed );
+
+/**
+ * Look up the area beneath 'queryCount' random positions over the loaded navigation mesh.
+ */
+extern void BenchmarkGetNavArea( int queryCount, unsigned int seed );
+
+/**
+ * Flood out from 'queryCount' random areas to every area within 'range' of them.
+ */
+extern void BenchmarkSearchSurroundingAreas( int queryCount, unsigned int seed, float range );
+
+/**
+ * Find the travel distance between 'queryCount' random pairs of areas.
+ */
+extern void BenchmarkNavAreaTravelDistance( int queryCount, unsigned int seed );
+
+/**
+ * Run every benchmark above with the same queries and seed, as a regression check.
+ */
+extern void BenchmarkNavAll( int queryCount, unsigned int seed );
+
+#endif // _NAV_BENCH_H_
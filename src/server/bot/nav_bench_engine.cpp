@@ -0,0 +1,315 @@
+// nav_bench_engine.cpp
+// Just enough of the engine to load a navigation mesh and search it outside of the game
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <string>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+
+#include "bot_util.h"
+#include "nav.h"
+#include "nav_area.h"
+#include "nav_bench_engine.h"
+
+
+//
+// The navigation code reads these, but nothing sets them outside of the game
+//
+cvar_t cv_bot_traceview					= {"cv_bot_traceview",				"0",			FCVAR_SERVER,	0.0f};
+cvar_t cv_bot_nav_zdraw					= {"cv_bot_nav_zdraw",				"4",			FCVAR_SERVER,	4.0f};
+cvar_t cv_bot_quicksave					= {"cv_bot_quicksave",				"0",			FCVAR_SERVER,	0.0f};
+
+
+static globalvars_t benchGlobals;
+static std::string benchStrings;						///< the string table, which holds only the map name
+static std::string benchMapDirectory;					///< where the .nav file being benchmarked is
+static bool benchUseTraces = true;
+static unsigned int benchRandomState = 1;
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Read a file into memory, if it is a .nav file in the directory of the one being benchmarked.
+ * Nothing else is served, so that a legacy .nav file is never checked against a .bsp and rewritten.
+ */
+static byte *BenchLoadFile( const char *filename, int *length )
+{
+	std::string name = filename;
+	for( size_t i = 0; i < name.size(); ++i )
+		if (name[i] == '\\')
+			name[i] = '/';
+
+	size_t slash = name.find_last_of( '/' );
+	if (slash != std::string::npos)
+		name = name.substr( slash + 1 );
+
+	if (name.size() < 4 || stricmp( name.c_str() + name.size() - 4, ".nav" ) != 0)
+		return nullptr;
+
+	std::string path = benchMapDirectory + name;
+
+	FILE *fp = fopen( path.c_str(), "rb" );
+	if (fp == nullptr)
+		return nullptr;
+
+	fseek( fp, 0, SEEK_END );
+	long size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+
+	byte *data = (size > 0) ? static_cast<byte *>( malloc( size ) ) : nullptr;
+	if (data && fread( data, 1, size, fp ) != (size_t)size)
+	{
+		free( data );
+		data = nullptr;
+	}
+
+	fclose( fp );
+
+	if (length)
+		*length = (data) ? size : 0;
+
+	return data;
+}
+
+static void BenchFreeFile( void *buffer )
+{
+	free( buffer );
+}
+
+static int BenchGetFileSize( const char *filename )
+{
+	int length;
+	byte *data = BenchLoadFile( filename, &length );
+	if (data == nullptr)
+		return -1;
+
+	free( data );
+	return length;
+}
+
+static void BenchAlertMessage( ALERT_TYPE atype, const char *format, ... )
+{
+	va_list args;
+	va_start( args, format );
+	vprintf( format, args );
+	va_end( args );
+}
+
+/// the same sequence every run, so benchmarks are reproducible
+static int32 BenchRandomLong( int32 low, int32 high )
+{
+	benchRandomState = benchRandomState * 1103515245u + 12345u;
+
+	if (high <= low)
+		return low;
+
+	return low + (int32)((benchRandomState >> 8) % (unsigned int)(high - low + 1));
+}
+
+static void BenchGetGameDir( char *gameDir )
+{
+	strcpy( gameDir, "." );
+}
+
+static void BenchAngleVectors( const float *angles, float *forward, float *right, float *up )
+{
+	const float pitch = angles[0] * M_PI / 180.0f;
+	const float yaw = angles[1] * M_PI / 180.0f;
+	const float roll = angles[2] * M_PI / 180.0f;
+
+	const float sp = sinf( pitch ), cp = cosf( pitch );
+	const float sy = sinf( yaw ), cy = cosf( yaw );
+	const float sr = sinf( roll ), cr = cosf( roll );
+
+	if (forward)
+	{
+		forward[0] = cp * cy;
+		forward[1] = cp * sy;
+		forward[2] = -sp;
+	}
+
+	if (right)
+	{
+		right[0] = -sr * sp * cy + cr * sy;
+		right[1] = -sr * sp * sy - cr * cy;
+		right[2] = -sr * cp;
+	}
+
+	if (up)
+	{
+		up[0] = cr * sp * cy + sr * sy;
+		up[1] = cr * sp * sy - sr * cy;
+		up[2] = cr * cp;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+bool NavBenchEngineInit( const char *navFilename, bool useTraces )
+{
+	std::string path = navFilename;
+	for( size_t i = 0; i < path.size(); ++i )
+		if (path[i] == '\\')
+			path[i] = '/';
+
+	size_t slash = path.find_last_of( '/' );
+	std::string name = (slash == std::string::npos) ? path : path.substr( slash + 1 );
+	benchMapDirectory = (slash == std::string::npos) ? std::string() : path.substr( 0, slash + 1 );
+
+	if (name.size() < 4 || stricmp( name.c_str() + name.size() - 4, ".nav" ) != 0)
+		return false;
+
+	// LoadNavigationMap() asks for "maps\<mapname>.nav"
+	benchStrings.assign( 1, '\0' );
+	benchStrings.append( name, 0, name.size() - 4 );
+
+	memset( &benchGlobals, 0, sizeof(benchGlobals) );
+	benchGlobals.pStringBase = benchStrings.c_str();
+	benchGlobals.mapname = 1;
+	benchGlobals.maxClients = 0;
+	gpGlobals = &benchGlobals;
+
+	engine::LoadFileForMe = BenchLoadFile;
+	engine::FreeFile = BenchFreeFile;
+	engine::GetFileSize = BenchGetFileSize;
+	engine::AlertMessage = BenchAlertMessage;
+	engine::RandomLong = BenchRandomLong;
+	engine::GetGameDir = BenchGetGameDir;
+	engine::AngleVectors = BenchAngleVectors;
+
+	benchUseTraces = useTraces;
+	benchRandomState = 1;
+
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the height of the lowest point of the mesh, which is where the floor is away from it
+ */
+static float GetBenchFloorZ( void )
+{
+	static size_t areaCount = 0;
+	static float floorZ = 0.0f;
+
+	if (areaCount != TheNavAreaList.size())
+	{
+		areaCount = TheNavAreaList.size();
+		floorZ = 9999999999.9f;
+
+		for( NavAreaList::iterator iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
+		{
+			const Extent *extent = (*iter)->GetExtent();
+
+			if (extent->lo.z < floorZ)
+				floorZ = extent->lo.z;
+		}
+	}
+
+	return floorZ;
+}
+
+/**
+ * The world is the navigation mesh: a trace straight down stops on the highest area beneath its start,
+ * or on a floor level with the lowest point of the mesh if there is none, and every other trace is clear
+ */
+static void BenchTraceLine( const Vector &start, const Vector &end, TraceResult *result )
+{
+	memset( result, 0, sizeof(TraceResult) );
+	result->flFraction = 1.0f;
+	result->vecEndPos = end;
+
+	if (!benchUseTraces || start.x != end.x || start.y != end.y || end.z >= start.z)
+		return;
+
+	const float length = start.z - end.z;
+
+	const CNavArea *area = TheNavAreaGrid.GetNavArea( &start, length );
+	const float z = (area) ? area->GetZ( &start ) : GetBenchFloorZ();
+
+	if (z > start.z || z < end.z)
+		return;
+
+	result->flFraction = (start.z - z) / length;
+	result->vecEndPos = Vector( start.x, start.y, z );
+	result->vecPlaneNormal = Vector( 0, 0, 1 );
+	result->flPlaneDist = z;
+}
+
+void util::TraceLine( const Vector &vecStart, const Vector &vecEnd, IGNORE_MONSTERS igmon, CBaseEntity *ignore, TraceResult *ptr )
+{
+	BenchTraceLine( vecStart, vecEnd, ptr );
+}
+
+void util::TraceLine( const Vector &vecStart, const Vector &vecEnd, IGNORE_MONSTERS igmon, IGNORE_GLASS ignoreGlass, CBaseEntity *ignore, TraceResult *ptr )
+{
+	BenchTraceLine( vecStart, vecEnd, ptr );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+//
+// There are no players or entities outside of the game
+//
+CBaseEntity *util::GetLocalPlayer()										{ return nullptr; }
+CBaseEntity *util::PlayerByIndex( int playerIndex )						{ return nullptr; }
+CBaseEntity *util::FindEntityByClassname( CBaseEntity *pStartEntity, const char *szName )	{ return nullptr; }
+
+void util::ClientPrintAll( int msg_dest, const char *msg_name, const char *param1, const char *param2, const char *param3, const char *param4 )
+{
+}
+
+void util::MakeVectors( const Vector &vecAngles )
+{
+	BenchAngleVectors( vecAngles, gpGlobals->v_forward, gpGlobals->v_right, gpGlobals->v_up );
+}
+
+void CBaseEntity::EmitSound( const char *sample, int channel, float volume, float attenuation, int pitch, int flags )
+{
+}
+
+void CBaseEntity::SetOrigin( const Vector &org )
+{
+	v.origin = org;
+}
+
+CBasePlayer *UTIL_GetClosestPlayer( const Vector *pos, float *distance, CBasePlayer *ignore )				{ return nullptr; }
+CBasePlayer *UTIL_GetClosestPlayer( const Vector *pos, int team, float *distance, CBasePlayer *ignore )	{ return nullptr; }
+
+void UTIL_DrawBeamPoints( Vector vecStart, Vector vecEnd, int iLifetime, byte bRed, byte bGreen, byte bBlue )
+{
+}
+
+void HintMessageToAllPlayers( const char *message )
+{
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+void CONSOLE_ECHO( char *pszMsg, ... )
+{
+	va_list args;
+	va_start( args, pszMsg );
+	vprintf( pszMsg, args );
+	va_end( args );
+}
+
+float BotCOS( float angle )
+{
+	return cosf( angle * M_PI / 180.0f );
+}
+
+float BotSIN( float angle )
+{
+	return sinf( angle * M_PI / 180.0f );
+}
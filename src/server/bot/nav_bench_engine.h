@@ -0,0 +1,16 @@
+// nav_bench_engine.h
+// Just enough of the engine to load a navigation mesh and search it outside of the game
+
+#ifndef _NAV_BENCH_ENGINE_H_
+#define _NAV_BENCH_ENGINE_H_
+
+/**
+ * Set up the stand-in engine so that LoadNavigationMap() reads the given .nav file from disk.
+ *
+ * There is no map, so the world is the navigation mesh itself: a trace straight down stops
+ * on the highest area beneath it, or on a floor level with the lowest point of the mesh,
+ * and every other trace is clear. If 'useTraces' is false, every trace is clear.
+ */
+extern bool NavBenchEngineInit( const char *navFilename, bool useTraces );
+
+#endif // _NAV_BENCH_ENGINE_H_
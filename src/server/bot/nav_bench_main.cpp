@@ -0,0 +1,88 @@
+// nav_bench_main.cpp
+// Run the navigation mesh benchmarks on a .nav file, outside of the game
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+
+#include "bot_util.h"
+#include "nav.h"
+#include "nav_area.h"
+#include "nav_bench.h"
+#include "nav_bench_engine.h"
+
+
+//--------------------------------------------------------------------------------------------------------------
+static void PrintUsage( void )
+{
+	printf( "usage: nav_bench [-notrace] <file.nav> [benchmark [queries [seed [range]]]]\n" );
+	printf( "  benchmark is one of: path, distance, lookup, nearest, flood, all (the default)\n" );
+	printf( "  queries defaults to 1000, seed to 1, and range, for flood, to 1000\n" );
+	printf( "  -notrace treats every trace as clear, instead of letting downward traces land on the mesh\n" );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+int main( int argc, char *argv[] )
+{
+	bool useTraces = true;
+
+	int arg = 1;
+	if (arg < argc && strcmp( argv[ arg ], "-notrace" ) == 0)
+	{
+		useTraces = false;
+		++arg;
+	}
+
+	if (arg >= argc)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const char *navFilename = argv[ arg++ ];
+	const char *benchmark = (arg < argc) ? argv[ arg++ ] : "all";
+	const int queryCount = (arg < argc) ? atoi( argv[ arg++ ] ) : 1000;
+	const unsigned int seed = (arg < argc) ? strtoul( argv[ arg++ ], nullptr, 10 ) : 1;
+	const float range = (arg < argc) ? atof( argv[ arg++ ] ) : 1000.0f;
+
+	if (!NavBenchEngineInit( navFilename, useTraces ))
+	{
+		printf( "'%s' is not a .nav file.\n", navFilename );
+		return 1;
+	}
+
+	NavErrorType error = LoadNavigationMap();
+	if (error != NAV_OK)
+	{
+		printf( "Navigation map '%s' could not be loaded (error %d).\n", navFilename, error );
+		return 1;
+	}
+
+	if (strcmp( benchmark, "path" ) == 0)
+		BenchmarkNavAreaBuildPath( queryCount, seed );
+	else if (strcmp( benchmark, "distance" ) == 0)
+		BenchmarkNavAreaTravelDistance( queryCount, seed );
+	else if (strcmp( benchmark, "lookup" ) == 0)
+		BenchmarkGetNavArea( queryCount, seed );
+	else if (strcmp( benchmark, "nearest" ) == 0)
+		BenchmarkGetNearestNavArea( queryCount, seed );
+	else if (strcmp( benchmark, "flood" ) == 0)
+		BenchmarkSearchSurroundingAreas( queryCount, seed, range );
+	else if (strcmp( benchmark, "all" ) == 0)
+		BenchmarkNavAll( queryCount, seed );
+	else
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	DestroyNavigationMap();
+
+	return 0;
+}
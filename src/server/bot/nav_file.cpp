@@ -18,8 +18,7 @@
 
 #else
 #include <unistd.h>
-#define _write write
-#define _close close
+#include <sys/mman.h>
 #endif
 
 #include "extdll.h"
@@ -27,6 +26,11 @@
 #include "cbase.h"
 #include "player.h"
 #include "gamerules.h"
+#include "filesystem_utils.h"
+
+#ifdef _WIN32
+#include "PlatformHeaders.h"
+#endif
 
 #include "bot_util.h"
 
@@ -41,6 +45,7 @@
 #include "nav.h"
 #include "nav_node.h"
 #include "nav_area.h"
+#include "nav_file.h"
 
 
 //
@@ -112,7 +117,7 @@ public:
 
 		int i = entry-1;
 
-		if (i > m_directory.size())
+		if (i >= m_directory.size())
 		{
 			assert( false && "PlaceDirectory::EntryToPlace: Invalid entry" );
 			return UNDEFINED_PLACE;
@@ -122,27 +127,21 @@ public:
 	}
 
 	/// store the directory
-	void Save( int fd )
+	void Save( NavFileContents *contents ) const
 	{
 #ifdef CSTRIKE
-		// store number of entries in directory
-		EntryType count = m_directory.size();
-		_write( fd, &count, sizeof(EntryType) );
-
-		// store entries		
-		std::vector<Place>::iterator it;
+		std::vector<Place>::const_iterator it;
 		for( it = m_directory.begin(); it != m_directory.end(); ++it )
 		{
 			const char *placeName = TheBotPhrases->IDToName( *it );
 
-			// store string length followed by string itself
-			unsigned short len = strlen(placeName)+1;
-			_write( fd, &len, sizeof(unsigned short) );
-			_write( fd, placeName, len );
+			// store offset of name followed by name itself
+			NavFilePlace entry;
+			entry.name = contents->placeNames.size();
+			contents->places.push_back( entry );
+
+			contents->placeNames.insert( contents->placeNames.end(), placeName, placeName + strlen(placeName)+1 );
 		}
-#else
-		EntryType count = 0;
-		_write( fd, &count, sizeof(EntryType) );
 #endif
 	}
 
@@ -168,6 +167,21 @@ public:
 		}
 	}
 
+	/// load the directory from a current version file
+	void Load( const NavMappedFile *file )
+	{
+#ifdef CSTRIKE
+		const NavFilePlace *places = file->GetRecords<NavFilePlace>( NAV_FILE_PLACES );
+		const char *placeNames = file->GetRecords<char>( NAV_FILE_PLACE_NAMES );
+
+		unsigned int count = file->GetCount( NAV_FILE_PLACES );
+		m_directory.reserve( count );
+
+		for( unsigned int i=0; i<count; ++i )
+			AddPlace( TheBotPhrases->NameToID( placeNames + places[i].name ) );
+#endif
+	}
+
 private:
 	std::vector<Place> m_directory;
 };
@@ -196,6 +210,350 @@ char *GetBspFilename( const char *navFilename )
 	return bspFilename;
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the modification time of a bsp file, or zero if it is not known
+ */
+inline unsigned int GetBspTime( const char *bspFilename )
+{
+	return (unsigned int)FileSystem_GetFileTime( bspFilename );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if the bsp file has the size and modification time a nav file was made for.
+ * If either time is not known, only the size is compared.
+ */
+static bool IsBspCurrent( const char *bspFilename, unsigned int saveBspSize, unsigned int saveBspTime )
+{
+	if ((unsigned int)engine::GetFileSize( bspFilename ) != saveBspSize)
+		return false;
+
+	unsigned int bspTime = GetBspTime( bspFilename );
+	if (bspTime && saveBspTime && bspTime != saveBspTime)
+		return false;
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Tell everyone that the nav file was made for a different version of the map
+ */
+static void WarnOutOfDateNavigationMap( void )
+{
+	char *msg = "*** WARNING ***\nThe AI navigation data is from a different version of this map.\nThe CPU players will likely not perform well.\n";
+	HintMessageToAllPlayers( msg );
+	CONSOLE_ECHO( "\n-----------------\n" );
+	CONSOLE_ECHO( msg );
+	CONSOLE_ECHO( "-----------------\n\n" );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+static_assert( sizeof(NavFileHeader) == 84, "nav file header layout has changed" );
+static_assert( sizeof(NavFileArea) == 72, "nav file area layout has changed" );
+static_assert( sizeof(NavFileHidingSpot) == 20, "nav file hiding spot layout has changed" );
+static_assert( sizeof(NavFileApproach) == 16, "nav file approach layout has changed" );
+static_assert( sizeof(NavFileEncounter) == 16, "nav file encounter layout has changed" );
+
+/**
+ * The size of one record of each section of a nav file
+ */
+static const unsigned int navFileRecordSize[ NUM_NAV_FILE_SECTIONS ] =
+{
+	sizeof(NavFilePlace),
+	sizeof(char),
+	sizeof(NavFileArea),
+	sizeof(unsigned int),
+	sizeof(NavFileHidingSpot),
+	sizeof(NavFileApproach),
+	sizeof(NavFileEncounter),
+	sizeof(NavFileEncounterSpot),
+};
+
+/**
+ * Return true if 'count' records starting at 'first' lie within a section of 'sectionCount' records
+ */
+inline bool IsInNavFileSection( unsigned int first, unsigned int count, unsigned int sectionCount )
+{
+	return (first <= sectionCount && count <= sectionCount - first) ? true : false;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Map the nav file into memory. Files that are not on disk, such as those in pak files,
+ * are read into memory by the engine instead.
+ */
+NavMappedFile::NavMappedFile( const char *filename )
+{
+	m_data = nullptr;
+	m_size = 0;
+	m_isMapped = false;
+
+#ifdef _WIN32
+	m_mapping = nullptr;
+#endif
+
+	std::string name = filename;
+	FileSystem_FixSlashes( name );
+
+	char path[ PATH_MAX ];
+	if (g_pFileSystem && g_pFileSystem->GetLocalPath( name.c_str(), path, sizeof(path) ))
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			DWORD size = ::GetFileSize( file, nullptr );
+			if (size != INVALID_FILE_SIZE && size > 0)
+			{
+				HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+				if (mapping)
+				{
+					m_data = static_cast<byte *>( MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) );
+					if (m_data)
+					{
+						m_size = size;
+						m_mapping = mapping;
+						m_isMapped = true;
+					}
+					else
+					{
+						CloseHandle( mapping );
+					}
+				}
+			}
+
+			// the mapping keeps the file open
+			CloseHandle( file );
+		}
+#else
+		int fd = open( path, O_RDONLY );
+		if (fd >= 0)
+		{
+			struct stat info;
+			if (fstat( fd, &info ) == 0 && info.st_size > 0)
+			{
+				void *data = mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+				if (data != MAP_FAILED)
+				{
+					m_data = static_cast<byte *>( data );
+					m_size = info.st_size;
+					m_isMapped = true;
+				}
+			}
+
+			// the mapping keeps the file open
+			close( fd );
+		}
+#endif
+	}
+
+	if (m_data == nullptr)
+	{
+		int length;
+		m_data = engine::LoadFileForMe( const_cast<char *>( filename ), &length );
+		m_size = (m_data) ? length : 0;
+	}
+}
+
+NavMappedFile::~NavMappedFile()
+{
+	Close();
+}
+
+/**
+ * Release the file
+ */
+void NavMappedFile::Close( void )
+{
+	if (m_data == nullptr)
+		return;
+
+	if (m_isMapped)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile( m_data );
+		CloseHandle( m_mapping );
+		m_mapping = nullptr;
+#else
+		munmap( m_data, m_size );
+#endif
+	}
+	else
+	{
+		engine::FreeFile( m_data );
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+	m_isMapped = false;
+}
+
+/**
+ * Return the version of the file, or zero if it is not a nav file.
+ * Every version of nav file starts with the magic number followed by the version.
+ */
+unsigned int NavMappedFile::GetVersion( void ) const
+{
+	if (m_size < 2*sizeof(unsigned int))
+		return 0;
+
+	const unsigned int *start = reinterpret_cast<const unsigned int *>( m_data );
+	if (start[0] != NAV_MAGIC_NUMBER)
+		return 0;
+
+	return start[1];
+}
+
+/**
+ * Make sure a current version file is complete, and that its records refer only to records it contains,
+ * so they can be used without checking each one as it is read
+ */
+NavErrorType NavMappedFile::Validate( void ) const
+{
+	if (m_size < sizeof(NavFileHeader) || GetVersion() == 0)
+		return NAV_INVALID_FILE;
+
+	const NavFileHeader *header = GetHeader();
+
+	if (header->version != NAV_FILE_VERSION)
+		return NAV_BAD_FILE_VERSION;
+
+	if (header->size > m_size)
+		return NAV_CORRUPT_DATA;
+
+	// every section must be aligned, and lie within the file
+	for( int s=0; s<NUM_NAV_FILE_SECTIONS; ++s )
+	{
+		const NavFileSection *section = &header->section[s];
+
+		if (section->offset % NAV_FILE_ALIGNMENT || section->offset < sizeof(NavFileHeader) || section->offset > header->size)
+			return NAV_CORRUPT_DATA;
+
+		if (section->count > (header->size - section->offset) / navFileRecordSize[s])
+			return NAV_CORRUPT_DATA;
+	}
+
+	// every place name must be terminated within its section
+	unsigned int placeNameCount = GetCount( NAV_FILE_PLACE_NAMES );
+	if (placeNameCount && GetRecords<char>( NAV_FILE_PLACE_NAMES )[ placeNameCount-1 ] != '\0')
+		return NAV_CORRUPT_DATA;
+
+	const NavFilePlace *places = GetRecords<NavFilePlace>( NAV_FILE_PLACES );
+	for( unsigned int p=0; p<GetCount( NAV_FILE_PLACES ); ++p )
+		if (places[p].name >= placeNameCount)
+			return NAV_CORRUPT_DATA;
+
+	// every area must refer only to records that exist
+	const NavFileArea *areas = GetRecords<NavFileArea>( NAV_FILE_AREAS );
+	for( unsigned int a=0; a<GetCount( NAV_FILE_AREAS ); ++a )
+	{
+		const NavFileArea *area = &areas[a];
+
+		unsigned int connectionCount = 0;
+		for( int d=0; d<NUM_DIRECTIONS; ++d )
+			connectionCount += area->connectionCount[d];
+
+		if (!IsInNavFileSection( area->firstConnection, connectionCount, GetCount( NAV_FILE_CONNECTIONS ) ) ||
+			!IsInNavFileSection( area->firstHidingSpot, area->hidingSpotCount, GetCount( NAV_FILE_HIDING_SPOTS ) ) ||
+			!IsInNavFileSection( area->firstApproach, area->approachCount, GetCount( NAV_FILE_APPROACHES ) ) ||
+			!IsInNavFileSection( area->firstEncounter, area->encounterCount, GetCount( NAV_FILE_ENCOUNTERS ) ) ||
+			area->place > GetCount( NAV_FILE_PLACES ))
+		{
+			return NAV_CORRUPT_DATA;
+		}
+	}
+
+	const NavFileEncounter *encounters = GetRecords<NavFileEncounter>( NAV_FILE_ENCOUNTERS );
+	for( unsigned int e=0; e<GetCount( NAV_FILE_ENCOUNTERS ); ++e )
+		if (!IsInNavFileSection( encounters[e].firstSpot, encounters[e].spotCount, GetCount( NAV_FILE_ENCOUNTER_SPOTS ) ))
+			return NAV_CORRUPT_DATA;
+
+	return NAV_OK;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Write the given records to a current version nav file, laid out as described in nav_file.h
+ */
+static bool WriteNavFile( const char *filename, const NavFileContents *contents, unsigned int bspSize, unsigned int bspTime )
+{
+	NavFileHeader header;
+	memset( &header, 0, sizeof(NavFileHeader) );
+
+	header.magic = NAV_MAGIC_NUMBER;
+	header.version = NAV_FILE_VERSION;
+	header.bspSize = bspSize;
+	header.bspTime = bspTime;
+
+	const void *data[ NUM_NAV_FILE_SECTIONS ];
+
+	data[ NAV_FILE_PLACES ] = contents->places.data();
+	header.section[ NAV_FILE_PLACES ].count = contents->places.size();
+
+	data[ NAV_FILE_PLACE_NAMES ] = contents->placeNames.data();
+	header.section[ NAV_FILE_PLACE_NAMES ].count = contents->placeNames.size();
+
+	data[ NAV_FILE_AREAS ] = contents->areas.data();
+	header.section[ NAV_FILE_AREAS ].count = contents->areas.size();
+
+	data[ NAV_FILE_CONNECTIONS ] = contents->connections.data();
+	header.section[ NAV_FILE_CONNECTIONS ].count = contents->connections.size();
+
+	data[ NAV_FILE_HIDING_SPOTS ] = contents->hidingSpots.data();
+	header.section[ NAV_FILE_HIDING_SPOTS ].count = contents->hidingSpots.size();
+
+	data[ NAV_FILE_APPROACHES ] = contents->approaches.data();
+	header.section[ NAV_FILE_APPROACHES ].count = contents->approaches.size();
+
+	data[ NAV_FILE_ENCOUNTERS ] = contents->encounters.data();
+	header.section[ NAV_FILE_ENCOUNTERS ].count = contents->encounters.size();
+
+	data[ NAV_FILE_ENCOUNTER_SPOTS ] = contents->encounterSpots.data();
+	header.section[ NAV_FILE_ENCOUNTER_SPOTS ].count = contents->encounterSpots.size();
+
+	// lay out the sections one after another
+	unsigned int offset = sizeof(NavFileHeader);
+	for( int s=0; s<NUM_NAV_FILE_SECTIONS; ++s )
+	{
+		offset = (offset + NAV_FILE_ALIGNMENT-1) & ~(NAV_FILE_ALIGNMENT-1);
+
+		header.section[s].offset = offset;
+		offset += header.section[s].count * navFileRecordSize[s];
+	}
+	header.size = offset;
+
+	std::string name = filename;
+	FileSystem_FixSlashes( name );
+
+	FSFile file( name.c_str(), "wb", "GAMECONFIG" );
+	if (!file)
+		return false;
+
+	if (file.Write( &header, sizeof(NavFileHeader) ) != sizeof(NavFileHeader))
+		return false;
+
+	static const char padding[ NAV_FILE_ALIGNMENT ] = { 0 };
+	unsigned int written = sizeof(NavFileHeader);
+
+	for( int s=0; s<NUM_NAV_FILE_SECTIONS; ++s )
+	{
+		int padSize = header.section[s].offset - written;
+		if (padSize && file.Write( padding, padSize ) != padSize)
+			return false;
+
+		int size = header.section[s].count * navFileRecordSize[s];
+		if (size && file.Write( data[s], size ) != size)
+			return false;
+
+		written = header.section[s].offset + size;
+	}
+
+	return true;
+}
+
 //--------------------------------------------------------------------------------------------------------------
 void CNavArea::Save( FILE *fp ) const
 {
@@ -216,169 +574,135 @@ void CNavArea::Save( FILE *fp ) const
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Save a navigation area to the opened binary stream
+ * Store a count in a record field, returning false if it does not fit
+ */
+template < typename T >
+inline bool SetNavFileCount( T *field, size_t count )
+{
+	*field = (T)count;
+	return (*field == count) ? true : false;
+}
+
+/**
+ * Add the records of a navigation area to those being saved.
+ * Return false if the area has more of something than a record can count.
  */
-void CNavArea::Save( int fd, unsigned int version )
+bool CNavArea::Save( NavFileContents *contents ) const
 {
-	// save ID
-	_write( fd, &m_id, sizeof(unsigned int) );
+	NavFileArea data;
+	memset( &data, 0, sizeof(NavFileArea) );
 
-	// save attribute flags
-	_write( fd, &m_attributeFlags, sizeof(unsigned char) );
+	data.id = m_id;
+	data.attributes = m_attributeFlags;
 
 	// save extent of area
-	_write( fd, &m_extent, 6*sizeof(float) );
+	data.lo[0] = m_extent.lo.x;
+	data.lo[1] = m_extent.lo.y;
+	data.lo[2] = m_extent.lo.z;
+	data.hi[0] = m_extent.hi.x;
+	data.hi[1] = m_extent.hi.y;
+	data.hi[2] = m_extent.hi.z;
 
 	// save heights of implicit corners
-	_write( fd, &m_neZ, sizeof(float) );
-	_write( fd, &m_swZ, sizeof(float) );
+	data.neZ = m_neZ;
+	data.swZ = m_swZ;
 
 	// save connections to adjacent areas
 	// in the enum order NORTH, EAST, SOUTH, WEST
+	data.firstConnection = contents->connections.size();
 	for( int d=0; d<NUM_DIRECTIONS; d++ )
 	{
-		// save number of connections for this direction
-		unsigned int count = m_connect[d].size();
-		_write( fd, &count, sizeof(unsigned int) );
+		if (!SetNavFileCount( &data.connectionCount[d], m_connect[d].size() ))
+		{
+			CONSOLE_ECHO( "ERROR: Navigation Area #%d has too many connections to save.\n", m_id );
+			return false;
+		}
 
 		NavConnectList::const_iterator iter;
 		for( iter = m_connect[d].begin(); iter != m_connect[d].end(); ++iter )
-		{
-			NavConnect connect = *iter;
-			_write( fd, &connect.area->m_id, sizeof(unsigned int) );
-		}
+			contents->connections.push_back( (*iter).area->m_id );
 	}
 
 	//
 	// Store hiding spots for this area
 	//
-	unsigned char count;
-	if (m_hidingSpotList.size() > 255)
-	{
-		count = 255;
-		CONSOLE_ECHO( "Warning: NavArea #%d: Truncated hiding spot list to 255\n", m_id );
-	}
-	else
+	data.firstHidingSpot = contents->hidingSpots.size();
+	if (!SetNavFileCount( &data.hidingSpotCount, m_hidingSpotList.size() ))
 	{
-		count = m_hidingSpotList.size();
+		CONSOLE_ECHO( "ERROR: Navigation Area #%d has too many hiding spots to save.\n", m_id );
+		return false;
 	}
-	_write( fd, &count, sizeof(unsigned char) );
 
-	// store HidingSpot objects
-	unsigned int saveCount = 0;
-	for( HidingSpotList::iterator iter = m_hidingSpotList.begin(); iter != m_hidingSpotList.end(); ++iter )
+	for( HidingSpotList::const_iterator iter = m_hidingSpotList.begin(); iter != m_hidingSpotList.end(); ++iter )
 	{
-		HidingSpot *spot = *iter;
-		
-		spot->Save( fd, version );
-
-		// overflow check
-		if (++saveCount == count)
-			break;
+		NavFileHidingSpot spot;
+		(*iter)->Save( &spot );
+		contents->hidingSpots.push_back( spot );
 	}
 
 	//
 	// Save the approach areas for this area
 	//
-
-	// save number of approach areas
-	_write( fd, &m_approachCount, sizeof(unsigned char) );
-	if (cv_bot_debug.value > 0.0f)
-		CONSOLE_ECHO( "  m_approachCount = %d\n", m_approachCount );
-
-	// save approach area info
-	unsigned char type;
-	unsigned int zero = 0;
+	data.firstApproach = contents->approaches.size();
+	data.approachCount = m_approachCount;
 	for( int a=0; a<m_approachCount; ++a )
 	{
-		if (m_approach[a].here.area)
-			_write( fd, &m_approach[a].here.area->m_id, sizeof(unsigned int) );
-		else
-			_write( fd, &zero, sizeof(unsigned int) );
+		NavFileApproach approach;
+		memset( &approach, 0, sizeof(NavFileApproach) );
 
-		if (m_approach[a].prev.area)
-			_write( fd, &m_approach[a].prev.area->m_id, sizeof(unsigned int) );
-		else
-			_write( fd, &zero, sizeof(unsigned int) );
-		type = (unsigned char)m_approach[a].prevToHereHow;
-		_write( fd, &type, sizeof(unsigned char) );
+		approach.here = (m_approach[a].here.area) ? m_approach[a].here.area->m_id : 0;
+		approach.prev = (m_approach[a].prev.area) ? m_approach[a].prev.area->m_id : 0;
+		approach.prevToHereHow = (unsigned char)m_approach[a].prevToHereHow;
+		approach.next = (m_approach[a].next.area) ? m_approach[a].next.area->m_id : 0;
+		approach.hereToNextHow = (unsigned char)m_approach[a].hereToNextHow;
 
-		if (m_approach[a].next.area)
-			_write( fd, &m_approach[a].next.area->m_id, sizeof(unsigned int) );
-		else
-			_write( fd, &zero, sizeof(unsigned int) );
-		type = (unsigned char)m_approach[a].hereToNextHow;
-		_write( fd, &type, sizeof(unsigned char) );
+		contents->approaches.push_back( approach );
 	}
 
 	//
 	// Save encounter spots for this area
 	//
+	data.firstEncounter = contents->encounters.size();
+	data.encounterCount = m_spotEncounterList.size();
+	for( SpotEncounterList::const_iterator iter = m_spotEncounterList.begin(); iter != m_spotEncounterList.end(); ++iter )
 	{
-		// save number of encounter paths for this area
-		unsigned int count = m_spotEncounterList.size();
-		_write( fd, &count, sizeof(unsigned int) );
+		const SpotEncounter *e = &(*iter);
 
-		if (cv_bot_debug.value > 0.0f)
-			CONSOLE_ECHO( "  m_spotEncounterList.size() = %d\n", count );
+		NavFileEncounter encounter;
+		encounter.from = (e->from.area) ? e->from.area->m_id : 0;
+		encounter.fromDir = e->fromDir;
+		encounter.to = (e->to.area) ? e->to.area->m_id : 0;
+		encounter.toDir = e->toDir;
 
-		SpotEncounter *e;
-		for( SpotEncounterList::iterator iter = m_spotEncounterList.begin(); iter != m_spotEncounterList.end(); ++iter )
+		// save list of spots along this path
+		encounter.firstSpot = contents->encounterSpots.size();
+		if (!SetNavFileCount( &encounter.spotCount, e->spotList.size() ))
 		{
-			e = &(*iter);
-
-			if (e->from.area)
-				_write( fd, &e->from.area->m_id, sizeof(unsigned int) );
-			else
-				_write( fd, &zero, sizeof(unsigned int) );
-
-			unsigned char dir = e->fromDir;
-			_write( fd, &dir, sizeof(unsigned char) );
-
-			if (e->to.area)
-				_write( fd, &e->to.area->m_id, sizeof(unsigned int) );
-			else
-				_write( fd, &zero, sizeof(unsigned int) );
-
-			dir = e->toDir;
-			_write( fd, &dir, sizeof(unsigned char) );
-
-			// write list of spots along this path
-			unsigned char spotCount;
-			if (e->spotList.size() > 255)
-			{
-				spotCount = 255;
-				CONSOLE_ECHO( "Warning: NavArea #%d: Truncated encounter spot list to 255\n", m_id );
-			}
-			else
-			{
-				spotCount = e->spotList.size();
-			}
-			_write( fd, &spotCount, sizeof(unsigned char) );
-		
-			saveCount = 0;
-			for( SpotOrderList::iterator oiter = e->spotList.begin(); oiter != e->spotList.end(); ++oiter )
-			{
-				SpotOrder *order = &(*oiter);
+			CONSOLE_ECHO( "ERROR: Navigation Area #%d has too many spots along an encounter path to save.\n", m_id );
+			return false;
+		}
 
-				// order->spot may be nullptr if we've loaded a nav mesh that has been edited but not re-analyzed
-				unsigned int id = (order->spot) ? order->spot->GetID() : 0;
-				_write( fd, &id, sizeof(unsigned int) );
+		for( SpotOrderList::const_iterator oiter = e->spotList.begin(); oiter != e->spotList.end(); ++oiter )
+		{
+			const SpotOrder *order = &(*oiter);
 
-				unsigned char t = 255 * order->t;
-				_write( fd, &t, sizeof(unsigned char) );
+			// order->spot may be nullptr if we've loaded a nav mesh that has been edited but not re-analyzed
+			NavFileEncounterSpot spot;
+			spot.id = (order->spot) ? order->spot->GetID() : 0;
+			spot.t = order->t;
 
-				// overflow check
-				if (++saveCount == spotCount)
-					break;
-			}
+			contents->encounterSpots.push_back( spot );
 		}
+
+		contents->encounters.push_back( encounter );
 	}
 
 	// store place dictionary entry
-	PlaceDirectory::EntryType entry = placeDirectory.GetEntry( GetPlace() );
-	_write( fd, &entry, sizeof(entry) );
+	data.place = placeDirectory.GetEntry( GetPlace() );
+
+	contents->areas.push_back( data );
 
+	return true;
 }
 
 //--------------------------------------------------------------------------------------------------------------
@@ -394,6 +718,8 @@ void CNavArea::Load( SteamFile *file, unsigned int version )
 	if (m_id >= m_nextID)
 		m_nextID = m_id+1;
 
+	ReserveSearchNode( m_id );
+
 	// load attribute flags
 	file->Read( &m_attributeFlags, sizeof(unsigned char) );
 
@@ -563,6 +889,97 @@ void CNavArea::Load( SteamFile *file, unsigned int version )
 	SetPlace( placeDirectory.EntryToPlace( entry ) );
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Load a navigation area from its record in a current version file
+ */
+void CNavArea::Load( const NavMappedFile *file, const NavFileArea *data )
+{
+	m_id = data->id;
+
+	// update nextID to avoid collisions
+	if (m_id >= m_nextID)
+		m_nextID = m_id+1;
+
+	ReserveSearchNode( m_id );
+
+	m_attributeFlags = data->attributes;
+
+	m_extent.lo = Vector( data->lo[0], data->lo[1], data->lo[2] );
+	m_extent.hi = Vector( data->hi[0], data->hi[1], data->hi[2] );
+
+	m_center.x = (m_extent.lo.x + m_extent.hi.x)/2.0f;
+	m_center.y = (m_extent.lo.y + m_extent.hi.y)/2.0f;
+	m_center.z = (m_extent.lo.z + m_extent.hi.z)/2.0f;
+
+	m_neZ = data->neZ;
+	m_swZ = data->swZ;
+
+	// load connections (IDs) to adjacent areas
+	// in the enum order NORTH, EAST, SOUTH, WEST
+	const unsigned int *connection = file->GetRecords<unsigned int>( NAV_FILE_CONNECTIONS ) + data->firstConnection;
+	for( int d=0; d<NUM_DIRECTIONS; d++ )
+	{
+		for( int i=0; i<data->connectionCount[d]; ++i )
+		{
+			NavConnect connect;
+			connect.id = *connection++;
+
+			m_connect[d].push_back( connect );
+		}
+	}
+
+	// load HidingSpot objects for this area
+	const NavFileHidingSpot *spot = file->GetRecords<NavFileHidingSpot>( NAV_FILE_HIDING_SPOTS ) + data->firstHidingSpot;
+	for( int h=0; h<data->hidingSpotCount; ++h )
+	{
+		// create new hiding spot and put on master list
+		HidingSpot *hidingSpot = new HidingSpot;
+
+		hidingSpot->Load( &spot[h] );
+
+		m_hidingSpotList.push_back( hidingSpot );
+	}
+
+	// load approach area info (IDs)
+	const NavFileApproach *approach = file->GetRecords<NavFileApproach>( NAV_FILE_APPROACHES ) + data->firstApproach;
+	m_approachCount = (data->approachCount < MAX_APPROACH_AREAS) ? data->approachCount : MAX_APPROACH_AREAS;
+	for( int a=0; a<m_approachCount; ++a )
+	{
+		m_approach[a].here.id = approach[a].here;
+		m_approach[a].prev.id = approach[a].prev;
+		m_approach[a].prevToHereHow = (NavTraverseType)approach[a].prevToHereHow;
+		m_approach[a].next.id = approach[a].next;
+		m_approach[a].hereToNextHow = (NavTraverseType)approach[a].hereToNextHow;
+	}
+
+	// load encounter paths for this area
+	const NavFileEncounter *encounter = file->GetRecords<NavFileEncounter>( NAV_FILE_ENCOUNTERS ) + data->firstEncounter;
+	const NavFileEncounterSpot *encounterSpots = file->GetRecords<NavFileEncounterSpot>( NAV_FILE_ENCOUNTER_SPOTS );
+	for( unsigned int e=0; e<data->encounterCount; ++e )
+	{
+		m_spotEncounterList.push_back( SpotEncounter() );
+		SpotEncounter *spotEncounter = &m_spotEncounterList.back();
+
+		spotEncounter->from.id = encounter[e].from;
+		spotEncounter->fromDir = static_cast<NavDirType>( encounter[e].fromDir );
+		spotEncounter->to.id = encounter[e].to;
+		spotEncounter->toDir = static_cast<NavDirType>( encounter[e].toDir );
+
+		SpotOrder order;
+		for( int s=0; s<encounter[e].spotCount; ++s )
+		{
+			order.id = encounterSpots[ encounter[e].firstSpot + s ].id;
+			order.t = encounterSpots[ encounter[e].firstSpot + s ].t;
+
+			spotEncounter->spotList.push_back( order );
+		}
+	}
+
+	// convert entry to actual Place
+	SetPlace( placeDirectory.EntryToPlace( data->place ) );
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Convert loaded IDs to pointers
@@ -679,71 +1096,15 @@ NavErrorType CNavArea::PostLoad( void )
 
 
 //--------------------------------------------------------------------------------------------------------------
-/*
-============
-COM_FixSlashes
-
-Changes all '/' characters into '\' characters, in place.
-============
-*/
-inline void COM_FixSlashes( char *pname )
-{
-#ifdef _WIN32
-	while ( *pname ) 
-	{
-		if ( *pname == '/' )
-			*pname = '\\';
-		pname++;
-	}
-#else
-	while ( *pname ) 
-	{
-		if ( *pname == '\\' )
-			*pname = '/';
-		pname++;
-	}
-#endif
-}
-
 /**
- * Store AI navigation data to a file
+ * Store AI navigation data to a file, named relative to the game directory
  */
 bool SaveNavigationMap( const char *filename )
 {
 	if (filename == nullptr)
 		return false;
 
-	//
-	// Store the NAV file
-	//
-	COM_FixSlashes( const_cast<char *>(filename) );
-
-#ifdef WIN32
-	int fd = _open( filename, _O_BINARY | _O_CREAT | _O_WRONLY, _S_IREAD | _S_IWRITE );
-#else
-#define _write write
-	int fd = creat( filename, S_IRUSR | S_IWUSR | S_IRGRP );
-#endif
-
-	if (fd < 0)
-		return false;
-
-	// store "magic number" to help identify this kind of file
-	unsigned int magic = NAV_MAGIC_NUMBER;
-	_write( fd, &magic, sizeof(unsigned int) );
-
-	// store version number of file
-	// 1 = hiding spots as plain vector array
-	// 2 = hiding spots as HidingSpot objects
-	// 3 = Encounter spots use HidingSpot ID's instead of storing vector again
-	// 4 = Includes size of source bsp file to verify nav data correlation
-	// ---- Beta Release at V4 -----
-	// 5 = Added Place info
-	unsigned int version = 5;
-	_write( fd, &version, sizeof(unsigned int) );
-
-
-	// get size of source bsp file and store it in the nav file
+	// get size and modification time of source bsp file and store them in the nav file
 	// so we can test if the bsp changed since the nav file was made
 	char *bspFilename = GetBspFilename( filename );
 	if (bspFilename == nullptr)
@@ -752,7 +1113,7 @@ bool SaveNavigationMap( const char *filename )
 	unsigned int bspSize = (unsigned int)engine::GetFileSize( bspFilename );
 	CONSOLE_ECHO( "Size of bsp file '%s' is %u bytes.\n", bspFilename, bspSize );
 
-	_write( fd, &bspSize, sizeof(unsigned int) );
+	unsigned int bspTime = GetBspTime( bspFilename );
 
 
 	//
@@ -773,26 +1134,23 @@ bool SaveNavigationMap( const char *filename )
 		}
 	}
 
-	placeDirectory.Save( fd );
+	NavFileContents contents;
+	placeDirectory.Save( &contents );
 
 
 	//
 	// Store navigation areas
 	//
-
-	// store number of areas
-	unsigned int count = TheNavAreaList.size();
-	_write( fd, &count, sizeof(unsigned int) );
-
-	// store each area
 	for( it = TheNavAreaList.begin(); it != TheNavAreaList.end(); ++it )
 	{
 		CNavArea *area = *it;
 
-		area->Save( fd, version );
+		if (!area->Save( &contents ))
+			return false;
 	}
 
-	_close( fd );
+	if (!WriteNavFile( filename, &contents, bspSize, bspTime ))
+		return false;
 
 
 #ifdef _WIN32
@@ -920,7 +1278,7 @@ void SanityCheckNavigationMap( const char *mapName )
 	// read file version number
 	unsigned int version;
 	result = navFile.Read( &version, sizeof(unsigned int) );
-	if (!result || version > 5)
+	if (!result || version > NAV_FILE_VERSION)
 	{
 		CONSOLE_ECHO( "ERROR: Unknown version in navigation file %s.\n", navFilename );
 		return;
@@ -948,30 +1306,74 @@ void SanityCheckNavigationMap( const char *mapName )
 			return;
 		}
 	}
+
+	if (version >= 6)
+	{
+		// the bsp may have changed without changing size
+		unsigned int saveBspTime;
+		navFile.Read( &saveBspTime, sizeof(unsigned int) );
+
+		unsigned int bspTime = GetBspTime( bspFilename );
+		if (bspTime && saveBspTime && bspTime != saveBspTime)
+		{
+			CONSOLE_ECHO( "ERROR: Out-of-date navigation data in navigation file %s.\n", navFilename );
+			return;
+		}
+	}
 	CONSOLE_ECHO( "navigation file %s passes the sanity check.\n", navFilename );
 }
 
 //--------------------------------------------------------------------------------------------------------------
 /**
- * Load AI navigation data from a file
+ * Create the navigation areas stored in a current version file, reading their records in place
  */
-NavErrorType LoadNavigationMap( void )
+static NavErrorType LoadMappedNavigationAreas( const NavMappedFile *file, const char *filename )
 {
-	// since the navigation map is destroyed on map change,
-	// if it exists it has already been loaded for this map
-	if (!TheNavAreaList.empty())
-		return NAV_OK;
+	NavErrorType error = file->Validate();
+	if (error != NAV_OK)
+	{
+		CONSOLE_ECHO( "ERROR: Corrupt navigation file '%s'.\n", filename );
+		return error;
+	}
 
-	// nav filename is derived from map filename
-	char filename[256];
-	sprintf( filename, "maps\\%s.nav", STRING( gpGlobals->mapname ) );
+	// verify that the bsp hasn't changed
+	char *bspFilename = GetBspFilename( filename );
+	if (bspFilename == nullptr)
+		return NAV_INVALID_FILE;
 
+	const NavFileHeader *header = file->GetHeader();
 
-	// free previous navigation map data
-	DestroyNavigationMap();
-	placeDirectory.Reset();
+	if (!IsBspCurrent( bspFilename, header->bspSize, header->bspTime ))
+	{
+		// this nav file is out of date for this bsp file
+		WarnOutOfDateNavigationMap();
+	}
 
-	CNavArea::m_nextID = 1;
+	// load Place directory
+	placeDirectory.Load( file );
+
+	// load the areas
+	const NavFileArea *areas = file->GetRecords<NavFileArea>( NAV_FILE_AREAS );
+	unsigned int count = file->GetCount( NAV_FILE_AREAS );
+
+	for( unsigned int i=0; i<count; ++i )
+	{
+		CNavArea *area = new CNavArea;
+		area->Load( file, &areas[i] );
+		TheNavAreaList.push_back( area );
+	}
+
+	return NAV_OK;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Create the navigation areas stored in an earlier version file, reading them a field at a time.
+ * 'isBspCurrent' is set if the file is known to have been made for the current bsp file.
+ */
+static NavErrorType LoadLegacyNavigationAreas( const char *filename, unsigned int *version, bool *isBspCurrent )
+{
+	*isBspCurrent = false;
 
 	SteamFile navFile( filename );
 
@@ -989,15 +1391,14 @@ NavErrorType LoadNavigationMap( void )
 	}
 
 	// read file version number
-	unsigned int version;
-	result = navFile.Read( &version, sizeof(unsigned int) );
-	if (!result || version > 5)
+	result = navFile.Read( version, sizeof(unsigned int) );
+	if (!result || *version > 5)
 	{
 		CONSOLE_ECHO( "ERROR: Unknown navigation file version.\n" );
 		return NAV_BAD_FILE_VERSION;
 	}
 
-	if (version >= 4)
+	if (*version >= 4)
 	{
 		// get size of source bsp file and verify that the bsp hasn't changed
 		unsigned int saveBspSize;
@@ -1013,16 +1414,16 @@ NavErrorType LoadNavigationMap( void )
 		if (bspSize != saveBspSize)
 		{
 			// this nav file is out of date for this bsp file
-			char *msg = "*** WARNING ***\nThe AI navigation data is from a different version of this map.\nThe CPU players will likely not perform well.\n";
-			HintMessageToAllPlayers( msg );
-			CONSOLE_ECHO( "\n-----------------\n" );
-			CONSOLE_ECHO( msg );
-			CONSOLE_ECHO( "-----------------\n\n" );
+			WarnOutOfDateNavigationMap();
+		}
+		else
+		{
+			*isBspCurrent = true;
 		}
 	}
 
 	// load Place directory
-	if (version >= 5)
+	if (*version >= 5)
 	{
 		placeDirectory.Load( &navFile );
 	}
@@ -1031,18 +1432,76 @@ NavErrorType LoadNavigationMap( void )
 	unsigned int count;
 	result = navFile.Read( &count, sizeof(unsigned int) );
 
+	// load the areas
+	for( unsigned int i=0; i<count; ++i )
+	{
+		CNavArea *area = new CNavArea;
+		area->Load( &navFile, *version );
+		TheNavAreaList.push_back( area );
+	}
+
+	return NAV_OK;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Load AI navigation data from a file.
+ * Files in an earlier format are converted to the current one once they are loaded.
+ */
+NavErrorType LoadNavigationMap( void )
+{
+	// since the navigation map is destroyed on map change,
+	// if it exists it has already been loaded for this map
+	if (!TheNavAreaList.empty())
+		return NAV_OK;
+
+	// nav filename is derived from map filename
+	char filename[256];
+	sprintf( filename, "maps\\%s.nav", STRING( gpGlobals->mapname ) );
+
+
+	// free previous navigation map data
+	DestroyNavigationMap();
+	placeDirectory.Reset();
+
+	CNavArea::m_nextID = 1;
+
+	NavMappedFile mappedFile( filename );
+
+	if (!mappedFile.IsValid())
+		return NAV_CANT_ACCESS_FILE;
+
+	NavErrorType error;
+	unsigned int version = mappedFile.GetVersion();
+	bool isBspCurrent = false;
+
+	if (version == NAV_FILE_VERSION)
+	{
+		error = LoadMappedNavigationAreas( &mappedFile, filename );
+	}
+	else
+	{
+		mappedFile.Close();
+		error = LoadLegacyNavigationAreas( filename, &version, &isBspCurrent );
+	}
+
+	if (error != NAV_OK)
+	{
+		DestroyNavigationMap();
+		return error;
+	}
+
 	Extent extent;
 	extent.lo.x = 9999999999.9f;
 	extent.lo.y = 9999999999.9f;
 	extent.hi.x = -9999999999.9f;
 	extent.hi.y = -9999999999.9f;
 
-	// load the areas and compute total extent
-	for( unsigned int i=0; i<count; ++i )
+	// compute total extent
+	NavAreaList::iterator iter;
+	for( iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
 	{
-		CNavArea *area = new CNavArea;
-		area->Load( &navFile, version );
-		TheNavAreaList.push_back( area );
+		CNavArea *area = *iter;
 
 		const Extent *areaExtent = area->GetExtent();
 
@@ -1064,7 +1523,6 @@ NavErrorType LoadNavigationMap( void )
 	// add the areas to the grid
 	TheNavAreaGrid.Initialize( extent.lo.x, extent.hi.x, extent.lo.y, extent.hi.y );
 
-	NavAreaList::iterator iter;
 	for( iter = TheNavAreaList.begin(); iter != TheNavAreaList.end(); ++iter )
 		TheNavAreaGrid.AddNavArea( *iter );
 
@@ -1089,5 +1547,21 @@ NavErrorType LoadNavigationMap( void )
 	//
 	BuildLadders();
 
+	// lay out the mesh for fast searching, from the records in place if we have them
+	if (version == NAV_FILE_VERSION)
+		TheNavCompactMesh.Build( &mappedFile );
+	else
+		TheNavCompactMesh.Build();
+
+	// store earlier versions in the current format, so that from now on they can be used in place -
+	// unless we don't know that the file matches the bsp, since that would hide that it is out of date
+	if (version < NAV_FILE_VERSION && isBspCurrent)
+	{
+		if (SaveNavigationMap( filename ))
+			CONSOLE_ECHO( "Converted navigation file '%s' to version %d.\n", filename, NAV_FILE_VERSION );
+		else
+			CONSOLE_ECHO( "WARNING: Unable to convert navigation file '%s' to version %d.\n", filename, NAV_FILE_VERSION );
+	}
+
 	return NAV_OK;
 }
@@ -0,0 +1,177 @@
+// nav_file.h
+// Layout of nav files, and access to them in memory
+
+#ifndef _NAV_FILE_H_
+#define _NAV_FILE_H_
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <vector>
+
+#include "nav.h"
+
+//--------------------------------------------------------------------------------------------------------------
+//
+// Version 6 nav files are a single block of data that is used where it lies.
+// A header is followed by sections of fixed size records, each starting on a NAV_FILE_ALIGNMENT
+// boundary and located by its offset from the start of the file, so the file can be mapped
+// into memory and its records read in place instead of being parsed a field at a time.
+// Records refer to each other by index into their sections, or to areas and hiding spots by ID.
+//
+// Earlier versions are a stream of variable length fields, and are converted when loaded.
+//
+
+// 1 = hiding spots as plain vector array
+// 2 = hiding spots as HidingSpot objects
+// 3 = Encounter spots use HidingSpot ID's instead of storing vector again
+// 4 = Includes size of source bsp file to verify nav data correlation
+// ---- Beta Release at V4 -----
+// 5 = Added Place info
+// 6 = Sections of fixed size records that are used in place, and the modification time of the source bsp file
+#define NAV_FILE_VERSION 6							///< the version of nav files we write
+#define NAV_FILE_ALIGNMENT 16						///< sections start on multiples of this many bytes
+
+enum NavFileSectionType
+{
+	NAV_FILE_PLACES,								///< NavFilePlace records, the place directory
+	NAV_FILE_PLACE_NAMES,							///< nul-terminated place names, one byte each
+	NAV_FILE_AREAS,									///< NavFileArea records
+	NAV_FILE_CONNECTIONS,							///< IDs of adjacent areas, one unsigned int each
+	NAV_FILE_HIDING_SPOTS,							///< NavFileHidingSpot records
+	NAV_FILE_APPROACHES,							///< NavFileApproach records
+	NAV_FILE_ENCOUNTERS,							///< NavFileEncounter records
+	NAV_FILE_ENCOUNTER_SPOTS,						///< NavFileEncounterSpot records
+
+	NUM_NAV_FILE_SECTIONS
+};
+
+struct NavFileSection
+{
+	unsigned int offset;							///< from the start of the file
+	unsigned int count;								///< number of records
+};
+
+struct NavFileHeader
+{
+	unsigned int magic;								///< NAV_MAGIC_NUMBER
+	unsigned int version;							///< NAV_FILE_VERSION
+	unsigned int bspSize;							///< size of the bsp file the mesh was made for, where earlier versions keep it
+	unsigned int bspTime;							///< modification time of the bsp file the mesh was made for, zero if unknown
+	unsigned int size;								///< size of the whole file
+	NavFileSection section[ NUM_NAV_FILE_SECTIONS ];
+};
+
+struct NavFilePlace
+{
+	unsigned int name;								///< offset of the name in the NAV_FILE_PLACE_NAMES section
+};
+
+struct NavFileArea
+{
+	unsigned int id;
+	float lo[3];									///< extent of the area, as in Extent
+	float hi[3];
+	float neZ;										///< heights of the implicit corners
+	float swZ;
+
+	unsigned int firstConnection;					///< connections in the enum order NORTH, EAST, SOUTH, WEST
+	unsigned int firstHidingSpot;
+	unsigned int firstApproach;
+	unsigned int firstEncounter;
+	unsigned int encounterCount;
+	unsigned short connectionCount[ NUM_DIRECTIONS ];
+	unsigned short hidingSpotCount;
+	unsigned short place;							///< place directory entry, zero if none
+	unsigned char approachCount;
+	unsigned char attributes;						///< NavAttributeType flags
+	unsigned char pad[2];
+};
+
+struct NavFileHidingSpot
+{
+	unsigned int id;
+	float pos[3];
+	unsigned char flags;
+	unsigned char pad[3];
+};
+
+struct NavFileApproach
+{
+	unsigned int here;								///< area IDs, zero if none
+	unsigned int prev;
+	unsigned int next;
+	unsigned char prevToHereHow;					///< NavTraverseType
+	unsigned char hereToNextHow;
+	unsigned char pad[2];
+};
+
+struct NavFileEncounter
+{
+	unsigned int from;								///< area IDs
+	unsigned int to;
+	unsigned int firstSpot;
+	unsigned short spotCount;
+	unsigned char fromDir;							///< NavDirType
+	unsigned char toDir;
+};
+
+struct NavFileEncounterSpot
+{
+	unsigned int id;								///< hiding spot ID, zero if the spot is gone
+	float t;										///< parametric distance along the encounter path
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The records of a nav file, collected while saving
+ */
+struct NavFileContents
+{
+	std::vector<NavFilePlace> places;
+	std::vector<char> placeNames;
+	std::vector<NavFileArea> areas;
+	std::vector<unsigned int> connections;
+	std::vector<NavFileHidingSpot> hidingSpots;
+	std::vector<NavFileApproach> approaches;
+	std::vector<NavFileEncounter> encounters;
+	std::vector<NavFileEncounterSpot> encounterSpots;
+};
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * A nav file in memory, mapped straight from disk if possible, or loaded by the engine if not
+ */
+class NavMappedFile
+{
+public:
+	NavMappedFile( const char *filename );
+	~NavMappedFile();
+
+	bool IsValid( void ) const						{ return (m_data) ? true : false; }	///< returns true if the file could be accessed
+	void Close( void );								///< release the file
+
+	unsigned int GetVersion( void ) const;			///< return the version of the file, or zero if it is not a nav file
+	NavErrorType Validate( void ) const;			///< make sure a current version file is complete and refers only to records it contains
+
+	const NavFileHeader *GetHeader( void ) const	{ return reinterpret_cast<const NavFileHeader *>( m_data ); }
+
+	unsigned int GetCount( NavFileSectionType section ) const	{ return GetHeader()->section[ section ].count; }
+
+	/// return the records of the given section - only valid once the file has been validated
+	template < typename T >
+	const T *GetRecords( NavFileSectionType section ) const
+	{
+		return reinterpret_cast<const T *>( m_data + GetHeader()->section[ section ].offset );
+	}
+
+private:
+	byte *m_data;
+	unsigned int m_size;
+	bool m_isMapped;								///< if true, m_data is mapped from disk, otherwise it was loaded by the engine
+
+#ifdef _WIN32
+	void *m_mapping;								///< handle of the file mapping object
+#endif
+};
+
+#endif // _NAV_FILE_H_
@@ -299,6 +299,72 @@ bool CNavPath::FindClosestPointOnPath( const Vector *worldPos, int startIndex, i
 	return true;
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Build path by following parent links back from 'effectiveGoalArea', after a search towards 'goal'.
+ * 'goalArea' is the area containing the goal, if any.
+ */
+bool CNavPath::BuildFromSearch( const Vector *start, const Vector *goal, CNavArea *goalArea, CNavArea *effectiveGoalArea )
+{
+	Invalidate();
+
+	// make sure path end position is on the ground
+	Vector pathEndPosition = *goal;
+	if (goalArea)
+		pathEndPosition.z = goalArea->GetZ( &pathEndPosition );
+	else
+		GetGroundHeight( &pathEndPosition, &pathEndPosition.z );
+
+	//
+	// Build path by following parent links
+	//
+
+	// get count
+	int count = 0;
+	CNavArea *area;
+	for( area = effectiveGoalArea; area; area = area->GetParent() )
+		++count;
+
+	// save room for endpoint
+	if (count > MAX_PATH_SEGMENTS-1)
+		count = MAX_PATH_SEGMENTS-1;
+
+	if (count == 0)
+		return false;
+
+	if (count == 1)
+	{
+		BuildTrivialPath( start, goal );
+		return true;
+	}
+
+	// build path
+	m_segmentCount = count;
+	for( area = effectiveGoalArea; count && area; area = area->GetParent() )
+	{
+		--count;
+		m_path[ count ].area = area;
+		m_path[ count ].how = area->GetParentHow();
+	}
+
+	// compute path positions
+	if (ComputePathPositions() == false)
+	{
+		//PrintIfWatched( "Error building path\n" );
+		Invalidate();
+		return false;
+	}
+
+	// append path end position
+	m_path[ m_segmentCount ].area = effectiveGoalArea;
+	m_path[ m_segmentCount ].pos = pathEndPosition;
+	m_path[ m_segmentCount ].ladder = nullptr;
+	m_path[ m_segmentCount ].how = NUM_TRAVERSE_TYPES;
+	++m_segmentCount;
+
+	return true;
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Build trivial path when start and goal are in the same nav area
@@ -1092,6 +1158,150 @@ void CNavPathFollower::FeelerReflexAdjustment( Vector *goalPosition, float heigh
 
 }
 
+//--------------------------------------------------------------------------------------------------------------
+CNavPathCache TheNavPathCache;
+
+//--------------------------------------------------------------------------------------------------------------
+CNavPathCache::CNavPathCache( void )
+{
+	m_meshGeneration = 0;
+	m_dangerGeneration = 0;
+
+	ResetStats();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Build 'path' from the cached path from 'startArea' to 'goalArea' that was found with the given cost,
+ * ending at 'goal'. Return false if there is no such path, or it is out of date.
+ */
+bool CNavPathCache::Find( CNavArea *startArea, CNavArea *goalArea, const Vector *goal, unsigned int costID, bool usesDanger, CNavPath *path )
+{
+	Key key;
+	key.startID = startArea->GetID();
+	key.goalID = goalArea->GetID();
+	key.costID = costID;
+
+	std::unordered_map< Key, EntryList::iterator, KeyHash >::iterator iter = m_entryMap.find( key );
+	if (iter == m_entryMap.end())
+	{
+		++m_missCount;
+		return false;
+	}
+
+	EntryList::iterator entry = iter->second;
+
+	if (entry->meshGeneration != m_meshGeneration || (usesDanger && entry->dangerGeneration != m_dangerGeneration))
+	{
+		// the areas on this path may be gone, or the costs along it have changed
+		m_entryMap.erase( iter );
+		m_entryList.erase( entry );
+
+		++m_staleCount;
+		++m_missCount;
+		return false;
+	}
+
+	// move to the front of the list, as the most recently used
+	m_entryList.splice( m_entryList.begin(), m_entryList, entry );
+
+	++m_hitCount;
+
+	int count = entry->segments.size();
+	for( int i=0; i<count; ++i )
+		path->m_path[i] = entry->segments[i];
+
+	// append path end position, on the ground
+	CNavPath::PathSegment *end = &path->m_path[ count ];
+	end->area = goalArea;
+	end->pos = *goal;
+	end->pos.z = goalArea->GetZ( goal );
+	end->ladder = nullptr;
+	end->how = NUM_TRAVERSE_TYPES;
+
+	path->m_segmentCount = count + 1;
+
+	return true;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Remember 'path', which was built from a search from 'startArea' to 'goalArea' with the given cost
+ */
+void CNavPathCache::Store( CNavArea *startArea, CNavArea *goalArea, unsigned int costID, bool usesDanger, const CNavPath *path )
+{
+	// there must be something besides the end position
+	if (path->m_segmentCount < 2)
+		return;
+
+	Key key;
+	key.startID = startArea->GetID();
+	key.goalID = goalArea->GetID();
+	key.costID = costID;
+
+	std::unordered_map< Key, EntryList::iterator, KeyHash >::iterator iter = m_entryMap.find( key );
+	if (iter != m_entryMap.end())
+	{
+		m_entryList.erase( iter->second );
+		m_entryMap.erase( iter );
+	}
+
+	m_entryList.push_front( Entry() );
+
+	Entry *entry = &m_entryList.front();
+	entry->key = key;
+	entry->meshGeneration = m_meshGeneration;
+	entry->dangerGeneration = m_dangerGeneration;
+	entry->usesDanger = usesDanger;
+	entry->segments.assign( path->m_path, path->m_path + path->m_segmentCount-1 );
+
+	m_entryMap[ key ] = m_entryList.begin();
+
+	++m_storeCount;
+
+	// forget the least recently used path
+	if (m_entryList.size() > MAX_ENTRIES)
+	{
+		m_entryMap.erase( m_entryList.back().key );
+		m_entryList.pop_back();
+
+		++m_evictCount;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Discard all cached paths, invoked when the mesh goes away
+ */
+void CNavPathCache::Reset( void )
+{
+	m_entryList.clear();
+	m_entryMap.clear();
+
+	OnMeshChanged();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavPathCache::ResetStats( void )
+{
+	m_hitCount = 0;
+	m_missCount = 0;
+	m_staleCount = 0;
+	m_storeCount = 0;
+	m_evictCount = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavPathCache::PrintStats( void ) const
+{
+	unsigned int lookupCount = m_hitCount + m_missCount;
+
+	CONSOLE_ECHO( "Nav path cache: %d of %d entries used, mesh generation %u, danger generation %u\n", m_entryList.size(), MAX_ENTRIES, m_meshGeneration, m_dangerGeneration );
+	CONSOLE_ECHO( "  %u lookups, %u hits, %u misses (%u out of date), %.1f%% hit rate\n", lookupCount, m_hitCount, m_missCount, m_staleCount, (lookupCount) ? 100.0f * m_hitCount / lookupCount : 0.0f );
+	CONSOLE_ECHO( "  %u paths stored, %u evicted\n", m_storeCount, m_evictCount );
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Reset the stuck-checker.
@@ -7,10 +7,15 @@
 
 #pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
 
+#include <list>
+#include <vector>
+#include <unordered_map>
+
 #include "nav_area.h"
 #include "bot_util.h"
 
 class CImprov;
+class CNavPathCache;
 
 //--------------------------------------------------------------------------------------------------------
 /**
@@ -77,12 +82,9 @@ public:
 			return true;
 		}
 
-		// make sure path end position is on the ground
-		Vector pathEndPosition = *goal;
-		if (goalArea)
-			pathEndPosition.z = goalArea->GetZ( &pathEndPosition );
-		else
-			GetGroundHeight( &pathEndPosition, &pathEndPosition.z );
+		// reuse a path to the goal area found by an earlier search
+		if (FindInCache( startArea, goalArea, goal, costFunc ))
+			return true;
 
 		//
 		// Compute shortest path to goal
@@ -92,67 +94,153 @@ public:
 
 		CNavArea *effectiveGoalArea = (pathToGoalExists) ? goalArea : closestArea;
 
-		//
-		// Build path by following parent links
-		//
-
-		// get count
-		int count = 0;
-		CNavArea *area;
-		for( area = effectiveGoalArea; area; area = area->GetParent() )
-			++count;
-
-		// save room for endpoint
-		if (count > MAX_PATH_SEGMENTS-1)
-			count = MAX_PATH_SEGMENTS-1;
-
-		if (count == 0)
+		if (!BuildFromSearch( start, goal, goalArea, effectiveGoalArea ))
 			return false;
 
-		if (count == 1)
-		{
-			BuildTrivialPath( start, goal );
-			return true;
-		}
+		if (pathToGoalExists)
+			StoreInCache( startArea, goalArea, costFunc );
 
-		// build path
-		m_segmentCount = count;
-		for( area = effectiveGoalArea; count && area; area = area->GetParent() )
-		{
-			--count;
-			m_path[ count ].area = area;
-			m_path[ count ].how = area->GetParentHow();
-		}
+		return true;
+	}
 
-		// compute path positions
-		if (ComputePathPositions() == false)
-		{
-			//PrintIfWatched( "Error building path\n" );
-			Invalidate();
-			return false;
-		}
+	template< typename CostFunctor >
+	bool FindInCache( CNavArea *startArea, CNavArea *goalArea, const Vector *goal, CostFunctor &costFunc );	///< build path from the path cache, if it has one from 'startArea' to 'goalArea'
 
-		// append path end position
-		m_path[ m_segmentCount ].area = effectiveGoalArea;
-		m_path[ m_segmentCount ].pos = pathEndPosition;
-		m_path[ m_segmentCount ].ladder = nullptr;
-		m_path[ m_segmentCount ].how = NUM_TRAVERSE_TYPES;
-		++m_segmentCount;
+	template< typename CostFunctor >
+	void StoreInCache( CNavArea *startArea, CNavArea *goalArea, CostFunctor &costFunc );	///< remember this path, found by a search from 'startArea' to 'goalArea', in the path cache
 
-		return true;
-	}
+	/**
+	 * Build path by following parent links back from 'effectiveGoalArea', after a search towards 'goal'.
+	 * The search context the search ran in must still be current.
+	 */
+	bool BuildFromSearch( const Vector *start, const Vector *goal, CNavArea *goalArea, CNavArea *effectiveGoalArea );
+
+	bool BuildTrivialPath( const Vector *start, const Vector *goal );		///< utility function for when start and goal are in the same area, or to move straight towards the goal while a path is computed
 
 private:
+	friend class CNavPathCache;
+
 	enum { MAX_PATH_SEGMENTS = 256 };
 	PathSegment m_path[ MAX_PATH_SEGMENTS ];
 	int m_segmentCount;
 
 	bool ComputePathPositions( void );				///< determine actual path positions 
-	bool BuildTrivialPath( const Vector *start, const Vector *goal );		///< utility function for when start and goal are in the same area
 
 	int FindNextOccludedNode( int anchor );		///< used by Optimize()
 };
 
+//--------------------------------------------------------------------------------------------------------
+/**
+ * Cost functors opt in to path caching by specializing this with a unique, nonzero ID.
+ * Only functors whose cost depends on nothing but the mesh and area danger may be cached.
+ */
+template< typename CostFunctor >
+struct NavPathCacheTraits
+{
+	enum
+	{
+		ID = 0,													///< zero means paths computed with this functor are never cached
+		USES_DANGER = 0,										///< if nonzero, cached paths are discarded when area danger increases
+	};
+};
+
+template<>
+struct NavPathCacheTraits< ShortestPathCost >
+{
+	enum { ID = 1, USES_DANGER = 0 };
+};
+
+/**
+ * The CNavPathCache remembers the most recently used paths between pairs of areas, so that bots
+ * heading for the same places do not repeat the same searches.
+ * Cached paths are discarded when the mesh is edited, and paths whose cost depends on
+ * area danger are also discarded when danger increases.
+ */
+class CNavPathCache
+{
+public:
+	CNavPathCache( void );
+
+	bool Find( CNavArea *startArea, CNavArea *goalArea, const Vector *goal, unsigned int costID, bool usesDanger, CNavPath *path );	///< build 'path' from the cached path between the given areas, if any
+	void Store( CNavArea *startArea, CNavArea *goalArea, unsigned int costID, bool usesDanger, const CNavPath *path );	///< remember 'path', found by a search from 'startArea' to 'goalArea'
+
+	void OnMeshChanged( void )						{ ++m_meshGeneration; }		///< invoked when areas or their connections change
+	void OnDangerChanged( void )					{ ++m_dangerGeneration; }	///< invoked when the danger of an area increases
+	unsigned int GetMeshGeneration( void ) const	{ return m_meshGeneration; }
+
+	void Reset( void );											///< discard all cached paths, invoked when the mesh goes away
+	void ResetStats( void );
+	void PrintStats( void ) const;
+
+private:
+	enum { MAX_ENTRIES = 256 };
+
+	struct Key
+	{
+		unsigned int startID;
+		unsigned int goalID;
+		unsigned int costID;
+
+		bool operator==( const Key &other ) const
+		{
+			return (startID == other.startID && goalID == other.goalID && costID == other.costID) ? true : false;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()( const Key &key ) const
+		{
+			return (key.startID * 2654435761u) ^ (key.goalID * 40503u) ^ key.costID;
+		}
+	};
+
+	struct Entry
+	{
+		Key key;
+		unsigned int meshGeneration;							///< the mesh generation the path was found in
+		unsigned int dangerGeneration;							///< the danger generation the path was found in
+		bool usesDanger;
+		std::vector<CNavPath::PathSegment> segments;			///< the path, up to but not including the goal position
+	};
+
+	typedef std::list<Entry> EntryList;
+	EntryList m_entryList;										///< most recently used first
+	std::unordered_map< Key, EntryList::iterator, KeyHash > m_entryMap;
+
+	unsigned int m_meshGeneration;
+	unsigned int m_dangerGeneration;
+
+	unsigned int m_hitCount;
+	unsigned int m_missCount;
+	unsigned int m_staleCount;									///< misses due to entries invalidated by mesh or danger changes
+	unsigned int m_storeCount;
+	unsigned int m_evictCount;
+};
+
+extern CNavPathCache TheNavPathCache;
+
+//--------------------------------------------------------------------------------------------------------
+template< typename CostFunctor >
+inline bool CNavPath::FindInCache( CNavArea *startArea, CNavArea *goalArea, const Vector *goal, CostFunctor &costFunc )
+{
+	if (NavPathCacheTraits< CostFunctor >::ID == 0 || goalArea == nullptr)
+		return false;
+
+	return TheNavPathCache.Find( startArea, goalArea, goal, NavPathCacheTraits< CostFunctor >::ID, NavPathCacheTraits< CostFunctor >::USES_DANGER, this );
+}
+
+//--------------------------------------------------------------------------------------------------------
+template< typename CostFunctor >
+inline void CNavPath::StoreInCache( CNavArea *startArea, CNavArea *goalArea, CostFunctor &costFunc )
+{
+	if (NavPathCacheTraits< CostFunctor >::ID == 0 || goalArea == nullptr)
+		return;
+
+	TheNavPathCache.Store( startArea, goalArea, NavPathCacheTraits< CostFunctor >::ID, NavPathCacheTraits< CostFunctor >::USES_DANGER, this );
+}
+
+
 //--------------------------------------------------------------------------------------------------------
 /**
  * Monitor improv movement and determine if it becomes stuck
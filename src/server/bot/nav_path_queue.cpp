@@ -0,0 +1,152 @@
+// nav_path_queue.cpp
+// Path queries that are computed a little at a time, over several frames
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+
+#include "nav.h"
+#include "nav_path_queue.h"
+#include "bot_perf.h"
+
+
+/**
+ * The number of areas expanded between checks of the time budget
+ */
+const int NavPathQueueSliceIterations = 16;
+
+
+//--------------------------------------------------------------------------------------------------------------
+CNavPathQueue::CNavPathQueue( void )
+{
+}
+
+//--------------------------------------------------------------------------------------------------------------
+CNavPathQueue::~CNavPathQueue()
+{
+	Reset();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Discard any query queued by the given listener
+ */
+void CNavPathQueue::Cancel( INavPathListener *listener )
+{
+	NavPathQueryList::iterator iter = m_queue.begin();
+	while( iter != m_queue.end() )
+	{
+		if ((*iter)->m_listener == listener)
+		{
+			// a search in progress leaves stale state in our context, which the next search clears when it starts
+			delete *iter;
+			iter = m_queue.erase( iter );
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if the given listener is waiting on a query
+ */
+bool CNavPathQueue::IsPending( const INavPathListener *listener ) const
+{
+	for( NavPathQueryList::const_iterator iter = m_queue.begin(); iter != m_queue.end(); ++iter )
+		if ((*iter)->m_listener == listener)
+			return true;
+
+	return false;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Run queued queries, in the order they were made, for up to 'budget' seconds.
+ * If 'budget' is zero or less, all queued queries are run to completion.
+ * At least one slice of the query at the head of the queue is always run, so queries make progress.
+ */
+void CNavPathQueue::Update( float budget )
+{
+	if (m_queue.empty())
+		return;
+
+	CBotPerf::Clock::time_point deadline = CBotPerf::Clock::now() + std::chrono::duration_cast< CBotPerf::Clock::duration >( std::chrono::duration< float >( budget ) );
+
+	NavSearchContext *prevSearch = CNavArea::SetSearchContext( &m_search );
+
+	while( !m_queue.empty() )
+	{
+		NavPathQuery *query = m_queue.front();
+
+		// if the mesh has changed, our areas may be gone - find them again and start over
+		if (query->m_meshGeneration != TheNavPathCache.GetMeshGeneration())
+		{
+			query->m_startArea = TheNavAreaGrid.GetNearestNavArea( &query->m_start );
+			query->m_goalArea = TheNavAreaGrid.GetNavArea( &query->m_goal );
+			query->m_meshGeneration = TheNavPathCache.GetMeshGeneration();
+			query->m_isStarted = false;
+		}
+
+		NavPathSearchStatus status;
+		if (!query->m_isStarted)
+		{
+			query->m_isStarted = true;
+			status = query->Start();
+		}
+		else
+		{
+			status = query->Step( NavPathQueueSliceIterations );
+		}
+
+		if (status == NAV_SEARCH_IN_PROGRESS)
+		{
+			if (budget > 0.0f && CBotPerf::Clock::now() >= deadline)
+				break;
+
+			continue;
+		}
+
+		m_queue.pop_front();
+
+		// build the path while the parent links of the search are still current
+		CNavArea *effectiveGoalArea = (status == NAV_SEARCH_FOUND) ? query->m_goalArea : query->GetClosestArea();
+		if (effectiveGoalArea == nullptr)
+			query->m_path->Invalidate();
+		else if (query->m_path->BuildFromSearch( &query->m_start, &query->m_goal, query->m_goalArea, effectiveGoalArea ) && status == NAV_SEARCH_FOUND)
+			query->StoreInCache();
+
+		// the listener may make its own searches, which belong in the shared context
+		CNavArea::SetSearchContext( prevSearch );
+		query->m_listener->OnPathComputed( query->m_path, (status == NAV_SEARCH_FOUND) ? true : false );
+		CNavArea::SetSearchContext( &m_search );
+
+		delete query;
+
+		if (budget > 0.0f && CBotPerf::Clock::now() >= deadline)
+			break;
+	}
+
+	CNavArea::SetSearchContext( prevSearch );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Discard all queries, invoked when the navigation mesh goes away
+ */
+void CNavPathQueue::Reset( void )
+{
+	for( NavPathQueryList::iterator iter = m_queue.begin(); iter != m_queue.end(); ++iter )
+		delete *iter;
+
+	m_queue.clear();
+
+	// the search nodes refer to areas that may no longer exist
+	m_search.nodeList.clear();
+	m_search.openList.clear();
+}
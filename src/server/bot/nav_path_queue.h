@@ -0,0 +1,154 @@
+// nav_path_queue.h
+// Path queries that are computed a little at a time, over several frames
+
+#ifndef _NAV_PATH_QUEUE_H_
+#define _NAV_PATH_QUEUE_H_
+
+#pragma warning( disable : 4530 )					// STL uses exceptions, but we are not compiling with them - ignore warning
+
+#include <list>
+
+#include "nav_path.h"
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * Implemented by anything that queues path queries, to be told when they are done
+ */
+class INavPathListener
+{
+public:
+	/**
+	 * Invoked when a queued path query has finished and its path has been built.
+	 * If the goal could not be reached, the path leads to the area closest to it.
+	 * The path is invalid if no path could be built at all.
+	 */
+	virtual void OnPathComputed( CNavPath *path, bool pathToGoalExists ) = 0;
+};
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * A queued path query, independent of the cost functor it uses
+ */
+class NavPathQuery
+{
+public:
+	NavPathQuery( INavPathListener *listener, CNavPath *path, const Vector *start, const Vector *goal, CNavArea *startArea, CNavArea *goalArea )
+	{
+		m_listener = listener;
+		m_path = path;
+		m_start = *start;
+		m_goal = *goal;
+		m_startArea = startArea;
+		m_goalArea = goalArea;
+		m_isStarted = false;
+		m_meshGeneration = TheNavPathCache.GetMeshGeneration();
+	}
+
+	virtual ~NavPathQuery() { }
+
+	virtual NavPathSearchStatus Start( void ) = 0;					///< begin the search in the current search context
+	virtual NavPathSearchStatus Step( int maxIterations ) = 0;		///< continue the search in the current search context
+	virtual CNavArea *GetClosestArea( void ) const = 0;
+	virtual void StoreInCache( void ) = 0;							///< remember the path built from a successful search
+
+	INavPathListener *m_listener;									///< who to tell when the path is ready
+	CNavPath *m_path;												///< the path to build
+	Vector m_start;
+	Vector m_goal;
+	CNavArea *m_startArea;
+	CNavArea *m_goalArea;
+	bool m_isStarted;												///< if true, the search state in the queue's context belongs to this query
+	unsigned int m_meshGeneration;									///< the mesh generation the areas were found in
+};
+
+/**
+ * A queued path query using a copy of the given cost functor
+ */
+template< typename CostFunctor >
+class NavPathQueryImpl : public NavPathQuery
+{
+public:
+	NavPathQueryImpl( INavPathListener *listener, CNavPath *path, const Vector *start, const Vector *goal, CNavArea *startArea, CNavArea *goalArea, CostFunctor &costFunc )
+		: NavPathQuery( listener, path, start, goal, startArea, goalArea ), m_costFunc( costFunc ), m_search( m_costFunc )
+	{
+	}
+
+	virtual NavPathSearchStatus Start( void )					{ return m_search.Start( m_startArea, m_goalArea, &m_goal ); }
+	virtual NavPathSearchStatus Step( int maxIterations )		{ return m_search.Step( maxIterations ); }
+	virtual CNavArea *GetClosestArea( void ) const				{ return m_search.GetClosestArea(); }
+	virtual void StoreInCache( void )							{ m_path->StoreInCache( m_startArea, m_goalArea, m_costFunc ); }
+
+private:
+	CostFunctor m_costFunc;
+	NavAreaPathSearch< CostFunctor > m_search;
+};
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * The CNavPathQueue runs path queries first-come, first-served, spending no more than a fixed
+ * amount of time on them each frame. A query that does not finish is suspended and resumed
+ * on the next frame, so a long search across the map is spread out instead of spiking one frame.
+ * Suspended searches keep their state in the queue's own search context, so synchronous
+ * searches made in the meantime do not disturb them.
+ */
+class CNavPathQueue
+{
+public:
+	CNavPathQueue( void );
+	~CNavPathQueue();
+
+	/**
+	 * Queue a query for a path from 'start' to 'goal', to be built into 'path'.
+	 * Any query already queued by the listener is replaced.
+	 * Returns NAV_SEARCH_IN_PROGRESS if the query was queued and the listener will be told when it is done.
+	 * Trivial and cached queries are answered at once: NAV_SEARCH_FOUND means 'path' has been built,
+	 * NAV_SEARCH_FAILED means there is no path. The listener is not invoked for these.
+	 */
+	template< typename CostFunctor >
+	NavPathSearchStatus Request( INavPathListener *listener, CNavPath *path, const Vector *start, const Vector *goal, CostFunctor &costFunc )
+	{
+		Cancel( listener );
+
+		path->Invalidate();
+
+		CNavArea *startArea = TheNavAreaGrid.GetNearestNavArea( start );
+		if (startArea == nullptr)
+			return NAV_SEARCH_FAILED;
+
+		CNavArea *goalArea = TheNavAreaGrid.GetNavArea( goal );
+
+		// if we are already in the goal area, build trivial path
+		if (startArea == goalArea)
+		{
+			path->BuildTrivialPath( start, goal );
+			return NAV_SEARCH_FOUND;
+		}
+
+		// reuse a path to the goal area found by an earlier search
+		if (path->FindInCache( startArea, goalArea, goal, costFunc ))
+			return NAV_SEARCH_FOUND;
+
+		m_queue.push_back( new NavPathQueryImpl< CostFunctor >( listener, path, start, goal, startArea, goalArea, costFunc ) );
+
+		return NAV_SEARCH_IN_PROGRESS;
+	}
+
+	void Cancel( INavPathListener *listener );					///< discard any query queued by the given listener
+	bool IsPending( const INavPathListener *listener ) const;	///< return true if the given listener is waiting on a query
+	int GetPendingCount( void ) const							{ return m_queue.size(); }
+
+	void Update( float budget );								///< run queued queries for up to 'budget' seconds
+	void Reset( void );											///< discard all queries, invoked when the navigation mesh goes away
+
+private:
+	typedef std::list<NavPathQuery *> NavPathQueryList;
+	NavPathQueryList m_queue;
+
+	NavSearchContext m_search;									///< search state of the query at the head of the queue
+};
+
+
+#endif // _NAV_PATH_QUEUE_H_
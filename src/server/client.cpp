@@ -43,7 +43,11 @@
 #include "netadr.h"
 #include "pm_shared.h"
 #include "pm_defs.h"
+#include "pm_record.h"
 #include "UserMessages.h"
+#include "lag_compensation.h"
+#include "entity_names.h"
+#include "fullpack_cache.h"
 #ifdef HALFLIFE_BOTS
 #include "bot/hl_bot_manager.h"
 #endif
@@ -93,6 +97,8 @@ void ClientDisconnect(Entity* pEntity)
 
 		engine::FreeEntPrivateData(pEntity);
 	}
+
+	g_LagCompensation.ClientDisconnected(pEntity->GetIndex());
 }
 
 
@@ -563,6 +569,12 @@ void ServerDeactivate()
 
 	g_serveractive = 0;
 
+	// The names of this level's entities are about to go
+	g_EntityNames.Reset();
+
+	// The traces recorded so far belong to this level
+	PM_RecordStop();
+
 #ifdef HALFLIFE_BOTS
 	if (g_pBotMan)
 	{
@@ -611,6 +623,8 @@ void ServerActivate(Entity* pEdictList, int edictCount, int clientMax)
 	// Link user messages here to make sure first client can get them...
 	LinkUserMessages();
 
+	g_LagCompensation.Reset();
+
 #ifdef HALFLIFE_BOTS
 	if (g_pBotMan)
 	{
@@ -788,6 +802,10 @@ void StartFrame()
 	{
 		g_pGameRules->Think();
 	}
+
+	g_LagCompensation.RecordPlayers();
+	g_EntityNames.StartFrame();
+	g_FullPackCache.Invalidate();
 	
 #ifdef HALFLIFE_BOTS
 	if (g_pBotMan)
@@ -1071,10 +1089,47 @@ void SetupVisibility(Entity* pViewEntity, Entity* pClient, unsigned char** pvs,
 
 	*pvs = engine::SetFatPVS(org);
 	*pas = engine::SetFatPAS(org);
+
+	g_FullPackCache.SetupVisibility(pClient);
 }
 
 #include "entity_state.h"
 
+// The checks in AddToFullPack that depend on the host
+static bool ShouldSendToHost(Entity* ent, Entity* host, int hostflags)
+{
+	// Don't send entity to local client if the client says it's predicting the entity itself.
+	if ((ent->flags & FL_SKIPLOCALHOST) != 0)
+	{
+		if ((hostflags & 1) != 0 && (ent->owner == host))
+			return false;
+	}
+
+	if (0 != host->groupinfo)
+	{
+		util::SetGroupTrace(host->groupinfo, util::GROUP_OP_AND);
+
+		// Should always be set, of course
+		if (0 != ent->groupinfo)
+		{
+			if (util::g_groupop == util::GROUP_OP_AND)
+			{
+				if ((ent->groupinfo & host->groupinfo) == 0)
+					return false;
+			}
+			else if (util::g_groupop == util::GROUP_OP_NAND)
+			{
+				if ((ent->groupinfo & host->groupinfo) != 0)
+					return false;
+			}
+		}
+
+		util::UnsetGroupTrace();
+	}
+
+	return true;
+}
+
 /*
 AddToFullPack
 
@@ -1099,6 +1154,39 @@ int AddToFullPack(struct entity_state_s* state, int e, Entity* ent, Entity* host
 		return 0;
 	}
 
+	// Most of this is the same for every host, so only work it out once per frame
+	if (sv_fullpack_cache.value != 0)
+	{
+		const auto flags = g_FullPackCache.Evaluate(e, ent);
+
+		if ((flags & CFullPackCache::kNoEntity) != 0)
+		{
+			return 0;
+		}
+
+		if (ent != host)
+		{
+			if ((flags & CFullPackCache::kHidden) != 0)
+			{
+				return 0;
+			}
+
+			if ((flags & CFullPackCache::kAlwaysSend) == 0 && !engine::CheckVisibility(ent, pSet))
+			{
+				return 0;
+			}
+		}
+
+		if (!ShouldSendToHost(ent, host, hostflags))
+		{
+			return 0;
+		}
+
+		g_FullPackCache.WriteState(state, e, ent, host);
+
+		return 1;
+	}
+
 	auto entity = ent->Get<CBaseEntity>();
 
 	if (entity == nullptr)
@@ -1137,34 +1225,9 @@ int AddToFullPack(struct entity_state_s* state, int e, Entity* ent, Entity* host
 		}
 	}
 
-
-	// Don't send entity to local client if the client says it's predicting the entity itself.
-	if ((ent->flags & FL_SKIPLOCALHOST) != 0)
-	{
-		if ((hostflags & 1) != 0 && (ent->owner == host))
-			return 0;
-	}
-
-	if (0 != host->groupinfo)
+	if (!ShouldSendToHost(ent, host, hostflags))
 	{
-		util::SetGroupTrace(host->groupinfo, util::GROUP_OP_AND);
-
-		// Should always be set, of course
-		if (0 != ent->groupinfo)
-		{
-			if (util::g_groupop == util::GROUP_OP_AND)
-			{
-				if ((ent->groupinfo & host->groupinfo) == 0)
-					return 0;
-			}
-			else if (util::g_groupop == util::GROUP_OP_NAND)
-			{
-				if ((ent->groupinfo & host->groupinfo) != 0)
-					return 0;
-			}
-		}
-
-		util::UnsetGroupTrace();
+		return 0;
 	}
 
 	memset(state, 0, sizeof(entity_state_t));
@@ -1553,6 +1616,8 @@ void CmdStart(const Entity* ent, const struct usercmd_s* cmd, unsigned int rando
 
 	player->CmdStart(*cmd, random_seed);
 
+	g_LagCompensation.SetInterpolation(player->v.GetIndex(), cmd->lerp_msec);
+
 	if (player->v.groupinfo != 0)
 	{
 		util::SetGroupTrace(player->v.groupinfo, util::GROUP_OP_AND);
@@ -1662,7 +1727,9 @@ AllowLagCompensation
 */
 int AllowLagCompensation()
 {
-	return sv_unlag->value;
+	// Players are rewound by the game instead (see lag_compensation.cpp),
+	// so the engine must not rewind them a second time.
+	return 0;
 }
 
 /*
@@ -1679,6 +1746,8 @@ void PM_Move(struct playermove_s* ppmove, qboolean server)
 
 	if (player != nullptr && player->GetGameMovement() != nullptr)
 	{
+		PM_RecordBeginMove(ppmove);
 		player->GetGameMovement()->Move();
+		PM_RecordEndMove(ppmove);
 	}
 }
@@ -58,7 +58,7 @@ public:
 	void Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE useType, float value) override;
 
 	// Bmodels don't go across transitions
-	int ObjectCaps() override { return CBaseEntity::ObjectCaps() & ~FCAP_ACROSS_TRANSITION; }
+	int ObjectCaps() override { return (CBaseEntity::ObjectCaps() & ~FCAP_ACROSS_TRANSITION) | FCAP_NET_LOW_PRIORITY; }
 };
 
 LINK_ENTITY_TO_CLASS(func_wall, CFuncWall);
@@ -93,6 +93,8 @@ public:
 
 	bool Spawn() override;
 	void Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE useType, float value) override;
+	// Whether it's there or not matters to players, however far away
+	int ObjectCaps() override { return CFuncWall::ObjectCaps() & ~FCAP_NET_LOW_PRIORITY; }
 	void TurnOff();
 	void TurnOn();
 	bool IsOn();
@@ -229,7 +231,7 @@ public:
 	bool Spawn() override;
 	void EXPORT SloshTouch(CBaseEntity* pOther);
 	bool KeyValue(KeyValueData* pkvd) override;
-	int ObjectCaps() override { return CBaseEntity::ObjectCaps() & ~FCAP_ACROSS_TRANSITION; }
+	int ObjectCaps() override { return (CBaseEntity::ObjectCaps() & ~FCAP_ACROSS_TRANSITION) | FCAP_NET_LOW_PRIORITY; }
 };
 
 LINK_ENTITY_TO_CLASS(func_illusionary, CFuncIllusionary);
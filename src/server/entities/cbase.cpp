@@ -20,6 +20,9 @@
 #include "gamerules.h"
 #include "game.h"
 #include "pm_shared.h"
+#include "entity_grid.h"
+#include "entity_names.h"
+#include "fullpack_cache.h"
 
 void OnFreeEntPrivateData(Entity* pEdict);
 int ShouldCollide(Entity* pentTouched, Entity* pentOther);
@@ -149,12 +152,15 @@ int DispatchSpawn(Entity* pent)
 	// Initialize these or entities who don't link to the world won't have anything in here
 	entity->v.absmin = entity->v.origin - Vector(1, 1, 1);
 	entity->v.absmax = entity->v.origin + Vector(1, 1, 1);
+	g_EntityGrid.Link(pent);
 
 	if (!entity->Spawn())
 	{
 		return -1;
 	}
 
+	g_EntityNames.Update(pent);
+
 	if (g_pGameRules != nullptr && !g_pGameRules->IsAllowedToSpawn(entity))
 	{
 		return -1; // return that this entity should be deleted
@@ -370,11 +376,13 @@ void DispatchKeyValue(Entity* pentKeyvalue, KeyValueData* pkvd)
 	if (pkvd->szClassName == nullptr || entity == nullptr)
 	{
 		EntvarsKeyvalue(pentKeyvalue, pkvd);
+		g_EntityNames.Update(pentKeyvalue);
 		return;
 	}
 
 	if (entity->EntvarsKeyvalue(pkvd))
 	{
+		g_EntityNames.Update(pentKeyvalue);
 		return;
 	}
 
@@ -502,6 +510,10 @@ void OnFreeEntPrivateData(Entity* pEdict)
 		return;
 	}
 
+	g_EntityGrid.Unlink(pEdict);
+	g_EntityNames.Remove(pEdict);
+	g_FullPackCache.EntityFreed(pEdict);
+
 	pEdict->Free<CBaseEntity>();
 }
 
@@ -681,6 +693,9 @@ void DispatchObjectCollsionBox(Entity* pent)
 	{
 		SetObjectCollisionBox(pent);
 	}
+
+	g_EntityGrid.Link(pent);
+	g_EntityNames.Update(pent);
 }
 
 
@@ -1148,5 +1163,26 @@ void CBaseEntity::GetEntityState(entity_state_t& state)
 
 	// Class is overridden for non-players to signify a breakable glass object ( sort of a class? )
 	state.playerclass = v.playerclass;
+
+	// Coarser animation for studio models that can do without it. The client
+	// advances the frame itself, so this mostly saves sending the frame.
+	if (sv_netlod.value != 0 && sv_netlod_quantize.value >= 1
+	 && (ObjectCaps() & FCAP_NET_LOW_PRIORITY) != 0
+	 && !FStringNull(v.model) && strstr(STRING(v.model), ".mdl") != nullptr)
+	{
+		const auto step = sv_netlod_quantize.value;
+
+		state.frame = floorf(state.frame / step) * step;
+
+		for (int i = 0; i < 4; i++)
+		{
+			state.controller[i] = static_cast<byte>(floorf(state.controller[i] / step) * step);
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			state.blending[i] = static_cast<byte>(floorf(state.blending[i] / step) * step);
+		}
+	}
 }
 
@@ -34,6 +34,7 @@ enum
 	FCAP_FORCE_TRANSITION = 0x00000080, // ALWAYS goes across transitions
 
 	FCAP_NET_ALWAYS_SEND = 0x00000100, // Don't perform a PVS check in AddToFullPack
+	FCAP_NET_LOW_PRIORITY = 0x00000200, // May be updated less often for clients far away (sv_netlod)
 };
 
 #include "Platform.h"
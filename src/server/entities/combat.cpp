@@ -29,6 +29,8 @@
 #include "player.h"
 #include "UserMessages.h"
 #include "gamerules.h"
+#include "lag_compensation.h"
+#include "game.h"
 
 
 bool CBaseEntity::ApplyMultiDamage(CBaseEntity* inflictor, CBaseEntity* attacker)
@@ -63,13 +65,18 @@ void RadiusDamage(
 	const float radius,
 	const int damageType)
 {
-	CBaseEntity* entity = nullptr;
+	/* Found in one go, as the damage may set off more explosions, which search again. */
+	CBaseEntity* list[1024];
 	TraceResult tr;
 	float adjusted;
 	float falloff = damage / radius;
 
-	while ((entity = util::FindEntityInSphere(entity, origin, radius)) != nullptr)
+	const int count = util::EntitiesInSphere(list, ARRAYSIZE(list), origin, radius);
+
+	for (int i = 0; i < count; i++)
 	{
+		CBaseEntity* entity = list[i];
+
 		if (entity->v.takedamage == DAMAGE_NO)
 		{
 			continue;
@@ -217,6 +224,59 @@ void CBaseEntity::TraceAttack(CBaseEntity* attacker, float flDamage, Vector vecD
 	}
 }
 
+static struct
+{
+	unsigned int shots;
+	unsigned int pellets; // One trace each, without the broadphase
+	unsigned int traces;
+	unsigned int mismatches;
+} gBulletStats;
+
+// Studio models are traced against their hitboxes, which may stick out of the bounds a little
+static constexpr float kBulletHitboxPadding = 32.0F;
+static constexpr int kMaxBulletCandidates = 256;
+
+static bool BulletMayHit(const Vector& start, const Vector& delta, CBaseEntity** candidates, int candidateCount)
+{
+	for (auto i = 0; i < candidateCount; i++)
+	{
+		const auto& mins = candidates[i]->v.absmin;
+		const auto& maxs = candidates[i]->v.absmax;
+
+		// Clip the segment against each pair of planes of the padded bounds
+		auto enter = 0.0F;
+		auto leave = 1.0F;
+		auto j = 0;
+		for (; j < 3; j++)
+		{
+			const auto low = mins[j] - kBulletHitboxPadding;
+			const auto high = maxs[j] + kBulletHitboxPadding;
+
+			if (delta[j] == 0.0F)
+			{
+				if (start[j] < low || start[j] > high)
+					break;
+				continue;
+			}
+
+			auto t0 = (low - start[j]) / delta[j];
+			auto t1 = (high - start[j]) / delta[j];
+			if (t0 > t1)
+				std::swap(t0, t1);
+
+			enter = std::max(enter, t0);
+			leave = std::min(leave, t1);
+			if (enter > leave)
+				break;
+		}
+
+		if (j == 3)
+			return true;
+	}
+
+	return false;
+}
+
 void CBasePlayer::FireBullets(
 	const float damage,
 	const Vector2D& spread,
@@ -226,12 +286,16 @@ void CBasePlayer::FireBullets(
 	const auto gun = v.origin + v.view_ofs;
 	const auto aim = v.v_angle + v.punchangle;
 
+	CLagCompensationScope lagCompensation{this};
+
 	auto traceHits = 0;
 	auto traceFlags = 0;
 	auto traceEndPos = static_cast<Vector*>(alloca(count * sizeof(Vector)));
 	auto traceCount = 0;
 	auto traceEntities = static_cast<CBaseEntity**>(alloca(count * sizeof(CBaseEntity*)));
 
+	auto pelletDir = static_cast<Vector*>(alloca(count * sizeof(Vector)));
+
 	for (auto i = 0; i < count; i++)
 	{
 		const Vector2D spreadScale
@@ -249,11 +313,85 @@ void CBasePlayer::FireBullets(
 			aim.z,
 		};
 
-		Vector dir;
-		AngleVectors(angles, &dir, nullptr, nullptr);
+		AngleVectors(angles, &pelletDir[i], nullptr, nullptr);
+	}
+
+	// A pellet can only do something if it hits an entity that takes damage,
+	// so find those in the way of the shot once, and skip pellets that miss all of them.
+	// Pellets that might hit one get the same trace as ever, so the results don't change.
+	CBaseEntity* candidates[kMaxBulletCandidates];
+	auto candidateCount = -1; // Trace every pellet
+
+	if (sv_bullet_broadphase.value != 0 && count > 1)
+	{
+		auto mins = gun;
+		auto maxs = gun;
+
+		for (auto i = 0; i < count; i++)
+		{
+			const auto end = gun + pelletDir[i] * distance;
+
+			for (auto j = 0; j < 3; j++)
+			{
+				mins[j] = std::min(mins[j], end[j]);
+				maxs[j] = std::max(maxs[j], end[j]);
+			}
+		}
+
+		const Vector padding{kBulletHitboxPadding, kBulletHitboxPadding, kBulletHitboxPadding};
+		const auto found = util::EntitiesInBox(candidates, kMaxBulletCandidates, mins - padding, maxs + padding, 0);
+
+		// Too many to be sure of having them all
+		if (found < kMaxBulletCandidates)
+		{
+			candidateCount = 0;
+
+			for (auto i = 0; i < found; i++)
+			{
+				auto candidate = candidates[i];
+
+				if (candidate == this || candidate->v.takedamage == DAMAGE_NO)
+					continue;
+
+				if (candidate->v.solid != SOLID_BBOX
+				 && candidate->v.solid != SOLID_SLIDEBOX
+				 && candidate->v.solid != SOLID_BSP)
+					continue;
+
+				candidates[candidateCount] = candidate;
+				candidateCount++;
+			}
+		}
+	}
+
+	gBulletStats.shots++;
+	gBulletStats.pellets += count;
+
+	for (auto i = 0; i < count; i++)
+	{
+		const auto& dir = pelletDir[i];
+
+		if (candidateCount >= 0 && !BulletMayHit(gun, dir * distance, candidates, candidateCount))
+		{
+			// Make sure the trace really would have been wasted
+			if (sv_bullet_broadphase.value >= 2)
+			{
+				TraceResult tr;
+				util::TraceLine(gun, gun + dir * distance, &tr, this);
+
+				if (tr.flFraction != 1.0F
+				 && tr.pHit->Get<CBaseEntity>() != nullptr
+				 && tr.pHit->Get<CBaseEntity>()->v.takedamage != DAMAGE_NO)
+				{
+					gBulletStats.mismatches++;
+				}
+			}
+			continue;
+		}
 
 		TraceResult tr;
 		util::TraceLine(gun, gun + dir * distance, &tr, this);
+		gBulletStats.traces++;
 		
 		if (tr.flFraction == 1.0F)
 		{
@@ -322,6 +460,28 @@ void CBasePlayer::FireBullets(
 	}
 }
 
+void FireBullets_PrintStats()
+{
+	if (gBulletStats.shots == 0)
+	{
+		engine::ServerPrint("No shots fired yet.\n");
+		return;
+	}
+
+	engine::ServerPrint(util::VarArgs("Bullets: %u shots, %u pellets, %.2f traces per shot without the broadphase, %.2f with it\n",
+		gBulletStats.shots,
+		gBulletStats.pellets,
+		gBulletStats.pellets / static_cast<float>(gBulletStats.shots),
+		gBulletStats.traces / static_cast<float>(gBulletStats.shots)));
+
+	if (sv_bullet_broadphase.value >= 2)
+	{
+		engine::ServerPrint(util::VarArgs("  %u skipped pellets would have hit something\n", gBulletStats.mismatches));
+	}
+
+	gBulletStats = {};
+}
+
 //=========================================================
 // Look - Base class monster function to find enemies or
 // food by sight. iDistance is distance ( in units ) that the
@@ -21,6 +21,7 @@
 #include "func_break.h"
 #include "shake.h"
 #include "UserMessages.h"
+#include "entity_names.h"
 
 #define SF_GIBSHOOTER_REPEATABLE 1 // allows a gibshooter to be refired
 
@@ -222,6 +223,7 @@ CBeam* CBeam::BeamCreate(const char* pSpriteName, int width)
 	// Create a new entity with CBeam private data
 	CBeam* pBeam = Entity::Create<CBeam>();
 	pBeam->v.classname = MAKE_STRING("beam");
+	g_EntityNames.Update(&pBeam->v);
 
 	pBeam->BeamInit(pSpriteName, width);
 
@@ -1194,6 +1196,7 @@ CSprite* CSprite::SpriteCreate(const char* pSpriteName, const Vector& origin, bo
 	CSprite* pSprite = Entity::Create<CSprite>();
 	pSprite->SpriteInit(pSpriteName, origin);
 	pSprite->v.classname = MAKE_STRING("env_sprite");
+	g_EntityNames.Update(&pSprite->v);
 	pSprite->v.solid = SOLID_NOT;
 	pSprite->v.movetype = MOVETYPE_NOCLIP;
 	if (animate)
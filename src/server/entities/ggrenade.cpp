@@ -24,6 +24,7 @@
 #include "player.h"
 #include "weapons.h"
 #include "UserMessages.h"
+#include "entity_names.h"
 
 LINK_ENTITY_TO_CLASS(grenade, CGrenade);
 
@@ -159,6 +160,7 @@ bool CGrenade::Spawn()
 {
 	v.movetype = MOVETYPE_BOUNCE;
 	v.classname = MAKE_STRING("grenade");
+	g_EntityNames.Update(&v);
 
 	v.solid = SOLID_BBOX;
 
@@ -199,6 +201,7 @@ CGrenade* CGrenade::ShootContact(CBaseEntity* owner, Vector vecStart, Vector vec
 bool CPrimeGrenade::Spawn()
 {
 	v.classname = MAKE_STRING("grenade");
+	g_EntityNames.Update(&v);
 	v.movetype = MOVETYPE_NONE;
 	v.solid = SOLID_NOT;
 
@@ -36,6 +36,7 @@ public:
 
 	bool KeyValue(KeyValueData* pkvd) override;
 	bool Spawn() override;
+	void Precache() override;
 	void Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE useType, float value) override;
 
 private:
@@ -83,17 +84,24 @@ bool CLight::Spawn()
 		return false;
 	}
 
+	Precache();
+
+	return true;
+}
+
+
+// Also called when the light is restored, to tell clients about the style again
+void CLight::Precache()
+{
 	if (m_iStyle >= 32)
 	{
 		if (FBitSet(v.spawnflags, SF_LIGHT_START_OFF))
-			engine::LightStyle(m_iStyle, "a");
+			util::LightStyle(m_iStyle, "a");
 		else if (!FStringNull(m_iszPattern))
-			engine::LightStyle(m_iStyle, (char*)STRING(m_iszPattern));
+			util::LightStyle(m_iStyle, STRING(m_iszPattern));
 		else
-			engine::LightStyle(m_iStyle, "m");
+			util::LightStyle(m_iStyle, "m");
 	}
-
-	return true;
 }
 
 
@@ -107,14 +115,14 @@ void CLight::Use(CBaseEntity* pActivator, CBaseEntity* pCaller, USE_TYPE useType
 		if (FBitSet(v.spawnflags, SF_LIGHT_START_OFF))
 		{
 			if (!FStringNull(m_iszPattern))
-				engine::LightStyle(m_iStyle, (char*)STRING(m_iszPattern));
+				util::LightStyle(m_iStyle, STRING(m_iszPattern));
 			else
-				engine::LightStyle(m_iStyle, "m");
+				util::LightStyle(m_iStyle, "m");
 			ClearBits(v.spawnflags, SF_LIGHT_START_OFF);
 		}
 		else
 		{
-			engine::LightStyle(m_iStyle, "a");
+			util::LightStyle(m_iStyle, "a");
 			SetBits(v.spawnflags, SF_LIGHT_START_OFF);
 		}
 	}
@@ -21,6 +21,7 @@
 #include "util.h"
 #include "cbase.h"
 #include "saverestore.h"
+#include "entity_names.h"
 
 // Monstermaker spawnflags
 #define SF_MONSTERMAKER_START_ON 1	  // start active ( if has targetname )
@@ -217,6 +218,7 @@ void CMonsterMaker::MakeMonster()
 	{
 		// if I have a netname (overloaded), give the child monster that name as a targetname
 		pent->targetname = v.netname;
+		g_EntityNames.Update(pent);
 	}
 
 	m_cLiveChildren++; // count this monster
@@ -41,6 +41,7 @@
 #include "client.h"
 #include "animation.h"
 #include "weaponbox.h"
+#include "entity_names.h"
 #ifdef HALFLIFE_NODEGRAPH
 #include "nodes.h"
 #endif
@@ -916,6 +917,7 @@ bool CBasePlayer::Spawn()
 	Precache();
 
 	v.classname = MAKE_STRING("player");
+	g_EntityNames.Update(&v);
 	v.health = 100;
 	v.armorvalue = 0;
 	v.takedamage = DAMAGE_AIM;
@@ -1454,6 +1456,8 @@ void CBasePlayer::UpdateClientData()
 			MessageEnd();
 
 			g_pGameRules->InitHUD(this);
+
+			util::SendLightStyles(this);
 		}
 
 		MessageBegin(MSG_ONE, gmsgResetHUD, this);
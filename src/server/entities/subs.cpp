@@ -26,6 +26,7 @@
 #include "saverestore.h"
 #include "doors.h"
 #include "gamerules.h"
+#include "entity_names.h"
 #ifdef HALFLIFE_NODEGRAPH
 #include "nodes.h"
 #endif
@@ -216,6 +217,7 @@ void CBaseEntity::UseTargets(CBaseEntity* pActivator, USE_TYPE useType, float va
 		// create a temp object to fire at a later time
 		CBaseEntity* pTemp = Entity::Create<CBaseEntity>();
 		pTemp->v.classname = MAKE_STRING("DelayedUse");
+		g_EntityNames.Update(&pTemp->v);
 
 		pTemp->v.nextthink = gpGlobals->time + m_flDelay;
 
@@ -27,6 +27,7 @@
 #include "saverestore.h"
 #include "trains.h" // trigger_camera has train functionality
 #include "gamerules.h"
+#include "entity_names.h"
 
 #define SF_TRIGGER_ALLOWMONSTERS 1 // monsters allowed to fire this trigger
 #define SF_TRIGGER_NOCLIENTS 2	   // players not allowed to fire this trigger
@@ -1222,6 +1223,7 @@ LINK_ENTITY_TO_CLASS(fireanddie, CFireAndDie);
 bool CFireAndDie::Spawn()
 {
 	v.classname = MAKE_STRING("fireanddie");
+	g_EntityNames.Update(&v);
 	// Don't call Precache() - it should be called on restore
 	return true;
 }
@@ -30,6 +30,7 @@ public:
 	bool KeyValue(KeyValueData* pkvd) override;
 	bool IsEmpty();
 	void SetObjectCollisionBox() override;
+	int ObjectCaps() override { return CBaseEntity::ObjectCaps() | FCAP_NET_LOW_PRIORITY; }
 
 	void RemoveWeapons();
 
@@ -29,6 +29,8 @@
 #include "weapons.h"
 #include "gamerules.h"
 #include "teamplay_gamerules.h"
+#include "entity_grid.h"
+#include "entity_names.h"
 #ifdef HALFLIFE_NODEGRAPH
 #include "nodes.h"
 #endif
@@ -363,6 +365,10 @@ CWorld::CWorld(Entity* containingEntity) : CBaseEntity(containingEntity)
 	}
 
 	World = this;
+
+	/* Every other entity is gone by now. */
+	g_EntityGrid.Reset();
+	g_EntityNames.Reset();
 }
 
 CWorld::~CWorld()
@@ -413,20 +419,22 @@ void CWorld::Precache()
 	BotPrecache();
 #endif
 
-	engine::LightStyle(0, "m");
-	engine::LightStyle(1, "mmnmmommommnonmmonqnmmo");
-	engine::LightStyle(2, "abcdefghijklmnopqrstuvwxyzyxwvutsrqponmlkjihgfedcba");
-	engine::LightStyle(3, "mmmmmaaaaammmmmaaaaaabcdefgabcdefg");
-	engine::LightStyle(4, "mamamamamama");
-	engine::LightStyle(5, "jklmnopqrstuvwxyzyxwvutsrqponmlkj");
-	engine::LightStyle(6, "nmonqnmomnmomomno");
-	engine::LightStyle(7, "mmmaaaabcdefgmmmmaaaammmaamm");
-	engine::LightStyle(8, "mmmaaammmaaammmabcdefaaaammmmabcdefmmmaaaa");
-	engine::LightStyle(9, "aaaaaaaazzzzzzzz");
-	engine::LightStyle(10, "mmamammmmammamamaaamammma");
-	engine::LightStyle(11, "abcdefghijklmnopqrrqponmlkjihgfedcba");
-	engine::LightStyle(12, "mmnnmmnnnmmnn");
-	engine::LightStyle(63, "a");
+	util::ResetLightStyles();
+
+	util::LightStyle(0, "m");
+	util::LightStyle(1, "mmnmmommommnonmmonqnmmo");
+	util::LightStyle(2, "abcdefghijklmnopqrstuvwxyzyxwvutsrqponmlkjihgfedcba");
+	util::LightStyle(3, "mmmmmaaaaammmmmaaaaaabcdefgabcdefg");
+	util::LightStyle(4, "mamamamamama");
+	util::LightStyle(5, "jklmnopqrstuvwxyzyxwvutsrqponmlkj");
+	util::LightStyle(6, "nmonqnmomnmomomno");
+	util::LightStyle(7, "mmmaaaabcdefgmmmmaaaammmaamm");
+	util::LightStyle(8, "mmmaaammmaaammmabcdefaaaammmmabcdefmmmaaaa");
+	util::LightStyle(9, "aaaaaaaazzzzzzzz");
+	util::LightStyle(10, "mmamammmmammamamaaamammma");
+	util::LightStyle(11, "abcdefghijklmnopqrrqponmlkjihgfedcba");
+	util::LightStyle(12, "mmnnmmnnnmmnn");
+	util::LightStyle(63, "a");
 
 #ifdef HALFLIFE_NODEGRAPH
 	WorldGraph.InitGraph();
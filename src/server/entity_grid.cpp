@@ -0,0 +1,632 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Uniform grid of entities for spatial queries
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "entity_grid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+
+CEntityGrid g_EntityGrid;
+
+cvar_t sv_entity_grid = {"sv_entity_grid", "1", FCVAR_SERVER};
+
+
+CEntityGrid::CEntityGrid()
+{
+	m_markStamp = 0;
+}
+
+
+void CEntityGrid::Allocate()
+{
+	EntityState state;
+	state.rect.x0 = 1;
+	state.rect.x1 = 0;
+	state.rect.y0 = 1;
+	state.rect.y1 = 0;
+	state.oversized = false;
+
+	m_entity.assign(gpGlobals->maxEntities, state);
+	m_mark.assign(gpGlobals->maxEntities, 0);
+	m_markStamp = 0;
+}
+
+
+void CEntityGrid::Reset()
+{
+	m_entity.clear();
+	m_mark.clear();
+
+	for (auto& cell : m_cell)
+	{
+		cell.clear();
+	}
+
+	m_oversized.clear();
+	m_gathered.clear();
+}
+
+
+int CEntityGrid::CellForCoord(float coord)
+{
+	/* Anything beyond the edge of the grid is filed in the edge cells, for queries and entities alike. */
+	const int cell = (int)floorf((coord + kWorldSize / 2) / kCellSize);
+	return std::clamp(cell, 0, kCellCount - 1);
+}
+
+
+CEntityGrid::CellRect CEntityGrid::RectForBounds(const Vector& mins, const Vector& maxs)
+{
+	CellRect rect;
+	rect.x0 = CellForCoord(mins.x);
+	rect.y0 = CellForCoord(mins.y);
+	rect.x1 = CellForCoord(maxs.x);
+	rect.y1 = CellForCoord(maxs.y);
+	return rect;
+}
+
+
+void CEntityGrid::AddToCells(int index, const CellRect& rect)
+{
+	for (int y = rect.y0; y <= rect.y1; y++)
+	{
+		for (int x = rect.x0; x <= rect.x1; x++)
+		{
+			m_cell[y * kCellCount + x].push_back(index);
+		}
+	}
+}
+
+
+void CEntityGrid::RemoveFromCells(int index, const CellRect& rect)
+{
+	for (int y = rect.y0; y <= rect.y1; y++)
+	{
+		for (int x = rect.x0; x <= rect.x1; x++)
+		{
+			auto& cell = m_cell[y * kCellCount + x];
+			auto it = std::find(cell.begin(), cell.end(), index);
+			if (it != cell.end())
+			{
+				*it = cell.back();
+				cell.pop_back();
+			}
+		}
+	}
+}
+
+
+void CEntityGrid::Link(Entity* entity)
+{
+	if (!IsActive())
+	{
+		Allocate();
+	}
+
+	const int index = entity - util::GetEntityList();
+	if (index <= 0 || index >= (int)m_entity.size())
+	{
+		return;
+	}
+
+	auto& state = m_entity[index];
+	const auto rect = RectForBounds(entity->absmin, entity->absmax);
+	const bool oversized =
+		(rect.x1 - rect.x0 + 1) * (rect.y1 - rect.y0 + 1) > kMaxCellsPerEntity;
+
+	/* Most moves stay within the same cells. */
+	if (oversized && state.oversized)
+	{
+		return;
+	}
+	if (!oversized && !state.oversized
+	 && rect.x0 == state.rect.x0 && rect.y0 == state.rect.y0
+	 && rect.x1 == state.rect.x1 && rect.y1 == state.rect.y1)
+	{
+		return;
+	}
+
+	Unlink(entity);
+
+	if (oversized)
+	{
+		m_oversized.push_back(index);
+	}
+	else
+	{
+		AddToCells(index, rect);
+		state.rect = rect;
+	}
+	state.oversized = oversized;
+}
+
+
+void CEntityGrid::Unlink(Entity* entity)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	const int index = entity - util::GetEntityList();
+	if (index <= 0 || index >= (int)m_entity.size())
+	{
+		return;
+	}
+
+	auto& state = m_entity[index];
+
+	if (state.oversized)
+	{
+		auto it = std::find(m_oversized.begin(), m_oversized.end(), index);
+		if (it != m_oversized.end())
+		{
+			*it = m_oversized.back();
+			m_oversized.pop_back();
+		}
+		state.oversized = false;
+	}
+	else
+	{
+		RemoveFromCells(index, state.rect);
+	}
+
+	state.rect.x0 = 1;
+	state.rect.x1 = 0;
+	state.rect.y0 = 1;
+	state.rect.y1 = 0;
+}
+
+
+void CEntityGrid::Gather(const Vector& mins, const Vector& maxs)
+{
+	m_gathered.clear();
+
+	if (++m_markStamp == 0)
+	{
+		std::fill(m_mark.begin(), m_mark.end(), 0);
+		m_markStamp = 1;
+	}
+
+	const auto rect = RectForBounds(mins, maxs);
+
+	for (int y = rect.y0; y <= rect.y1; y++)
+	{
+		for (int x = rect.x0; x <= rect.x1; x++)
+		{
+			for (auto index : m_cell[y * kCellCount + x])
+			{
+				if (m_mark[index] != m_markStamp)
+				{
+					m_mark[index] = m_markStamp;
+					m_gathered.push_back(index);
+				}
+			}
+		}
+	}
+
+	m_gathered.insert(m_gathered.end(), m_oversized.begin(), m_oversized.end());
+
+	std::sort(m_gathered.begin(), m_gathered.end());
+}
+
+
+int CEntityGrid::EntitiesInBox(CBaseEntity** list, int listMax, const Vector& mins, const Vector& maxs, int flagMask, bool checkSolid)
+{
+	int count = 0;
+
+	Gather(mins, maxs);
+
+	Entity* edicts = util::GetEntityList();
+
+	for (auto index : m_gathered)
+	{
+		Entity* pEdict = edicts + index;
+
+		if (pEdict->IsFree())
+			continue;
+
+		if (0 != flagMask && (pEdict->flags & flagMask) == 0)
+			continue;
+
+		if (checkSolid && (pEdict->solid == SOLID_NOT || pEdict->mins.x == pEdict->maxs.x))
+			continue;
+
+		if (mins.x > pEdict->absmax.x ||
+			mins.y > pEdict->absmax.y ||
+			mins.z > pEdict->absmax.z ||
+			maxs.x < pEdict->absmin.x ||
+			maxs.y < pEdict->absmin.y ||
+			maxs.z < pEdict->absmin.z)
+			continue;
+
+		CBaseEntity* pEntity = pEdict->Get<CBaseEntity>();
+		if (!pEntity)
+			continue;
+
+		list[count] = pEntity;
+		count++;
+
+		if (count >= listMax)
+			break;
+	}
+
+	return count;
+}
+
+
+int CEntityGrid::MonstersInSphere(CBaseEntity** list, int listMax, const Vector& center, float radius)
+{
+	int count = 0;
+	const float radiusSquared = radius * radius;
+
+	/* X & Y are measured from the origin, so gather around the origins, which are within the bounds. */
+	Gather(center - Vector(radius, radius, radius), center + Vector(radius, radius, radius));
+
+	Entity* edicts = util::GetEntityList();
+
+	for (auto index : m_gathered)
+	{
+		Entity* pEdict = edicts + index;
+
+		if (pEdict->IsFree())
+			continue;
+
+		if ((pEdict->flags & (FL_CLIENT | FL_MONSTER)) == 0)
+			continue;
+
+		float delta = center.x - pEdict->origin.x;
+		delta *= delta;
+
+		if (delta > radiusSquared)
+			continue;
+		float distance = delta;
+
+		delta = center.y - pEdict->origin.y;
+		delta *= delta;
+
+		distance += delta;
+		if (distance > radiusSquared)
+			continue;
+
+		delta = center.z - (pEdict->absmin.z + pEdict->absmax.z) * 0.5;
+		delta *= delta;
+
+		distance += delta;
+		if (distance > radiusSquared)
+			continue;
+
+		CBaseEntity* pEntity = pEdict->Get<CBaseEntity>();
+		if (!pEntity)
+			continue;
+
+		list[count] = pEntity;
+		count++;
+
+		if (count >= listMax)
+			break;
+	}
+
+	return count;
+}
+
+
+/* The engine's test for its sphere search: a spawned entity whose bounds are within the radius. */
+bool CEntityGrid::IsInSphere(int index, Entity* pEdict, const Vector& center, float radiusSquared)
+{
+	if (pEdict->IsFree() || FStringNull(pEdict->classname))
+		return false;
+
+	/* Clients must be spawned. */
+	if (index <= gpGlobals->maxClients && pEdict->pvPrivateData == nullptr)
+		return false;
+
+	float distance = 0.0F;
+	for (int j = 0; j < 3 && distance <= radiusSquared; j++)
+	{
+		float delta;
+		if (center[j] < pEdict->absmin[j])
+			delta = center[j] - pEdict->absmin[j];
+		else if (center[j] > pEdict->absmax[j])
+			delta = center[j] - pEdict->absmax[j];
+		else
+			delta = 0.0F;
+
+		distance += delta * delta;
+	}
+
+	return distance <= radiusSquared;
+}
+
+
+/* Matches the engine's own search: the next entity after the start whose bounds are within the radius. */
+CBaseEntity* CEntityGrid::FindEntityInSphere(CBaseEntity* startEntity, const Vector& center, float radius)
+{
+	Entity* edicts = util::GetEntityList();
+	const int start = (startEntity != nullptr) ? &startEntity->v - edicts : 0;
+	const float radiusSquared = radius * radius;
+
+	Gather(center - Vector(radius, radius, radius), center + Vector(radius, radius, radius));
+
+	auto it = std::upper_bound(m_gathered.begin(), m_gathered.end(), start);
+
+	for (; it != m_gathered.end(); ++it)
+	{
+		const int index = *it;
+		Entity* pEdict = edicts + index;
+
+		if (IsInSphere(index, pEdict, center, radiusSquared))
+		{
+			return pEdict->Get<CBaseEntity>();
+		}
+	}
+
+	return nullptr;
+}
+
+
+int CEntityGrid::EntitiesInSphere(CBaseEntity** list, int listMax, const Vector& center, float radius)
+{
+	int count = 0;
+	const float radiusSquared = radius * radius;
+
+	Gather(center - Vector(radius, radius, radius), center + Vector(radius, radius, radius));
+
+	Entity* edicts = util::GetEntityList();
+
+	for (auto index : m_gathered)
+	{
+		Entity* pEdict = edicts + index;
+
+		if (!IsInSphere(index, pEdict, center, radiusSquared))
+			continue;
+
+		CBaseEntity* pEntity = pEdict->Get<CBaseEntity>();
+		if (!pEntity)
+			continue;
+
+		list[count] = pEntity;
+		count++;
+
+		if (count >= listMax)
+			break;
+	}
+
+	return count;
+}
+
+
+int CEntityGrid::EntitiesAlongRay(CBaseEntity** list, int listMax, const Vector& start, const Vector& end, int flagMask)
+{
+	int count = 0;
+
+	Vector mins, maxs;
+	for (int j = 0; j < 3; j++)
+	{
+		mins[j] = std::min(start[j], end[j]);
+		maxs[j] = std::max(start[j], end[j]);
+	}
+
+	Gather(mins, maxs);
+
+	Entity* edicts = util::GetEntityList();
+	const Vector dir = end - start;
+
+	for (auto index : m_gathered)
+	{
+		Entity* pEdict = edicts + index;
+
+		if (pEdict->IsFree())
+			continue;
+
+		if (0 != flagMask && (pEdict->flags & flagMask) == 0)
+			continue;
+
+		/* Clip the segment against each pair of planes of the bounds. */
+		float enter = 0.0F;
+		float leave = 1.0F;
+		int j;
+		for (j = 0; j < 3; j++)
+		{
+			if (dir[j] == 0.0F)
+			{
+				if (start[j] < pEdict->absmin[j] || start[j] > pEdict->absmax[j])
+					break;
+				continue;
+			}
+
+			float t0 = (pEdict->absmin[j] - start[j]) / dir[j];
+			float t1 = (pEdict->absmax[j] - start[j]) / dir[j];
+			if (t0 > t1)
+				std::swap(t0, t1);
+
+			enter = std::max(enter, t0);
+			leave = std::min(leave, t1);
+			if (enter > leave)
+				break;
+		}
+		if (j < 3)
+			continue;
+
+		CBaseEntity* pEntity = pEdict->Get<CBaseEntity>();
+		if (!pEntity)
+			continue;
+
+		list[count] = pEntity;
+		count++;
+
+		if (count >= listMax)
+			break;
+	}
+
+	return count;
+}
+
+
+/*
+Scatter entities over the map and time the util queries with the grid and
+with the linear scans, making sure both give the same results. Then gather
+them all in one cluster, as with grenade spam or a pile of weaponboxes, and
+time whole sphere searches in the middle of it.
+Usage: sv_entity_grid_bench [entities] [queries] [seed]
+*/
+void EntityGrid_Benchmark()
+{
+	const int entityCount = engine::Cmd_Argc() > 1 ? atoi(engine::Cmd_Argv(1)) : 1000;
+	const int queryCount = engine::Cmd_Argc() > 2 ? atoi(engine::Cmd_Argv(2)) : 1000;
+	const unsigned int seed = engine::Cmd_Argc() > 3 ? strtoul(engine::Cmd_Argv(3), nullptr, 10) : 1;
+
+	if (CWorld::World == nullptr)
+	{
+		engine::ServerPrint("No map is running.\n");
+		return;
+	}
+
+	std::mt19937 random(seed);
+	const auto& worldMins = CWorld::World->v.absmin;
+	const auto& worldMaxs = CWorld::World->v.absmax;
+	std::uniform_real_distribution<float> randomX(worldMins.x, worldMaxs.x);
+	std::uniform_real_distribution<float> randomY(worldMins.y, worldMaxs.y);
+	std::uniform_real_distribution<float> randomZ(worldMins.z, worldMaxs.z);
+
+	const auto randomPoint = [&]() {
+		return Vector(randomX(random), randomY(random), randomZ(random));
+	};
+
+	std::vector<CBaseEntity*> spawned;
+	for (int i = 0; i < entityCount; i++)
+	{
+		auto entity = CBaseEntity::Create("info_target", randomPoint(), g_vecZero, CWorld::World->v);
+		if (entity == nullptr)
+		{
+			break;
+		}
+		entity->SetSize(Vector(-16, -16, 0), Vector(16, 16, 72));
+		entity->SetOrigin(entity->v.origin);
+		if ((i & 1) != 0)
+		{
+			entity->v.flags |= FL_MONSTER;
+		}
+		spawned.push_back(entity);
+	}
+
+	std::vector<Vector> centers;
+	std::vector<float> radii;
+	for (int i = 0; i < queryCount; i++)
+	{
+		centers.push_back(randomPoint());
+		radii.push_back(64.0F + 448.0F * (random() / (float)random.max()));
+	}
+
+	/* Big enough for every entity when they are all in one place. */
+	std::vector<CBaseEntity*> list(std::max<std::size_t>(spawned.size(), 256) + 64);
+	const int listMax = (int)list.size();
+
+	unsigned int checksum = 0;
+	const auto mix = [&](CBaseEntity* entity) {
+		checksum = checksum * 31 + (unsigned int)(&entity->v - util::GetEntityList());
+	};
+
+	/* Time the given queries, with or without the grid. */
+	const auto time = [&](bool useGrid, int count, auto query) {
+		const auto savedValue = sv_entity_grid.value;
+		sv_entity_grid.value = useGrid ? 1.0F : 0.0F;
+
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < count; i++)
+		{
+			query(i);
+		}
+		const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		sv_entity_grid.value = savedValue;
+		return seconds;
+	};
+
+	const auto boxQuery = [&](int i) {
+		const Vector delta(radii[i], radii[i], radii[i]);
+		const int count = util::EntitiesInBox(list.data(), listMax, centers[i] - delta, centers[i] + delta, 0);
+		std::for_each(list.data(), list.data() + count, mix);
+	};
+
+	const auto monsterQuery = [&](int i) {
+		const int count = util::MonstersInSphere(list.data(), listMax, centers[i], radii[i]);
+		std::for_each(list.data(), list.data() + count, mix);
+	};
+
+	const auto findQuery = [&](int i) {
+		CBaseEntity* entity = nullptr;
+		while ((entity = util::FindEntityInSphere(entity, centers[i], radii[i])) != nullptr)
+		{
+			mix(entity);
+		}
+	};
+
+	const auto sphereQuery = [&](int i) {
+		const int count = util::EntitiesInSphere(list.data(), listMax, centers[i], radii[i]);
+		std::for_each(list.data(), list.data() + count, mix);
+	};
+
+	/* Each kind of query, linear then with the grid, checking they found the same entities. */
+	bool match = true;
+	const auto compare = [&](const char* name, int count, auto query) {
+		checksum = 0;
+		const double linear = time(false, count, query);
+		const auto linearChecksum = checksum;
+
+		checksum = 0;
+		const double grid = time(true, count, query);
+
+		match = match && linearChecksum == checksum;
+
+		const double perQuery = (count > 0) ? 1000000.0 / count : 0.0;
+		engine::ServerPrint(util::VarArgs("  %-19s %10.2f us linear, %10.2f us grid\n", name, linear * perQuery, grid * perQuery));
+	};
+
+	engine::ServerPrint(util::VarArgs("Entity grid benchmark: %d entities spawned, %d queries, seed %u\n",
+		(int)spawned.size(), queryCount, seed));
+
+	compare("EntitiesInBox", queryCount, boxQuery);
+	compare("MonstersInSphere", queryCount, monsterQuery);
+	compare("FindEntityInSphere", queryCount, findQuery);
+	compare("EntitiesInSphere", queryCount, sphereQuery);
+
+	/* All of them in one cluster, with the searches around its middle. */
+	const Vector clusterCenter = randomPoint();
+	std::uniform_real_distribution<float> clusterOffset(-192.0F, 192.0F);
+
+	for (auto entity : spawned)
+	{
+		entity->SetOrigin(clusterCenter + Vector(clusterOffset(random), clusterOffset(random), clusterOffset(random) * 0.25F));
+	}
+
+	/* Whole searches through the cluster cost a gather for every result, so keep them few. */
+	const int clusterQueryCount = std::min(queryCount, 50);
+
+	for (int i = 0; i < clusterQueryCount; i++)
+	{
+		centers[i] = clusterCenter + Vector(clusterOffset(random), clusterOffset(random), 0.0F) * 0.5F;
+		radii[i] = 128.0F + 256.0F * (random() / (float)random.max());
+	}
+
+	engine::ServerPrint(util::VarArgs("In one cluster, %d whole searches:\n", clusterQueryCount));
+
+	compare("FindEntityInSphere", clusterQueryCount, findQuery);
+	compare("EntitiesInSphere", clusterQueryCount, sphereQuery);
+
+	for (auto entity : spawned)
+	{
+		engine::RemoveEntity(&entity->v);
+	}
+
+	engine::ServerPrint(match ? "  Results match.\n" : "  RESULTS DIFFER!\n");
+}
@@ -0,0 +1,87 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Uniform grid of entities for spatial queries
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include <vector>
+
+class CBaseEntity;
+
+/*
+Active entities, filed by the grid cells their bounds overlap on the X/Y plane.
+The engine hands every entity to the dll whenever it links it into the world,
+to set its absolute bounds, so the grid is kept up to date from there and from
+the entity being freed. Entities larger than a few cells are kept in a list of
+their own, which every query checks.
+
+Queries collect the entities in the cells they cover, then apply the same test
+as the linear scans they replace, against the entities as they are now.
+Results are in the order of the edict list, as with the scans.
+*/
+class CEntityGrid
+{
+public:
+	CEntityGrid();
+
+	void Link(Entity* entity);	 // File the entity by its current absolute bounds
+	void Unlink(Entity* entity); // Forget the entity
+	void Reset();
+
+	bool IsActive() const { return !m_entity.empty(); }
+
+	int EntitiesInBox(CBaseEntity** list, int listMax, const Vector& mins, const Vector& maxs, int flagMask, bool checkSolid);
+	int MonstersInSphere(CBaseEntity** list, int listMax, const Vector& center, float radius);
+	CBaseEntity* FindEntityInSphere(CBaseEntity* startEntity, const Vector& center, float radius);
+
+	// Everything FindEntityInSphere would find, one search at a time, with one gather.
+	int EntitiesInSphere(CBaseEntity** list, int listMax, const Vector& center, float radius);
+
+	// Entities whose absolute bounds the segment from start to end passes through.
+	int EntitiesAlongRay(CBaseEntity** list, int listMax, const Vector& start, const Vector& end, int flagMask);
+
+private:
+	static constexpr int kCellSize = 256;
+	static constexpr int kWorldSize = 16384;
+	static constexpr int kCellCount = kWorldSize / kCellSize; // Along each axis
+	static constexpr int kMaxCellsPerEntity = 16;
+
+	struct CellRect
+	{
+		short x0, y0, x1, y1; // Inclusive; x0 > x1 if not linked
+	};
+
+	struct EntityState
+	{
+		CellRect rect;
+		bool oversized;
+	};
+
+	static int CellForCoord(float coord);
+	static bool IsInSphere(int index, Entity* pEdict, const Vector& center, float radiusSquared);
+	static CellRect RectForBounds(const Vector& mins, const Vector& maxs);
+
+	void Allocate();
+	void AddToCells(int index, const CellRect& rect);
+	void RemoveFromCells(int index, const CellRect& rect);
+
+	// Gather the indices of the entities that may overlap the given bounds, in edict order.
+	void Gather(const Vector& mins, const Vector& maxs);
+
+	std::vector<EntityState> m_entity;		  // By edict index
+	std::vector<unsigned short> m_cell[kCellCount * kCellCount];
+	std::vector<unsigned short> m_oversized;
+
+	std::vector<unsigned int> m_mark; // By edict index, to gather each entity once
+	unsigned int m_markStamp;
+	std::vector<unsigned short> m_gathered;
+};
+
+extern CEntityGrid g_EntityGrid;
+
+extern cvar_t sv_entity_grid;
+
+void EntityGrid_Benchmark();
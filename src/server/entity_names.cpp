@@ -0,0 +1,328 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Index of entities by classname & targetname
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "entity_names.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+CEntityNameIndex g_EntityNames;
+
+cvar_t sv_entity_names = {"sv_entity_names", "1", FCVAR_SERVER};
+
+
+static double EntityNames_Seconds()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+CEntityNameIndex::CEntityNameIndex()
+{
+	Reset();
+}
+
+
+void CEntityNameIndex::Allocate()
+{
+	for (auto key = 0; key < kKeyCount; key++)
+	{
+		m_Filed[key].assign(gpGlobals->maxEntities, 0);
+	}
+}
+
+
+void CEntityNameIndex::Reset()
+{
+	for (auto key = 0; key < kKeyCount; key++)
+	{
+		m_Names[key].clear();
+		m_Filed[key].clear();
+	}
+
+	m_Frames = 0;
+	m_Lookups = 0;
+	m_Samples = 0;
+	m_Mismatches = 0;
+	m_LookupTime = 0.0;
+	m_SampleLookupTime = 0.0;
+	m_SampleEngineTime = 0.0;
+}
+
+
+string_t CEntityNameIndex::GetName(const Entity* entity, int key)
+{
+	return (key == kClassname) ? entity->classname : entity->targetname;
+}
+
+
+void CEntityNameIndex::File(int key, int index, string_t name)
+{
+	if (m_Filed[key][index] == name)
+	{
+		return;
+	}
+
+	Unfile(key, index);
+
+	/* Like the engine, don't bother with entities that have no name. */
+	if (FStringNull(name))
+	{
+		return;
+	}
+
+	auto& bucket = m_Names[key][STRING(name)];
+	bucket.insert(std::upper_bound(bucket.begin(), bucket.end(), index), index);
+
+	m_Filed[key][index] = name;
+}
+
+
+void CEntityNameIndex::Unfile(int key, int index)
+{
+	const auto name = m_Filed[key][index];
+
+	if (FStringNull(name))
+	{
+		return;
+	}
+
+	auto it = m_Names[key].find(STRING(name));
+
+	if (it != m_Names[key].end())
+	{
+		auto& bucket = it->second;
+		auto position = std::lower_bound(bucket.begin(), bucket.end(), index);
+
+		if (position != bucket.end() && *position == index)
+		{
+			bucket.erase(position);
+		}
+
+		if (bucket.empty())
+		{
+			m_Names[key].erase(it);
+		}
+	}
+
+	m_Filed[key][index] = 0;
+}
+
+
+void CEntityNameIndex::Update(Entity* entity)
+{
+	if (!IsActive())
+	{
+		Allocate();
+	}
+
+	const int index = entity - util::GetEntityList();
+	if (index <= 0 || index >= (int)m_Filed[kClassname].size())
+	{
+		return;
+	}
+
+	for (auto key = 0; key < kKeyCount; key++)
+	{
+		File(key, index, entity->IsFree() ? 0 : GetName(entity, key));
+	}
+}
+
+
+void CEntityNameIndex::Remove(Entity* entity)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	const int index = entity - util::GetEntityList();
+	if (index <= 0 || index >= (int)m_Filed[kClassname].size())
+	{
+		return;
+	}
+
+	for (auto key = 0; key < kKeyCount; key++)
+	{
+		Unfile(key, index);
+	}
+}
+
+
+void CEntityNameIndex::StartFrame()
+{
+	if (!IsActive())
+	{
+		return;
+	}
+
+	/* Catch any name set since the entity was last filed. */
+	Entity* edicts = util::GetEntityList();
+	const int count = std::min(gpGlobals->maxEntities, (int)m_Filed[kClassname].size());
+
+	for (auto index = 1; index < count; index++)
+	{
+		Entity* entity = edicts + index;
+		const bool free = entity->IsFree();
+
+		for (auto key = 0; key < kKeyCount; key++)
+		{
+			const auto name = free ? 0 : GetName(entity, key);
+
+			if (m_Filed[key][index] != name)
+			{
+				File(key, index, name);
+			}
+		}
+	}
+
+	m_Frames++;
+}
+
+
+Entity* CEntityNameIndex::Search(int key, int start, const char* value)
+{
+	Entity* edicts = util::GetEntityList();
+
+	auto it = m_Names[key].find(value);
+
+	if (it == m_Names[key].end())
+	{
+		return edicts;
+	}
+
+	const auto& bucket = it->second;
+
+	for (auto position = std::upper_bound(bucket.begin(), bucket.end(), start);
+		 position != bucket.end();
+		 ++position)
+	{
+		Entity* entity = edicts + *position;
+
+		/* Still called that? */
+		if (entity->IsFree())
+		{
+			continue;
+		}
+
+		const auto name = GetName(entity, key);
+
+		if (!FStringNull(name) && strcmp(STRING(name), value) == 0)
+		{
+			return entity;
+		}
+	}
+
+	return edicts;
+}
+
+
+bool CEntityNameIndex::Find(Entity* start, const char* key, const char* value, Entity*& result)
+{
+	if (sv_entity_names.value == 0 || !IsActive() || value == nullptr)
+	{
+		return false;
+	}
+
+	int keyIndex;
+
+	if (strcmp(key, "classname") == 0)
+	{
+		keyIndex = kClassname;
+	}
+	else if (strcmp(key, "targetname") == 0)
+	{
+		keyIndex = kTargetname;
+	}
+	else
+	{
+		return false;
+	}
+
+	const int startIndex = (start != nullptr) ? start - util::GetEntityList() : 0;
+
+	const auto lookupStart = EntityNames_Seconds();
+
+	result = Search(keyIndex, startIndex, value);
+
+	const auto lookupTime = EntityNames_Seconds() - lookupStart;
+
+	m_LookupTime += lookupTime;
+	m_Lookups++;
+
+	/* Every so often, see what the engine would have made of it. */
+	if ((m_Lookups % kSampleInterval) == 0)
+	{
+		const auto engineStart = EntityNames_Seconds();
+
+		auto engineResult = engine::FindEntityByString(start, key, value);
+
+		m_SampleEngineTime += EntityNames_Seconds() - engineStart;
+		m_SampleLookupTime += lookupTime;
+		m_Samples++;
+
+		if (engineResult != result)
+		{
+			m_Mismatches++;
+			result = engineResult;
+		}
+	}
+
+	return true;
+}
+
+
+void CEntityNameIndex::PrintStats()
+{
+	if (m_Lookups == 0)
+	{
+		engine::ServerPrint("No entity name lookups yet.\n");
+		return;
+	}
+
+	const auto frames = std::max(m_Frames, 1U);
+	const auto lookupCost = m_LookupTime / m_Lookups;
+
+	engine::ServerPrint(util::VarArgs("Entity name index: %u lookups over %u frames (%.2f per frame), %.2f us per lookup\n",
+		m_Lookups, frames, m_Lookups / static_cast<float>(frames), 1000000.0 * lookupCost));
+
+	if (m_Samples != 0)
+	{
+		const auto engineCost = m_SampleEngineTime / m_Samples;
+		const auto sampleCost = m_SampleLookupTime / m_Samples;
+
+		engine::ServerPrint(util::VarArgs("  engine search %.2f us per lookup (%u samples), about %.2f ms saved, %u mismatches\n",
+			1000000.0 * engineCost, m_Samples, 1000.0 * (engineCost - sampleCost) * m_Lookups, m_Mismatches));
+	}
+
+	std::size_t names = 0;
+	for (auto key = 0; key < kKeyCount; key++)
+	{
+		names += m_Names[key].size();
+	}
+	engine::ServerPrint(util::VarArgs("  %u distinct names filed\n", static_cast<unsigned int>(names)));
+
+	m_Frames = 0;
+	m_Lookups = 0;
+	m_Samples = 0;
+	m_Mismatches = 0;
+	m_LookupTime = 0.0;
+	m_SampleLookupTime = 0.0;
+	m_SampleEngineTime = 0.0;
+}
+
+
+void EntityNames_PrintStats()
+{
+	g_EntityNames.PrintStats();
+}
@@ -0,0 +1,84 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Index of entities by classname & targetname
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+/*
+Entities filed under the contents of their classname and targetname, so that
+finding the next entity with a given name doesn't mean comparing the name of
+every entity. Entities are filed when they're given key values, spawned,
+linked and freed, and wherever the game code names an entity without doing
+one of those. Every entity is also checked once a frame to catch names
+changed anywhere else.
+
+Lookups only return entities whose name matches as they are now, in the
+order of the edict list, just as the engine's search does. An entity given a
+name somewhere that doesn't file it can't be found by that name until the
+next frame.
+*/
+class CEntityNameIndex
+{
+public:
+	CEntityNameIndex();
+
+	void Update(Entity* entity); // File the entity by its current names
+	void Remove(Entity* entity);
+	void Reset();
+
+	void StartFrame();
+
+	bool IsActive() const { return !m_Filed[kClassname].empty(); }
+
+	/*
+	Find the next entity after start whose key matches value. Returns false if
+	the key isn't indexed. Otherwise, result is the entity found, or the world
+	if there wasn't one, like the engine's FindEntityByString.
+	*/
+	bool Find(Entity* start, const char* key, const char* value, Entity*& result);
+
+	void PrintStats();
+
+private:
+	enum
+	{
+		kClassname = 0,
+		kTargetname,
+		kKeyCount,
+	};
+
+	static constexpr unsigned int kSampleInterval = 64; // Time an engine search once every so many lookups
+
+	using Bucket = std::vector<unsigned short>; // Edict indices, in order
+
+	void Allocate();
+	void File(int key, int index, string_t name);
+	void Unfile(int key, int index);
+	static string_t GetName(const Entity* entity, int key);
+	Entity* Search(int key, int start, const char* value);
+
+	std::unordered_map<std::string_view, Bucket> m_Names[kKeyCount];
+	std::vector<string_t> m_Filed[kKeyCount]; // By edict index, the name each entity is filed under
+
+	unsigned int m_Frames;
+	unsigned int m_Lookups;
+	unsigned int m_Samples;
+	unsigned int m_Mismatches;
+	double m_LookupTime;
+	double m_SampleLookupTime;
+	double m_SampleEngineTime;
+};
+
+extern CEntityNameIndex g_EntityNames;
+
+extern cvar_t sv_entity_names;
+
+void EntityNames_PrintStats();
@@ -0,0 +1,292 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Per-frame cache of what AddToFullPack sends for each entity
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "fullpack_cache.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+CFullPackCache g_FullPackCache;
+
+cvar_t sv_fullpack_cache = {"sv_fullpack_cache", "1", FCVAR_SERVER};
+cvar_t sv_netlod = {"sv_netlod", "0", FCVAR_SERVER};
+cvar_t sv_netlod_distance = {"sv_netlod_distance", "2048", FCVAR_SERVER};
+cvar_t sv_netlod_rate = {"sv_netlod_rate", "4", FCVAR_SERVER};
+cvar_t sv_netlod_quantize = {"sv_netlod_quantize", "0", FCVAR_SERVER};
+
+
+CFullPackCache::CFullPackCache()
+{
+	m_Passes = 0;
+	m_Pairs = 0;
+	m_Evaluations = 0;
+
+	memset(m_ClientStats, 0, sizeof(m_ClientStats));
+}
+
+
+void CFullPackCache::Invalidate()
+{
+	m_Evaluated.reset();
+	m_SentClients.reset();
+	m_Passes++;
+}
+
+
+void CFullPackCache::SetupVisibility(Entity* client)
+{
+	const int index = client - util::GetEntityList();
+
+	if (index < 0 || index >= MAX_EDICTS)
+	{
+		return;
+	}
+
+	/* Sending to this client again means the game has run since the last pass. */
+	if (m_SentClients.test(index))
+	{
+		Invalidate();
+	}
+
+	m_SentClients.set(index);
+
+	if (index >= 1 && index <= MAX_PLAYERS)
+	{
+		m_ClientStats[index].frames++;
+	}
+}
+
+
+void CFullPackCache::EntityFreed(Entity* entity)
+{
+	const int index = entity - util::GetEntityList();
+
+	if (index >= 0 && index < MAX_EDICTS)
+	{
+		m_HeldValid.reset(index);
+	}
+}
+
+
+int CFullPackCache::DeltaBytes(const entity_state_t& from, const entity_state_t& to)
+{
+	const auto a = reinterpret_cast<const byte*>(&from);
+	const auto b = reinterpret_cast<const byte*>(&to);
+
+	int count = 0;
+
+	for (std::size_t i = 0; i < sizeof(entity_state_t); i++)
+	{
+		if (a[i] != b[i])
+		{
+			count++;
+		}
+	}
+
+	return count;
+}
+
+
+int CFullPackCache::Evaluate(int index, Entity* entity)
+{
+	m_Pairs++;
+
+	if (!m_Evaluated.test(index))
+	{
+		m_Evaluated.set(index);
+		m_Evaluations++;
+
+		auto base = entity->Get<CBaseEntity>();
+
+		m_NoEntity.set(index, base == nullptr);
+
+		if (base != nullptr)
+		{
+			m_Hidden.set(index,
+				(entity->effects & EF_NODRAW) != 0
+				|| 0 == entity->modelindex
+				|| !STRING(entity->model)
+				|| (entity->flags & FL_SPECTATOR) != 0);
+
+			const auto caps = base->ObjectCaps();
+
+			m_AlwaysSend.set(index, (caps & FCAP_NET_ALWAYS_SEND) != 0);
+			m_LowPriority.set(index, (caps & FCAP_NET_LOW_PRIORITY) != 0);
+
+			if (m_States.empty())
+			{
+				m_States.resize(MAX_EDICTS);
+				m_HeldStates.resize(MAX_EDICTS);
+				m_PreviousStates.resize(MAX_EDICTS);
+				m_HeldPass.resize(MAX_EDICTS);
+				m_DeltaBytes.resize(MAX_EDICTS);
+				m_HeldDeltaBytes.resize(MAX_EDICTS);
+			}
+
+			auto& state = m_States[index];
+
+			m_PreviousStates[index] = state;
+
+			memset(&state, 0, sizeof(entity_state_t));
+
+			// Assign index so we can track this entity from frame to frame and
+			// delta from it.
+			state.number = index;
+
+			base->GetEntityState(state);
+
+			m_DeltaBytes[index] = DeltaBytes(m_PreviousStates[index], state);
+
+			if (m_LowPriority.test(index) && sv_netlod.value != 0)
+			{
+				const auto rate = std::max(static_cast<unsigned int>(sv_netlod_rate.value), 1U);
+
+				if (!m_HeldValid.test(index))
+				{
+					m_HeldStates[index] = state;
+					m_HeldDeltaBytes[index] = m_DeltaBytes[index];
+					m_HeldValid.set(index);
+
+					/* Spread the refreshes out over the frames. */
+					m_HeldPass[index] = m_Passes - (index % rate);
+				}
+				else if (m_Passes - m_HeldPass[index] >= rate)
+				{
+					m_HeldDeltaBytes[index] = DeltaBytes(m_HeldStates[index], state);
+					m_HeldStates[index] = state;
+					m_HeldPass[index] = m_Passes;
+				}
+				else
+				{
+					m_HeldDeltaBytes[index] = 0;
+				}
+			}
+			else
+			{
+				m_HeldValid.reset(index);
+			}
+		}
+	}
+
+	int flags = 0;
+
+	if (m_NoEntity.test(index))
+		flags |= kNoEntity;
+	if (m_Hidden.test(index))
+		flags |= kHidden;
+	if (m_AlwaysSend.test(index))
+		flags |= kAlwaysSend;
+	if (m_LowPriority.test(index))
+		flags |= kLowPriority;
+
+	return flags;
+}
+
+
+void CFullPackCache::WriteState(entity_state_t* state, int index, Entity* entity, Entity* host)
+{
+	const int hostIndex = host - util::GetEntityList();
+	auto stats = (hostIndex >= 1 && hostIndex <= MAX_PLAYERS) ? &m_ClientStats[hostIndex] : nullptr;
+
+	const entity_state_t* send = &m_States[index];
+	int bytes = m_DeltaBytes[index];
+
+	if (m_HeldValid.test(index) && sv_netlod.value != 0 && entity != host)
+	{
+		const auto center = (entity->absmin + entity->absmax) * 0.5F;
+		const auto eye = host->origin + host->view_ofs;
+		const auto distance = sv_netlod_distance.value;
+
+		if ((center - eye).LengthSquared() > distance * distance)
+		{
+			send = &m_HeldStates[index];
+			bytes = m_HeldDeltaBytes[index];
+
+			if (stats != nullptr)
+			{
+				stats->held++;
+			}
+		}
+	}
+
+	memcpy(state, send, sizeof(entity_state_t));
+
+	if (stats != nullptr)
+	{
+		stats->entities++;
+
+		/* Nothing goes out for an entity that hasn't changed. */
+		if (bytes != 0)
+		{
+			stats->bytes += kEntityHeaderBytes + bytes;
+		}
+	}
+}
+
+
+void CFullPackCache::PrintStats()
+{
+	const auto shortCircuited = m_Pairs - m_Evaluations;
+
+	engine::ServerPrint(util::VarArgs("Full pack cache: %u passes, %u client/entity pairs, %u entities evaluated, %u pairs short-circuited (%.1f%%)\n",
+		m_Passes,
+		m_Pairs,
+		m_Evaluations,
+		shortCircuited,
+		(m_Pairs != 0) ? 100.0F * shortCircuited / m_Pairs : 0.0F));
+
+	m_Passes = 0;
+	m_Pairs = 0;
+	m_Evaluations = 0;
+}
+
+
+void CFullPackCache::PrintNetLODStats()
+{
+	engine::ServerPrint(util::VarArgs("Network LOD is %s (distance %g, rate %g, quantize %g)\n",
+		(sv_netlod.value != 0) ? "on" : "off",
+		sv_netlod_distance.value,
+		sv_netlod_rate.value,
+		sv_netlod_quantize.value));
+	engine::ServerPrint("  client                    entities/frame  held  est. bytes/frame\n");
+
+	for (auto i = 1; i <= gpGlobals->maxClients && i <= MAX_PLAYERS; i++)
+	{
+		auto& stats = m_ClientStats[i];
+
+		if (stats.frames == 0)
+		{
+			continue;
+		}
+
+		auto player = util::PlayerByIndex(i);
+
+		engine::ServerPrint(util::VarArgs("  %-24.24s %15.1f %4.0f%% %17.1f\n",
+			(player != nullptr) ? STRING(player->v.netname) : "",
+			stats.entities / static_cast<float>(stats.frames),
+			(stats.entities != 0) ? 100.0F * stats.held / stats.entities : 0.0F,
+			stats.bytes / static_cast<float>(stats.frames)));
+	}
+
+	memset(m_ClientStats, 0, sizeof(m_ClientStats));
+}
+
+
+void FullPackCache_PrintStats()
+{
+	g_FullPackCache.PrintStats();
+}
+
+
+void FullPackCache_PrintNetLODStats()
+{
+	g_FullPackCache.PrintNetLODStats();
+}
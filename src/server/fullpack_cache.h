@@ -0,0 +1,102 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Per-frame cache of what AddToFullPack sends for each entity
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include <bitset>
+#include <vector>
+
+#include "com_model.h"
+#include "entity_state.h"
+#include "cdll_dll.h"
+
+
+/*
+The engine asks about every entity once for every client. Most of what
+decides whether an entity is sent, and all of its state, doesn't depend on
+the client, so it is worked out the first time an entity comes up in a pass
+over the clients and reused for the rest of them.
+
+The entity states are only good while nothing can change them, so the cache
+is emptied at the start of every frame, and whenever the engine starts on a
+client it has already sent to since then.
+
+With sv_netlod, low priority entities (FCAP_NET_LOW_PRIORITY) that are far
+from a client are sent as they were when last refreshed, which happens every
+sv_netlod_rate frames. Sending a client the same state again costs next to
+nothing, as the engine only sends what changed.
+*/
+class CFullPackCache
+{
+public:
+	enum
+	{
+		kNoEntity = 1,   // No private data, never sent
+		kHidden = 2,     // Only sent to its own client
+		kAlwaysSend = 4, // Sent without checking the PVS
+		kLowPriority = 8,
+	};
+
+	CFullPackCache();
+
+	void Invalidate();
+	void SetupVisibility(Entity* client);
+
+	void EntityFreed(Entity* entity);
+
+	int Evaluate(int index, Entity* entity); // Returns the flags for the entity
+	void WriteState(entity_state_t* state, int index, Entity* entity, Entity* host);
+
+	void PrintStats();
+	void PrintNetLODStats();
+
+private:
+	std::bitset<MAX_EDICTS> m_Evaluated;
+	std::bitset<MAX_EDICTS> m_NoEntity;
+	std::bitset<MAX_EDICTS> m_Hidden;
+	std::bitset<MAX_EDICTS> m_AlwaysSend;
+	std::bitset<MAX_EDICTS> m_SentClients;
+
+	std::vector<entity_state_t> m_States; // By edict index
+
+	static constexpr int kEntityHeaderBytes = 2; // Rough size of an entity in an update, before its fields
+
+	static int DeltaBytes(const entity_state_t& from, const entity_state_t& to); // Estimated
+
+	std::bitset<MAX_EDICTS> m_LowPriority;
+	std::bitset<MAX_EDICTS> m_HeldValid;
+	std::vector<entity_state_t> m_HeldStates;    // What far away clients get
+	std::vector<entity_state_t> m_PreviousStates; // From the last pass, to estimate the size of updates
+	std::vector<unsigned int> m_HeldPass;         // When the held state was last refreshed
+	std::vector<unsigned short> m_DeltaBytes;
+	std::vector<unsigned short> m_HeldDeltaBytes;
+
+	struct ClientStats
+	{
+		unsigned int frames;
+		unsigned int entities;
+		unsigned int held;
+		unsigned int bytes;
+	};
+
+	ClientStats m_ClientStats[MAX_PLAYERS + 1];
+
+	unsigned int m_Passes;
+	unsigned int m_Pairs;
+	unsigned int m_Evaluations;
+};
+
+extern CFullPackCache g_FullPackCache;
+
+extern cvar_t sv_fullpack_cache;
+extern cvar_t sv_netlod;
+extern cvar_t sv_netlod_distance;
+extern cvar_t sv_netlod_rate;
+extern cvar_t sv_netlod_quantize;
+
+void FullPackCache_PrintStats();
+void FullPackCache_PrintNetLODStats();
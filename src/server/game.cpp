@@ -23,6 +23,12 @@
 #endif
 #include "steam_utils.h"
 #include "vote_manager.h"
+#include "entity_grid.h"
+#include "lag_compensation.h"
+#include "entity_names.h"
+#include "fullpack_cache.h"
+#include "pm_defs.h"
+#include "pm_record.h"
 
 // multiplayer server rules
 cvar_t teamplay = {"mp_teamplay", "0", FCVAR_SERVER};
@@ -43,6 +49,8 @@ cvar_t allow_spectators = {"allow_spectators", "1", FCVAR_SERVER};
 
 cvar_t mp_chattime = {"mp_chattime", "10", FCVAR_SERVER};
 
+cvar_t sv_bullet_broadphase = {"sv_bullet_broadphase", "1", FCVAR_SERVER};
+
 static bool SV_InitServer()
 {
 	if (!Steam_LoadSteamAPI())
@@ -102,6 +110,28 @@ void GameDLLInit()
 
 	engine::CVarRegister(&mp_chattime);
 
+	engine::CVarRegister(&sv_bullet_broadphase);
+	engine::AddServerCommand("sv_bullet_stats", FireBullets_PrintStats);
+
+	engine::CVarRegister(&sv_unlag_timing);
+
+	engine::CVarRegister(&sv_entity_grid);
+	engine::AddServerCommand("sv_entity_grid_bench", EntityGrid_Benchmark);
+
+	engine::CVarRegister(&sv_entity_names);
+	engine::AddServerCommand("sv_entity_names_stats", EntityNames_PrintStats);
+
+	engine::CVarRegister(&sv_fullpack_cache);
+	engine::AddServerCommand("sv_fullpack_stats", FullPackCache_PrintStats);
+
+	engine::CVarRegister(&sv_netlod);
+	engine::CVarRegister(&sv_netlod_distance);
+	engine::CVarRegister(&sv_netlod_rate);
+	engine::CVarRegister(&sv_netlod_quantize);
+	engine::AddServerCommand("sv_netlod_stats", FullPackCache_PrintNetLODStats);
+
+	engine::AddServerCommand("sv_pm_record", PM_RecordCommand);
+
 	CVoteManager::RegisterCvars();
 
 #ifdef HALFLIFE_BOTS
@@ -115,6 +145,7 @@ void GameDLLInit()
 
 void GameDLLShutdown()
 {
+	PM_RecordStop();
 	FileSystem_FreeFileSystem();
 	Steam_FreeSteamAPI();
 }
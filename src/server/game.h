@@ -36,6 +36,9 @@ extern cvar_t allowmonsters;
 extern cvar_t allow_spectators;
 extern cvar_t mp_chattime;
 
+extern cvar_t sv_bullet_broadphase;
+void FireBullets_PrintStats();
+
 // Engine Cvars
 inline cvar_t* g_psv_cheats;
 inline cvar_t* sv_unlag;
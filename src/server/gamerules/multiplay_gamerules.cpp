@@ -961,9 +961,12 @@ CSpawnPoint *CHalfLifeMultiplay::GetPlayerSpawnSpot(CBasePlayer* pPlayer)
 	}
 
 	/* Telefrag! */
-	CBaseEntity *entity = nullptr;
-	while ((entity = util::FindEntityInSphere(entity, spawn->m_origin, 128.0F)) != nullptr)
+	CBaseEntity *list[1024];
+	const int count = util::EntitiesInSphere(list, ARRAYSIZE(list), spawn->m_origin, 128.0F);
+	for (int i = 0; i < count; i++)
 	{
+		CBaseEntity *entity = list[i];
+
 		if (entity->IsPlayer() && entity != pPlayer)
 		{
 			if (FPlayerCanTakeDamage((CBasePlayer *)entity, pPlayer))
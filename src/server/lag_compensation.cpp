@@ -0,0 +1,398 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Rewinding players for hitscan attacks
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+#include "game.h"
+#include "lag_compensation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+
+CLagCompensation g_LagCompensation;
+
+cvar_t sv_unlag_timing = {"sv_unlag_timing", "0", FCVAR_SERVER};
+
+
+static double LagCompensation_Seconds()
+{
+	return std::chrono::duration<double>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+CLagCompensation::CLagCompensation()
+{
+	Reset();
+}
+
+
+void CLagCompensation::Reset()
+{
+	for (auto& history : m_History)
+	{
+		history.head = 0;
+		history.count = 0;
+		history.interpolation = 0;
+	}
+
+	std::fill(std::begin(m_Rewound), std::end(m_Rewound), false);
+	m_IsRewinding = false;
+
+	m_TimingTotal = 0.0;
+	m_TimingMax = 0.0;
+	m_TimingShots = 0;
+	m_TimingPlayers = 0;
+	m_NextTimingPrint = 0.0F;
+}
+
+
+void CLagCompensation::ClientDisconnected(const unsigned int playerIndex)
+{
+	if (playerIndex > MAX_PLAYERS)
+	{
+		return;
+	}
+
+	m_History[playerIndex].head = 0;
+	m_History[playerIndex].count = 0;
+	m_History[playerIndex].interpolation = 0;
+}
+
+
+void CLagCompensation::SetInterpolation(const unsigned int playerIndex, const int msec)
+{
+	if (playerIndex > MAX_PLAYERS)
+	{
+		return;
+	}
+
+	m_History[playerIndex].interpolation = std::max(msec, 0);
+}
+
+
+void CLagCompensation::SaveRecord(CBasePlayer* player, PlayerRecord& record)
+{
+	record.origin = player->v.origin;
+	record.angles = player->v.angles;
+	record.mins = player->v.mins;
+	record.maxs = player->v.maxs;
+	record.sequence = player->v.sequence;
+	record.gaitsequence = player->v.gaitsequence;
+	record.frame = player->v.frame;
+	record.animtime = player->v.animtime;
+	record.blending[0] = player->v.blending[0];
+	record.blending[1] = player->v.blending[1];
+}
+
+
+void CLagCompensation::ApplyRecord(CBasePlayer* player, const PlayerRecord& record)
+{
+	player->v.angles = record.angles;
+	player->v.sequence = record.sequence;
+	player->v.gaitsequence = record.gaitsequence;
+	player->v.frame = record.frame;
+	player->v.animtime = record.animtime;
+	player->v.blending[0] = record.blending[0];
+	player->v.blending[1] = record.blending[1];
+
+	/* Both of these relink the player. */
+	player->SetSize(record.mins, record.maxs);
+	player->SetOrigin(record.origin);
+}
+
+
+void CLagCompensation::RecordPlayers()
+{
+	for (auto i = 1; i <= gpGlobals->maxClients && i <= MAX_PLAYERS; i++)
+	{
+		auto& history = m_History[i];
+		auto player = static_cast<CBasePlayer*>(util::PlayerByIndex(i));
+
+		if (player == nullptr)
+		{
+			history.count = 0;
+			continue;
+		}
+
+		history.head = (history.head + 1) & (kHistorySize - 1);
+		history.count = std::min(history.count + 1, kHistorySize);
+
+		auto& record = history.records[history.head];
+		record.time = gpGlobals->time;
+		record.valid = player->IsPlayer() && player->IsAlive() && player->v.solid != SOLID_NOT;
+
+		if (record.valid)
+		{
+			SaveRecord(player, record);
+		}
+	}
+
+	if (sv_unlag_timing.value != 0 && gpGlobals->time >= m_NextTimingPrint)
+	{
+		PrintTiming();
+		m_NextTimingPrint = gpGlobals->time + 5.0F;
+	}
+}
+
+
+static float LagCompensation_LerpAngle(float from, float to, float fraction)
+{
+	float delta = to - from;
+
+	if (delta > 180.0F)
+	{
+		delta -= 360.0F;
+	}
+	else if (delta < -180.0F)
+	{
+		delta += 360.0F;
+	}
+
+	return from + delta * fraction;
+}
+
+
+bool CLagCompensation::FindRecord(const PlayerHistory& history, const float time, PlayerRecord& record) const
+{
+	if (history.count == 0)
+	{
+		return false;
+	}
+
+	/* Walk back from the newest record to the first one at or before the time. */
+	const PlayerRecord* newer = nullptr;
+	const PlayerRecord* older = nullptr;
+
+	for (auto i = 0; i < history.count; i++)
+	{
+		const auto& current = history.records[(history.head - i) & (kHistorySize - 1)];
+
+		if (current.time <= time)
+		{
+			older = &current;
+			break;
+		}
+
+		newer = &current;
+	}
+
+	/* Asked for a time before the oldest record; that is as far back as we go. */
+	if (older == nullptr)
+	{
+		older = newer;
+		newer = nullptr;
+	}
+
+	if (!older->valid)
+	{
+		return false;
+	}
+
+	if (newer == nullptr || !newer->valid || newer->time <= older->time)
+	{
+		record = *older;
+		return true;
+	}
+
+	const float fraction = (time - older->time) / (newer->time - older->time);
+
+	/* Don't drag the player across the map if they teleported or respawned. */
+	if ((newer->origin - older->origin).LengthSquared() > kTeleportDistance * kTeleportDistance)
+	{
+		record = (fraction < 0.5F) ? *older : *newer;
+		return true;
+	}
+
+	record = *older;
+	record.time = time;
+	record.origin = older->origin + (newer->origin - older->origin) * fraction;
+	record.mins = older->mins + (newer->mins - older->mins) * fraction;
+	record.maxs = older->maxs + (newer->maxs - older->maxs) * fraction;
+
+	for (auto j = 0; j < 3; j++)
+	{
+		record.angles[j] = LagCompensation_LerpAngle(older->angles[j], newer->angles[j], fraction);
+	}
+
+	/* Animation can only be blended within the same cycle of the same sequence. */
+	if (newer->sequence == older->sequence && newer->frame >= older->frame)
+	{
+		record.frame = older->frame + (newer->frame - older->frame) * fraction;
+		record.animtime = older->animtime + (newer->animtime - older->animtime) * fraction;
+		record.blending[0] = static_cast<byte>(older->blending[0] + (newer->blending[0] - older->blending[0]) * fraction);
+		record.blending[1] = static_cast<byte>(older->blending[1] + (newer->blending[1] - older->blending[1]) * fraction);
+	}
+	else if (fraction >= 0.5F)
+	{
+		record.sequence = newer->sequence;
+		record.gaitsequence = newer->gaitsequence;
+		record.frame = newer->frame;
+		record.animtime = newer->animtime;
+		record.blending[0] = newer->blending[0];
+		record.blending[1] = newer->blending[1];
+	}
+
+	return true;
+}
+
+
+bool CLagCompensation::StartRewind(CBasePlayer* shooter)
+{
+	if (m_IsRewinding || shooter == nullptr || sv_unlag == nullptr || sv_unlag->value == 0)
+	{
+		return false;
+	}
+
+	if ((shooter->v.flags & FL_FAKECLIENT) != 0)
+	{
+		return false;
+	}
+
+	/* Respect the player's choice, as the engine did. */
+	const auto lc = engine::InfoKeyValue(engine::GetInfoKeyBuffer(&shooter->v), "cl_lc");
+	if (lc[0] != '\0' && atoi(lc) == 0)
+	{
+		return false;
+	}
+
+	const auto shooterIndex = shooter->v.GetIndex();
+	if (shooterIndex < 1 || shooterIndex > MAX_PLAYERS)
+	{
+		return false;
+	}
+
+	const auto start = LagCompensation_Seconds();
+
+	float latency = (shooter->m_netPing + m_History[shooterIndex].interpolation) / 1000.0F;
+	latency = std::clamp(latency, 0.0F, sv_maxunlag->value);
+
+	if (latency <= 0.0F)
+	{
+		return false;
+	}
+
+	const float targetTime = gpGlobals->time - latency;
+	auto rewound = 0;
+
+	m_IsRewinding = true;
+
+	for (auto i = 1; i <= gpGlobals->maxClients && i <= MAX_PLAYERS; i++)
+	{
+		m_Rewound[i] = false;
+
+		if (i == shooterIndex)
+		{
+			continue;
+		}
+
+		auto player = static_cast<CBasePlayer*>(util::PlayerByIndex(i));
+
+		if (player == nullptr
+		 || !player->IsPlayer()
+		 || !player->IsAlive()
+		 || player->v.solid == SOLID_NOT)
+		{
+			continue;
+		}
+
+		PlayerRecord record;
+		if (!FindRecord(m_History[i], targetTime, record))
+		{
+			continue;
+		}
+
+		SaveRecord(player, m_Restore[i]);
+		ApplyRecord(player, record);
+
+		m_Rewound[i] = true;
+		rewound++;
+	}
+
+	m_TimingPlayers += rewound;
+	m_RewindCost = LagCompensation_Seconds() - start;
+
+	return true;
+}
+
+
+void CLagCompensation::FinishRewind()
+{
+	if (!m_IsRewinding)
+	{
+		return;
+	}
+
+	const auto start = LagCompensation_Seconds();
+
+	for (auto i = 1; i <= gpGlobals->maxClients && i <= MAX_PLAYERS; i++)
+	{
+		if (!m_Rewound[i])
+		{
+			continue;
+		}
+
+		m_Rewound[i] = false;
+
+		auto player = static_cast<CBasePlayer*>(util::PlayerByIndex(i));
+
+		if (player == nullptr)
+		{
+			continue;
+		}
+
+		/*
+		If the attack killed them, Killed() has already started their death
+		animation, so that stays and only their angles, size and position go back.
+		*/
+		if (!player->IsAlive())
+		{
+			player->v.angles = m_Restore[i].angles;
+
+			/* Both of these relink the player. */
+			player->SetSize(m_Restore[i].mins, m_Restore[i].maxs);
+			player->SetOrigin(m_Restore[i].origin);
+			continue;
+		}
+
+		ApplyRecord(player, m_Restore[i]);
+	}
+
+	m_IsRewinding = false;
+
+	/* The attack itself isn't counted, only moving the players there and back. */
+	const auto cost = m_RewindCost + (LagCompensation_Seconds() - start);
+
+	m_TimingTotal += cost;
+	m_TimingMax = std::max(m_TimingMax, cost);
+	m_TimingShots++;
+}
+
+
+void CLagCompensation::PrintTiming()
+{
+	if (m_TimingShots == 0)
+	{
+		return;
+	}
+
+	engine::ServerPrint(
+		util::VarArgs("Lag compensation: %u attacks, %.2f us average, %.2f us worst, %.1f players rewound per attack\n",
+			m_TimingShots,
+			1000000.0 * m_TimingTotal / m_TimingShots,
+			1000000.0 * m_TimingMax,
+			m_TimingPlayers / static_cast<float>(m_TimingShots)));
+
+	m_TimingTotal = 0.0;
+	m_TimingMax = 0.0;
+	m_TimingShots = 0;
+	m_TimingPlayers = 0;
+}
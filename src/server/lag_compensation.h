@@ -0,0 +1,106 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Rewinding players for hitscan attacks
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include "cdll_dll.h"
+
+class CBasePlayer;
+
+
+/*
+Every server frame, the state of each player that hitboxes depend on is
+written to a fixed ring of records. When a player attacks, the others are
+moved back to where that player saw them, their latency plus interpolation
+ago (no more than sv_maxunlag), and put back once the attack is done.
+*/
+class CLagCompensation
+{
+public:
+	CLagCompensation();
+
+	void Reset();
+	void ClientDisconnected(const unsigned int playerIndex);
+
+	void SetInterpolation(const unsigned int playerIndex, const int msec);
+
+	void RecordPlayers(); // Called at the start of every server frame
+
+	bool StartRewind(CBasePlayer* shooter); // Returns false if this attack isn't compensated
+	void FinishRewind();
+
+	void PrintTiming();
+
+private:
+	static constexpr int kHistorySize = 128; // Power of two
+	static constexpr float kTeleportDistance = 64.0F;
+
+	struct PlayerRecord
+	{
+		float time;
+		Vector origin;
+		Vector angles;
+		Vector mins;
+		Vector maxs;
+		int sequence;
+		int gaitsequence;
+		float frame;
+		float animtime;
+		byte blending[2];
+		bool valid;
+	};
+
+	struct PlayerHistory
+	{
+		PlayerRecord records[kHistorySize];
+		int head; // Newest record
+		int count;
+		int interpolation; // Milliseconds
+	};
+
+	static void SaveRecord(CBasePlayer* player, PlayerRecord& record);
+	static void ApplyRecord(CBasePlayer* player, const PlayerRecord& record);
+	bool FindRecord(const PlayerHistory& history, const float time, PlayerRecord& record) const;
+
+	PlayerHistory m_History[MAX_PLAYERS + 1];
+
+	PlayerRecord m_Restore[MAX_PLAYERS + 1];
+	bool m_Rewound[MAX_PLAYERS + 1];
+	bool m_IsRewinding;
+
+	double m_RewindCost; // Of the attack in progress
+	double m_TimingTotal;
+	double m_TimingMax;
+	unsigned int m_TimingShots;
+	unsigned int m_TimingPlayers;
+	float m_NextTimingPrint;
+};
+
+extern CLagCompensation g_LagCompensation;
+
+extern cvar_t sv_unlag_timing;
+
+
+/* Rewinds the players for as long as it is in scope. */
+class CLagCompensationScope
+{
+public:
+	CLagCompensationScope(CBasePlayer* shooter) : m_Started{g_LagCompensation.StartRewind(shooter)} {}
+	~CLagCompensationScope() { Restore(); }
+
+	void Restore()
+	{
+		if (m_Started)
+		{
+			g_LagCompensation.FinishRewind();
+			m_Started = false;
+		}
+	}
+
+private:
+	bool m_Started;
+};
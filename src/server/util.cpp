@@ -30,6 +30,8 @@
 #include "gamerules.h"
 #include "UserMessages.h"
 #include "game.h"
+#include "entity_grid.h"
+#include "entity_names.h"
 
 #include <algorithm>
 
@@ -253,6 +255,9 @@ Vector util::VecToAngles(const Vector& vec)
 
 int util::EntitiesInBox(CBaseEntity** pList, int listMax, const Vector& mins, const Vector& maxs, int flagMask, bool checkSolid)
 {
+	if (sv_entity_grid.value != 0 && g_EntityGrid.IsActive())
+		return g_EntityGrid.EntitiesInBox(pList, listMax, mins, maxs, flagMask, checkSolid);
+
 	Entity* pEdict = util::GetEntityList();
 	CBaseEntity* pEntity;
 	int count;
@@ -301,6 +306,9 @@ int util::EntitiesInBox(CBaseEntity** pList, int listMax, const Vector& mins, co
 
 int util::MonstersInSphere(CBaseEntity** pList, int listMax, const Vector& center, float radius)
 {
+	if (sv_entity_grid.value != 0 && g_EntityGrid.IsActive())
+		return g_EntityGrid.MonstersInSphere(pList, listMax, center, radius);
+
 	Entity* pEdict = util::GetEntityList();
 	CBaseEntity* pEntity;
 	int count;
@@ -364,17 +372,29 @@ int util::MonstersInSphere(CBaseEntity** pList, int listMax, const Vector& cente
 }
 
 
+// Use the name index for the keys it has, otherwise have the engine search every entity
+static Entity* FindEntityByString(Entity* start, const char* key, const char* value)
+{
+	Entity* result;
+
+	if (g_EntityNames.Find(start, key, value, result))
+		return result;
+
+	return engine::FindEntityByString(start, key, value);
+}
+
+
 util::EntityIterator::EntityIterator(const char* key, const char* value, CBaseEntity* start)
 {
 	_key = key;
 	_value = value;
 	_start = (start != nullptr) ? &start->v : &CWorld::World->v;
-	_current = engine::FindEntityByString(_start, _key, _value);
+	_current = FindEntityByString(_start, _key, _value);
 }
 
 void util::EntityIterator::operator++()
 {
-	_current = engine::FindEntityByString(_current, _key, _value);
+	_current = FindEntityByString(_current, _key, _value);
 }
 
 util::EntityIterator::operator bool()
@@ -385,6 +405,9 @@ util::EntityIterator::operator bool()
 
 CBaseEntity* util::FindEntityInSphere(CBaseEntity* pStartEntity, const Vector& vecCenter, float flRadius)
 {
+	if (sv_entity_grid.value != 0 && g_EntityGrid.IsActive())
+		return g_EntityGrid.FindEntityInSphere(pStartEntity, vecCenter, flRadius);
+
 	Entity* pentEntity;
 
 	if (pStartEntity)
@@ -400,6 +423,24 @@ CBaseEntity* util::FindEntityInSphere(CBaseEntity* pStartEntity, const Vector& v
 }
 
 
+int util::EntitiesInSphere(CBaseEntity** pList, int listMax, const Vector& center, float radius)
+{
+	if (sv_entity_grid.value != 0 && g_EntityGrid.IsActive())
+		return g_EntityGrid.EntitiesInSphere(pList, listMax, center, radius);
+
+	int count = 0;
+	CBaseEntity* pEntity = nullptr;
+
+	while (count < listMax && (pEntity = util::FindEntityInSphere(pEntity, center, radius)) != nullptr)
+	{
+		pList[count] = pEntity;
+		count++;
+	}
+
+	return count;
+}
+
+
 CBaseEntity* util::FindEntityByString(CBaseEntity* pStartEntity, const char* szKeyword, const char* szValue)
 {
 	Entity* entity = nullptr;
@@ -409,7 +450,7 @@ CBaseEntity* util::FindEntityByString(CBaseEntity* pStartEntity, const char* szK
 		entity = &pStartEntity->v;
 	}
 
-	entity = engine::FindEntityByString(entity, szKeyword, szValue);
+	entity = FindEntityByString(entity, szKeyword, szValue);
 
 	if (entity != nullptr && engine::EntOffsetOfPEntity(entity) != 0)
 	{
@@ -582,6 +623,54 @@ void util::ScreenShakeAll(const Vector& center, float amplitude, float frequency
 }
 
 
+#define MAX_LIGHTSTYLES 64
+#define MAX_LIGHTSTYLE_LENGTH 64
+
+static char g_LightStyles[MAX_LIGHTSTYLES][MAX_LIGHTSTYLE_LENGTH];
+
+static void SendLightStyle(CBaseEntity* pPlayer, int style)
+{
+	MessageBegin(MSG_ONE, gmsgLightStyle, pPlayer);
+	WriteByte(style);
+	WriteString(g_LightStyles[style]);
+	MessageEnd();
+}
+
+void util::LightStyle(int style, const char* value)
+{
+	engine::LightStyle(style, value);
+
+	if (style < 0 || style >= MAX_LIGHTSTYLES)
+		return;
+
+	strncpy(g_LightStyles[style], value, MAX_LIGHTSTYLE_LENGTH - 1);
+	g_LightStyles[style][MAX_LIGHTSTYLE_LENGTH - 1] = '\0';
+
+	// Players who join later are sent every style when their HUD is initialized
+	for (int i = 1; i <= gpGlobals->maxClients; i++)
+	{
+		CBaseEntity* pPlayer = util::PlayerByIndex(i);
+
+		if (pPlayer && pPlayer->IsNetClient())
+			SendLightStyle(pPlayer, style);
+	}
+}
+
+void util::ResetLightStyles()
+{
+	memset(g_LightStyles, 0, sizeof(g_LightStyles));
+}
+
+void util::SendLightStyles(CBaseEntity* pPlayer)
+{
+	for (int i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		if ('\0' != g_LightStyles[i][0])
+			SendLightStyle(pPlayer, i);
+	}
+}
+
+
 static void ScreenFadeBuild(ScreenFade& fade, const Vector& color, float fadeTime, float fadeHold, int alpha, int flags)
 {
 	fade.duration = FixedUnsigned16(fadeTime, 1 << 12); // 4.12 fixed
@@ -328,6 +328,7 @@ void MakeVectors(const Vector& vecAngles);
 
 // Pass in an array of pointers and an array size, it fills the array and returns the number inserted
 int MonstersInSphere(CBaseEntity** pList, int listMax, const Vector& center, float radius);
+int EntitiesInSphere(CBaseEntity** pList, int listMax, const Vector& center, float radius); // What FindEntityInSphere finds, in one go
 int EntitiesInBox(CBaseEntity** pList, int listMax, const Vector& mins, const Vector& maxs, int flagMask, bool checkSolid = false);
 
 inline void MakeVectorsPrivate(const Vector& vecAngles, float* p_vForward, float* p_vRight, float* p_vUp)
@@ -346,6 +347,11 @@ void ShowMessageAll(const char* pString);
 void ScreenFadeAll(const Vector& color, float fadeTime, float holdTime, int alpha, int flags);
 void ScreenFade(CBaseEntity* pEntity, const Vector& color, float fadeTime, float fadeHold, int alpha, int flags);
 
+// Light styles are also sent to clients, so that they know when the world's lighting changes
+void LightStyle(int style, const char* value);
+void ResetLightStyles(); // Called on map change
+void SendLightStyles(CBaseEntity* pPlayer);
+
 enum
 {
 	kTraceIgnoreMonsters = 1,
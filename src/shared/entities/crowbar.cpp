@@ -13,6 +13,7 @@
 #include "trace.h"
 #ifdef GAME_DLL
 #include "gamerules.h"
+#include "lag_compensation.h"
 #endif
 
 
@@ -70,12 +71,18 @@ void CCrowbar::PrimaryAttack()
 	Vector end = gun + forward * 64;
 #ifdef GAME_DLL
 	int ignore = m_pPlayer->v.GetIndex();
+
+	CLagCompensationScope lagCompensation{m_pPlayer};
 #else
 	int ignore = -1; 
 #endif
 
 	Trace trace{gun, end, ignore, Trace::kBox};
 
+#ifdef GAME_DLL
+	lagCompensation.Restore();
+#endif
+
 	auto hit = kCrowbarMiss;
 	if (trace.fraction != 1.0F)
 	{
@@ -214,7 +214,11 @@ void CHalfLifeMovement::Jump()
 
     pmove->onground = -1;
 
-    player->SetAction(CBasePlayer::Action::Jump);
+    /* There is no player when moves are replayed outside of the game */
+    if (player != nullptr)
+    {
+        player->SetAction(CBasePlayer::Action::Jump);
+    }
 
     pmove->velocity.z = sqrtf(2 * 800 * 45);
 
@@ -0,0 +1,367 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Player movement recording, for replaying moves outside of the game
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+
+#include "usercmd.h"
+#include "pm_defs.h"
+#include "pm_shared.h"
+#include "pm_movevars.h"
+#include "pm_record.h"
+#include "filesystem_utils.h"
+
+#ifdef CLIENT_DLL
+#include "cl_dll.h"
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+/* Moves are gathered here and written out in blocks, to keep file writes out of most moves */
+constexpr std::size_t kRecordFlushSize = 64 * 1024;
+
+static FSFile g_RecordFile;
+static std::vector<byte> g_RecordBuffer;
+static std::string g_RecordFilename;
+static unsigned int g_RecordMoveCount = 0;
+
+/* What the next state for each player is written against, and the last movement variables written */
+static byte g_RecordState[MAX_PLAYERS][kPMRecordStateSize];
+static movevars_t g_RecordMovevars;
+static Vector g_RecordHullMins[4];
+static Vector g_RecordHullMaxs[4];
+static bool g_RecordMovevarsWritten = false;
+
+/* The move being recorded, and the engine functions we stand in for while it runs */
+static playermove_t* g_RecordMove = nullptr;
+static pmtrace_t (*g_EnginePlayerTraceEx)(float* start, float* end, int traceFlags, int (*pfnIgnore)(physent_t* pe));
+static int (*g_EngineTestPlayerPositionEx)(float* pos, pmtrace_t* ptrace, int (*pfnIgnore)(physent_t* pe));
+static int (*g_EnginePointContents)(float* p, int* truecontents);
+static void (*g_EngineStuckTouch)(int hitent, pmtrace_t* ptraceresult);
+
+
+static void PM_RecordWrite(const void* data, std::size_t size)
+{
+    const byte* bytes = static_cast<const byte*>(data);
+    g_RecordBuffer.insert(g_RecordBuffer.end(), bytes, bytes + size);
+}
+
+
+static void PM_RecordWriteTag(byte tag)
+{
+    g_RecordBuffer.push_back(tag);
+}
+
+
+/* Write the runs of bytes that differ from the reference, which then becomes this state */
+static void PM_RecordWriteState(const void* data, byte* reference)
+{
+    const byte* state = static_cast<const byte*>(data);
+    std::size_t offset = 0;
+
+    while (offset < kPMRecordStateSize)
+    {
+        if (state[offset] == reference[offset])
+        {
+            offset++;
+            continue;
+        }
+
+        std::size_t last = offset;
+        for (std::size_t end = offset + 1; end < kPMRecordStateSize && end - last <= kPMRecordRunGap; end++)
+        {
+            if (state[end] != reference[end])
+            {
+                last = end;
+            }
+        }
+
+        const unsigned short run[2] =
+        {
+            static_cast<unsigned short>(offset),
+            static_cast<unsigned short>(last + 1 - offset)
+        };
+
+        PM_RecordWrite(run, sizeof(run));
+        PM_RecordWrite(state + offset, run[1]);
+
+        offset = last + 1;
+    }
+
+    const unsigned short end[2] = {0, 0};
+    PM_RecordWrite(end, sizeof(end));
+
+    memcpy(reference, state, kPMRecordStateSize);
+}
+
+
+static void PM_RecordFlush()
+{
+    if (!g_RecordBuffer.empty())
+    {
+        g_RecordFile.Write(g_RecordBuffer.data(), g_RecordBuffer.size());
+        g_RecordBuffer.clear();
+    }
+}
+
+
+static pmtrace_t PM_RecordPlayerTraceEx(float* start, float* end, int traceFlags, int (*pfnIgnore)(physent_t* pe))
+{
+    pm_record_trace_t record;
+    record.start = start;
+    record.end = end;
+    record.traceFlags = traceFlags;
+    record.trace = g_EnginePlayerTraceEx(start, end, traceFlags, pfnIgnore);
+
+    PM_RecordWriteTag(PM_RECORD_TRACE);
+    PM_RecordWrite(&record, sizeof(record));
+
+    return record.trace;
+}
+
+
+static int PM_RecordTestPlayerPositionEx(float* pos, pmtrace_t* ptrace, int (*pfnIgnore)(physent_t* pe))
+{
+    pm_record_test_position_t record;
+    memset(&record, 0, sizeof(record));
+    record.pos = pos;
+    record.wantTrace = ptrace != nullptr;
+    record.hitent = g_EngineTestPlayerPositionEx(pos, ptrace, pfnIgnore);
+
+    if (ptrace != nullptr)
+    {
+        record.trace = *ptrace;
+    }
+
+    if (record.hitent >= 0 && record.hitent < g_RecordMove->numphysent)
+    {
+        record.hitplayer = g_RecordMove->physents[record.hitent].player;
+    }
+
+    PM_RecordWriteTag(PM_RECORD_TEST_POSITION);
+    PM_RecordWrite(&record, sizeof(record));
+
+    return record.hitent;
+}
+
+
+static int PM_RecordPointContents(float* p, int* truecontents)
+{
+    pm_record_point_contents_t record;
+    memset(&record, 0, sizeof(record));
+    record.p = p;
+    record.wantTrueContents = truecontents != nullptr;
+    record.contents = g_EnginePointContents(p, truecontents);
+
+    if (truecontents != nullptr)
+    {
+        record.truecontents = *truecontents;
+    }
+
+    PM_RecordWriteTag(PM_RECORD_POINT_CONTENTS);
+    PM_RecordWrite(&record, sizeof(record));
+
+    return record.contents;
+}
+
+
+static void PM_RecordStuckTouch(int hitent, pmtrace_t* ptraceresult)
+{
+    pm_record_stuck_touch_t record;
+    record.hitent = hitent;
+    record.trace = *ptraceresult;
+    record.numtouchbefore = g_RecordMove->numtouch;
+
+    g_EngineStuckTouch(hitent, ptraceresult);
+
+    record.numtouch = std::max(g_RecordMove->numtouch, record.numtouchbefore);
+
+    PM_RecordWriteTag(PM_RECORD_STUCK_TOUCH);
+    PM_RecordWrite(&record, sizeof(record));
+    PM_RecordWrite(
+        g_RecordMove->touchindex + record.numtouchbefore,
+        (record.numtouch - record.numtouchbefore) * sizeof(pmtrace_t));
+}
+
+
+bool PM_RecordStart(const char* filename, bool server)
+{
+    PM_RecordStop();
+
+    std::string name = filename;
+    FileSystem_FixSlashes(name);
+
+    if (!g_RecordFile.Open(name.c_str(), "wb", "GAMECONFIG"))
+    {
+        return false;
+    }
+
+    pm_record_header_t header;
+    memcpy(header.id, kPMRecordId, sizeof(header.id));
+    header.version = kPMRecordVersion;
+    header.stateSize = kPMRecordStateSize;
+    header.cmdSize = sizeof(usercmd_t);
+    header.traceSize = sizeof(pmtrace_t);
+    header.movevarsSize = sizeof(movevars_t);
+    header.server = server ? 1 : 0;
+
+    PM_RecordWrite(&header, sizeof(header));
+
+    memset(g_RecordState, 0, sizeof(g_RecordState));
+    g_RecordMovevarsWritten = false;
+
+    g_RecordFilename = name;
+    g_RecordMoveCount = 0;
+    return true;
+}
+
+
+void PM_RecordStop()
+{
+    if (!g_RecordFile.IsOpen())
+    {
+        return;
+    }
+
+    PM_RecordFlush();
+    g_RecordFile.Close();
+}
+
+
+bool PM_IsRecording()
+{
+    return g_RecordFile.IsOpen();
+}
+
+
+void PM_RecordBeginMove(playermove_t* ppmove)
+{
+    if (!g_RecordFile.IsOpen())
+    {
+        return;
+    }
+
+    g_RecordMove = ppmove;
+
+    if (!g_RecordMovevarsWritten
+     || memcmp(&g_RecordMovevars, ppmove->movevars, sizeof(g_RecordMovevars)) != 0
+     || memcmp(g_RecordHullMins, ppmove->player_mins, sizeof(g_RecordHullMins)) != 0
+     || memcmp(g_RecordHullMaxs, ppmove->player_maxs, sizeof(g_RecordHullMaxs)) != 0)
+    {
+        memcpy(&g_RecordMovevars, ppmove->movevars, sizeof(g_RecordMovevars));
+        memcpy(g_RecordHullMins, ppmove->player_mins, sizeof(g_RecordHullMins));
+        memcpy(g_RecordHullMaxs, ppmove->player_maxs, sizeof(g_RecordHullMaxs));
+        g_RecordMovevarsWritten = true;
+
+        PM_RecordWriteTag(PM_RECORD_MOVEVARS);
+        PM_RecordWrite(&g_RecordMovevars, sizeof(g_RecordMovevars));
+        PM_RecordWrite(g_RecordHullMins, sizeof(g_RecordHullMins));
+        PM_RecordWrite(g_RecordHullMaxs, sizeof(g_RecordHullMaxs));
+    }
+
+    const byte slot = PM_RecordStateSlot(ppmove->player_index);
+
+    PM_RecordWriteTag(PM_RECORD_MOVE);
+    PM_RecordWrite(&slot, sizeof(slot));
+    PM_RecordWriteState(ppmove, g_RecordState[slot]);
+    PM_RecordWrite(&ppmove->cmd, sizeof(ppmove->cmd));
+
+    const int stuckIndex = PM_GetStuckOffsetIndex(ppmove->player_index);
+    PM_RecordWrite(&stuckIndex, sizeof(stuckIndex));
+
+    g_EnginePlayerTraceEx = ppmove->PM_PlayerTraceEx;
+    g_EngineTestPlayerPositionEx = ppmove->PM_TestPlayerPositionEx;
+    g_EnginePointContents = ppmove->PM_PointContents;
+    g_EngineStuckTouch = ppmove->PM_StuckTouch;
+
+    ppmove->PM_PlayerTraceEx = PM_RecordPlayerTraceEx;
+    ppmove->PM_TestPlayerPositionEx = PM_RecordTestPlayerPositionEx;
+    ppmove->PM_PointContents = PM_RecordPointContents;
+    ppmove->PM_StuckTouch = PM_RecordStuckTouch;
+}
+
+
+void PM_RecordEndMove(playermove_t* ppmove)
+{
+    if (g_RecordMove != ppmove)
+    {
+        return;
+    }
+
+    ppmove->PM_PlayerTraceEx = g_EnginePlayerTraceEx;
+    ppmove->PM_TestPlayerPositionEx = g_EngineTestPlayerPositionEx;
+    ppmove->PM_PointContents = g_EnginePointContents;
+    ppmove->PM_StuckTouch = g_EngineStuckTouch;
+    g_RecordMove = nullptr;
+
+    PM_RecordWriteTag(PM_RECORD_END);
+    PM_RecordWriteState(ppmove, g_RecordState[PM_RecordStateSlot(ppmove->player_index)]);
+    PM_RecordWrite(&ppmove->numtouch, sizeof(ppmove->numtouch));
+    PM_RecordWrite(ppmove->touchindex, ppmove->numtouch * sizeof(pmtrace_t));
+
+    const int stuckIndex = PM_GetStuckOffsetIndex(ppmove->player_index);
+    PM_RecordWrite(&stuckIndex, sizeof(stuckIndex));
+
+    g_RecordMoveCount++;
+
+    if (g_RecordBuffer.size() >= kRecordFlushSize)
+    {
+        PM_RecordFlush();
+    }
+}
+
+
+void PM_RecordCommand()
+{
+#ifdef CLIENT_DLL
+    const bool server = false;
+    const int argc = client::Cmd_Argc();
+    const char* arg = argc > 1 ? client::Cmd_Argv(1) : nullptr;
+#else
+    const bool server = true;
+    const int argc = engine::Cmd_Argc();
+    const char* arg = argc > 1 ? engine::Cmd_Argv(1) : nullptr;
+#endif
+
+    if (arg == nullptr)
+    {
+        if (PM_IsRecording())
+        {
+            pmove->Con_Printf("Recording player movement to %s (%u moves)\n", g_RecordFilename.c_str(), g_RecordMoveCount);
+        }
+        else
+        {
+            pmove->Con_Printf("Usage: %s <filename> | stop\n", server ? "sv_pm_record" : "cl_pm_record");
+        }
+        return;
+    }
+
+    if (stricmp(arg, "stop") == 0)
+    {
+        if (PM_IsRecording())
+        {
+            PM_RecordStop();
+            pmove->Con_Printf("Recorded %u moves to %s\n", g_RecordMoveCount, g_RecordFilename.c_str());
+        }
+        return;
+    }
+
+    if (PM_RecordStart(arg, server))
+    {
+        pmove->Con_Printf("Recording player movement to %s\n", g_RecordFilename.c_str());
+    }
+    else
+    {
+        pmove->Con_Printf("Couldn't open %s for writing\n", arg);
+    }
+}
@@ -0,0 +1,112 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Player movement recording, for replaying moves outside of the game
+//
+// $NoKeywords: $
+//=============================================================================
+
+#pragma once
+
+#include <cstddef>
+
+#include "cdll_dll.h"
+
+/*
+A recording is a header followed by one record per move:
+
+    PM_RECORD_MOVEVARS, the movement variables and hull sizes, only when they have changed
+    PM_RECORD_MOVE, which player's last state this one is written against, then the state, command and stuck offset
+    then one record for each question the movement code asked of the engine, in the order asked:
+        PM_RECORD_TRACE, PM_RECORD_TEST_POSITION, PM_RECORD_POINT_CONTENTS or PM_RECORD_STUCK_TOUCH
+    PM_RECORD_END, the player state and touched entities after the move, and the stuck offset
+
+Player states are written as the runs of bytes that differ from the last state
+written for the same player, which, for the state after a move, is the one
+before it. Each run is an unsigned short offset and length, followed by the
+bytes, and a run of length 0 ends the state.
+
+Everything is written as it is laid out in memory, so a recording can only be
+replayed by a build for the same platform (pm_replay checks the sizes in the header).
+*/
+
+constexpr char kPMRecordId[4] = {'H', 'L', 'P', 'M'};
+constexpr int kPMRecordVersion = 1;
+
+/* Unchanged bytes this close together are written as part of one run, which is cheaper than starting another */
+constexpr std::size_t kPMRecordRunGap = 4;
+
+/* The player state is everything in playermove_t ahead of the physents */
+constexpr std::size_t kPMRecordStateSize = offsetof(playermove_t, numphysent);
+
+typedef struct pm_record_header_s
+{
+    char id[4];
+    int version;
+    int stateSize;	  // kPMRecordStateSize
+    int cmdSize;	  // sizeof(usercmd_t)
+    int traceSize;	  // sizeof(pmtrace_t)
+    int movevarsSize; // sizeof(movevars_t)
+    qboolean server;  // recorded by the server, rather than client prediction
+} pm_record_header_t;
+
+/* Which of the last states written a player's next state is written against */
+inline int PM_RecordStateSlot(int playerIndex)
+{
+    return (playerIndex >= 0 && playerIndex < MAX_PLAYERS) ? playerIndex : 0;
+}
+
+enum
+{
+    PM_RECORD_MOVEVARS = 1,
+    PM_RECORD_MOVE,
+    PM_RECORD_END,
+    PM_RECORD_TRACE,
+    PM_RECORD_TEST_POSITION,
+    PM_RECORD_POINT_CONTENTS,
+    PM_RECORD_STUCK_TOUCH,
+};
+
+typedef struct pm_record_trace_s
+{
+    Vector start;
+    Vector end;
+    int traceFlags;
+    pmtrace_t trace;
+} pm_record_trace_t;
+
+typedef struct pm_record_test_position_s
+{
+    Vector pos;
+    qboolean wantTrace; // the caller asked for the trace
+    int hitent;
+    pmtrace_t trace;
+    int hitplayer; // physents[hitent].player, which the server checks when unsticking
+} pm_record_test_position_t;
+
+typedef struct pm_record_point_contents_s
+{
+    Vector p;
+    qboolean wantTrueContents;
+    int contents;
+    int truecontents;
+} pm_record_point_contents_t;
+
+/* Followed by the touches the engine added, touchindex[numtouchbefore] up to touchindex[numtouch] */
+typedef struct pm_record_stuck_touch_s
+{
+    int hitent;
+    pmtrace_t trace;
+    int numtouchbefore;
+    int numtouch;
+} pm_record_stuck_touch_t;
+
+bool PM_RecordStart(const char* filename, bool server);
+void PM_RecordStop();
+bool PM_IsRecording();
+
+/* Call around each CGameMovement::Move to record it, if a recording is running */
+void PM_RecordBeginMove(playermove_t* ppmove);
+void PM_RecordEndMove(playermove_t* ppmove);
+
+/* Console command: <prefix>_pm_record [filename | stop] */
+void PM_RecordCommand();
@@ -0,0 +1,739 @@
+//========= Copyright © 1996-2002, Valve LLC, All rights reserved. ============
+//
+// Purpose: Replay recorded player movement outside of the game
+//
+// $NoKeywords: $
+//=============================================================================
+
+#include "extdll.h"
+#include "util.h"
+#include "cbase.h"
+#include "player.h"
+
+#include "usercmd.h"
+#include "pm_defs.h"
+#include "pm_shared.h"
+#include "pm_movevars.h"
+#include "pm_record.h"
+#include "gamemovement.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <vector>
+
+
+/*
+The movement code runs against the answers recorded by the engine, so each move
+has to ask exactly the same questions in exactly the same order to stay on the
+recording. Anything else, or any difference in the state left afterwards, is a
+divergence: either the movement code has changed its behaviour, or the build
+that recorded the moves (the client's prediction, say) doesn't move the player
+the way this one, built as the server, does.
+*/
+
+typedef struct
+{
+    byte type;
+    const byte* data;
+} ReplayCall;
+
+typedef struct
+{
+    movevars_t movevars;
+    Vector player_mins[4];
+    Vector player_maxs[4];
+} ReplayMovevars;
+
+typedef struct
+{
+    std::size_t offset; // in the recording, for finding the move again
+    byte input[kPMRecordStateSize];
+    usercmd_t cmd;
+    const ReplayMovevars* movevars;
+    int stuckIndex;
+    std::vector<ReplayCall> calls;
+    byte output[kPMRecordStateSize];
+    int numtouch;
+    const byte* touchindex;
+    int stuckIndexAfter;
+} ReplayMove;
+
+static std::vector<byte> g_Recording;
+static std::vector<ReplayMove> g_Moves;
+static std::deque<ReplayMovevars> g_Movevars; // moves point at these, so they must stay put
+
+static playermove_t g_ReplayMove;
+static const ReplayMove* g_CurrentMove = nullptr;
+static std::size_t g_CurrentCall = 0;
+static std::string g_Divergence;
+
+
+/* Name the parts of the player state most worth knowing about when they differ */
+typedef struct
+{
+    const char* name;
+    std::size_t offset;
+    std::size_t size;
+} ReplayField;
+
+#define REPLAY_FIELD(name) {#name, offsetof(playermove_t, name), sizeof(playermove_t::name)}
+
+static const ReplayField g_ReplayFields[] =
+{
+    REPLAY_FIELD(origin),
+    REPLAY_FIELD(velocity),
+    REPLAY_FIELD(basevelocity),
+    REPLAY_FIELD(angles),
+    REPLAY_FIELD(view_ofs),
+    REPLAY_FIELD(onground),
+    REPLAY_FIELD(flags),
+    REPLAY_FIELD(movetype),
+    REPLAY_FIELD(waterlevel),
+    REPLAY_FIELD(watertype),
+    REPLAY_FIELD(flFallVelocity),
+    REPLAY_FIELD(friction),
+    REPLAY_FIELD(maxspeed),
+    REPLAY_FIELD(frametime),
+    REPLAY_FIELD(forward),
+    REPLAY_FIELD(right),
+    REPLAY_FIELD(up),
+};
+
+
+static void ReplayDiverged(const char* format, ...)
+{
+    /* The first difference is the one that matters, the rest follow from it */
+    if (!g_Divergence.empty())
+    {
+        return;
+    }
+
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    g_Divergence = buffer;
+}
+
+
+static bool ReplayVectorsMatch(const Vector& a, const float* b)
+{
+    return memcmp(&a, b, sizeof(Vector)) == 0;
+}
+
+
+/* Return the next recorded answer, if it is the kind being asked for */
+static const byte* ReplayNextCall(byte type, const char* name)
+{
+    if (g_CurrentCall >= g_CurrentMove->calls.size())
+    {
+        ReplayDiverged("asked for an extra %s after %d calls", name, static_cast<int>(g_CurrentCall));
+        return nullptr;
+    }
+
+    const ReplayCall& call = g_CurrentMove->calls[g_CurrentCall];
+    if (call.type != type)
+    {
+        ReplayDiverged("call %d was a %s instead of the recorded call type %d", static_cast<int>(g_CurrentCall), name, call.type);
+        return nullptr;
+    }
+
+    g_CurrentCall++;
+    return call.data;
+}
+
+
+static pmtrace_t ReplayPlayerTraceEx(float* start, float* end, int traceFlags, int (*pfnIgnore)(physent_t* pe))
+{
+    const int callNumber = static_cast<int>(g_CurrentCall);
+    const byte* data = ReplayNextCall(PM_RECORD_TRACE, "trace");
+
+    pm_record_trace_t record;
+    if (data == nullptr)
+    {
+        memset(&record.trace, 0, sizeof(record.trace));
+        record.trace.fraction = 1.0F;
+        record.trace.endpos = end;
+        record.trace.ent = -1;
+        return record.trace;
+    }
+
+    memcpy(&record, data, sizeof(record));
+
+    if (!ReplayVectorsMatch(record.start, start)
+     || !ReplayVectorsMatch(record.end, end)
+     || record.traceFlags != traceFlags)
+    {
+        ReplayDiverged("trace %d went from (%.9g %.9g %.9g) to (%.9g %.9g %.9g), but was recorded from (%.9g %.9g %.9g) to (%.9g %.9g %.9g)",
+            callNumber,
+            start[0], start[1], start[2], end[0], end[1], end[2],
+            record.start.x, record.start.y, record.start.z, record.end.x, record.end.y, record.end.z);
+    }
+
+    return record.trace;
+}
+
+
+static int ReplayTestPlayerPositionEx(float* pos, pmtrace_t* ptrace, int (*pfnIgnore)(physent_t* pe))
+{
+    const int callNumber = static_cast<int>(g_CurrentCall);
+    const byte* data = ReplayNextCall(PM_RECORD_TEST_POSITION, "position test");
+
+    if (data == nullptr)
+    {
+        return -1;
+    }
+
+    pm_record_test_position_t record;
+    memcpy(&record, data, sizeof(record));
+
+    if (!ReplayVectorsMatch(record.pos, pos))
+    {
+        ReplayDiverged("position test %d was at (%.9g %.9g %.9g), but was recorded at (%.9g %.9g %.9g)",
+            callNumber, pos[0], pos[1], pos[2], record.pos.x, record.pos.y, record.pos.z);
+    }
+
+    if (ptrace != nullptr)
+    {
+        *ptrace = record.trace;
+    }
+
+    if (record.hitent >= 0 && record.hitent < MAX_PHYSENTS)
+    {
+        g_ReplayMove.physents[record.hitent].player = record.hitplayer;
+    }
+
+    return record.hitent;
+}
+
+
+static int ReplayPointContents(float* p, int* truecontents)
+{
+    const int callNumber = static_cast<int>(g_CurrentCall);
+    const byte* data = ReplayNextCall(PM_RECORD_POINT_CONTENTS, "point contents");
+
+    if (data == nullptr)
+    {
+        if (truecontents != nullptr)
+        {
+            *truecontents = CONTENTS_EMPTY;
+        }
+        return CONTENTS_EMPTY;
+    }
+
+    pm_record_point_contents_t record;
+    memcpy(&record, data, sizeof(record));
+
+    if (!ReplayVectorsMatch(record.p, p))
+    {
+        ReplayDiverged("point contents %d was at (%.9g %.9g %.9g), but was recorded at (%.9g %.9g %.9g)",
+            callNumber, p[0], p[1], p[2], record.p.x, record.p.y, record.p.z);
+    }
+
+    if (truecontents != nullptr)
+    {
+        *truecontents = record.truecontents;
+    }
+
+    return record.contents;
+}
+
+
+static void ReplayStuckTouch(int hitent, pmtrace_t* ptraceresult)
+{
+    const int callNumber = static_cast<int>(g_CurrentCall);
+    const byte* data = ReplayNextCall(PM_RECORD_STUCK_TOUCH, "stuck touch");
+
+    if (data == nullptr)
+    {
+        return;
+    }
+
+    pm_record_stuck_touch_t record;
+    memcpy(&record, data, sizeof(record));
+
+    if (record.hitent != hitent
+     || record.numtouchbefore != g_ReplayMove.numtouch
+     || memcmp(&record.trace, ptraceresult, sizeof(pmtrace_t)) != 0)
+    {
+        ReplayDiverged("stuck touch %d was against entity %d, but was recorded against entity %d", callNumber, hitent, record.hitent);
+        return;
+    }
+
+    /* Whatever the engine added to the touched entities */
+    memcpy(
+        g_ReplayMove.touchindex + record.numtouchbefore,
+        data + sizeof(record),
+        (record.numtouch - record.numtouchbefore) * sizeof(pmtrace_t));
+
+    g_ReplayMove.numtouch = record.numtouch;
+}
+
+
+static void ReplayPrintf(const char* fmt, ...)
+{
+}
+
+
+static int ReplayFileSize(const char* filename)
+{
+    return -1;
+}
+
+
+static byte* ReplayLoadFile(const char* path, int usehunk, int* pLength)
+{
+    return nullptr;
+}
+
+
+static void ReplayFreeFile(void* buffer)
+{
+}
+
+
+static void ReplayInit()
+{
+    memset(&g_ReplayMove, 0, sizeof(g_ReplayMove));
+
+    g_ReplayMove.PM_PlayerTraceEx = ReplayPlayerTraceEx;
+    g_ReplayMove.PM_TestPlayerPositionEx = ReplayTestPlayerPositionEx;
+    g_ReplayMove.PM_PointContents = ReplayPointContents;
+    g_ReplayMove.PM_StuckTouch = ReplayStuckTouch;
+    g_ReplayMove.Con_DPrintf = ReplayPrintf;
+    g_ReplayMove.Con_Printf = ReplayPrintf;
+    g_ReplayMove.COM_FileSize = ReplayFileSize;
+    g_ReplayMove.COM_LoadFile = ReplayLoadFile;
+    g_ReplayMove.COM_FreeFile = ReplayFreeFile;
+
+    /* For the stuck offsets; there's no materials.txt, and the recorded moves bring their own hull sizes */
+    PM_Init(&g_ReplayMove);
+}
+
+
+/* Read the next part of a record, failing if the recording ends first */
+class ReplayReader
+{
+public:
+    ReplayReader(const std::vector<byte>& data) : m_data{data}, m_offset{0} {}
+
+    bool AtEnd() const { return m_offset >= m_data.size(); }
+    std::size_t Offset() const { return m_offset; }
+
+    const byte* Take(std::size_t size)
+    {
+        if (m_data.size() - m_offset < size)
+        {
+            m_offset = m_data.size();
+            return nullptr;
+        }
+        const byte* data = m_data.data() + m_offset;
+        m_offset += size;
+        return data;
+    }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        const byte* data = Take(sizeof(T));
+        if (data == nullptr)
+        {
+            return false;
+        }
+        memcpy(&value, data, sizeof(T));
+        return true;
+    }
+
+    /* Apply the runs of bytes written for a state to the reference, which then becomes that state */
+    bool ReadState(byte* reference)
+    {
+        while (true)
+        {
+            unsigned short run[2];
+            if (!Read(run))
+            {
+                return false;
+            }
+
+            if (run[1] == 0)
+            {
+                return true;
+            }
+
+            const byte* data = run[0] + run[1] <= kPMRecordStateSize ? Take(run[1]) : nullptr;
+            if (data == nullptr)
+            {
+                return false;
+            }
+
+            memcpy(reference + run[0], data, run[1]);
+        }
+    }
+
+private:
+    const std::vector<byte>& m_data;
+    std::size_t m_offset;
+};
+
+
+static bool ReplayLoad(const char* filename, bool& server)
+{
+    FILE* file = fopen(filename, "rb");
+    if (file == nullptr)
+    {
+        printf("Couldn't open %s\n", filename);
+        return false;
+    }
+
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    g_Recording.resize(size > 0 ? size : 0);
+    const bool read = fread(g_Recording.data(), 1, g_Recording.size(), file) == g_Recording.size();
+    fclose(file);
+
+    if (!read)
+    {
+        printf("Couldn't read %s\n", filename);
+        return false;
+    }
+
+    ReplayReader reader{g_Recording};
+
+    pm_record_header_t header;
+    if (!reader.Read(header)
+     || memcmp(header.id, kPMRecordId, sizeof(header.id)) != 0)
+    {
+        printf("%s is not a player movement recording\n", filename);
+        return false;
+    }
+
+    if (header.version != kPMRecordVersion
+     || header.stateSize != static_cast<int>(kPMRecordStateSize)
+     || header.cmdSize != static_cast<int>(sizeof(usercmd_t))
+     || header.traceSize != static_cast<int>(sizeof(pmtrace_t))
+     || header.movevarsSize != static_cast<int>(sizeof(movevars_t)))
+    {
+        printf("%s was recorded by an incompatible build (version %d, state %d bytes, command %d bytes, trace %d bytes, movevars %d bytes)\n",
+            filename, header.version, header.stateSize, header.cmdSize, header.traceSize, header.movevarsSize);
+        return false;
+    }
+
+    server = header.server != 0;
+
+    /* Each player's last state, which the next is written against */
+    static byte states[MAX_PLAYERS][kPMRecordStateSize];
+
+    while (!reader.AtEnd())
+    {
+        ReplayMove move;
+        move.offset = reader.Offset();
+
+        byte type;
+        if (!reader.Read(type))
+        {
+            break;
+        }
+
+        if (type == PM_RECORD_MOVEVARS)
+        {
+            ReplayMovevars movevars;
+            if (!reader.Read(movevars.movevars)
+             || !reader.Read(movevars.player_mins)
+             || !reader.Read(movevars.player_maxs))
+            {
+                printf("Movement variables at offset %d are incomplete; ignoring the rest of the recording\n", static_cast<int>(move.offset));
+                break;
+            }
+
+            g_Movevars.push_back(movevars);
+            continue;
+        }
+
+        if (type != PM_RECORD_MOVE || g_Movevars.empty())
+        {
+            printf("Bad record at offset %d; ignoring the rest of the recording\n", static_cast<int>(move.offset));
+            break;
+        }
+
+        move.movevars = &g_Movevars.back();
+
+        byte slot;
+        bool complete = reader.Read(slot)
+            && slot < MAX_PLAYERS
+            && reader.ReadState(states[slot])
+            && reader.Read(move.cmd)
+            && reader.Read(move.stuckIndex);
+
+        if (complete)
+        {
+            memcpy(move.input, states[slot], kPMRecordStateSize);
+        }
+
+        while (complete)
+        {
+            if (!reader.Read(type))
+            {
+                complete = false;
+                break;
+            }
+
+            if (type == PM_RECORD_END)
+            {
+                break;
+            }
+
+            ReplayCall call;
+            call.type = type;
+
+            switch (type)
+            {
+            case PM_RECORD_TRACE:
+                call.data = reader.Take(sizeof(pm_record_trace_t));
+                break;
+            case PM_RECORD_TEST_POSITION:
+                call.data = reader.Take(sizeof(pm_record_test_position_t));
+                break;
+            case PM_RECORD_POINT_CONTENTS:
+                call.data = reader.Take(sizeof(pm_record_point_contents_t));
+                break;
+            case PM_RECORD_STUCK_TOUCH:
+            {
+                pm_record_stuck_touch_t record;
+                call.data = reader.Take(sizeof(record));
+                if (call.data != nullptr)
+                {
+                    memcpy(&record, call.data, sizeof(record));
+                    if (record.numtouchbefore < 0
+                     || record.numtouch < record.numtouchbefore
+                     || record.numtouch > MAX_PHYSENTS
+                     || reader.Take((record.numtouch - record.numtouchbefore) * sizeof(pmtrace_t)) == nullptr)
+                    {
+                        call.data = nullptr;
+                    }
+                }
+                break;
+            }
+            default:
+                call.data = nullptr;
+                break;
+            }
+
+            if (call.data == nullptr)
+            {
+                complete = false;
+                break;
+            }
+
+            move.calls.push_back(call);
+        }
+
+        complete = complete
+            && reader.ReadState(states[slot])
+            && reader.Read(move.numtouch)
+            && move.numtouch >= 0 && move.numtouch <= MAX_PHYSENTS
+            && (move.touchindex = reader.Take(move.numtouch * sizeof(pmtrace_t))) != nullptr
+            && reader.Read(move.stuckIndexAfter);
+
+        if (!complete)
+        {
+            printf("Move at offset %d is incomplete; ignoring the rest of the recording\n", static_cast<int>(move.offset));
+            break;
+        }
+
+        memcpy(move.output, states[slot], kPMRecordStateSize);
+
+        g_Moves.push_back(std::move(move));
+    }
+
+    return true;
+}
+
+
+static void ReplayRun(const ReplayMove& move, CHalfLifeMovement& movement)
+{
+    g_CurrentMove = &move;
+    g_CurrentCall = 0;
+
+    memcpy(&g_ReplayMove, move.input, kPMRecordStateSize);
+    g_ReplayMove.cmd = move.cmd;
+    g_ReplayMove.movevars = const_cast<movevars_t*>(&move.movevars->movevars);
+    memcpy(g_ReplayMove.player_mins, move.movevars->player_mins, sizeof(g_ReplayMove.player_mins));
+    memcpy(g_ReplayMove.player_maxs, move.movevars->player_maxs, sizeof(g_ReplayMove.player_maxs));
+    PM_SetStuckOffsetIndex(g_ReplayMove.player_index, move.stuckIndex);
+
+    movement.Move();
+}
+
+
+/* Return whether the move finished where it was recorded as finishing, noting what differs if not */
+static bool ReplayCheck(const ReplayMove& move)
+{
+    if (g_CurrentCall != move.calls.size())
+    {
+        ReplayDiverged("made %d of the %d recorded calls", static_cast<int>(g_CurrentCall), static_cast<int>(move.calls.size()));
+    }
+
+    if (memcmp(&g_ReplayMove, move.output, kPMRecordStateSize) != 0)
+    {
+        std::string fields;
+
+        for (const auto& field : g_ReplayFields)
+        {
+            if (memcmp(reinterpret_cast<const byte*>(&g_ReplayMove) + field.offset, move.output + field.offset, field.size) != 0)
+            {
+                fields += fields.empty() ? "" : ", ";
+                fields += field.name;
+            }
+        }
+
+        if (fields.empty())
+        {
+            std::size_t offset = 0;
+            while (reinterpret_cast<const byte*>(&g_ReplayMove)[offset] == move.output[offset])
+            {
+                offset++;
+            }
+            fields = "byte " + std::to_string(offset);
+        }
+
+        ReplayDiverged("player state differs (%s)", fields.c_str());
+    }
+
+    if (g_ReplayMove.numtouch != move.numtouch)
+    {
+        ReplayDiverged("touched %d entities instead of %d", g_ReplayMove.numtouch, move.numtouch);
+    }
+    else if (memcmp(g_ReplayMove.touchindex, move.touchindex, move.numtouch * sizeof(pmtrace_t)) != 0)
+    {
+        ReplayDiverged("touched entities differ");
+    }
+
+    if (PM_GetStuckOffsetIndex(g_ReplayMove.player_index) != move.stuckIndexAfter)
+    {
+        ReplayDiverged("stuck offset is %d instead of %d", PM_GetStuckOffsetIndex(g_ReplayMove.player_index), move.stuckIndexAfter);
+    }
+
+    return g_Divergence.empty();
+}
+
+
+static void PrintUsage()
+{
+    printf("usage: pm_replay <recording> [passes [divergences]]\n");
+    printf("  replays each recorded move against the recorded trace results and checks that it\n");
+    printf("  finishes bit for bit where it was recorded, then times 'passes' runs (default 100)\n");
+    printf("  over all of the moves; up to 'divergences' (default 10) differing moves are listed\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* filename = argv[1];
+    const int passes = argc > 2 ? atoi(argv[2]) : 100;
+    const int maxReported = argc > 3 ? atoi(argv[3]) : 10;
+
+    bool server;
+    if (!ReplayLoad(filename, server))
+    {
+        return 1;
+    }
+
+    printf("%s: %d moves recorded by the %s\n", filename, static_cast<int>(g_Moves.size()), server ? "server" : "client");
+
+    if (g_Moves.empty())
+    {
+        return 0;
+    }
+
+    ReplayInit();
+
+    CHalfLifeMovement movement{&g_ReplayMove, nullptr};
+
+    /* Check every move */
+    int diverged = 0;
+    std::size_t calls = 0;
+
+    for (std::size_t i = 0; i < g_Moves.size(); i++)
+    {
+        const ReplayMove& move = g_Moves[i];
+
+        g_Divergence.clear();
+        ReplayRun(move, movement);
+        calls += move.calls.size();
+
+        if (!ReplayCheck(move))
+        {
+            if (diverged < maxReported)
+            {
+                printf("  move %d (player %d, offset %d): %s\n",
+                    static_cast<int>(i),
+                    g_ReplayMove.player_index,
+                    static_cast<int>(move.offset),
+                    g_Divergence.c_str());
+            }
+            diverged++;
+        }
+    }
+
+    if (diverged != 0)
+    {
+        printf("%d of %d moves diverged from the recording\n", diverged, static_cast<int>(g_Moves.size()));
+    }
+    else
+    {
+        printf("All moves matched the recording bit for bit (%.1f engine calls per move)\n",
+            static_cast<double>(calls) / g_Moves.size());
+    }
+
+    /* Time the movement code on its own; the engine's answers come from memory */
+    using Clock = std::chrono::steady_clock;
+
+    double best = 0.0;
+    double total = 0.0;
+
+    /* Already checked, so don't spend any time describing divergences */
+    g_Divergence = "timing";
+
+    for (int pass = 0; pass < passes; pass++)
+    {
+        const auto start = Clock::now();
+
+        for (const auto& move : g_Moves)
+        {
+            ReplayRun(move, movement);
+        }
+
+        const double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+        total += elapsed;
+        if (pass == 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+
+    if (passes > 0)
+    {
+        printf("%d passes: %.1f ns per move (best pass %.1f ns per move)\n",
+            passes,
+            total / (static_cast<double>(passes) * g_Moves.size()),
+            best / g_Moves.size());
+    }
+
+    return diverged != 0 ? 2 : 0;
+}
@@ -268,6 +268,26 @@ void PM_ResetStuckOffsets(int nIndex)
 }
 
 
+/*
+=================
+PM_GetStuckOffsetIndex
+
+The stuck offset a player will try next, which is
+saved and restored when moves are recorded and replayed
+=================
+*/
+int PM_GetStuckOffsetIndex(int nIndex)
+{
+	return rgStuckLast[nIndex];
+}
+
+
+void PM_SetStuckOffsetIndex(int nIndex, int idx)
+{
+	rgStuckLast[nIndex] = idx;
+}
+
+
 /*
 =================
 PM_TryToUnstuck
@@ -28,6 +28,8 @@ void PM_Init(playermove_s* ppmove);
 void PM_Move(playermove_s* ppmove, qboolean server);
 #endif
 char PM_FindTextureType(const char* name);
+int PM_GetStuckOffsetIndex(int nIndex);
+void PM_SetStuckOffsetIndex(int nIndex, int idx);
 
 /**
 *	@brief Engine calls this to enumerate player collision hulls, for prediction. Return false if the hullnumber doesn't exist.